@@ -123,6 +123,10 @@
 /** Use the LAPACKE library for dense linear algebra */
 //#define MORPHO_LINALG_USE_LAPACKE
 
+/** Use morpho's own cache-blocked, multithreaded kernel for dense matrix multiplication in place of
+    cblas_dgemm; CMake defines this when MORPHO_NATIVEGEMM is set or no BLAS library is found */
+//#define MORPHO_LINALG_USE_NATIVEGEMM
+
 /** Use CSparse for sparse matrix */
 #define MORPHO_LINALG_USE_CSPARSE
 
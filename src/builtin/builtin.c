@@ -16,6 +16,13 @@
 #include "selection.h"
 #include "functional.h"
 #include "field.h"
+#include "delaunay.h"
+#include "levelset.h"
+#include "meshgen.h"
+#include "vtkio.h"
+#include "matrixio.h"
+#include "matrixbatch.h"
+#include "factorization.h"
 
 /* **********************************************************************
  * Global data
@@ -348,12 +355,19 @@ void builtin_initialize(void) {
     // Initialize linear algebra
     matrix_initialize();
     sparse_initialize();
+    matrixio_initialize();
+    matrixbatch_initialize();
+    factorization_initialize();
     
     // Initialize geometry
     mesh_initialize();
     selection_initialize();
     field_initialize();
     functional_initialize();
+    delaunay_initialize();
+    levelset_initialize();
+    meshgen_initialize();
+    vtkio_initialize();
     
     morpho_addfinalizefn(builtin_finalize);
 }
@@ -0,0 +1,514 @@
+/** @file delaunay.c
+ *  @author T J Atherton
+ *
+ *  @brief Delaunay triangulation of point sets in two and three dimensions
+ */
+
+#include <string.h>
+
+#include "morpho.h"
+#include "classes.h"
+#include "delaunay.h"
+#include "meshreorder.h"
+#include "predicates.h"
+
+/* **********************************************************************
+ * Triangulation data structure
+ * ********************************************************************** */
+
+/** Marks a simplex that has been removed */
+#define DELAUNAY_DEAD -2
+
+/** A triangulation of the points inserted so far. Simplex s has vertices vert[s*nv ... s*nv+dim] and the neighbor
+    across the facet opposite vertex i is nbr[s*nv+i]. Simplices are positively oriented; for ghost simplices, this
+    means that replacing the vertex at infinity with a point beyond the hull facet gives a positive simplex. */
+typedef struct {
+    int dim;
+    int nv; // Number of vertices per simplex
+    double *x;
+    varray_int vert;
+    varray_int nbr;
+    varray_int mark; // Stamp of the last insertion whose cavity contained each simplex
+    varray_int free; // Removed simplices available for reuse
+    int last; // A simplex next to the most recently inserted point
+    int stamp;
+
+    varray_int cavity; // Workspace for insertion
+    varray_int boundary;
+    varray_int newverts;
+    struct delaunayridge *ridges;
+    int nridges;
+} delaunay;
+
+static void delaunay_init(delaunay *t, int dim, double *x) {
+    t->dim=dim;
+    t->nv=dim+1;
+    t->x=x;
+    t->last=0;
+    t->stamp=0;
+    varray_intinit(&t->vert);
+    varray_intinit(&t->nbr);
+    varray_intinit(&t->mark);
+    varray_intinit(&t->free);
+    varray_intinit(&t->cavity);
+    varray_intinit(&t->boundary);
+    varray_intinit(&t->newverts);
+    t->ridges=NULL;
+    t->nridges=0;
+}
+
+static void delaunay_clear(delaunay *t) {
+    varray_intclear(&t->vert);
+    varray_intclear(&t->nbr);
+    varray_intclear(&t->mark);
+    varray_intclear(&t->free);
+    varray_intclear(&t->cavity);
+    varray_intclear(&t->boundary);
+    varray_intclear(&t->newverts);
+    if (t->ridges) MORPHO_FREE(t->ridges);
+}
+
+static inline double *delaunay_point(delaunay *t, int id) {
+    return t->x+((size_t) id)*t->dim;
+}
+
+static inline int *delaunay_vertices(delaunay *t, int s) {
+    return t->vert.data+((size_t) s)*t->nv;
+}
+
+static inline int *delaunay_neighbors(delaunay *t, int s) {
+    return t->nbr.data+((size_t) s)*t->nv;
+}
+
+/** Returns the position of the vertex at infinity in a simplex, or -1 if it is finite */
+static int delaunay_infiniteposition(delaunay *t, int s) {
+    int *v=delaunay_vertices(t, s);
+    for (int i=0; i<t->nv; i++) if (v[i]==DELAUNAY_INFINITE) return i;
+    return -1;
+}
+
+/** Creates a simplex, reusing a removed one if possible
+ * @returns the simplex id, or -1 if allocation failed */
+static int delaunay_newsimplex(delaunay *t, int *v) {
+    int s;
+    if (t->free.count>0) {
+        s=t->free.data[--t->free.count];
+    } else {
+        s=t->mark.count;
+        int empty[t->nv];
+        for (int i=0; i<t->nv; i++) empty[i]=-1;
+        if (!varray_intadd(&t->vert, empty, t->nv) ||
+            !varray_intadd(&t->nbr, empty, t->nv) ||
+            !varray_intadd(&t->mark, empty, 1)) return -1;
+    }
+    memcpy(delaunay_vertices(t, s), v, sizeof(int)*t->nv);
+    t->mark.data[s]=-1;
+    return s;
+}
+
+static bool delaunay_removesimplex(delaunay *t, int s) {
+    delaunay_vertices(t, s)[0]=DELAUNAY_DEAD;
+    return varray_intadd(&t->free, &s, 1);
+}
+
+/* **********************************************************************
+ * Predicates
+ * ********************************************************************** */
+
+/** Orientation of the simplex s with vertex i replaced by the point p; all other vertices must be finite */
+static int delaunay_orient(delaunay *t, int s, int i, double *p) {
+    int *v=delaunay_vertices(t, s);
+    double *x[4];
+    for (int k=0; k<t->nv; k++) x[k]=(k==i ? p : delaunay_point(t, v[k]));
+
+    if (t->dim==2) return predicates_orient2d(x[0], x[1], x[2]);
+    return predicates_orient3d(x[0], x[1], x[2], x[3]);
+}
+
+/** Tests whether p lies strictly inside the circumsphere of a finite simplex */
+static bool delaunay_insphere(delaunay *t, int s, double *p) {
+    int *v=delaunay_vertices(t, s);
+    double *x[4];
+    for (int k=0; k<t->nv; k++) x[k]=delaunay_point(t, v[k]);
+
+    if (t->dim==2) return predicates_incircle(x[0], x[1], x[2], p)>0;
+    return predicates_insphere(x[0], x[1], x[2], x[3], p)>0;
+}
+
+/** Tests whether the point p conflicts with simplex s, i.e. whether s must be removed when p is inserted.
+    A ghost simplex conflicts with points strictly beyond its hull facet, or with points in the plane of the facet
+    that lie inside its circumcircle; these are exactly the points inside the circumsphere of the finite simplex
+    on the other side of the facet. */
+static bool delaunay_conflict(delaunay *t, int s, double *p) {
+    int j=delaunay_infiniteposition(t, s);
+    if (j<0) return delaunay_insphere(t, s, p);
+
+    int o=delaunay_orient(t, s, j, p);
+    if (o!=0) return o>0;
+    return delaunay_insphere(t, delaunay_neighbors(t, s)[j], p);
+}
+
+/* **********************************************************************
+ * Point location
+ * ********************************************************************** */
+
+/** Locates the simplex containing p by a visibility walk from the last simplex created. Returns either a finite
+    simplex that contains p, or a ghost simplex whose hull facet p lies strictly beyond. */
+static int delaunay_locate(delaunay *t, double *p) {
+    int s=t->last;
+    int j=delaunay_infiniteposition(t, s);
+    if (j>=0) s=delaunay_neighbors(t, s)[j];
+
+    for (unsigned int step=0; ; step++) {
+        int next=-1;
+        for (int k=0; k<t->nv; k++) {
+            int i=(k+step) % t->nv; // Vary the facet tested first so the walk doesn't favor a direction
+            if (delaunay_orient(t, s, i, p)<0) { next=delaunay_neighbors(t, s)[i]; break; }
+        }
+        if (next<0) return s;
+
+        s=next;
+        if (delaunay_infiniteposition(t, s)>=0) return s;
+    }
+}
+
+/* **********************************************************************
+ * Insertion
+ * ********************************************************************** */
+
+typedef struct delaunayridge {
+    int v[2]; // Sorted vertices of a ridge, padded with DELAUNAY_INFINITE in 2D
+    int s, i; // Simplex and the position of the vertex opposite the facet through the ridge and the new point
+} delaunayridge;
+
+static int delaunay_cmpridge(const void *a, const void *b) {
+    const delaunayridge *x=a, *y=b;
+    if (x->v[0]!=y->v[0]) return (x->v[0]<y->v[0] ? -1 : 1);
+    return (x->v[1]<y->v[1] ? -1 : (x->v[1]>y->v[1] ? 1 : 0));
+}
+
+static bool delaunay_samepoint(delaunay *t, double *a, double *b) {
+    for (int k=0; k<t->dim; k++) if (a[k]!=b[k]) return false;
+    return true;
+}
+
+/** Tests whether p coincides with a vertex of the simplex s */
+static bool delaunay_isduplicate(delaunay *t, int s, double *p) {
+    int *v=delaunay_vertices(t, s);
+    for (int k=0; k<t->nv; k++) {
+        if (v[k]!=DELAUNAY_INFINITE && delaunay_samepoint(t, delaunay_point(t, v[k]), p)) return true;
+    }
+    return false;
+}
+
+/** Inserts point id into the triangulation */
+static bool delaunay_insert(delaunay *t, int id) {
+    double *p=delaunay_point(t, id);
+    int start=delaunay_locate(t, p);
+    if (delaunay_infiniteposition(t, start)<0 && delaunay_isduplicate(t, start, p)) return true;
+
+    /* Find the cavity of simplices in conflict with p, recording the facets on its boundary */
+    int stamp=++t->stamp;
+    t->cavity.count=0;
+    t->boundary.count=0;
+    t->mark.data[start]=stamp;
+    if (!varray_intadd(&t->cavity, &start, 1)) return false;
+
+    for (unsigned int c=0; c<t->cavity.count; c++) {
+        int s=t->cavity.data[c];
+        for (int i=0; i<t->nv; i++) {
+            int nb=delaunay_neighbors(t, s)[i];
+            if (t->mark.data[nb]==stamp) continue;
+            if (delaunay_conflict(t, nb, p)) {
+                t->mark.data[nb]=stamp;
+                if (!varray_intadd(&t->cavity, &nb, 1)) return false;
+            } else { // Record the facet with the neighbor outside and the position of s among its neighbors
+                int *nbnbr=delaunay_neighbors(t, nb), j=0;
+                while (j<t->nv && nbnbr[j]!=s) j++;
+                int facet[4] = { s, i, nb, j };
+                if (!varray_intadd(&t->boundary, facet, 4)) return false;
+            }
+        }
+    }
+
+    /* Fill the cavity with simplices joining each boundary facet to p */
+    int nnew=t->boundary.count/4;
+    t->newverts.count=0;
+    if (!varray_intresize(&t->newverts, nnew*t->nv)) return false;
+    for (int k=0; k<nnew; k++) {
+        int s=t->boundary.data[4*k], i=t->boundary.data[4*k+1];
+        int *verts=t->newverts.data+k*t->nv;
+        memcpy(verts, delaunay_vertices(t, s), sizeof(int)*t->nv);
+        verts[i]=id;
+    }
+    for (unsigned int c=0; c<t->cavity.count; c++) if (!delaunay_removesimplex(t, t->cavity.data[c])) return false;
+
+    if (nnew*t->dim>t->nridges) {
+        delaunayridge *new=MORPHO_REALLOC(t->ridges, sizeof(delaunayridge)*2*nnew*t->dim);
+        if (!new) return false;
+        t->ridges=new;
+        t->nridges=2*nnew*t->dim;
+    }
+    delaunayridge *ridges=t->ridges;
+    int nridges=0;
+    for (int k=0; k<nnew; k++) {
+        int *verts=t->newverts.data+k*t->nv;
+        int i=t->boundary.data[4*k+1], nb=t->boundary.data[4*k+2];
+        int s=delaunay_newsimplex(t, verts); // May reuse a simplex from the cavity
+        if (s<0) return false;
+
+        /* Link to the simplex outside the cavity */
+        delaunay_neighbors(t, s)[i]=nb;
+        delaunay_neighbors(t, nb)[t->boundary.data[4*k+3]]=s;
+
+        /* Record the ridges shared with other new simplices */
+        for (int j=0; j<t->nv; j++) {
+            if (j==i) continue;
+            delaunayridge *r=&ridges[nridges++];
+            int n=0;
+            r->v[0]=r->v[1]=DELAUNAY_INFINITE;
+            for (int m=0; m<t->nv; m++) if (m!=i && m!=j) r->v[n++]=verts[m];
+            if (n==2 && r->v[0]>r->v[1]) { int tmp=r->v[0]; r->v[0]=r->v[1]; r->v[1]=tmp; }
+            r->s=s;
+            r->i=j;
+        }
+        t->last=s;
+    }
+
+    /* Each ridge is shared by exactly two new simplices */
+    qsort(ridges, nridges, sizeof(delaunayridge), delaunay_cmpridge);
+    for (int k=0; k+1<nridges; k+=2) {
+        delaunay_neighbors(t, ridges[k].s)[ridges[k].i]=ridges[k+1].s;
+        delaunay_neighbors(t, ridges[k+1].s)[ridges[k+1].i]=ridges[k].s;
+    }
+
+    return true;
+}
+
+/* **********************************************************************
+ * Initialization
+ * ********************************************************************** */
+
+/** Tests whether three points in 3D are collinear by checking their projections onto the coordinate planes */
+static bool delaunay_collinear3d(delaunay *t, int a, int b, int c) {
+    double *x[3] = { delaunay_point(t, a), delaunay_point(t, b), delaunay_point(t, c) };
+    for (int k=0; k<3; k++) {
+        double pa[2] = { x[0][k], x[0][(k+1)%3] }, pb[2] = { x[1][k], x[1][(k+1)%3] }, pc[2] = { x[2][k], x[2][(k+1)%3] };
+        if (predicates_orient2d(pa, pb, pc)!=0) return false;
+    }
+    return true;
+}
+
+/** Finds dim+1 affinely independent points, moving them to the start of the insertion order */
+static bool delaunay_findinitial(delaunay *t, int n, int *order) {
+    int found=1;
+    for (int k=1; k<n && found<t->nv; k++) {
+        int c=order[k];
+        bool independent;
+        if (found==1) independent=!delaunay_samepoint(t, delaunay_point(t, order[0]), delaunay_point(t, c));
+        else if (found==2) {
+            if (t->dim==2) independent=(predicates_orient2d(delaunay_point(t, order[0]), delaunay_point(t, order[1]), delaunay_point(t, c))!=0);
+            else independent=!delaunay_collinear3d(t, order[0], order[1], c);
+        } else independent=(predicates_orient3d(delaunay_point(t, order[0]), delaunay_point(t, order[1]), delaunay_point(t, order[2]), delaunay_point(t, c))!=0);
+
+        if (independent) { // Move the point forward, keeping the order of the others
+            memmove(order+found+1, order+found, sizeof(int)*(k-found));
+            order[found++]=c;
+        }
+    }
+    return found==t->nv;
+}
+
+/** Creates the first simplex from the points order[0...dim] together with its ghost simplices */
+static bool delaunay_start(delaunay *t, int *order) {
+    int v[4], nsimplex=t->nv+1;
+    memcpy(v, order, sizeof(int)*t->nv);
+
+    if (delaunay_newsimplex(t, v)<0) return false;
+    if (delaunay_orient(t, 0, -1, NULL)<0) {
+        int tmp=v[0]; v[0]=v[1]; v[1]=tmp;
+        memcpy(delaunay_vertices(t, 0), v, sizeof(int)*t->nv);
+    }
+
+    /* Ghost simplex i replaces vertex i by infinity, with the orientation reversed */
+    for (int i=0; i<t->nv; i++) {
+        int g[4];
+        memcpy(g, v, sizeof(int)*t->nv);
+        g[i]=DELAUNAY_INFINITE;
+        int a=(i+1) % t->nv, b=(i+2) % t->nv, tmp=g[a];
+        g[a]=g[b]; g[b]=tmp;
+        if (delaunay_newsimplex(t, g)<0) return false;
+    }
+
+    /* Link the simplices that share facets */
+    for (int s=0; s<nsimplex; s++) {
+        for (int i=0; i<t->nv; i++) {
+            for (int r=0; r<nsimplex; r++) {
+                if (r==s) continue;
+                int shared=0;
+                for (int k=0; k<t->nv; k++) {
+                    if (k==i) continue;
+                    for (int m=0; m<t->nv; m++) if (delaunay_vertices(t, r)[m]==delaunay_vertices(t, s)[k]) { shared++; break; }
+                }
+                if (shared==t->dim) delaunay_neighbors(t, s)[i]=r;
+            }
+        }
+    }
+
+    t->last=0;
+    return true;
+}
+
+/* **********************************************************************
+ * Triangulation
+ * ********************************************************************** */
+
+/** Computes the Delaunay triangulation of a set of points
+ * @param[in] dim - dimension, 2 or 3
+ * @param[in] n - number of points
+ * @param[in] x - coordinates of the points, stored consecutively
+ * @param[out] simplices - vertex ids of each simplex, dim+1 per simplex in ascending order
+ * @returns DELAUNAY_OK on success */
+delaunaystatus delaunay_triangulate(int dim, int n, double *x, varray_elementid *simplices) {
+    delaunaystatus status=DELAUNAY_ALLOCATIONFAILED;
+    delaunay t;
+    delaunay_init(&t, dim, x);
+
+    int *order=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    if (!order || !meshreorder_hilbertorder(dim, n, x, order)) goto delaunay_triangulate_cleanup;
+
+    if (!delaunay_findinitial(&t, n, order)) {
+        status=DELAUNAY_DEGENERATEPOINTS;
+        goto delaunay_triangulate_cleanup;
+    }
+    if (!delaunay_start(&t, order)) goto delaunay_triangulate_cleanup;
+
+    for (int k=t.nv; k<n; k++) if (!delaunay_insert(&t, order[k])) goto delaunay_triangulate_cleanup;
+
+    /* Extract the finite simplices */
+    for (unsigned int s=0; s<t.mark.count; s++) {
+        int *v=delaunay_vertices(&t, s);
+        if (v[0]==DELAUNAY_DEAD || delaunay_infiniteposition(&t, s)>=0) continue;
+        elementid el[4];
+        for (int k=0; k<t.nv; k++) el[k]=v[k];
+        mesh_sorttuple(t.nv, el);
+        if (!varray_elementidadd(simplices, el, t.nv)) goto delaunay_triangulate_cleanup;
+    }
+    status=DELAUNAY_OK;
+
+delaunay_triangulate_cleanup:
+    if (order) MORPHO_FREE(order);
+    delaunay_clear(&t);
+    return status;
+}
+
+/* **********************************************************************
+ * DelaunayMesh
+ * ********************************************************************** */
+
+static value delaunay_outputdimoption;
+
+/** Copies the coordinates of a List of points, or of the columns of a Matrix */
+static bool delaunay_points(value pts, int *dim, int *n, double **x) {
+    if (MORPHO_ISMATRIX(pts)) {
+        objectmatrix *m=MORPHO_GETMATRIX(pts);
+        *dim=m->nrows;
+        *n=m->ncols;
+        if (*dim<2 || *dim>3) return false;
+        *x=MORPHO_MALLOC(sizeof(double)*(*dim)*(*n>0 ? *n : 1));
+        if (*x) memcpy(*x, m->elements, sizeof(double)*(*dim)*(*n));
+        return (*x!=NULL);
+    }
+
+    if (!MORPHO_ISLIST(pts)) return false;
+    objectlist *list=MORPHO_GETLIST(pts);
+    *n=list->val.count;
+    if (*n==0 || !MORPHO_ISMATRIX(list->val.data[0])) return false;
+    *dim=matrix_countdof(MORPHO_GETMATRIX(list->val.data[0]));
+    if (*dim<2 || *dim>3) return false;
+
+    *x=MORPHO_MALLOC(sizeof(double)*(*dim)*(*n));
+    if (!*x) return false;
+    for (int i=0; i<*n; i++) {
+        value p=list->val.data[i];
+        if (!MORPHO_ISMATRIX(p) || matrix_countdof(MORPHO_GETMATRIX(p))!=*dim) {
+            MORPHO_FREE(*x);
+            *x=NULL;
+            return false;
+        }
+        memcpy(*x+i*(*dim), MORPHO_GETMATRIX(p)->elements, sizeof(double)*(*dim));
+    }
+    return true;
+}
+
+/** Creates a Mesh from the Delaunay triangulation of a set of points */
+value delaunay_mesh(vm *v, int nargs, value *args) {
+    value outputdim=MORPHO_INTEGER(3);
+    value out=MORPHO_NIL;
+    int nfixed=nargs;
+
+    if (!builtin_options(v, nargs, args, &nfixed, 1, delaunay_outputdimoption, &outputdim)) return MORPHO_NIL;
+
+    int dim=0, n=0, odim=0;
+    double *x=NULL;
+    if (nfixed!=1 || !MORPHO_ISINTEGER(outputdim) ||
+        !delaunay_points(MORPHO_GETARG(args, 0), &dim, &n, &x) ||
+        (odim=MORPHO_GETINTEGERVALUE(outputdim))<dim) {
+        if (x) MORPHO_FREE(x);
+        morpho_runtimeerror(v, DELAUNAY_ARGS);
+        return MORPHO_NIL;
+    }
+
+    varray_elementid simplices;
+    varray_elementidinit(&simplices);
+    delaunaystatus status=delaunay_triangulate(dim, n, x, &simplices);
+
+    objectmesh *new=NULL;
+    objectsparse *conn=NULL;
+    double *vert=NULL;
+    if (status==DELAUNAY_OK) {
+        int nel=simplices.count/(dim+1);
+        vert=MORPHO_MALLOC(sizeof(double)*odim*(n>0 ? n : 1));
+        if (vert) {
+            for (int i=0; i<n; i++) {
+                for (int k=0; k<odim; k++) vert[i*odim+k]=(k<dim ? x[i*dim+k] : 0.0);
+            }
+            new=object_newmesh(odim, n, vert);
+        }
+        conn=object_newsparse(NULL, NULL);
+        if (new && new->vert && conn && sparseccs_resize(&conn->ccs, n, nel, nel*(dim+1), false)) {
+            memcpy(conn->ccs.rix, simplices.data, sizeof(elementid)*simplices.count);
+            for (int i=0; i<=nel; i++) conn->ccs.cptr[i]=i*(dim+1);
+            mesh_setconnectivityelement(new, 0, dim, conn);
+            mesh_freezeconnectivity(new);
+            conn=NULL;
+            out=MORPHO_OBJECT(new);
+            morpho_bindobjects(v, 1, &out);
+        } else status=DELAUNAY_ALLOCATIONFAILED;
+    }
+
+    if (status==DELAUNAY_DEGENERATEPOINTS) morpho_runtimeerror(v, DELAUNAY_DEGENERATE, dim+1, (dim==2 ? "line" : "plane"));
+    else if (status!=DELAUNAY_OK) {
+        if (new) object_free((object *) new);
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    }
+
+    if (conn) object_free((object *) conn);
+    if (vert) MORPHO_FREE(vert);
+    if (x) MORPHO_FREE(x);
+    varray_elementidclear(&simplices);
+    return out;
+}
+
+/* **********************************************************************
+ * Initialization
+ * ********************************************************************** */
+
+void delaunay_initialize(void) {
+    builtin_addfunction(DELAUNAY_MESHFUNCTION, delaunay_mesh, BUILTIN_FLAGSEMPTY);
+
+    delaunay_outputdimoption=builtin_internsymbolascstring(DELAUNAY_OUTPUTDIMOPTION);
+
+    morpho_defineerror(DELAUNAY_ARGS, ERROR_HALT, DELAUNAY_ARGS_MSG);
+    morpho_defineerror(DELAUNAY_DEGENERATE, ERROR_HALT, DELAUNAY_DEGENERATE_MSG);
+}
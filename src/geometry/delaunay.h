@@ -0,0 +1,55 @@
+/** @file delaunay.h
+ *  @author T J Atherton
+ *
+ *  @brief Delaunay triangulation of point sets in two and three dimensions
+ */
+
+#ifndef delaunay_h
+#define delaunay_h
+
+#include "mesh.h"
+
+/* -------------------------------------------------------
+ * Delaunay triangulation
+ * ------------------------------------------------------- */
+
+/** Points are inserted one at a time by the Bowyer-Watson algorithm: the simplex containing a new point is found
+    by walking through the triangulation from the previous insertion, every simplex whose circumsphere contains the
+    point is removed, and the resulting cavity is filled with simplices that connect its boundary to the point.
+    Points are inserted in the order they lie along a Hilbert curve, so that successive points are close and walks
+    are short. The triangulation is closed by "ghost" simplices that join each facet of the convex hull to a vertex
+    at infinity, so points outside the current hull need no special treatment. All decisions are made with robust
+    predicates, so cocircular and cospherical points, such as those on a regular grid, are handled consistently.
+    Points that duplicate an earlier point are left unconnected. */
+
+#define DELAUNAY_MESHFUNCTION "DelaunayMesh"
+#define DELAUNAY_OUTPUTDIMOPTION "outputdim"
+
+/** The vertex at infinity */
+#define DELAUNAY_INFINITE -1
+
+/* -------------------------------------------------------
+ * Errors
+ * ------------------------------------------------------- */
+
+#define DELAUNAY_ARGS                        "DlnyArgs"
+#define DELAUNAY_ARGS_MSG                    "DelaunayMesh expects a List of points, or a Matrix whose columns are points, in two or three dimensions and optionally an output dimension no smaller than that of the points."
+
+#define DELAUNAY_DEGENERATE                  "DlnyDgnrt"
+#define DELAUNAY_DEGENERATE_MSG              "DelaunayMesh requires at least %i points that do not all lie on a %s."
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+typedef enum {
+    DELAUNAY_OK,
+    DELAUNAY_DEGENERATEPOINTS,
+    DELAUNAY_ALLOCATIONFAILED
+} delaunaystatus;
+
+delaunaystatus delaunay_triangulate(int dim, int n, double *x, varray_elementid *simplices);
+
+void delaunay_initialize(void);
+
+#endif /* delaunay_h */
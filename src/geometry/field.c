@@ -139,6 +139,7 @@ objectfield *object_newfield(objectmesh *mesh, value prototype, unsigned int *do
         new->data.ncols=1;
         new->data.nrows=size;
         new->data.elements=new->data.matrixdata;
+        new->data.parent=NULL;
         
         if (MORPHO_ISMATRIX(prototype)) {
             objectmatrix *mat = MORPHO_GETMATRIX(prototype);
@@ -228,6 +229,7 @@ bool field_addpool(objectfield *f) {
                 m[i].elements=f->data.elements+i*f->psize;
                 m[i].ncols=prototype->ncols;
                 m[i].nrows=prototype->nrows;
+                m[i].parent=NULL;
             }
         }
         return true;
@@ -401,6 +403,11 @@ bool field_accumulate(objectfield *left, double lambda, objectfield *right) {
     return (matrix_accumulate(&left->data, lambda, &right->data)==MATRIX_OK);
 }
 
+/** Linear combination, i.e. out <- alpha*a + beta*b */
+bool field_linearcombination(double alpha, objectfield *a, double beta, objectfield *b, objectfield *out) {
+    return (matrix_linearcombination(alpha, &a->data, beta, &b->data, &out->data)==MATRIX_OK);
+}
+
 bool field_inner(objectfield *left, objectfield *right, double *out) {
     return (matrix_inner(&left->data, &right->data, out)==MATRIX_OK);
 }
@@ -687,6 +694,27 @@ value Field_acc(vm *v, int nargs, value *args) {
     return MORPHO_NIL;
 }
 
+/** Overwrites a field with the linear combination alpha*a + beta*b */
+value Field_linearcombination(vm *v, int nargs, value *args) {
+    objectfield *f=MORPHO_GETFIELD(MORPHO_SELF(args));
+    double alpha, beta;
+    
+    if (nargs==4 &&
+        morpho_valuetofloat(MORPHO_GETARG(args, 0), &alpha) &&
+        MORPHO_ISFIELD(MORPHO_GETARG(args, 1)) &&
+        morpho_valuetofloat(MORPHO_GETARG(args, 2), &beta) &&
+        MORPHO_ISFIELD(MORPHO_GETARG(args, 3))) {
+        objectfield *a=MORPHO_GETFIELD(MORPHO_GETARG(args, 1));
+        objectfield *b=MORPHO_GETFIELD(MORPHO_GETARG(args, 3));
+        
+        if (field_compareshape(f, a) && field_compareshape(f, b)) {
+            field_linearcombination(alpha, a, beta, b, f);
+        } else morpho_runtimeerror(v, FIELD_INCOMPATIBLEMATRICES);
+    } else morpho_runtimeerror(v, FIELD_ARITHARGS);
+    
+    return MORPHO_NIL;
+}
+
 /** Field multiply by a scalar */
 value Field_mul(vm *v, int nargs, value *args) {
     objectfield *a=MORPHO_GETFIELD(MORPHO_SELF(args));
@@ -851,6 +879,7 @@ MORPHO_METHOD(MORPHO_ADDR_METHOD, Field_addr, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_SUB_METHOD, Field_sub, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_SUBR_METHOD, Field_subr, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_ACC_METHOD, Field_acc, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_LINEARCOMBINATION_METHOD, Field_linearcombination, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_MUL_METHOD, Field_mul, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_MULR_METHOD, Field_mul, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_DIV_METHOD, Field_div, BUILTIN_FLAGSEMPTY),
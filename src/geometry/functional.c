@@ -13,7 +13,9 @@
 
 #include "matrix.h"
 #include "sparse.h"
+#include "matrixbatch.h"
 #include "integrate.h"
+#include "meshadjacency.h"
 #include <math.h>
 
 #ifndef M_PI
@@ -343,20 +345,25 @@ bool functional_mapgradientX(vm *v, functional_mapinfo *info, value *out) {
     bool ret=false;
     int n=0;
 
+    /* Find any image elements so we can skip over them */
+    varray_elementid imageids;
+    varray_elementidinit(&imageids);
+    functional_symmetryimagelist(mesh, g, true, &imageids);
+
     /* How many elements? */
-    if (!functional_countelements(v, mesh, g, &n, &s)) return false;
+    if (!functional_countelements(v, mesh, g, &n, &s)) goto functional_mapgradient_cleanup;
 
     /* Create the output matrix */
     if (n>0) {
         frc=object_newmatrix(mesh->vert->nrows, mesh->vert->ncols, true);
-        if (!frc)  { morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED); return false; }
+        if (!frc)  { morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED); goto functional_mapgradient_cleanup; }
     }
 
     if (frc) {
         int vertexid; // Use this if looping over grade 0
         int *vid=(g==0 ? &vertexid : NULL),
             nv=(g==0 ? 1 : 0); // The vertex indices
-
+        int sindx=0; // Index into imageids array
 
         if (sel) { // Loop over selection
             if (sel->selected[g].count>0) for (unsigned int k=0; k<sel->selected[g].capacity; k++) {
@@ -366,12 +373,18 @@ bool functional_mapgradientX(vm *v, functional_mapinfo *info, value *out) {
                 if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
                 else vertexid=i;
 
+                // Skip this element if it's an image element
+                if ((imageids.count>0) && (sindx<imageids.count) && imageids.data[sindx]==i) { sindx++; continue; }
+
                 if (vid && nv>0) {
                     if (!(*grad) (v, mesh, i, nv, vid, ref, frc)) goto functional_mapgradient_cleanup;
                 }
             }
         } else { // Loop over elements
             for (elementid i=0; i<n; i++) {
+                // Skip this element if it's an image element
+                if ((imageids.count>0) && (sindx<imageids.count) && imageids.data[sindx]==i) { sindx++; continue; }
+
                 if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
                 else vertexid=i;
 
@@ -388,7 +401,8 @@ bool functional_mapgradientX(vm *v, functional_mapinfo *info, value *out) {
     }
 
 functional_mapgradient_cleanup:
-    if (!ret) object_free((object *) frc);
+    if (!ret && frc) object_free((object *) frc);
+    varray_elementidclear(&imageids);
 
     return ret;
 }
@@ -864,9 +878,6 @@ functional_mapnumericalhessian_cleanup:
  * Multithreaded map functions
  * ********************************************************************** */
 
-threadpool functional_pool;
-bool functional_poolinitialized;
-
 /** Gradient function */
 typedef bool (functional_mapfn) (vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, void *out);
 
@@ -978,17 +989,19 @@ bool functional_mapfn_elements(void *arg) {
     return true;
 }
 
-/** Dispatches tasks to threadpool */
+/** Dispatches tasks to the shared threadpool, or performs them in turn if it is unavailable */
 bool functional_parallelmap(int ntasks, functional_task *tasks) {
-    if (!functional_poolinitialized) {
-        functional_poolinitialized=threadpool_init(&functional_pool, morpho_threadnumber());
-        if (!functional_poolinitialized) return false;
+    threadpool *pool=threadpool_shared();
+    
+    if (!pool) {
+        for (int i=0; i<ntasks; i++) functional_mapfn_elements((void *) &tasks[i]);
+        return true;
     }
     
     for (int i=0; i<ntasks; i++) {
-       threadpool_add_task(&functional_pool, functional_mapfn_elements, (void *) &tasks[i]);
+       threadpool_add_task(pool, functional_mapfn_elements, (void *) &tasks[i]);
     }
-    threadpool_fence(&functional_pool);
+    threadpool_fence(pool);
     
     return true;
 }
@@ -2077,6 +2090,160 @@ MORPHO_METHOD(FUNCTIONAL_GRADIENT_METHOD, ScalarPotential_gradient, BUILTIN_FLAG
 MORPHO_METHOD(FUNCTIONAL_TOTAL_METHOD, ScalarPotential_total, BUILTIN_FLAGSEMPTY)
 MORPHO_ENDCLASS
 
+/* ----------------------------------------------
+ * Functional adapter
+ * ---------------------------------------------- */
+
+static value functionaladapter_functionalproperty;
+static value functionaladapter_integrandfnlabel;
+static value functionaladapter_gradientfnlabel;
+
+/** Reference passed to the adapter's integrand and gradient */
+typedef struct {
+    value self; // The wrapped functional object
+    value mesh; // The mesh, as passed to the method
+    value method; // The integrandfn or gradientfn method to call
+    bool noelement; // Pass nil rather than the element definition, as for vertices
+} functionaladapterref;
+
+/** Calls the method for an element. Vertex ids are passed as a Tuple bound to the VM, since the method may keep
+ *  it, and the vertex matrix is taken from the mesh provided so that perturbed clones are used when computing
+ *  numerical gradients. */
+static bool functionaladapter_call(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, functionaladapterref *ref, objectmatrix *frc, value *out) {
+    value el=MORPHO_NIL;
+    if (!ref->noelement) {
+        value ids[nv];
+        for (int i=0; i<nv; i++) ids[i]=MORPHO_INTEGER(vid[i]);
+        objecttuple *new=object_newtuple(nv, ids);
+        if (!new) {
+            morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+            return false;
+        }
+        el=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &el);
+    }
+
+    value args[5] = { ref->mesh, MORPHO_OBJECT(mesh->vert), MORPHO_INTEGER(id), el, (frc ? MORPHO_OBJECT(frc) : MORPHO_NIL) };
+
+    return morpho_invoke(v, ref->self, ref->method, (frc ? 5 : 4), args, out);
+}
+
+/** Evaluates the integrand through integrandfn */
+bool functionaladapter_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, double *out) {
+    value ret;
+    if (!functionaladapter_call(v, mesh, id, nv, vid, (functionaladapterref *) ref, NULL, &ret)) return false;
+    if (morpho_valuetofloat(ret, out)) return true;
+    morpho_runtimeerror(v, FUNCTIONALADAPTER_INTEGRAND);
+    return false;
+}
+
+/** Accumulates the gradient through gradientfn */
+bool functionaladapter_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, objectmatrix *frc) {
+    value ret;
+    return functionaladapter_call(v, mesh, id, nv, vid, (functionaladapterref *) ref, frc, &ret);
+}
+
+/** Prepares to map over the elements of the wrapped functional's grade */
+static bool functionaladapter_prepare(vm *v, int nargs, value *args, functional_mapinfo *info, functionaladapterref *ref) {
+    value functional=MORPHO_NIL, grade=MORPHO_NIL;
+
+    if (!functional_validateargs(v, nargs, args, info)) return false;
+
+    if (!objectinstance_getpropertyinterned(MORPHO_GETINSTANCE(MORPHO_SELF(args)), functionaladapter_functionalproperty, &functional) ||
+        !MORPHO_ISINSTANCE(functional) ||
+        !objectinstance_getpropertyinterned(MORPHO_GETINSTANCE(functional), functional_gradeproperty, &grade) ||
+        !MORPHO_ISINTEGER(grade)) {
+        morpho_runtimeerror(v, FUNCTIONALADAPTER_GRADE);
+        return false;
+    }
+
+    ref->self=functional;
+    ref->mesh=MORPHO_OBJECT(info->mesh);
+    ref->method=MORPHO_NIL;
+    ref->noelement=(MORPHO_GETINTEGERVALUE(grade)==MESH_GRADE_VERTEX);
+
+    info->g=MORPHO_GETINTEGERVALUE(grade);
+    info->ref=ref;
+    return true;
+}
+
+/** Looks up the integrandfn method, which subclasses must provide */
+static bool functionaladapter_integrandfn(vm *v, functional_mapinfo *info, functionaladapterref *ref) {
+    if (!morpho_lookupmethod(ref->self, functionaladapter_integrandfnlabel, &ref->method)) {
+        morpho_runtimeerror(v, FUNCTIONALADAPTER_METHOD, FUNCTIONALADAPTER_INTEGRANDFN_METHOD);
+        return false;
+    }
+    info->integrand=functionaladapter_integrand;
+    return true;
+}
+
+/** Initialize a functional adapter with the functional object to wrap */
+value FunctionalAdapter_init(vm *v, int nargs, value *args) {
+    if (nargs==1 && MORPHO_ISINSTANCE(MORPHO_GETARG(args, 0))) {
+        objectinstance_setproperty(MORPHO_GETINSTANCE(MORPHO_SELF(args)), functionaladapter_functionalproperty, MORPHO_GETARG(args, 0));
+    } else morpho_runtimeerror(v, FUNCTIONALADAPTER_ARGS);
+
+    return MORPHO_NIL;
+}
+
+/** Integrand function */
+value FunctionalAdapter_integrand(vm *v, int nargs, value *args) {
+    functional_mapinfo info;
+    functionaladapterref ref;
+    value out=MORPHO_NIL;
+
+    if (functionaladapter_prepare(v, nargs, args, &info, &ref) &&
+        functionaladapter_integrandfn(v, &info, &ref) &&
+        functional_mapintegrand(v, &info, &out) && MORPHO_ISMATRIX(out)) {
+        objectmatrix *m = MORPHO_GETMATRIX(out); // Return a column vector with an entry per element
+        m->nrows=m->ncols;
+        m->ncols=1;
+    }
+
+    if (!MORPHO_ISNIL(out)) morpho_bindobjects(v, 1, &out);
+    return out;
+}
+
+/** Evaluate a gradient, numerically if no gradientfn is provided */
+value FunctionalAdapter_gradient(vm *v, int nargs, value *args) {
+    functional_mapinfo info;
+    functionaladapterref ref;
+    value out=MORPHO_NIL;
+
+    if (functionaladapter_prepare(v, nargs, args, &info, &ref)) {
+        if (morpho_lookupmethod(ref.self, functionaladapter_gradientfnlabel, &ref.method)) {
+            info.grad=functionaladapter_gradient;
+            functional_mapgradient(v, &info, &out);
+        } else if (functionaladapter_integrandfn(v, &info, &ref)) {
+            functional_mapnumericalgradient(v, &info, &out);
+        }
+    }
+
+    if (!MORPHO_ISNIL(out)) morpho_bindobjects(v, 1, &out);
+    return out;
+}
+
+/** Total function */
+value FunctionalAdapter_total(vm *v, int nargs, value *args) {
+    functional_mapinfo info;
+    functionaladapterref ref;
+    value out=MORPHO_NIL;
+
+    if (functionaladapter_prepare(v, nargs, args, &info, &ref) &&
+        functionaladapter_integrandfn(v, &info, &ref)) {
+        functional_sumintegrand(v, &info, &out);
+    }
+
+    return out;
+}
+
+MORPHO_BEGINCLASS(FunctionalAdapter)
+MORPHO_METHOD(MORPHO_INITIALIZER_METHOD, FunctionalAdapter_init, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FUNCTIONAL_INTEGRAND_METHOD, FunctionalAdapter_integrand, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FUNCTIONAL_GRADIENT_METHOD, FunctionalAdapter_gradient, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FUNCTIONAL_TOTAL_METHOD, FunctionalAdapter_total, BUILTIN_FLAGSEMPTY)
+MORPHO_ENDCLASS
+
 /* ----------------------------------------------
  * Linear Elasticity
  * ---------------------------------------------- */
@@ -2089,6 +2256,7 @@ typedef struct {
     grade grade;
     double lambda; // Lamé coefficients
     double mu;     //
+    objectmatrixbatch *qbatch; // Inverse reference Gram matrices, one per element (may be NULL)
 } linearelasticityref;
 
 /** Calculates the Gram matrix */
@@ -2117,10 +2285,14 @@ bool linearelasticity_integrand(vm *v, objectmesh *mesh, elementid id, int nv, i
     objectmatrix r = MORPHO_STATICMATRIX(rel, gdim, gdim); // Intermediate calculations
     objectmatrix cg = MORPHO_STATICMATRIX(cgel, gdim, gdim); // Cauchy-Green strain tensor
 
-    linearelasticity_calculategram(info->refmesh->vert, mesh->dim, nv, vid, &gramref);
     linearelasticity_calculategram(mesh->vert, mesh->dim, nv, vid, &gramdef);
 
-    if (matrix_inverse(&gramref, &q)!=MATRIX_OK) return false;
+    if (info->qbatch && id<info->qbatch->nmatrices && info->qbatch->nrows==gdim) {
+        q.elements=MATRIXBATCH_GETELEMENTS(info->qbatch, id);
+    } else {
+        linearelasticity_calculategram(info->refmesh->vert, mesh->dim, nv, vid, &gramref);
+        if (matrix_inverse(&gramref, &q)!=MATRIX_OK) return false;
+    }
     if (matrix_mul(&gramdef, &q, &r)!=MATRIX_OK) return false;
 
     matrix_identity(&cg);
@@ -2159,11 +2331,49 @@ bool linearelasticity_prepareref(objectinstance *self, linearelasticityref *ref)
 
         ref->mu=0.5/(1+nu);
         ref->lambda=nu/(1+nu)/(1-2*nu);
+        ref->qbatch=NULL;
         success=true;
     }
     return success;
 }
 
+/** The reference mesh is fixed, so the inverse reference Gram matrices are computed once per call as a
+    single batch rather than for every evaluation of the integrand; the numerical gradient in particular
+    evaluates each element many times. If the batch can't be built, the integrand falls back to
+    inverting each matrix itself, which also reports any singular element. */
+void linearelasticity_preparebatch(objectmesh *mesh, linearelasticityref *ref) {
+    if (ref->grade<1) return;
+    objectsparse *s=mesh_getconnectivityelement(mesh, 0, ref->grade);
+    if (!s || s->ccs.ncols<1) return;
+
+    int nv, *vid;
+    if (!sparseccs_getrowindices(&s->ccs, 0, &nv, &vid) || nv<2) return;
+    int gdim=nv-1, nel=s->ccs.ncols;
+
+    objectmatrixbatch *q=object_newmatrixbatch(nel, gdim, gdim, false);
+    if (!q) return;
+
+    for (elementid i=0; i<nel; i++) {
+        if (!sparseccs_getrowindices(&s->ccs, i, &nv, &vid) || nv-1!=gdim) goto linearelasticity_preparebatch_cleanup;
+        objectmatrix gram = MORPHO_STATICMATRIX(MATRIXBATCH_GETELEMENTS(q, i), gdim, gdim);
+        linearelasticity_calculategram(ref->refmesh->vert, mesh->dim, nv, vid, &gram);
+    }
+
+    if (matrixbatch_inverse(q, q)==MATRIX_OK) {
+        ref->qbatch=q;
+        return;
+    }
+
+linearelasticity_preparebatch_cleanup:
+    object_free((object *) q);
+}
+
+/** Frees the batch of inverse reference Gram matrices */
+void linearelasticity_freebatch(linearelasticityref *ref) {
+    if (ref->qbatch) object_free((object *) ref->qbatch);
+    ref->qbatch=NULL;
+}
+
 value LinearElasticity_init(vm *v, int nargs, value *args) {
     objectinstance *self = MORPHO_GETINSTANCE(MORPHO_SELF(args));
     /* First argument is the reference mesh */
@@ -2198,7 +2408,9 @@ value LinearElasticity_integrand(vm *v, int nargs, value *args) {
             info.g = ref.grade;
             info.integrand = linearelasticity_integrand;
             info.ref = &ref;
+            linearelasticity_preparebatch(info.mesh, &ref);
             functional_mapintegrand(v, &info, &out);
+            linearelasticity_freebatch(&ref);
         } else morpho_runtimeerror(v, LINEARELASTICITY_PRP);
     }
     if (!MORPHO_ISNIL(out)) morpho_bindobjects(v, 1, &out);
@@ -2216,7 +2428,9 @@ value LinearElasticity_total(vm *v, int nargs, value *args) {
             info.g = ref.grade;
             info.integrand = linearelasticity_integrand;
             info.ref = &ref;
+            linearelasticity_preparebatch(info.mesh, &ref);
             functional_sumintegrand(v, &info, &out);
+            linearelasticity_freebatch(&ref);
         } else morpho_runtimeerror(v, LINEARELASTICITY_PRP);
     }
     return out;
@@ -2233,8 +2447,10 @@ value LinearElasticity_gradient(vm *v, int nargs, value *args) {
             info.g = ref.grade;
             info.integrand = linearelasticity_integrand;
             info.ref = &ref;
+            linearelasticity_preparebatch(info.mesh, &ref);
             info.sym = SYMMETRY_ADD;
             functional_mapnumericalgradient(v, &info, &out);
+            linearelasticity_freebatch(&ref);
         } else morpho_runtimeerror(v, LINEARELASTICITY_PRP);
     }
     if (!MORPHO_ISNIL(out)) morpho_bindobjects(v, 1, &out);
@@ -2493,6 +2709,7 @@ bool equielement_prepareref(objectinstance *self, objectmesh *mesh, grade g, obj
         ref->eltov=mesh_addconnectivityelement(mesh, 0, ref->grade);
 
         if (ref->vtoel && ref->eltov) success=true;
+        if (success) meshadjacency_buildneighbors(mesh, MESH_GRADE_VERTEX, ref->grade);
     }
 
     if (objectinstance_getpropertyinterned(self, equielement_weightproperty, &weight) &&
@@ -2651,6 +2868,11 @@ bool curvature_prepareref(objectinstance *self, objectmesh *mesh, grade g, objec
         success=s;
     }
 
+    if (success) { // Build neighbor lists before any parallel evaluation
+        meshadjacency_buildneighbors(mesh, g, MESH_GRADE_LINE);
+        meshadjacency_buildsynonyms(mesh, MESH_GRADE_VERTEX);
+    }
+
     if (success) {
         value integrandonly=MORPHO_FALSE;
         objectinstance_getpropertyinterned(self, curvature_integrandonlyproperty, &integrandonly);
@@ -2660,32 +2882,6 @@ bool curvature_prepareref(objectinstance *self, objectmesh *mesh, grade g, objec
     return success;
 }
 
-/** Finds the points that a point depends on  */
-bool linecurvsq_dependencies(functional_mapinfo *info, elementid id, varray_elementid *out) {
-    objectmesh *mesh = info->mesh;
-    curvatureref *cref = info->ref;
-    bool success=false;
-    varray_elementid nbrs;
-    varray_elementidinit(&nbrs);
-
-    if (mesh_findneighbors(mesh, MESH_GRADE_VERTEX, id, MESH_GRADE_LINE, &nbrs)>0) {
-        for (unsigned int i=0; i<nbrs.count; i++) {
-            int nentries, *entries; // Get the vertices for this edge
-            if (!sparseccs_getrowindices(&cref->lineel->ccs, nbrs.data[i], &nentries, &entries)) goto linecurvsq_dependencies_cleanup;
-            for (unsigned int j=0; j<nentries; j++) {
-                if (entries[j]==id) continue;
-                varray_elementidwrite(out, entries[j]);
-            }
-        }
-    }
-    success=true;
-
-linecurvsq_dependencies_cleanup:
-    varray_elementidclear(&nbrs);
-
-    return success;
-}
-
 /** Calculate the integral of the curvature squared  */
 bool linecurvsq_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, double *out) {
     curvatureref *cref = (curvatureref *) ref;
@@ -2739,85 +2935,133 @@ linecurvsq_integrand_cleanup:
     return true;
 }
 
-FUNCTIONAL_INIT(LineCurvatureSq, MESH_GRADE_VERTEX)
-FUNCTIONAL_METHOD(LineCurvatureSq, integrand, MESH_GRADE_VERTEX, curvatureref, curvature_prepareref, functional_mapintegrand, linecurvsq_integrand, NULL, FUNCTIONAL_ARGS, SYMMETRY_NONE)
-FUNCTIONAL_METHOD(LineCurvatureSq, integrandForElement, MESH_GRADE_VERTEX, curvatureref, curvature_prepareref, functional_mapintegrandforelement, linecurvsq_integrand, NULL, FUNCTIONAL_ARGS, SYMMETRY_NONE)
-FUNCTIONAL_METHOD(LineCurvatureSq, total, MESH_GRADE_VERTEX, curvatureref, curvature_prepareref, functional_sumintegrand, linecurvsq_integrand, NULL, FUNCTIONAL_ARGS, SYMMETRY_NONE)
-FUNCTIONAL_METHOD(LineCurvatureSq, gradient, MESH_GRADE_VERTEX, curvatureref, curvature_prepareref, functional_mapnumericalgradient, linecurvsq_integrand, linecurvsq_dependencies, FUNCTIONAL_ARGS, SYMMETRY_ADD)
-
-MORPHO_BEGINCLASS(LineCurvatureSq)
-MORPHO_METHOD(MORPHO_INITIALIZER_METHOD, LineCurvatureSq_init, BUILTIN_FLAGSEMPTY),
-MORPHO_METHOD(FUNCTIONAL_INTEGRAND_METHOD, LineCurvatureSq_integrand, BUILTIN_FLAGSEMPTY),
-MORPHO_METHOD(FUNCTIONAL_INTEGRANDFORELEMENT_METHOD, LineCurvatureSq_integrandForElement, BUILTIN_FLAGSEMPTY),
-MORPHO_METHOD(FUNCTIONAL_GRADIENT_METHOD, LineCurvatureSq_gradient, BUILTIN_FLAGSEMPTY),
-MORPHO_METHOD(FUNCTIONAL_TOTAL_METHOD, LineCurvatureSq_total, BUILTIN_FLAGSEMPTY)
-MORPHO_ENDCLASS
-
-/* ----------------------------------------------
- * LineTorsionSq
- * ---------------------------------------------- */
-
-/** Return a list of vertices that an element depends on  */
-bool linetorsionsq_dependencies(functional_mapinfo *info, elementid id, varray_elementid *out) {
-    objectmesh *mesh = info->mesh;
-    curvatureref *cref = info->ref;
+/** Calculate the gradient of the integral of the curvature squared */
+bool linecurvsq_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, objectmatrix *frc) {
+    curvatureref *cref = (curvatureref *) ref;
     bool success=false;
     varray_elementid nbrs;
     varray_elementid synid;
-
     varray_elementidinit(&nbrs);
     varray_elementidinit(&synid);
 
-    if (mesh_findneighbors(mesh, MESH_GRADE_LINE, id, MESH_GRADE_LINE, &nbrs)>0) {
-        for (unsigned int i=0; i<nbrs.count; i++) {
-            int nentries, *entries; // Get the vertices for this edge
-            if (!sparseccs_getrowindices(&cref->lineel->ccs, nbrs.data[i], &nentries, &entries)) goto linetorsionsq_dependencies_cleanup;
-            for (unsigned int j=0; j<nentries; j++) {
-                varray_elementidwriteunique(out, entries[j]);
+    double s0[mesh->dim], s1[mesh->dim], *s[2] = { s0, s1}, sgn=-1.0;
+    int *ends[2]; // The vertices of each edge
+
+    if (mesh_findneighbors(mesh, MESH_GRADE_VERTEX, id, MESH_GRADE_LINE, &nbrs)>0 &&
+        mesh_getsynonyms(mesh, MESH_GRADE_VERTEX, id, &synid)) {
+        if (nbrs.count!=2) { success=true; goto linecurvsq_gradient_cleanup; }
+
+        for (unsigned int i=0; i<2; i++) {
+            int nentries;
+            if (!sparseccs_getrowindices(&cref->lineel->ccs, nbrs.data[i], &nentries, &ends[i])) goto linecurvsq_gradient_cleanup;
+
+            double *x0, *x1;
+            if (!(mesh_getvertexcoordinatesaslist(mesh, ends[i][0], &x0) &&
+                  mesh_getvertexcoordinatesaslist(mesh, ends[i][1], &x1))) goto linecurvsq_gradient_cleanup;
+            functional_vecsub(mesh->dim, x0, x1, s[i]);
+            if (!(ends[i][0]==id || functional_inlist(&synid, ends[i][0]))) sgn*=-1;
+        }
+
+        double norm[2] = { functional_vecnorm(mesh->dim, s0), functional_vecnorm(mesh->dim, s1) };
+        if (norm[0]<MORPHO_EPS || norm[1]<MORPHO_EPS) goto linecurvsq_gradient_cleanup;
+
+        double c=sgn*functional_vecdot(mesh->dim, s0, s1)/norm[0]/norm[1],
+               len=0.5*(norm[0]+norm[1]),
+               u=(c<1 ? acos(c) : 0),
+               r=(u>MORPHO_EPS ? u/sin(u) : 1.0); // u/sqrt(1-c^2), which is finite as the edges become collinear
+
+        /* With E = u^2/len^p, dE = -2 r/len^p dc - p u^2/len^(p+1) dlen */
+        double p=(cref->integrandonly ? 2.0 : 1.0),
+               dEdc=-2*r/pow(len, p),
+               dEdlen=-p*u*u/pow(len, p+1);
+
+        for (unsigned int i=0; i<2; i++) {
+            double *si=s[i], *sj=s[1-i], g[mesh->dim];
+
+            /* dc/dsi = (sgn sj/|sj| - c si/|si|)/|si|; dlen/dsi = si/|si|/2 */
+            for (unsigned int k=0; k<mesh->dim; k++) {
+                g[k]=dEdc*(sgn*sj[k]/norm[1-i] - c*si[k]/norm[i])/norm[i] + dEdlen*0.5*si[k]/norm[i];
             }
+
+            matrix_addtocolumn(frc, ends[i][0], 1.0, g);
+            matrix_addtocolumn(frc, ends[i][1], -1.0, g);
         }
     }
     success=true;
 
-linetorsionsq_dependencies_cleanup:
+linecurvsq_gradient_cleanup:
     varray_elementidclear(&nbrs);
     varray_elementidclear(&synid);
 
     return success;
 }
 
+/** Evaluate the gradient of the integral of the curvature squared */
+value LineCurvatureSq_gradient(vm *v, int nargs, value *args) {
+    functional_mapinfo info;
+    curvatureref ref;
+    value out=MORPHO_NIL;
+
+    if (functional_validateargs(v, nargs, args, &info)) {
+        if (curvature_prepareref(MORPHO_GETINSTANCE(MORPHO_SELF(args)), info.mesh, MESH_GRADE_VERTEX, info.sel, &ref)) {
+            info.g = MESH_GRADE_VERTEX;
+            info.grad = linecurvsq_gradient;
+            info.ref = &ref;
+            info.sym = SYMMETRY_ADD;
+            functional_mapgradient(v, &info, &out);
+        } else morpho_runtimeerror(v, FUNCTIONAL_ARGS);
+    }
+    if (!MORPHO_ISNIL(out)) morpho_bindobjects(v, 1, &out);
+    return out;
+}
+
+FUNCTIONAL_INIT(LineCurvatureSq, MESH_GRADE_VERTEX)
+FUNCTIONAL_METHOD(LineCurvatureSq, integrand, MESH_GRADE_VERTEX, curvatureref, curvature_prepareref, functional_mapintegrand, linecurvsq_integrand, NULL, FUNCTIONAL_ARGS, SYMMETRY_NONE)
+FUNCTIONAL_METHOD(LineCurvatureSq, integrandForElement, MESH_GRADE_VERTEX, curvatureref, curvature_prepareref, functional_mapintegrandforelement, linecurvsq_integrand, NULL, FUNCTIONAL_ARGS, SYMMETRY_NONE)
+FUNCTIONAL_METHOD(LineCurvatureSq, total, MESH_GRADE_VERTEX, curvatureref, curvature_prepareref, functional_sumintegrand, linecurvsq_integrand, NULL, FUNCTIONAL_ARGS, SYMMETRY_NONE)
 
-/** Calculate the integral of the torsion squared  */
-bool linetorsionsq_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, double *out) {
-    curvatureref *cref = (curvatureref *) ref;
+MORPHO_BEGINCLASS(LineCurvatureSq)
+MORPHO_METHOD(MORPHO_INITIALIZER_METHOD, LineCurvatureSq_init, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FUNCTIONAL_INTEGRAND_METHOD, LineCurvatureSq_integrand, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FUNCTIONAL_INTEGRANDFORELEMENT_METHOD, LineCurvatureSq_integrandForElement, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FUNCTIONAL_GRADIENT_METHOD, LineCurvatureSq_gradient, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FUNCTIONAL_TOTAL_METHOD, LineCurvatureSq_total, BUILTIN_FLAGSEMPTY)
+MORPHO_ENDCLASS
+
+/* ----------------------------------------------
+ * LineTorsionSq
+ * ---------------------------------------------- */
+
+/** Finds an ordered list of the vertices of a line element and its two neighbors:
+ *               v the element
+ *    0 --- 1/2 --- 3/4 --- 5
+ * Where 1/2 and 3/4 are the same vertex, but could have different indices due to symmetries.
+ * Returns false if the list couldn't be constructed; nnbrs is set to the number of neighbors found. */
+bool linetorsionsq_ordervertices(objectmesh *mesh, curvatureref *cref, elementid id, int *vid, elementid *vlist, int *nnbrs) {
     int tmpi; elementid tmpid;
     bool success=false;
 
-    //double result = 0.0;
     varray_elementid nbrs;
     varray_elementid synid;
     varray_elementidinit(&nbrs);
     varray_elementidinit(&synid);
-    elementid vlist[6]; // List of vertices in order  n
     int type[6];
     for (unsigned int i=0; i<6; i++) type[i]=-1;
 
-    /* We want an ordered list of vertex indices:
-     *               v the element
-     *    0 --- 1/2 --- 3/4 --- 5
-     * Where 1/2 and 3/4 are the same vertex, but could have different indices due to symmetries */
-     vlist[2] = vid[0]; vlist[3] = vid[1]; // Copy the current element into place
+    vlist[2] = vid[0]; vlist[3] = vid[1]; // Copy the current element into place
+    *nnbrs = 0;
 
     /* First identify neighbors and get the vertex ids for each element */
     if (mesh_findneighbors(mesh, MESH_GRADE_LINE, id, MESH_GRADE_LINE, &nbrs)>0) {
+        *nnbrs = nbrs.count;
         if (nbrs.count<2) {
-            *out = 0; success=true;
-            goto linecurvsq_torsion_cleanup;
+            success=true;
+            goto linetorsionsq_ordervertices_cleanup;
         }
 
         for (unsigned int i=0; i<nbrs.count; i++) {
             int nentries, *entries; // Get the vertices for this edge
-            if (!sparseccs_getrowindices(&cref->lineel->ccs, nbrs.data[i], &nentries, &entries)) goto linecurvsq_torsion_cleanup;
+            if (!sparseccs_getrowindices(&cref->lineel->ccs, nbrs.data[i], &nentries, &entries)) goto linetorsionsq_ordervertices_cleanup;
             for (unsigned int j=0; j<nentries; j++) { // Copy the vertexids
                 vlist[4*i+j] = entries[j];
             }
@@ -2847,6 +3091,23 @@ bool linetorsionsq_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int
         SWAP(type, 4, 5, tmpi);
     }
 #undef SWAP
+    success=true;
+
+linetorsionsq_ordervertices_cleanup:
+    varray_elementidclear(&nbrs);
+    varray_elementidclear(&synid);
+
+    return success;
+}
+
+/** Calculate the integral of the torsion squared  */
+bool linetorsionsq_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, double *out) {
+    curvatureref *cref = (curvatureref *) ref;
+    elementid vlist[6]; // List of vertices in order
+    int nnbrs;
+
+    if (!linetorsionsq_ordervertices(mesh, cref, id, vid, vlist, &nnbrs)) return false;
+    if (nnbrs<2) { *out = 0; return true; }
 
     /* We now have an ordered list of vertices.
        Get the vertex positions */
@@ -2871,19 +3132,99 @@ bool linetorsionsq_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int
 
     S=asin(S);
     *out=S*S/normB;
-    success=true;
 
-linecurvsq_torsion_cleanup:
-    varray_elementidclear(&nbrs);
-    varray_elementidclear(&synid);
+    return true;
+}
 
-    return success;
+/** Calculate the gradient of the integral of the torsion squared */
+bool linetorsionsq_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, objectmatrix *frc) {
+    curvatureref *cref = (curvatureref *) ref;
+    elementid vlist[6]; // List of vertices in order
+    int nnbrs;
+
+    if (!linetorsionsq_ordervertices(mesh, cref, id, vid, vlist, &nnbrs)) return false;
+    if (nnbrs<2) return true;
+
+    double *x[6];
+    for (int i=0; i<6; i++) matrix_getcolumn(mesh->vert, vlist[i], &x[i]);
+
+    double A[3], B[3], C[3], crossAB[3], crossBC[3], crossCA[3];
+    functional_vecsub(3, x[1], x[0], A);
+    functional_vecsub(3, x[3], x[2], B);
+    functional_vecsub(3, x[5], x[4], C);
+
+    functional_veccross(A, B, crossAB);
+    functional_veccross(B, C, crossBC);
+    functional_veccross(C, A, crossCA);
+
+    double normB=functional_vecnorm(3, B),
+           normAB=functional_vecnorm(3, crossAB),
+           normBC=functional_vecnorm(3, crossBC);
+
+    /* If either pair of segments is collinear, the triple product vanishes and so does the gradient */
+    if (normAB<MORPHO_EPS || normBC<MORPHO_EPS) return true;
+
+    /* The torsion angle is S = asin(sn/|AB||BC|) = atan2(sn, |cs|), with sn = A.(BxC)|B| and cs = (AxB).(BxC),
+       as |(AxB)x(BxC)| = |B||A.(BxC)|. The latter form has a finite derivative throughout. */
+    double AB=functional_vecdot(3, A, B), AC=functional_vecdot(3, A, C),
+           BB=functional_vecdot(3, B, B), BC=functional_vecdot(3, B, C);
+    double P=functional_vecdot(3, A, crossBC),
+           sn=P*normB,
+           cs=AB*BC-AC*BB,
+           sgn=(cs<0 ? -1.0 : 1.0);
+
+    double S=asin(sn/normAB/normBC);
+
+    /* With E = S^2/|B|, dE = 2S/|B| dS - S^2/|B|^2 d|B| and dS = (|cs| dsn - sn d|cs|)/(|AB||BC|)^2 */
+    double scale=2*S/normB/(normAB*normAB*normBC*normBC);
+    double dBnorm=-S*S/(normB*normB*normB); // d|B|/dB = B/|B|
+
+    double gA[3], gB[3], gC[3];
+    for (int k=0; k<3; k++) {
+        double dcsA=B[k]*BC-C[k]*BB,
+               dcsB=A[k]*BC+C[k]*AB-2*B[k]*AC,
+               dcsC=B[k]*AB-A[k]*BB;
+        double dsnA=normB*crossBC[k],
+               dsnB=normB*crossCA[k]+P*B[k]/normB,
+               dsnC=normB*crossAB[k];
+
+        gA[k]=scale*sgn*(cs*dsnA - sn*dcsA);
+        gB[k]=scale*sgn*(cs*dsnB - sn*dcsB) + dBnorm*B[k];
+        gC[k]=scale*sgn*(cs*dsnC - sn*dcsC);
+    }
+
+    matrix_addtocolumn(frc, vlist[1], 1.0, gA);
+    matrix_addtocolumn(frc, vlist[0], -1.0, gA);
+    matrix_addtocolumn(frc, vlist[3], 1.0, gB);
+    matrix_addtocolumn(frc, vlist[2], -1.0, gB);
+    matrix_addtocolumn(frc, vlist[5], 1.0, gC);
+    matrix_addtocolumn(frc, vlist[4], -1.0, gC);
+
+    return true;
+}
+
+/** Evaluate the gradient of the integral of the torsion squared */
+value LineTorsionSq_gradient(vm *v, int nargs, value *args) {
+    functional_mapinfo info;
+    curvatureref ref;
+    value out=MORPHO_NIL;
+
+    if (functional_validateargs(v, nargs, args, &info)) {
+        if (curvature_prepareref(MORPHO_GETINSTANCE(MORPHO_SELF(args)), info.mesh, MESH_GRADE_LINE, info.sel, &ref)) {
+            info.g = MESH_GRADE_LINE;
+            info.grad = linetorsionsq_gradient;
+            info.ref = &ref;
+            info.sym = SYMMETRY_ADD;
+            functional_mapgradient(v, &info, &out);
+        } else morpho_runtimeerror(v, FUNCTIONAL_ARGS);
+    }
+    if (!MORPHO_ISNIL(out)) morpho_bindobjects(v, 1, &out);
+    return out;
 }
 
 FUNCTIONAL_INIT(LineTorsionSq, MESH_GRADE_LINE)
 FUNCTIONAL_METHOD(LineTorsionSq, integrand, MESH_GRADE_LINE, curvatureref, curvature_prepareref, functional_mapintegrand, linetorsionsq_integrand, NULL, FUNCTIONAL_ARGS, SYMMETRY_NONE)
 FUNCTIONAL_METHOD(LineTorsionSq, total, MESH_GRADE_LINE, curvatureref, curvature_prepareref, functional_sumintegrand, linetorsionsq_integrand, NULL, FUNCTIONAL_ARGS, SYMMETRY_NONE)
-FUNCTIONAL_METHOD(LineTorsionSq, gradient, MESH_GRADE_LINE, curvatureref, curvature_prepareref, functional_mapnumericalgradient, linetorsionsq_integrand, linetorsionsq_dependencies, FUNCTIONAL_ARGS, SYMMETRY_ADD)
 
 MORPHO_BEGINCLASS(LineTorsionSq)
 MORPHO_METHOD(MORPHO_INITIALIZER_METHOD, LineTorsionSq_init, BUILTIN_FLAGSEMPTY),
@@ -2919,6 +3260,11 @@ bool areacurvature_prepareref(objectinstance *self, objectmesh *mesh, grade g, o
         success=s;
     }
 
+    if (success) { // Build neighbor lists before any parallel evaluation
+        meshadjacency_buildneighbors(mesh, MESH_GRADE_VERTEX, MESH_GRADE_AREA);
+        meshadjacency_buildsynonyms(mesh, MESH_GRADE_VERTEX);
+    }
+
     if (success) {
         value integrandonly=MORPHO_FALSE;
         objectinstance_getpropertyinterned(self, curvature_integrandonlyproperty, &integrandonly);
@@ -2932,41 +3278,6 @@ bool areacurvature_prepareref(objectinstance *self, objectmesh *mesh, grade g, o
     return success;
 }
 
-/** Return a list of vertices that an element depends on  */
-bool meancurvaturesq_dependencies(functional_mapinfo *info, elementid id, varray_elementid *out) {
-    objectmesh *mesh = info->mesh;
-    areacurvatureref *cref = info->ref;
-    bool success=false;
-    varray_elementid nbrs;
-    varray_elementid synid;
-
-    varray_elementidinit(&nbrs);
-    varray_elementidinit(&synid);
-
-    mesh_getsynonyms(mesh, MESH_GRADE_VERTEX, id, &synid);
-    varray_elementidwriteunique(&synid, id);
-
-    /* Loop over synonyms of the element id */
-    mesh_findneighbors(mesh, MESH_GRADE_VERTEX, id, MESH_GRADE_AREA, &nbrs);
-
-    for (unsigned int i=0; i<nbrs.count; i++) { /* Loop over adjacent triangles */
-        int nvert, *vids;
-        if (!sparseccs_getrowindices(&cref->areael->ccs, nbrs.data[i], &nvert, &vids)) goto meancurvsq_dependencies_cleanup;
-
-        for (unsigned int j=0; j<nvert; j++) {
-            if (vids[j]==id) continue;
-            varray_elementidwriteunique(out, vids[j]);
-        }
-    }
-    success=true;
-
-meancurvsq_dependencies_cleanup:
-    varray_elementidclear(&nbrs);
-    varray_elementidclear(&synid);
-
-    return success;
-}
-
 /** Orders the vertices in the list vids so that the vertex in synid is first */
 bool curvature_ordervertices(varray_elementid *synid, int nv, int *vids) {
     int posn=-1;
@@ -3041,10 +3352,117 @@ meancurvsq_cleanup:
     return success;
 }
 
+/** Calculate the gradient of the integral of the mean curvature squared */
+bool meancurvaturesq_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, objectmatrix *frc) {
+    areacurvatureref *cref = (areacurvatureref *) ref;
+    double areasum = 0;
+    bool success=false;
+
+    varray_elementid nbrs;
+    varray_elementid synid;
+    varray_elementidinit(&nbrs);
+    varray_elementidinit(&synid);
+
+    mesh_getsynonyms(mesh, MESH_GRADE_VERTEX, id, &synid);
+    varray_elementidwriteunique(&synid, id);
+
+    double F[3] = { 0.0, 0.0, 0.0 }; // The total force due to the triangles present, as in the integrand
+
+    mesh_findneighbors(mesh, MESH_GRADE_VERTEX, id, MESH_GRADE_AREA, &nbrs);
+
+    /* The integrand is E = k |F|^2/A^p, where A is the area of the adjacent triangles and
+       F = sum (a |b|^2 - b (a.b))/(2|a x b|) with a = x1-x0, b = x2-x1 is the gradient of A wrt a.
+       First find F and A... */
+    for (int pass=0; pass<2; pass++) {
+        double k=(cref->integrandonly ? 9.0/4.0 : 3.0/4.0),
+               p=(cref->integrandonly ? 2.0 : 1.0),
+               FF=functional_vecdot(3, F, F),
+               dEdF=2*k/pow(areasum, p), // Coefficient of F.dF
+               dEdA=-p*k*FF/pow(areasum, p+1);
+
+        for (unsigned int i=0; i<nbrs.count; i++) { /* Loop over adjacent triangles */
+            int nvert, *ovids;
+            if (!sparseccs_getrowindices(&cref->areael->ccs, nbrs.data[i], &nvert, &ovids)) goto meancurvsq_gradient_cleanup;
+
+            int vids[nvert]; // Copy so we can reorder
+            for (int j=0; j<nvert; j++) vids[j]=ovids[j];
+
+            /* Order the vertices */
+            if (!curvature_ordervertices(&synid, nvert, vids)) goto meancurvsq_gradient_cleanup;
+
+            double *x[3], a[3] = { 0.0, 0.0, 0.0 }, b[3] = { 0.0, 0.0, 0.0 }, ab[3];
+            for (int j=0; j<3; j++) matrix_getcolumn(mesh->vert, vids[j], &x[j]);
+
+            functional_vecsub(mesh->dim, x[1], x[0], a);
+            functional_vecsub(mesh->dim, x[2], x[1], b);
+
+            functional_veccross(a, b, ab);
+            double norm=functional_vecnorm(3, ab);
+            if (norm<MORPHO_EPS) goto meancurvsq_gradient_cleanup;
+
+            double aa=functional_vecdot(3, a, a), bb=functional_vecdot(3, b, b), adb=functional_vecdot(3, a, b);
+
+            if (pass==0) {
+                areasum+=norm/2;
+                for (int j=0; j<3; j++) F[j]+=(a[j]*bb-b[j]*adb)/(2*norm);
+                continue;
+            }
+
+            /* ...then differentiate. With N = F.(a|b|^2 - b (a.b)) the contribution of this triangle to F.F
+               is N/(2|a x b|); the area of the triangle is |a x b|/2 */
+            double Fa=functional_vecdot(3, F, a), Fb=functional_vecdot(3, F, b);
+            double N=Fa*bb-adb*Fb;
+
+            double ga[3], gb[3];
+            for (int j=0; j<3; j++) {
+                double dnda=(a[j]*bb-b[j]*adb)/norm, // Derivatives of |a x b|
+                       dndb=(b[j]*aa-a[j]*adb)/norm;
+                double dNda=F[j]*bb-b[j]*Fb,
+                       dNdb=2*b[j]*Fa-a[j]*Fb-F[j]*adb;
+
+                ga[j]=dEdF*(dNda/(2*norm)-N*dnda/(2*norm*norm)) + dEdA*dnda/2;
+                gb[j]=dEdF*(dNdb/(2*norm)-N*dndb/(2*norm*norm)) + dEdA*dndb/2;
+            }
+
+            matrix_addtocolumn(frc, vids[0], -1.0, ga);
+            matrix_addtocolumn(frc, vids[1], 1.0, ga);
+            matrix_addtocolumn(frc, vids[1], -1.0, gb);
+            matrix_addtocolumn(frc, vids[2], 1.0, gb);
+        }
+
+        if (areasum<MORPHO_EPS) break; // No adjacent triangles
+    }
+    success=true;
+
+meancurvsq_gradient_cleanup:
+    varray_elementidclear(&nbrs);
+    varray_elementidclear(&synid);
+
+    return success;
+}
+
+/** Evaluate the gradient of the integral of the mean curvature squared */
+value MeanCurvatureSq_gradient(vm *v, int nargs, value *args) {
+    functional_mapinfo info;
+    areacurvatureref ref;
+    value out=MORPHO_NIL;
+
+    if (functional_validateargs(v, nargs, args, &info)) {
+        if (areacurvature_prepareref(MORPHO_GETINSTANCE(MORPHO_SELF(args)), info.mesh, MESH_GRADE_VERTEX, info.sel, &ref)) {
+            info.g = MESH_GRADE_VERTEX;
+            info.grad = meancurvaturesq_gradient;
+            info.ref = &ref;
+            info.sym = SYMMETRY_ADD;
+            functional_mapgradient(v, &info, &out);
+        } else morpho_runtimeerror(v, FUNCTIONAL_ARGS);
+    }
+    if (!MORPHO_ISNIL(out)) morpho_bindobjects(v, 1, &out);
+    return out;
+}
+
 FUNCTIONAL_INIT(MeanCurvatureSq, MESH_GRADE_VERTEX)
 FUNCTIONAL_METHOD(MeanCurvatureSq, integrand, MESH_GRADE_VERTEX, areacurvatureref, areacurvature_prepareref, functional_mapintegrand, meancurvaturesq_integrand, NULL, FUNCTIONAL_ARGS, SYMMETRY_NONE)
 FUNCTIONAL_METHOD(MeanCurvatureSq, total, MESH_GRADE_VERTEX, areacurvatureref, areacurvature_prepareref, functional_sumintegrand, meancurvaturesq_integrand, NULL, FUNCTIONAL_ARGS, SYMMETRY_NONE)
-FUNCTIONAL_METHOD(MeanCurvatureSq, gradient, MESH_GRADE_VERTEX, areacurvatureref, areacurvature_prepareref, functional_mapnumericalgradient, meancurvaturesq_integrand, meancurvaturesq_dependencies, FUNCTIONAL_ARGS, SYMMETRY_ADD)
 
 MORPHO_BEGINCLASS(MeanCurvatureSq)
 MORPHO_METHOD(MORPHO_INITIALIZER_METHOD, MeanCurvatureSq_init, BUILTIN_FLAGSEMPTY),
@@ -3112,10 +3530,106 @@ gausscurv_cleanup:
     return success;
 }
 
+/** Calculate the gradient of the integral of the gaussian curvature */
+bool gausscurvature_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, objectmatrix *frc) {
+    areacurvatureref *cref = (areacurvatureref *) ref;
+    double anglesum = 0, areasum = 0;
+    bool success=false;
+
+    varray_elementid nbrs;
+    varray_elementid synid;
+    varray_elementidinit(&nbrs);
+    varray_elementidinit(&synid);
+
+    mesh_getsynonyms(mesh, MESH_GRADE_VERTEX, id, &synid);
+    varray_elementidwriteunique(&synid, id);
+
+    mesh_findneighbors(mesh, MESH_GRADE_VERTEX, id, MESH_GRADE_AREA, &nbrs);
+
+    /* The integrand is E = (2 Pi - sum theta) or, for the bare curvature, E = (2 Pi - sum theta)/(A/3), where
+       theta is the angle between a = x1-x0 and b = x2-x0 and A is the area of the adjacent triangles.
+       The angle and area sums are only needed for the bare curvature. */
+    for (int pass=(cref->integrandonly ? 0 : 1); pass<2; pass++) {
+        double dEdtheta=-1.0, dEdA=0.0;
+        if (cref->integrandonly) {
+            double K=(cref->geodesic ? M_PI : 2*M_PI)-anglesum;
+            dEdtheta=-3.0/areasum;
+            dEdA=-3.0*K/(areasum*areasum);
+        }
+
+        for (unsigned int i=0; i<nbrs.count; i++) { /* Loop over adjacent triangles */
+            int nvert, *ovids;
+            if (!sparseccs_getrowindices(&cref->areael->ccs, nbrs.data[i], &nvert, &ovids)) goto gausscurv_gradient_cleanup;
+
+            int vids[nvert]; // Copy so we can reorder
+            for (int j=0; j<nvert; j++) vids[j]=ovids[j];
+
+            /* Order the vertices */
+            if (!curvature_ordervertices(&synid, nvert, vids)) goto gausscurv_gradient_cleanup;
+
+            double *x[3], a[3] = { 0.0, 0.0, 0.0 }, b[3] = { 0.0, 0.0, 0.0 }, ab[3];
+            for (int j=0; j<3; j++) matrix_getcolumn(mesh->vert, vids[j], &x[j]);
+
+            functional_vecsub(mesh->dim, x[1], x[0], a);
+            functional_vecsub(mesh->dim, x[2], x[0], b);
+
+            functional_veccross(a, b, ab);
+            double norm=functional_vecnorm(3, ab),
+                   adb=functional_vecdot(3, a, b);
+
+            if (pass==0) {
+                anglesum+=atan2(norm, adb);
+                areasum+=norm/2;
+                continue;
+            }
+
+            if (norm<MORPHO_EPS) goto gausscurv_gradient_cleanup;
+
+            /* dtheta/da = ((a.b) a/|a|^2 - b)/|a x b|; d|a x b|/da = (a |b|^2 - b (a.b))/|a x b| */
+            double aa=functional_vecdot(3, a, a), bb=functional_vecdot(3, b, b);
+            double ga[3], gb[3], g0[3];
+            for (int j=0; j<3; j++) {
+                ga[j]=(dEdtheta*(adb*a[j]/aa-b[j]) + dEdA*(a[j]*bb-b[j]*adb)/2)/norm;
+                gb[j]=(dEdtheta*(adb*b[j]/bb-a[j]) + dEdA*(b[j]*aa-a[j]*adb)/2)/norm;
+                g0[j]=-ga[j]-gb[j];
+            }
+
+            matrix_addtocolumn(frc, vids[0], 1.0, g0);
+            matrix_addtocolumn(frc, vids[1], 1.0, ga);
+            matrix_addtocolumn(frc, vids[2], 1.0, gb);
+        }
+    }
+    success=true;
+
+gausscurv_gradient_cleanup:
+    varray_elementidclear(&nbrs);
+    varray_elementidclear(&synid);
+
+    return success;
+}
+
+/** Evaluate the gradient of the integral of the gaussian curvature */
+value GaussCurvature_gradient(vm *v, int nargs, value *args) {
+    functional_mapinfo info;
+    areacurvatureref ref;
+    value out=MORPHO_NIL;
+
+    if (functional_validateargs(v, nargs, args, &info)) {
+        if (areacurvature_prepareref(MORPHO_GETINSTANCE(MORPHO_SELF(args)), info.mesh, MESH_GRADE_VERTEX, info.sel, &ref)) {
+            info.g = MESH_GRADE_VERTEX;
+            info.grad = gausscurvature_gradient;
+            info.ref = &ref;
+            info.sym = SYMMETRY_ADD;
+            functional_mapgradient(v, &info, &out);
+        } else morpho_runtimeerror(v, FUNCTIONAL_ARGS);
+    }
+    if (!MORPHO_ISNIL(out)) morpho_bindobjects(v, 1, &out);
+    return out;
+}
+
 FUNCTIONAL_INIT(GaussCurvature, MESH_GRADE_VERTEX)
 FUNCTIONAL_METHOD(GaussCurvature, integrand, MESH_GRADE_VERTEX, areacurvatureref, areacurvature_prepareref, functional_mapintegrand, gausscurvature_integrand, NULL, FUNCTIONAL_ARGS, SYMMETRY_NONE)
 FUNCTIONAL_METHOD(GaussCurvature, total, MESH_GRADE_VERTEX, areacurvatureref, areacurvature_prepareref, functional_sumintegrand, gausscurvature_integrand, NULL, FUNCTIONAL_ARGS, SYMMETRY_NONE)
-FUNCTIONAL_METHOD(GaussCurvature, gradient, MESH_GRADE_VERTEX, areacurvatureref, areacurvature_prepareref, functional_mapnumericalgradient, gausscurvature_integrand, meancurvaturesq_dependencies, FUNCTIONAL_ARGS, SYMMETRY_ADD)
 
 MORPHO_BEGINCLASS(GaussCurvature)
 MORPHO_METHOD(MORPHO_INITIALIZER_METHOD, GaussCurvature_init, BUILTIN_FLAGSEMPTY),
@@ -4566,6 +5080,10 @@ void functional_initialize(void) {
     curvature_integrandonlyproperty=builtin_internsymbolascstring(CURVATURE_INTEGRANDONLY_PROPERTY);
     curvature_geodesicproperty=builtin_internsymbolascstring(CURVATURE_GEODESIC_PROPERTY);
 
+    functionaladapter_functionalproperty=builtin_internsymbolascstring(FUNCTIONALADAPTER_FUNCTIONAL_PROPERTY);
+    functionaladapter_integrandfnlabel=builtin_internsymbolascstring(FUNCTIONALADAPTER_INTEGRANDFN_METHOD);
+    functionaladapter_gradientfnlabel=builtin_internsymbolascstring(FUNCTIONALADAPTER_GRADIENTFN_METHOD);
+
     objectstring objclassname = MORPHO_STATICSTRING(OBJECT_CLASSNAME);
     value objclass = builtin_findclass(MORPHO_OBJECT(&objclassname));
 
@@ -4575,6 +5093,7 @@ void functional_initialize(void) {
     builtin_addclass(VOLUMEENCLOSED_CLASSNAME, MORPHO_GETCLASSDEFINITION(VolumeEnclosed), objclass);
     builtin_addclass(VOLUME_CLASSNAME, MORPHO_GETCLASSDEFINITION(Volume), objclass);
     builtin_addclass(SCALARPOTENTIAL_CLASSNAME, MORPHO_GETCLASSDEFINITION(ScalarPotential), objclass);
+    builtin_addclass(FUNCTIONALADAPTER_CLASSNAME, MORPHO_GETCLASSDEFINITION(FunctionalAdapter), objclass);
     builtin_addclass(LINEARELASTICITY_CLASSNAME, MORPHO_GETCLASSDEFINITION(LinearElasticity), objclass);
     builtin_addclass(HYDROGEL_CLASSNAME, MORPHO_GETCLASSDEFINITION(Hydrogel), objclass);
     builtin_addclass(EQUIELEMENT_CLASSNAME, MORPHO_GETCLASSDEFINITION(EquiElement), objclass);
@@ -4599,6 +5118,11 @@ void functional_initialize(void) {
 
     morpho_defineerror(SCALARPOTENTIAL_FNCLLBL, ERROR_HALT, SCALARPOTENTIAL_FNCLLBL_MSG);
 
+    morpho_defineerror(FUNCTIONALADAPTER_ARGS, ERROR_HALT, FUNCTIONALADAPTER_ARGS_MSG);
+    morpho_defineerror(FUNCTIONALADAPTER_GRADE, ERROR_HALT, FUNCTIONALADAPTER_GRADE_MSG);
+    morpho_defineerror(FUNCTIONALADAPTER_METHOD, ERROR_HALT, FUNCTIONALADAPTER_METHOD_MSG);
+    morpho_defineerror(FUNCTIONALADAPTER_INTEGRAND, ERROR_HALT, FUNCTIONALADAPTER_INTEGRAND_MSG);
+
     morpho_defineerror(LINEARELASTICITY_REF, ERROR_HALT, LINEARELASTICITY_REF_MSG);
     morpho_defineerror(LINEARELASTICITY_PRP, ERROR_HALT, LINEARELASTICITY_PRP_MSG);
 
@@ -4621,16 +5145,8 @@ void functional_initialize(void) {
     morpho_defineerror(INTEGRAL_AMBGSFLD, ERROR_HALT, INTEGRAL_AMBGSFLD_MSG);
     morpho_defineerror(INTEGRAL_SPCLFN, ERROR_HALT, INTEGRAL_SPCLFN_MSG);
     
-    functional_poolinitialized = false;
-    
     objectintegralelementreftype=object_addtype(&objectintegralelementrefdefn);
     elementhandle=vm_addtlvar();
     tangenthandle=vm_addtlvar();
     normlhandle=vm_addtlvar();
-    
-    morpho_addfinalizefn(functional_finalize);
-}
-
-void functional_finalize(void) {
-    threadpool_clear(&functional_pool);
 }
@@ -23,6 +23,7 @@
 #define FUNCTIONAL_FIELD_PROPERTY             "field"
 #define SCALARPOTENTIAL_FUNCTION_PROPERTY     "function"
 #define SCALARPOTENTIAL_GRADFUNCTION_PROPERTY "gradfunction"
+#define FUNCTIONALADAPTER_FUNCTIONAL_PROPERTY "functional"
 #define LINEARELASTICITY_REFERENCE_PROPERTY   "reference"
 #define LINEARELASTICITY_POISSON_PROPERTY     "poissonratio"
 #define HYDROGEL_A_PROPERTY                   "a"
@@ -52,6 +53,10 @@
 #define FUNCTIONAL_HESSIAN_METHOD      "hessian"
 #define FUNCTIONAL_INTEGRANDFORELEMENT_METHOD      "integrandForElement"
 
+/* Methods that objects wrapped by a FunctionalAdapter provide for each element */
+#define FUNCTIONALADAPTER_INTEGRANDFN_METHOD       "integrandfn"
+#define FUNCTIONALADAPTER_GRADIENTFN_METHOD        "gradientfn"
+
 /* Special functions that can be used in integrands */
 #define TANGENT_FUNCTION               "tangent"
 #define NORMAL_FUNCTION                "normal"
@@ -64,6 +69,7 @@
 #define VOLUME_CLASSNAME               "Volume"
 #define VOLUMEENCLOSED_CLASSNAME       "VolumeEnclosed"
 #define SCALARPOTENTIAL_CLASSNAME      "ScalarPotential"
+#define FUNCTIONALADAPTER_CLASSNAME    "FunctionalAdapter"
 #define LINEARELASTICITY_CLASSNAME     "LinearElasticity"
 #define HYDROGEL_CLASSNAME             "Hydrogel"
 #define EQUIELEMENT_CLASSNAME          "EquiElement"
@@ -89,6 +95,18 @@
 #define SCALARPOTENTIAL_FNCLLBL        "SclrPtFnCllbl"
 #define SCALARPOTENTIAL_FNCLLBL_MSG    "ScalarPotential function is not callable."
 
+#define FUNCTIONALADAPTER_ARGS         "FnctlAdptArgs"
+#define FUNCTIONALADAPTER_ARGS_MSG     "FunctionalAdapter requires a functional object as the argument."
+
+#define FUNCTIONALADAPTER_GRADE        "FnctlAdptGrd"
+#define FUNCTIONALADAPTER_GRADE_MSG    "FunctionalAdapter requires the functional to have property 'grade' set to an integer grade."
+
+#define FUNCTIONALADAPTER_METHOD       "FnctlAdptMthd"
+#define FUNCTIONALADAPTER_METHOD_MSG   "FunctionalAdapter requires the functional to provide method '%s'."
+
+#define FUNCTIONALADAPTER_INTEGRAND    "FnctlAdptIntgrnd"
+#define FUNCTIONALADAPTER_INTEGRAND_MSG "Method 'integrandfn' must return a number."
+
 #define LINEINTEGRAL_ARGS              "IntgrlArgs"
 #define LINEINTEGRAL_ARGS_MSG          "Integral functionals require a callable argument, followed by zero or more Fields."
 
@@ -336,6 +354,5 @@ value name##_hessian(vm *v, int nargs, value *args) { \
  * ------------------------------------------------------- */
 
 void functional_initialize(void);
-void functional_finalize(void);
 
 #endif /* functional_h */
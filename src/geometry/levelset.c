@@ -0,0 +1,547 @@
+/** @file levelset.c
+ *  @author T J Atherton
+ *
+ *  @brief Meshing of level sets of implicit functions by marching simplices
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "morpho.h"
+#include "classes.h"
+#include "common.h"
+#include "levelset.h"
+
+/* **********************************************************************
+ * Evaluating the function
+ * ********************************************************************** */
+
+/** A user function of dim variables, with an optional gradient */
+typedef struct {
+    vm *v;
+    int dim;
+    value fn;
+    value grad;
+    bool batch; // Call the function once with a Matrix whose columns are the points
+} levelsetfunction;
+
+/** Creates a Matrix whose columns are a set of points, bound to the VM so that it may be retained by the callee */
+static bool levelset_points(levelsetfunction *lf, int n, double *x, value *out) {
+    objectmatrix *m=object_newmatrix(lf->dim, n, false);
+    if (!m) {
+        morpho_runtimeerror(lf->v, ERROR_ALLOCATIONFAILED);
+        return false;
+    }
+    memcpy(m->elements, x, sizeof(double)*lf->dim*n);
+    *out=MORPHO_OBJECT(m);
+    morpho_bindobjects(lf->v, 1, out);
+    return true;
+}
+
+/** Copies n numbers from a Matrix or a List */
+static bool levelset_copyvalues(value in, int n, double *f) {
+    if (MORPHO_ISMATRIX(in)) {
+        objectmatrix *m=MORPHO_GETMATRIX(in);
+        if (matrix_countdof(m)!=n) return false;
+        memcpy(f, m->elements, sizeof(double)*n);
+        return true;
+    } else if (MORPHO_ISLIST(in)) {
+        objectlist *l=MORPHO_GETLIST(in);
+        if (l->val.count!=n) return false;
+        for (int i=0; i<n; i++) if (!morpho_valuetofloat(l->val.data[i], f+i)) return false;
+        return true;
+    }
+    return false;
+}
+
+/** Evaluates the function at n points */
+static bool levelset_evaluate(levelsetfunction *lf, int n, double *x, double *f) {
+    value ret=MORPHO_NIL;
+    if (n==0) return true;
+
+    if (lf->batch) {
+        value pts;
+        if (!levelset_points(lf, n, x, &pts) ||
+            !morpho_call(lf->v, lf->fn, 1, &pts, &ret)) return false;
+        if (levelset_copyvalues(ret, n, f)) return true;
+    } else {
+        value args[lf->dim];
+        int i;
+        for (i=0; i<n; i++) {
+            for (int k=0; k<lf->dim; k++) args[k]=MORPHO_FLOAT(x[i*lf->dim+k]);
+            if (!morpho_call(lf->v, lf->fn, lf->dim, args, &ret)) return false;
+            if (!morpho_valuetofloat(ret, f+i)) break;
+        }
+        if (i==n) return true;
+    }
+
+    morpho_runtimeerror(lf->v, LEVELSET_VALUE);
+    return false;
+}
+
+/** Evaluates the gradient at n points, using the gradient function if one was provided or central differences
+ *  with step h otherwise */
+static bool levelset_gradient(levelsetfunction *lf, int n, double *x, double h, double *g) {
+    int dim=lf->dim;
+    value ret=MORPHO_NIL;
+    if (n==0) return true;
+
+    if (MORPHO_ISNIL(lf->grad)) {
+        bool success=false;
+        double *xh=MORPHO_MALLOC(sizeof(double)*dim*n);
+        double *fp=MORPHO_MALLOC(sizeof(double)*2*n);
+        if (!xh || !fp) {
+            morpho_runtimeerror(lf->v, ERROR_ALLOCATIONFAILED);
+            goto levelset_gradient_cleanup;
+        }
+
+        double *fm=fp+n;
+        for (int k=0; k<dim; k++) {
+            memcpy(xh, x, sizeof(double)*dim*n);
+            for (int i=0; i<n; i++) xh[i*dim+k]+=h;
+            if (!levelset_evaluate(lf, n, xh, fp)) goto levelset_gradient_cleanup;
+            for (int i=0; i<n; i++) xh[i*dim+k]-=2*h;
+            if (!levelset_evaluate(lf, n, xh, fm)) goto levelset_gradient_cleanup;
+            for (int i=0; i<n; i++) g[i*dim+k]=(fp[i]-fm[i])/(2*h);
+        }
+        success=true;
+
+levelset_gradient_cleanup:
+        if (xh) MORPHO_FREE(xh);
+        if (fp) MORPHO_FREE(fp);
+        return success;
+    }
+
+    if (lf->batch) {
+        value pts;
+        if (!levelset_points(lf, n, x, &pts) ||
+            !morpho_call(lf->v, lf->grad, 1, &pts, &ret)) return false;
+        if (levelset_copyvalues(ret, dim*n, g)) return true;
+    } else {
+        value args[dim];
+        int i;
+        for (i=0; i<n; i++) {
+            for (int k=0; k<dim; k++) args[k]=MORPHO_FLOAT(x[i*dim+k]);
+            if (!morpho_call(lf->v, lf->grad, dim, args, &ret)) return false;
+            if (!levelset_copyvalues(ret, dim, g+i*dim)) break;
+        }
+        if (i==n) return true;
+    }
+
+    morpho_runtimeerror(lf->v, LEVELSET_GRADIENT);
+    return false;
+}
+
+/* **********************************************************************
+ * Marching simplices
+ * ********************************************************************** */
+
+/** Kuhn triangulation of the unit square and cube: each simplex is a chain of corners, labelled by bitmasks of
+ *  their coordinates, that adds one axis at a time */
+static int levelset_triangles[2][3] = { { 0, 1, 3 }, { 0, 2, 3 } };
+
+static int levelset_tetrahedra[6][4] = {
+    { 0, 1, 3, 7 }, { 0, 1, 5, 7 }, { 0, 2, 3, 7 },
+    { 0, 2, 6, 7 }, { 0, 4, 5, 7 }, { 0, 4, 6, 7 }
+};
+
+/** The grid is traversed one layer of cells at a time along the last axis; a layer of nodes is indexed by the
+ *  remaining axes. Vertices of the level set are keyed by a node of the grid and the bitmask of the edge from
+ *  it to the other node they lie between, or zero if they lie on the node itself. */
+typedef struct {
+    levelsetfunction *lf;
+    int dim;
+    int n[3]; // Number of nodes along each axis
+    double lower[3];
+    double h[3]; // Grid spacing along each axis
+    int nlayer; // Number of nodes in a layer
+    int ndir; // Number of edge directions from a node, including the node itself
+    int stride[3]; // Offset between adjacent nodes in a layer along each axis
+    int offset[8]; // Offset within its layer of each corner of a cell from the cell's base node
+
+    double *x; // Positions of the nodes in a layer
+    double *f[2]; // Function values on the current and next layer of nodes
+    elementid *id[2]; // Vertex on each edge from nodes in the current and next layer, or -1
+
+    varray_double vert;
+    varray_elementid el;
+} levelsetmesher;
+
+static void levelset_clearmesher(levelsetmesher *m) {
+    if (m->x) MORPHO_FREE(m->x);
+    for (int i=0; i<2; i++) {
+        if (m->f[i]) MORPHO_FREE(m->f[i]);
+        if (m->id[i]) MORPHO_FREE(m->id[i]);
+    }
+    varray_doubleclear(&m->vert);
+    varray_elementidclear(&m->el);
+}
+
+/** Samples the function on a layer of nodes */
+static bool levelset_sample(levelsetmesher *m, int layer, double *f) {
+    int dim=m->dim;
+    for (int i=0; i<m->nlayer; i++) {
+        int r=i;
+        for (int k=0; k<dim-1; k++) {
+            m->x[i*dim+k]=m->lower[k]+(r%m->n[k])*m->h[k];
+            r/=m->n[k];
+        }
+        m->x[i*dim+dim-1]=m->lower[dim-1]+layer*m->h[dim-1];
+    }
+    return levelset_evaluate(m->lf, m->nlayer, m->x, f);
+}
+
+/** Finds or creates the vertex between corners a and b of a cell, where the function is negative at a */
+static elementid levelset_vertex(levelsetmesher *m, int base, int layer, double *fc, int a, int b) {
+    int dim=m->dim;
+    int node=(fc[b]==0.0 ? b : a & b);
+    int dir=(fc[b]==0.0 ? 0 : a ^ b);
+    int slot=(node>>(dim-1)) & 1;
+    elementid *id=m->id[slot]+(base+m->offset[node])*m->ndir+dir;
+
+    if (*id<0) {
+        double t=0.0; // Fraction of the way along the edge from node
+        if (dir) {
+            t=fc[a]/(fc[a]-fc[b]);
+            if (node!=a) t=1.0-t;
+        }
+        double x[dim];
+        for (int k=0; k<dim; k++) {
+            int pos=(k<dim-1 ? (base/m->stride[k])%m->n[k] : layer);
+            x[k]=m->lower[k]+(pos+((node>>k) & 1)+t*((dir>>k) & 1))*m->h[k];
+        }
+        *id=m->vert.count/dim;
+        if (!varray_doubleadd(&m->vert, x, dim)) return -1;
+    }
+    return *id;
+}
+
+/** Adds an element, oriented so that its normal points along d, unless it is degenerate */
+static bool levelset_addelement(levelsetmesher *m, elementid *el, double *d) {
+    int dim=m->dim;
+    for (int i=0; i<dim; i++) {
+        if (el[i]<0) return false;
+        for (int j=0; j<i; j++) if (el[i]==el[j]) return true;
+    }
+
+    double *x0=m->vert.data+el[0]*dim, *x1=m->vert.data+el[1]*dim;
+    double s[3], dot;
+    for (int k=0; k<dim; k++) s[k]=x1[k]-x0[k];
+
+    if (dim==2) {
+        dot=s[1]*d[0]-s[0]*d[1];
+        if (dot<0) { elementid t=el[0]; el[0]=el[1]; el[1]=t; }
+    } else {
+        double *x2=m->vert.data+el[2]*dim, u[3];
+        for (int k=0; k<dim; k++) u[k]=x2[k]-x0[k];
+        dot=(s[1]*u[2]-s[2]*u[1])*d[0]+(s[2]*u[0]-s[0]*u[2])*d[1]+(s[0]*u[1]-s[1]*u[0])*d[2];
+        if (dot<0) { elementid t=el[1]; el[1]=el[2]; el[2]=t; }
+    }
+
+    return varray_elementidadd(&m->el, el, dim);
+}
+
+/** Meshes the level set within a simplex given by a chain of corners of a cell */
+static bool levelset_simplex(levelsetmesher *m, int base, int layer, double *fc, int *c) {
+    int dim=m->dim;
+    int neg[4], pos[4], nneg=0, npos=0;
+    for (int i=0; i<=dim; i++) {
+        if (fc[c[i]]<0) neg[nneg++]=c[i];
+        else pos[npos++]=c[i];
+    }
+    if (!nneg || !npos) return true;
+
+    // Direction from the negative to the positive corners
+    double d[3];
+    for (int k=0; k<dim; k++) {
+        double sp=0, sn=0;
+        for (int i=0; i<npos; i++) sp+=(pos[i]>>k) & 1;
+        for (int i=0; i<nneg; i++) sn+=(neg[i]>>k) & 1;
+        d[k]=(sp/npos-sn/nneg)*m->h[k];
+    }
+
+    elementid el[3];
+    if (nneg==1 || npos==1) { // Cut off a single corner
+        for (int i=0; i<dim; i++) {
+            if (nneg==1) el[i]=levelset_vertex(m, base, layer, fc, neg[0], pos[i]);
+            else el[i]=levelset_vertex(m, base, layer, fc, neg[i], pos[0]);
+        }
+        return levelset_addelement(m, el, d);
+    }
+
+    // A quadrilateral in a tetrahedron, split along its shorter diagonal
+    elementid q[4] = { levelset_vertex(m, base, layer, fc, neg[0], pos[0]),
+                       levelset_vertex(m, base, layer, fc, neg[0], pos[1]),
+                       levelset_vertex(m, base, layer, fc, neg[1], pos[1]),
+                       levelset_vertex(m, base, layer, fc, neg[1], pos[0]) };
+    for (int i=0; i<4; i++) if (q[i]<0) return false;
+
+    double l02=0, l13=0;
+    for (int k=0; k<dim; k++) {
+        double s=m->vert.data[q[2]*dim+k]-m->vert.data[q[0]*dim+k];
+        double t=m->vert.data[q[3]*dim+k]-m->vert.data[q[1]*dim+k];
+        l02+=s*s; l13+=t*t;
+    }
+
+    int r=(l02<=l13 ? 0 : 1);
+    el[0]=q[r]; el[1]=q[r+1]; el[2]=q[(r+2)%4];
+    if (!levelset_addelement(m, el, d)) return false;
+    el[0]=q[r]; el[1]=q[(r+2)%4]; el[2]=q[(r+3)%4];
+    return levelset_addelement(m, el, d);
+}
+
+/** Meshes the level set within the layer of cells between two layers of nodes */
+static bool levelset_layer(levelsetmesher *m, int layer) {
+    int dim=m->dim, ncorners=1<<dim;
+    int nsimplices=(dim==2 ? 2 : 6);
+
+    for (int base=0; base<m->nlayer; base++) {
+        bool interior=true;
+        for (int k=0; k<dim-1; k++) if ((base/m->stride[k])%m->n[k]==m->n[k]-1) interior=false;
+        if (!interior) continue;
+
+        double fc[8];
+        int nneg=0;
+        for (int c=0; c<ncorners; c++) {
+            fc[c]=m->f[(c>>(dim-1)) & 1][base+m->offset[c]];
+            if (fc[c]<0) nneg++;
+        }
+        if (nneg==0 || nneg==ncorners) continue;
+
+        for (int s=0; s<nsimplices; s++) {
+            int *c=(dim==2 ? levelset_triangles[s] : levelset_tetrahedra[s]);
+            if (!levelset_simplex(m, base, layer, fc, c)) return false;
+        }
+    }
+    return true;
+}
+
+/** Meshes the level set, producing vertex positions and elements */
+static bool levelset_march(levelsetmesher *m) {
+    int dim=m->dim;
+    size_t nids=(size_t) m->nlayer*m->ndir;
+
+    m->x=MORPHO_MALLOC(sizeof(double)*dim*m->nlayer);
+    for (int i=0; i<2; i++) {
+        m->f[i]=MORPHO_MALLOC(sizeof(double)*m->nlayer);
+        m->id[i]=MORPHO_MALLOC(sizeof(elementid)*nids);
+    }
+    if (!m->x || !m->f[0] || !m->f[1] || !m->id[0] || !m->id[1]) {
+        morpho_runtimeerror(m->lf->v, ERROR_ALLOCATIONFAILED);
+        return false;
+    }
+
+    for (size_t i=0; i<nids; i++) m->id[0][i]=-1;
+    if (!levelset_sample(m, 0, m->f[0])) return false;
+
+    for (int layer=0; layer<m->n[dim-1]-1; layer++) {
+        if (!levelset_sample(m, layer+1, m->f[1])) return false;
+        for (size_t i=0; i<nids; i++) m->id[1][i]=-1;
+
+        if (!levelset_layer(m, layer)) {
+            morpho_runtimeerror(m->lf->v, ERROR_ALLOCATIONFAILED);
+            return false;
+        }
+
+        // The next layer becomes the current one
+        double *fswap=m->f[0]; m->f[0]=m->f[1]; m->f[1]=fswap;
+        elementid *idswap=m->id[0]; m->id[0]=m->id[1]; m->id[1]=idswap;
+    }
+    return true;
+}
+
+/** Removes vertices that belong to no element, which arise where degenerate elements were discarded */
+static void levelset_compact(levelsetmesher *m) {
+    int dim=m->dim, nv=m->vert.count/dim;
+    elementid *map=MORPHO_MALLOC(sizeof(elementid)*(nv>0 ? nv : 1));
+    if (!map) return;
+
+    for (int i=0; i<nv; i++) map[i]=-1;
+    for (unsigned int i=0; i<m->el.count; i++) map[m->el.data[i]]=0;
+
+    int n=0;
+    for (int i=0; i<nv; i++) {
+        if (map[i]<0) continue;
+        if (n!=i) memcpy(m->vert.data+n*dim, m->vert.data+i*dim, sizeof(double)*dim);
+        map[i]=n++;
+    }
+    for (unsigned int i=0; i<m->el.count; i++) m->el.data[i]=map[m->el.data[i]];
+    m->vert.count=n*dim;
+    MORPHO_FREE(map);
+}
+
+/* **********************************************************************
+ * Projection
+ * ********************************************************************** */
+
+/** Moves points onto the level set by Newton's method; steps are limited to the grid spacing h */
+static bool levelset_project(levelsetfunction *lf, int n, double *x, double h) {
+    int dim=lf->dim, nactive=n;
+    bool success=false;
+    int *active=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    double *xa=MORPHO_MALLOC(sizeof(double)*(dim+1)*(n>0 ? n : 1));
+    double *ga=MORPHO_MALLOC(sizeof(double)*dim*(n>0 ? n : 1));
+    if (!active || !xa || !ga) {
+        morpho_runtimeerror(lf->v, ERROR_ALLOCATIONFAILED);
+        goto levelset_project_cleanup;
+    }
+    double *fa=xa+dim*n;
+
+    for (int i=0; i<n; i++) active[i]=i;
+
+    for (int iter=0; iter<LEVELSET_MAXITERATIONS && nactive>0; iter++) {
+        for (int j=0; j<nactive; j++) memcpy(xa+j*dim, x+active[j]*dim, sizeof(double)*dim);
+        if (!levelset_evaluate(lf, nactive, xa, fa) ||
+            !levelset_gradient(lf, nactive, xa, LEVELSET_FDSTEP*h, ga)) goto levelset_project_cleanup;
+
+        int nnext=0;
+        for (int j=0; j<nactive; j++) {
+            double *g=ga+j*dim, gg=0;
+            for (int k=0; k<dim; k++) gg+=g[k]*g[k];
+            if (gg==0.0 || !isfinite(gg) || !isfinite(fa[j])) continue;
+
+            double s=fa[j]/gg, norm=fabs(s)*sqrt(gg);
+            if (norm>h) s*=h/norm;
+            for (int k=0; k<dim; k++) x[active[j]*dim+k]-=s*g[k];
+            if (norm>LEVELSET_TOLERANCE*h) active[nnext++]=active[j];
+        }
+        nactive=nnext;
+    }
+    success=true;
+
+levelset_project_cleanup:
+    if (active) MORPHO_FREE(active);
+    if (xa) MORPHO_FREE(xa);
+    if (ga) MORPHO_FREE(ga);
+    return success;
+}
+
+/* **********************************************************************
+ * LevelSetMesh
+ * ********************************************************************** */
+
+static value levelset_projectoption;
+static value levelset_gradientoption;
+static value levelset_batchoption;
+
+/** Copies the coordinates of a corner given as a Matrix or a List */
+static bool levelset_corner(value in, int *dim, double *x) {
+    if (MORPHO_ISMATRIX(in)) {
+        objectmatrix *a=MORPHO_GETMATRIX(in);
+        *dim=matrix_countdof(a);
+        if (*dim<2 || *dim>3) return false;
+        memcpy(x, a->elements, sizeof(double)*(*dim));
+        return true;
+    } else if (MORPHO_ISLIST(in)) {
+        objectlist *l=MORPHO_GETLIST(in);
+        *dim=l->val.count;
+        if (*dim<2 || *dim>3) return false;
+        for (int k=0; k<*dim; k++) if (!morpho_valuetofloat(l->val.data[k], x+k)) return false;
+        return true;
+    }
+    return false;
+}
+
+/** Creates a Mesh of the zero set of a function within a box */
+value levelset_mesh(vm *v, int nargs, value *args) {
+    value project=MORPHO_TRUE, grad=MORPHO_NIL, batch=MORPHO_FALSE;
+    value out=MORPHO_NIL;
+    int nfixed=nargs;
+
+    if (!builtin_options(v, nargs, args, &nfixed, 3, levelset_projectoption, &project,
+                         levelset_gradientoption, &grad, levelset_batchoption, &batch)) return MORPHO_NIL;
+
+    levelsetfunction lf = { .v=v, .fn=MORPHO_NIL, .grad=grad, .batch=MORPHO_ISTRUE(batch) };
+    levelsetmesher m = { .lf=&lf };
+    varray_doubleinit(&m.vert);
+    varray_elementidinit(&m.el);
+
+    double lower[3], upper[3], h=0;
+    int udim=0;
+    if (nfixed!=4 || !MORPHO_ISCALLABLE(MORPHO_GETARG(args, 0)) ||
+        !(MORPHO_ISNIL(grad) || MORPHO_ISCALLABLE(grad)) ||
+        !levelset_corner(MORPHO_GETARG(args, 1), &lf.dim, lower) ||
+        !levelset_corner(MORPHO_GETARG(args, 2), &udim, upper) || udim!=lf.dim ||
+        !morpho_valuetofloat(MORPHO_GETARG(args, 3), &h) || !(h>0)) {
+        morpho_runtimeerror(v, LEVELSET_ARGS);
+        return MORPHO_NIL;
+    }
+    lf.fn=MORPHO_GETARG(args, 0);
+
+    m.dim=lf.dim;
+    m.ndir=1<<m.dim;
+    m.nlayer=1;
+    double hmin=0;
+    for (int k=0; k<m.dim; k++) {
+        double len=upper[k]-lower[k];
+        if (!(len>0)) {
+            morpho_runtimeerror(v, LEVELSET_ARGS);
+            return MORPHO_NIL;
+        }
+        m.n[k]=(int) ceil(len/h-1e-8)+1;
+        if (m.n[k]<2) m.n[k]=2;
+        m.h[k]=len/(m.n[k]-1);
+        m.lower[k]=lower[k];
+        if (k<m.dim-1) {
+            m.stride[k]=m.nlayer;
+            m.nlayer*=m.n[k];
+        }
+        if (k==0 || m.h[k]<hmin) hmin=m.h[k];
+    }
+    for (int c=0; c<m.ndir; c++) {
+        m.offset[c]=0;
+        for (int k=0; k<m.dim-1; k++) if ((c>>k) & 1) m.offset[c]+=m.stride[k];
+    }
+
+    if (!levelset_march(&m)) goto levelset_mesh_cleanup;
+    levelset_compact(&m);
+
+    int nv=m.vert.count/m.dim, nel=m.el.count/m.dim;
+    if (MORPHO_ISTRUE(project) &&
+        !levelset_project(&lf, nv, m.vert.data, hmin)) goto levelset_mesh_cleanup;
+
+    double zero[3] = { 0, 0, 0 };
+    objectmesh *new=object_newmesh(m.dim, nv, (nv>0 ? m.vert.data : zero));
+    objectsparse *conn=NULL;
+    if (new && new->vert && nel>0) {
+        conn=object_newsparse(NULL, NULL);
+        if (conn && sparseccs_resize(&conn->ccs, nv, nel, nel*m.dim, false)) {
+            memcpy(conn->ccs.rix, m.el.data, sizeof(elementid)*m.el.count);
+            for (int i=0; i<=nel; i++) conn->ccs.cptr[i]=i*m.dim;
+            mesh_setconnectivityelement(new, 0, m.dim-1, conn);
+            mesh_freezeconnectivity(new);
+        } else {
+            if (conn) object_free((object *) conn);
+            object_free((object *) new);
+            new=NULL;
+        }
+    }
+
+    if (new && new->vert) {
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    } else {
+        if (new) object_free((object *) new);
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    }
+
+levelset_mesh_cleanup:
+    levelset_clearmesher(&m);
+    return out;
+}
+
+/* **********************************************************************
+ * Initialization
+ * ********************************************************************** */
+
+void levelset_initialize(void) {
+    builtin_addfunction(LEVELSET_MESHFUNCTION, levelset_mesh, BUILTIN_FLAGSEMPTY);
+
+    levelset_projectoption=builtin_internsymbolascstring(LEVELSET_PROJECTOPTION);
+    levelset_gradientoption=builtin_internsymbolascstring(LEVELSET_GRADIENTOPTION);
+    levelset_batchoption=builtin_internsymbolascstring(LEVELSET_BATCHOPTION);
+
+    morpho_defineerror(LEVELSET_ARGS, ERROR_HALT, LEVELSET_ARGS_MSG);
+    morpho_defineerror(LEVELSET_VALUE, ERROR_HALT, LEVELSET_VALUE_MSG);
+    morpho_defineerror(LEVELSET_GRADIENT, ERROR_HALT, LEVELSET_GRADIENT_MSG);
+}
@@ -0,0 +1,62 @@
+/** @file levelset.h
+ *  @author T J Atherton
+ *
+ *  @brief Meshing of level sets of implicit functions by marching simplices
+ */
+
+#ifndef levelset_h
+#define levelset_h
+
+#include "mesh.h"
+
+/* -------------------------------------------------------
+ * Level set meshing
+ * ------------------------------------------------------- */
+
+/** The zero set of a function of two or three variables is meshed by sampling the function on a regular grid that
+    covers a box and dividing each cell of the grid into simplices, triangles in 2D and tetrahedra in 3D, using the
+    Kuhn triangulation so that neighboring cells meet consistently. Within each simplex the function is treated as
+    linear, so the zero set is a line segment or a triangle, or a pair of triangles if the simplex has two vertices
+    on each side, with vertices lying on the edges of the simplex that change sign. These vertices are keyed by the
+    edge of the grid they lie on, so that they are shared between every simplex that contains it and the resulting
+    mesh is connected. Elements are oriented so that their normals point towards increasing values of the function.
+    The grid is processed one layer at a time, so that only two layers of samples are held, and the function is
+    evaluated either once per point or, in batch mode, once per layer with a Matrix whose columns are the points.
+    Vertices may then be projected onto the zero set by Newton's method, using the gradient of the function or a
+    finite difference approximation to it. */
+
+#define LEVELSET_MESHFUNCTION               "LevelSetMesh"
+
+#define LEVELSET_PROJECTOPTION              "project"
+#define LEVELSET_GRADIENTOPTION             "gradient"
+#define LEVELSET_BATCHOPTION                "batch"
+
+/** Maximum number of Newton iterations used to project vertices onto the level set */
+#define LEVELSET_MAXITERATIONS              20
+
+/** Convergence tolerance for projection, relative to the grid spacing */
+#define LEVELSET_TOLERANCE                  1e-12
+
+/** Step used for finite difference gradients, relative to the grid spacing */
+#define LEVELSET_FDSTEP                     1e-6
+
+/* -------------------------------------------------------
+ * Errors
+ * ------------------------------------------------------- */
+
+#define LEVELSET_ARGS                       "LvlStArgs"
+#define LEVELSET_ARGS_MSG                   "LevelSetMesh expects a function, lower and upper corners of a box in two or three dimensions and a positive grid spacing."
+
+#define LEVELSET_VALUE                      "LvlStVal"
+#define LEVELSET_VALUE_MSG                  "LevelSetMesh function must return a number for each point."
+
+#define LEVELSET_GRADIENT                   "LvlStGrad"
+#define LEVELSET_GRADIENT_MSG               "LevelSetMesh gradient must return a Matrix with a component for each coordinate of each point."
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+void levelset_initialize(void);
+
+#endif /* levelset_h */
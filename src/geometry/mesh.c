@@ -7,16 +7,31 @@
 #include "morpho.h"
 #include "classes.h"
 #include "mesh.h"
+#include "meshindex.h"
+#include "meshadjacency.h"
+#include "meshreorder.h"
+#include "meshrefine.h"
+#include "meshflip.h"
+#include "meshmerge.h"
+#include "meshprune.h"
+#include "meshslice.h"
 #include "file.h"
 #include "parse.h"
 #include "sparse.h"
 #include "matrix.h"
 #include "selection.h"
+#include "field.h"
+#include "matrixio.h"
+#include "threadpool.h"
 
 // Temporary include
 #include "integrate.h"
 
+#include <ctype.h>
 #include <limits.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
 
 void mesh_link(objectmesh *mesh, object *obj);
 
@@ -49,6 +64,8 @@ void objectmesh_freefn(object *obj) {
         }
     }
     if (m->conn) object_free((object *) m->conn);
+    meshindex_free(m->index);
+    meshadjacency_free(m->adjacency);
 }
 
 size_t objectmesh_sizefn(object *obj) {
@@ -78,6 +95,8 @@ objectmesh *object_newmesh(unsigned int dim, unsigned int nv, double *v) {
         new->conn=NULL;
         new->vert=object_newmatrix(dim, nv, false);
         new->link=NULL;
+        new->index=NULL;
+        new->adjacency=NULL;
         if (new->vert) {
             mesh_link(new, (object *) new->vert);
             if (dim>0){
@@ -143,7 +162,8 @@ bool mesh_getvertexcoordinatesaslist(objectmesh *mesh, elementid id, double **ou
 }
 
 /** Gets vertex coordinates */
-bool mesh_setvertexcoordinates(objectmesh *mesh, elementid id, double *x) {;
+bool mesh_setvertexcoordinates(objectmesh *mesh, elementid id, double *x) {
+    meshindex_moved(mesh);
     return matrix_setcolumn(mesh->vert, id, x);
 }
 
@@ -167,19 +187,7 @@ bool mesh_getvertexcoordinatesasvalues(objectmesh *mesh, elementid id, value *va
  * @param[out] separation (optional)
  * @returns true on success. */
 bool mesh_nearestvertex(objectmesh *mesh, double *x, elementid *id, double *separation) {
-    double *vx;
-    double best=0, sep=0;
-    elementid bestid=0;
-
-    for (elementid i=0; i<mesh_nvertices(mesh); i++) {
-        if (!matrix_getcolumn(mesh->vert, i, &vx)) return false;
-        sep=0;
-        for (int k=0; k<mesh->dim; k++) sep+=(vx[k]-x[k])*(vx[k]-x[k]);
-        if (i==0 || sep<best) { best=sep; bestid = i; }
-    }
-    *id = bestid;
-    if (separation) *separation=sqrt(best);
-    return true;
+    return meshindex_nearest(mesh, MESH_GRADE_VERTEX, x, id, separation);
 }
 
 
@@ -215,6 +223,8 @@ objectsparse *mesh_newconnectivityelement(objectmesh *mesh, unsigned int row, un
 
     out=object_newsparse(NULL, NULL);
     if (out) array_setelement(mesh->conn, 2, indx, MORPHO_OBJECT(out));
+    if (row==0) meshindex_invalidate(mesh, col);
+    meshadjacency_invalidate(mesh);
 
     if (out) mesh_link(mesh, (object *) out);
 
@@ -225,6 +235,8 @@ objectsparse *mesh_newconnectivityelement(objectmesh *mesh, unsigned int row, un
 bool mesh_setconnectivityelement(objectmesh *mesh, unsigned int row, unsigned int col, objectsparse *el) {
     if (row==col) return false;
     unsigned int indx[2]={row,col};
+    if (row==0) meshindex_invalidate(mesh, col);
+    meshadjacency_invalidate(mesh);
     if (mesh_checkconnectivity(mesh)) {
         value old = MORPHO_NIL;
         if ((array_getelement(mesh->conn, 2, indx, &old)==ARRAY_OK) &&
@@ -312,60 +324,280 @@ bool mesh_getconnectivity(objectsparse *conn, elementid id, int *nentries, int *
  * Functions to modify the connectivity array
  * ------------------------------------------ */
 
-/* Data structure to store ntuples of elementids and determine if a
-   particular ntuple is already present. */
+/* Elements of a new grade are generated as tuples of vertex ids drawn from the elements of a higher grade.
+   Tuples are generated in parallel, and duplicates identified with hash tables, each of which holds the tuples
+   whose hashes fall in one partition so that the tables can be filled in parallel. New elements are numbered in
+   the order in which they are first encountered, and written directly into the connectivity matrix. */
+
+/** Hash table of tuples of vertex ids, stored externally */
 typedef struct {
-    int n; // number of elements in a tuple
-    elementid maxval; // Maximum elementid that will be used
-    int *elementoffset; // Offset to tuples based on first element of the tuple
-    varray_elementid tuples; // data store
-} ntuplelist;
+    int n; // Number of vertex ids in a tuple
+    elementid *tuples; // Tuple i occupies tuples[i*n] ... tuples[i*n+n-1]
+    unsigned int size; // Number of slots; a power of 2
+    unsigned int count; // Number of occupied slots
+    int *slots; // Index of the tuple in each slot or -1 if empty
+} meshtuplehash;
+
+/** Hash function for a tuple */
+static uint64_t meshtuplehash_hash(int n, elementid *tuple) {
+    uint64_t h=0x9E3779B97F4A7C15ULL;
+    for (int i=0; i<n; i++) {
+        h^=(uint32_t) tuple[i];
+        h*=0xFF51AFD7ED558CCDULL;
+        h^=h>>32;
+    }
+    return h;
+}
 
-/* Initialize an ntuplelist data structure */
-void ntuplelist_init(ntuplelist *list, int n, elementid maxval) {
-    list->n=n;
-    list->maxval=maxval;
-    list->elementoffset=MORPHO_MALLOC(sizeof(int)*(maxval+1));
-    if (list->elementoffset) for (unsigned int i=0; i<=maxval; i++) list->elementoffset[i]=-1;
-    varray_elementidinit(&list->tuples);
+static bool meshtuplehash_init(meshtuplehash *table, int n, elementid *tuples, unsigned int expected) {
+    table->n=n;
+    table->tuples=tuples;
+    table->count=0;
+    table->size=16;
+    while (table->size<2*expected) table->size*=2;
+    table->slots=MORPHO_MALLOC(sizeof(int)*table->size);
+    if (table->slots) for (unsigned int i=0; i<table->size; i++) table->slots[i]=-1;
+    return table->slots;
 }
 
-/* Clear ntuplelist data structure */
-void ntuplelist_clear(ntuplelist *list) {
-    if (list->elementoffset) MORPHO_FREE(list->elementoffset);
-    varray_elementidclear(&list->tuples);
+static void meshtuplehash_clear(meshtuplehash *table) {
+    if (table->slots) MORPHO_FREE(table->slots);
+    table->slots=NULL;
 }
 
-/* Add a tuple */
-void ntuplelist_add(ntuplelist *list, elementid *tuple) {
-    unsigned int posn = list->tuples.count;
-    if (posn>INT_MAX) UNREACHABLE("Overflow in ntuplelist_add");
-    varray_elementidadd(&list->tuples, tuple, list->n);
-    if (list->elementoffset) { // Store an offset to the first
-        varray_elementidwrite(&list->tuples, list->elementoffset[tuple[0]]);
-        list->elementoffset[tuple[0]]=posn;
+/** Finds the slot for a tuple; the slot is either empty or holds a matching tuple */
+static unsigned int meshtuplehash_slot(meshtuplehash *table, elementid *tuple, uint64_t hash) {
+    unsigned int mask=table->size-1, i=(unsigned int) hash & mask;
+    for (;;) {
+        int k=table->slots[i];
+        if (k<0 || memcmp(table->tuples+((size_t) k)*table->n, tuple, sizeof(elementid)*table->n)==0) return i;
+        i=(i+1) & mask;
     }
 }
 
-/* Compare two tuples */
-bool ntuplelist_compare(int n, elementid *t1, elementid *t2) {
-    for (unsigned int i=0; i<n; i++) if (t1[i]!=t2[i]) return false;
+static bool meshtuplehash_grow(meshtuplehash *table) {
+    int *old=table->slots;
+    unsigned int oldsize=table->size;
+
+    table->size*=2;
+    table->slots=MORPHO_MALLOC(sizeof(int)*table->size);
+    if (!table->slots) { table->slots=old; table->size=oldsize; return false; }
+    for (unsigned int i=0; i<table->size; i++) table->slots[i]=-1;
+
+    for (unsigned int i=0; i<oldsize; i++) {
+        if (old[i]<0) continue;
+        elementid *t=table->tuples+((size_t) old[i])*table->n;
+        table->slots[meshtuplehash_slot(table, t, meshtuplehash_hash(table->n, t))]=old[i];
+    }
+    MORPHO_FREE(old);
     return true;
 }
 
-/* Determine whether a tuple is present in an ntuplelist */
-bool ntuplelist_find(ntuplelist *list, elementid *tuple) {
-    if (list->elementoffset) {
-        for (int i=list->elementoffset[tuple[0]]; i>=0; ) {
-            if (ntuplelist_compare(list->n, &list->tuples.data[i], tuple)) return true;
-            i=list->tuples.data[i+list->n];
-        }
-    } else {
-        for (unsigned int i=0; i<list->tuples.count; i+=list->n) {
-            if (ntuplelist_compare(list->n, &list->tuples.data[i], tuple)) return true;
+/** Inserts tuple k if no matching tuple is present
+ * @returns the index of the matching tuple, k if the tuple was inserted, or -1 on allocation failure */
+static int meshtuplehash_insert(meshtuplehash *table, int k, uint64_t hash) {
+    elementid *t=table->tuples+((size_t) k)*table->n;
+    unsigned int i=meshtuplehash_slot(table, t, hash);
+    if (table->slots[i]>=0) return table->slots[i];
+
+    if (2*(table->count+1)>table->size) {
+        if (!meshtuplehash_grow(table)) return -1;
+        i=meshtuplehash_slot(table, t, hash);
+    }
+    table->slots[i]=k;
+    table->count++;
+    return k;
+}
+
+/** Finds a tuple, returning its index or -1 if not present */
+static int meshtuplehash_find(meshtuplehash *table, elementid *tuple) {
+    return table->slots[meshtuplehash_slot(table, tuple, meshtuplehash_hash(table->n, tuple))];
+}
+
+/** Sorts a short tuple in place */
+void mesh_sorttuple(int n, elementid *tuple) {
+    for (int i=1; i<n; i++) {
+        elementid t=tuple[i];
+        int j=i;
+        while (j>0 && tuple[j-1]>t) { tuple[j]=tuple[j-1]; j--; }
+        tuple[j]=t;
+    }
+}
+
+/** Number of ways to choose n of k items */
+int mesh_ncombinations(int k, int n) {
+    if (n>k) return 0;
+    long c=1;
+    for (int i=1; i<=n; i++) c=c*(k-n+i)/i;
+    return (int) c;
+}
+
+/** Writes the tuples of n vertices drawn from an element's vertices, in lexicographic order of position */
+void mesh_elementtuples(int nel, int *entries, int n, elementid *out) {
+    int counter[n];
+    for (int i=0; i<n; i++) counter[i]=i;
+
+    for (;;) {
+        for (int i=0; i<n; i++) out[i]=entries[counter[i]];
+        mesh_sorttuple(n, out);
+        out+=n;
+
+        /* Advance to the next combination */
+        int k=n-1;
+        while (k>=0 && counter[k]==nel-n+k) k--;
+        if (k<0) break;
+        counter[k]++;
+        for (int i=k+1; i<n; i++) counter[i]=counter[i-1]+1;
+    }
+}
+
+/** Number of tasks to divide work of a given size between; large meshes use the shared thread pool */
+int mesh_ntasks(size_t work) {
+    int nthreads=morpho_threadnumber();
+    if (nthreads<2 || work<MESH_PARALLELTHRESHOLD) return 1;
+    return (threadpool_shared() ? nthreads : 1);
+}
+
+/** Runs tasks, in parallel if there is more than one */
+bool mesh_runtasks(int ntasks, workfn fn, void *tasks, size_t tasksize) {
+    threadpool *pool=threadpool_shared();
+    if (ntasks==1 || !pool) {
+        bool success=true;
+        for (int i=0; i<ntasks; i++) success &= fn(((char *) tasks)+i*tasksize);
+        return success;
+    }
+
+    for (int i=0; i<ntasks; i++) threadpool_add_task(pool, fn, ((char *) tasks)+i*tasksize);
+    threadpool_fence(pool);
+    return true;
+}
+
+typedef struct {
+    objectsparse *el; // Connectivity of the elements the tuples are drawn from
+    int n; // Number of vertices per tuple
+    elementid start, end; // Range of elements or tuples to process
+    int *offset; // Index of the first tuple generated by each element
+    elementid *tuples;
+    int ntuples;
+    int partition, npartitions; // Partition of the hash values handled by a task
+    char *isnew; // Set for the first occurrence of each tuple
+    bool success;
+} meshtupletask;
+
+/** Generates the tuples for a range of elements */
+static bool mesh_generatetuplestask(void *arg) {
+    meshtupletask *task = (meshtupletask *) arg;
+    sparseccs *ccs=&task->el->ccs;
+    for (elementid id=task->start; id<task->end; id++) {
+        int nel=ccs->cptr[id+1]-ccs->cptr[id];
+        if (nel<task->n) continue;
+        mesh_elementtuples(nel, ccs->rix+ccs->cptr[id], task->n, task->tuples+((size_t) task->offset[id])*task->n);
+    }
+    task->success=true;
+    return true;
+}
+
+/** Identifies the first occurrence of each tuple whose hash lies in the task's partition */
+static bool mesh_uniquetuplestask(void *arg) {
+    meshtupletask *task = (meshtupletask *) arg;
+    meshtuplehash table;
+    task->success=false;
+    if (!meshtuplehash_init(&table, task->n, task->tuples, task->ntuples/task->npartitions/2+1)) return true;
+
+    for (int k=0; k<task->ntuples; k++) {
+        elementid *t=task->tuples+((size_t) k)*task->n;
+        uint64_t hash=meshtuplehash_hash(task->n, t);
+        if (task->npartitions>1 && (int) ((hash>>48) % task->npartitions)!=task->partition) continue;
+
+        int match=meshtuplehash_insert(&table, k, hash);
+        if (match<0) { meshtuplehash_clear(&table); return true; }
+        task->isnew[k]=(match==k);
+    }
+
+    meshtuplehash_clear(&table);
+    task->success=true;
+    return true;
+}
+
+/** Identifies the first occurrence of each tuple in a list, using several tasks for long lists
+ * @param[in] n - number of vertex ids per tuple
+ * @param[in] ntuples - number of tuples
+ * @param[in] tuples - the tuples, each of which must be sorted
+ * @param[out] isnew - set for the first occurrence of each tuple and cleared otherwise
+ * @returns true on success */
+bool mesh_uniquetuples(int n, int ntuples, elementid *tuples, char *isnew) {
+    int ntasks=mesh_ntasks(ntuples);
+    meshtupletask tasks[ntasks];
+    for (int i=0; i<ntasks; i++) {
+        tasks[i] = (meshtupletask) { .n=n, .tuples=tuples, .ntuples=ntuples,
+                                     .partition=i, .npartitions=ntasks, .isnew=isnew, .success=false };
+    }
+
+    mesh_runtasks(ntasks, mesh_uniquetuplestask, tasks, sizeof(meshtupletask));
+    for (int i=0; i<ntasks; i++) if (!tasks[i].success) return false;
+    return true;
+}
+
+/** Generates elements of grade g from the elements of a higher grade
+ * @param[in] el - connectivity matrix of the higher grade
+ * @param[in] nv - number of vertices
+ * @param[in] g - grade to generate
+ * @param[out] out - CCS connectivity matrix for the new grade
+ * @returns true on success */
+static bool mesh_generategrade(objectsparse *el, int nv, grade g, sparseccs *out) {
+    sparseccs *ccs=&el->ccs;
+    int n=g+1, nelements=ccs->ncols;
+    bool success=false;
+
+    /* Count the tuples generated by each element */
+    int *offset=MORPHO_MALLOC(sizeof(int)*(nelements+1));
+    if (!offset) return false;
+    size_t ntuples=0;
+    for (elementid id=0; id<nelements; id++) {
+        offset[id]=(int) ntuples;
+        ntuples+=mesh_ncombinations(ccs->cptr[id+1]-ccs->cptr[id], n);
+    }
+    offset[nelements]=(int) ntuples;
+
+    elementid *tuples=NULL;
+    char *isnew=NULL;
+    if (ntuples>INT_MAX) goto mesh_generategrade_cleanup;
+    tuples=MORPHO_MALLOC(sizeof(elementid)*n*(ntuples>0 ? ntuples : 1));
+    isnew=MORPHO_MALLOC(sizeof(char)*(ntuples>0 ? ntuples : 1));
+    if (!tuples || !isnew) goto mesh_generategrade_cleanup;
+
+    { // Generate tuples, then find the first occurrence of each
+        int ntasks=mesh_ntasks(ntuples);
+        meshtupletask tasks[ntasks];
+        for (int i=0; i<ntasks; i++) {
+            tasks[i] = (meshtupletask) { .el=el, .n=n, .offset=offset, .tuples=tuples, .success=false };
+            tasks[i].start=(elementid) (((long) nelements*i)/ntasks);
+            tasks[i].end=(elementid) (((long) nelements*(i+1))/ntasks);
         }
+
+        mesh_runtasks(ntasks, mesh_generatetuplestask, tasks, sizeof(meshtupletask));
+        if (!mesh_uniquetuples(n, (int) ntuples, tuples, isnew)) goto mesh_generategrade_cleanup;
     }
-    return false;
+
+    /* Number the new elements in order of first occurrence */
+    int nnew=0;
+    for (size_t k=0; k<ntuples; k++) if (isnew[k]) nnew++;
+
+    if (!sparseccs_resize(out, nv, nnew, nnew*n, false)) goto mesh_generategrade_cleanup;
+    out->cptr[0]=0;
+    for (size_t k=0, j=0; k<ntuples; k++) {
+        if (!isnew[k]) continue;
+        memcpy(out->rix+j*n, tuples+k*n, sizeof(elementid)*n);
+        out->cptr[j+1]=(int) (j+1)*n;
+        j++;
+    }
+    success=true;
+
+mesh_generategrade_cleanup:
+    MORPHO_FREE(offset);
+    if (tuples) MORPHO_FREE(tuples);
+    if (isnew) MORPHO_FREE(isnew);
+    return success;
 }
 
 objectsparse *mesh_addgrade(objectmesh *mesh, grade g) {
@@ -380,59 +612,17 @@ objectsparse *mesh_addgrade(objectmesh *mesh, grade g) {
     }
     /* if this grade doesn't exist and we can't find the next available
        grade above it return NULL */
-    if (!el) return NULL;
+    if (!el || !sparse_checkformat(el, SPARSE_CCS, true, false)) return NULL;
 
     /* Create a new sparse matrix */
     objectsparse *new=object_newsparse(NULL, NULL);
     if (!new) return NULL;
 
-    /* Create an ntuplelist to keep track of elements already created */
-    ntuplelist list;
-    int n = g+1; // Number of elements in the tuple
-    elementid maxvid = mesh_nvertices(mesh)-1; // Highest vertexid
-    ntuplelist_init(&list, n, maxvid);
-
-    int nel, *entries;
-    elementid newid = 0;
-    /* Loop over elements in the higher grade */
-    for (elementid id=0; id<el->ccs.ncols; id++) {
-        /* Get the associated connectivity */
-        if (!mesh_getconnectivity(el, id, &nel, &entries)) break;
-
-        // Initialize n-tuple and counters with [0,1,2...]
-        elementid tuple[n]; // Store the tuple
-        int counter[n], cmax[n]; // Counters
-        for (unsigned int i=0; i<n; i++) {
-            counter[i]=i; tuple[i]=entries[i]; cmax[i]=nel-n+i;
-        }
-
-        if (!ntuplelist_find(&list, tuple)) { // Check if the first tuple exists
-            ntuplelist_add(&list, tuple);
-            for (unsigned int i=0; i<n; i++) sparsedok_insert(&new->dok, tuple[i], newid, MORPHO_NIL);
-            newid++;
-        }
-
-        /* Generate tuples */
-        int k;
-        while (counter[0]<cmax[0]) {
-            counter[n-1]++; // Increment last counter
-            for (k=n-1; k>=0 && counter[k]>cmax[k]; k--) counter[k-1]++; // Carry
-            if (k<n-1) for (unsigned int i=k+1; i<n; i++) counter[i]=counter[i-1]+1;
-
-            // Set up tuple from counter
-            for (unsigned int i=0; i<n; i++) tuple[i]=entries[counter[i]];
-
-            if (!ntuplelist_find(&list, tuple)) { // Check if we have the tuple
-                ntuplelist_add(&list, tuple);
-                for (unsigned int i=0; i<n; i++) sparsedok_insert(&new->dok, tuple[i], newid, MORPHO_NIL);
-                newid++;
-            }
-        }
-
+    if (!mesh_generategrade(el, mesh_nvertices(mesh), g, &new->ccs)) {
+        object_free((object *) new);
+        return NULL;
     }
 
-    ntuplelist_clear(&list);
-
     mesh_setconnectivityelement(mesh, 0, g, new);
     mesh_link(mesh, (object *) new);
     mesh_freezeconnectivity(mesh);
@@ -519,95 +709,123 @@ objectsparse *mesh_addgradeold(objectmesh *mesh, grade g) {
 }
 
 
-/** Internal function used for sorting ids */
+typedef struct {
+    meshtuplehash *table; // Elements of the lower grade
+    sparseccs *upper; // Elements of the higher grade
+    int n; // Number of vertices in an element of the lower grade
+    elementid start, end; // Range of higher elements to process
+    int *count; // Number of lower elements found in each higher element
+    varray_int rix; // Lower elements found, in order
+    bool success;
+} meshlowertask;
+
 static int mesh_compareid(const void *a, const void *b) {
     return *((int *) a) - *((int *) b);
 }
 
-/** Find elements that match grade g in a connectivity matrix .
- * @param[in] vmatrix - the (g, 0) connectivity matrix (i.e. the vertex raising matrix for grade g)
- * @param[in] g - the grade of interest
- * @param[in] nids - number of vertex ids to match
- * @param[in] ids - list of vertex ids to match
- * @param[in] maxmatches - maximum number of matches to find
- * @param[out] nmatches - the number of matches found
- * @param[out] matches - matched vertex ids
- * @returns true on success, false otherwise */
-static bool mesh_matchelements(objectsparse *vmatrix, grade g, int nids, int *ids, int maxmatches, int *nmatches, int *matches) {
-    int nentries[nids], *entries[nids], length=0, k=0;
-
-    /* Obtain connectivity information from the columns of vertex connectivity matrix */
-    for (unsigned int i=0; i<nids; i++) {
-        if (!mesh_getconnectivity(vmatrix, ids[i], &nentries[i], &entries[i])) return false;
-        length+=nentries[i];
-    }
-
-    /* Copy ids a single list */
-    int sids[length+1]; sids[length]=-1;
-    for (unsigned int i=0; i<nids; i++) {
-        memcpy(sids+k, entries[i], nentries[i]*sizeof(int));
-        k+=nentries[i];
-    }
-
-    /* and sort it */
-    qsort(sids, length, sizeof(int), mesh_compareid);
-
-    //for (unsigned int i=0; i<length; i++) printf("%u ", sids[i]);
-    //printf("\n");
-
-    /* Now look for repeated ids */
-    k=0; *nmatches=0;
-    for (unsigned int i=0; i<length; i++) {
-        if (sids[i+1]==sids[i]) { k++; continue; } // Keep counting if the next one is the same
-        if (k==g) { // if the number of repeats matches the grade we have a match
-            if (*nmatches<maxmatches) matches[*nmatches]=sids[i];
-            *nmatches+=1;
+/** Finds the elements of the lower grade contained in each of a range of higher elements */
+static bool mesh_lowertask(void *arg) {
+    meshlowertask *task = (meshlowertask *) arg;
+    sparseccs *upper=task->upper;
+    int n=task->n;
+    task->success=false;
+
+    for (elementid id=task->start; id<task->end; id++) {
+        int nel=upper->cptr[id+1]-upper->cptr[id];
+        int nt=mesh_ncombinations(nel, n), nfound=0;
+        task->count[id]=0;
+        if (nt==0) continue;
+
+        elementid tuples[nt*n];
+        int found[nt];
+        mesh_elementtuples(nel, upper->rix+upper->cptr[id], n, tuples);
+        for (int k=0; k<nt; k++) {
+            int match=meshtuplehash_find(task->table, tuples+k*n);
+            if (match>=0) found[nfound++]=match;
         }
-        k=0; // Reset counter
+
+        qsort(found, nfound, sizeof(int), mesh_compareid);
+        if (!varray_intadd(&task->rix, found, nfound)) return true;
+        task->count[id]=nfound;
     }
 
+    task->success=true;
     return true;
 }
 
-/** Adds a missing grade lowering element */
+/** Adds a missing grade lowering element, which records the elements of grade row contained in each element of grade col */
 static objectsparse *mesh_addlowermatrix(objectmesh *mesh, unsigned int row, unsigned int col) {
-    objectsparse *new=NULL;
-
-    /* Try to obtain the (row, 0) element (i.e. the grade raising matrix for the row) */
-    objectsparse *traise=mesh_getconnectivityelement(mesh, row, 0);
-    if (!traise) traise=mesh_addconnectivityelement(mesh, row, 0);
+    objectsparse *lower=mesh_getconnectivityelement(mesh, 0, row);
+    objectsparse *upper=mesh_getconnectivityelement(mesh, 0, col);
+    if (!lower || !upper ||
+        !sparse_checkformat(lower, SPARSE_CCS, true, false) ||
+        !sparse_checkformat(upper, SPARSE_CCS, true, false)) return NULL;
 
-    /* Also need to obtain the (0, col) element (i.e. the grade definition) */
-    objectsparse *tlower=mesh_getconnectivityelement(mesh, 0, col);
+    int n=row+1, nlower=lower->ccs.ncols, nupper=upper->ccs.ncols;
+    objectsparse *new=NULL;
+    bool success=false;
+
+    /* Table of the lower elements, keyed by their sorted vertex ids */
+    meshtuplehash table = { .slots=NULL };
+    elementid *tuples=MORPHO_MALLOC(sizeof(elementid)*n*(nlower>0 ? nlower : 1));
+    int *count=MORPHO_MALLOC(sizeof(int)*(nupper>0 ? nupper : 1));
+    if (!tuples || !count || !meshtuplehash_init(&table, n, tuples, nlower)) goto mesh_addlowermatrix_cleanup;
+
+    for (elementid id=0; id<nlower; id++) {
+        elementid *t=tuples+((size_t) id)*n;
+        int nel=lower->ccs.cptr[id+1]-lower->ccs.cptr[id];
+        if (nel!=n) goto mesh_addlowermatrix_cleanup; // Malformed element
+        memcpy(t, lower->ccs.rix+lower->ccs.cptr[id], sizeof(elementid)*n);
+        mesh_sorttuple(n, t);
+        if (meshtuplehash_insert(&table, id, meshtuplehash_hash(n, t))<0) goto mesh_addlowermatrix_cleanup;
+    }
 
-    if (traise && tlower) {
-        /* Create a new sparse matrix */
-        new=object_newsparse(NULL, NULL);
-        if (!new) return NULL;
+    { // Search each higher element for the lower elements it contains
+        int ntasks=mesh_ntasks(((size_t) nupper)*mesh_ncombinations(col+1, n));
+        meshlowertask tasks[ntasks];
+        for (int i=0; i<ntasks; i++) {
+            tasks[i] = (meshlowertask) { .table=&table, .upper=&upper->ccs, .n=n, .count=count, .success=false };
+            tasks[i].start=(elementid) (((long) nupper*i)/ntasks);
+            tasks[i].end=(elementid) (((long) nupper*(i+1))/ntasks);
+            varray_intinit(&tasks[i].rix);
+        }
+        mesh_runtasks(ntasks, mesh_lowertask, tasks, sizeof(meshlowertask));
 
-        int maxmatches = (col+1)*(col+2)/2+1; // Maximum number of elements for a given grade
-        int nentries, *entries, nmatches, matches[maxmatches];
+        success=true;
+        int nentries=0;
+        for (int i=0; i<ntasks; i++) {
+            if (!tasks[i].success) success=false;
+            nentries+=tasks[i].rix.count;
+        }
 
-        /* Loop over elements in the higher grade */
-        for (elementid rid=0; rid<tlower->ccs.ncols; rid++) {
-            /* Get the associated connectivity */
-            if (mesh_getconnectivity(tlower, rid, &nentries, &entries)) {
-                if (mesh_matchelements(traise, row, nentries, entries, maxmatches, &nmatches, matches)) {
-                    if (nmatches>=maxmatches) {
-                        UNREACHABLE("Too many connections.");
-                    }
+        /* Assemble the connectivity matrix from the results of each task, which cover consecutive columns */
+        if (success) {
+            new=object_newsparse(NULL, NULL);
+            if (!new || !sparseccs_resize(&new->ccs, nlower, nupper, nentries, false)) success=false;
+        }
 
-                    for (unsigned int i=0; i<nmatches; i++) {
-                        sparsedok_insert(&new->dok, matches[i], rid, MORPHO_NIL);
-                    }
-                }
+        if (success) {
+            new->ccs.cptr[0]=0;
+            for (elementid id=0; id<nupper; id++) new->ccs.cptr[id+1]=new->ccs.cptr[id]+count[id];
+            for (int i=0, k=0; i<ntasks; i++) {
+                if (tasks[i].rix.count) memcpy(new->ccs.rix+k, tasks[i].rix.data, sizeof(int)*tasks[i].rix.count);
+                k+=tasks[i].rix.count;
             }
+
+            mesh_setconnectivityelement(mesh, row, col, new);
+            mesh_freezeconnectivity(mesh);
+        } else if (new) {
+            object_free((object *) new);
+            new=NULL;
         }
 
-        mesh_setconnectivityelement(mesh, row, col, new);
-        mesh_freezeconnectivity(mesh);
+        for (int i=0; i<ntasks; i++) varray_intclear(&tasks[i].rix);
     }
 
+mesh_addlowermatrix_cleanup:
+    meshtuplehash_clear(&table);
+    if (tuples) MORPHO_FREE(tuples);
+    if (count) MORPHO_FREE(count);
     return new;
 }
 
@@ -719,6 +937,8 @@ bool mesh_addsymmetry(vm *v, objectmesh *mesh, value symmetry, objectselection *
     value ret = MORPHO_NIL;
 
     if (morpho_lookupmethod(symmetry, MORPHO_OBJECT(&s), &method)) {
+        meshindex_refit(mesh); // Vertices may have moved since the index was last used
+
         /* Loop over vertices */
         for (elementid i=0; i<nv; i++) {
             /* Read the vertex coordinates into x */
@@ -741,6 +961,7 @@ bool mesh_addsymmetry(vm *v, objectmesh *mesh, value symmetry, objectselection *
                     if (!sym) return false;
 
                     sparse_setelement(sym, i, nearest, symmetry);
+                    meshadjacency_invalidate(mesh);
                 }
             }
         }
@@ -755,6 +976,13 @@ bool mesh_getsynonyms(objectmesh *mesh, grade g, elementid id, varray_elementid
     objectsparse *sym = mesh_getconnectivityelement(mesh, g, g);
     if (sym) {
         synonymids->count=0;
+
+        int n; elementid *ids;
+        if (meshadjacency_synonyms(mesh, g, id, &n, &ids)) { // Use the cached lists if available
+            if (n>0) varray_elementidadd(synonymids, ids, n);
+            return true;
+        }
+
         void *ctr=sparsedok_loopstart(&sym->dok);
         int row, col;
         while (sparsedok_loop(&sym->dok, &ctr, &row, &col)) {
@@ -787,9 +1015,22 @@ void mesh_insertidsforelement(objectsparse *conn, elementid id, bool ignore, ele
 }
 
 #define MAX_NEIGHBORS 64
+/** Finds the elements of grade target that share a vertex with an element, including through symmetries.
+ *  The cached lists are used if they have been built with meshadjacency_buildneighbors.
+ * @param[in] mesh - the mesh
+ * @param[in] g - grade of the element
+ * @param[in] id - the element id
+ * @param[in] target - grade of the neighbors
+ * @param[out] neighbors - neighbors are appended to this varray
+ * @returns the number of entries in neighbors */
 int mesh_findneighbors(objectmesh *mesh, grade g, elementid id, grade target, varray_elementid *neighbors) {
     int nvert, *vids, vvid=id; // List of vertices in the element
 
+    if (neighbors->count==0 && meshadjacency_neighbors(mesh, g, id, target, &nvert, &vids)) {
+        if (nvert>0) varray_elementidadd(neighbors, vids, nvert);
+        return neighbors->count;
+    }
+
     /* If the element is not a point, find all vertices associated with that point */
     if (g>0) {
         objectsparse *down = mesh_getconnectivityelement(mesh, 0, g);
@@ -821,7 +1062,7 @@ int mesh_findneighbors(objectmesh *mesh, grade g, elementid id, grade target, va
 
             // Is this vertex a target vertex of any image vertices
             int nrids=0, rids[MAX_NEIGHBORS];
-            if (sparseccs_getcolindicesforrow(&sym->ccs, id, MAX_NEIGHBORS, &nrids, rids)) {
+            if (sparseccs_getcolindicesforrow(&sym->ccs, vids[k], MAX_NEIGHBORS, &nrids, rids)) {
                 for (unsigned int k=0; k<nrids; k++) {
                     mesh_insertidsforelement(conn, rids[k], g==target, id, neighbors);
                 }
@@ -858,126 +1099,431 @@ static bool mesh_checksection(char *line, grade *g) {
     return false;
 }
 
-/** Loads a .mesh file. */
-objectmesh *mesh_load(vm *v, char *file) {
-    objectmesh *out = NULL;
-    error err;
-    error_init(&err);
+/** Checks whether a file is in the binary mesh format; the file position is restored */
+bool mesh_isbinary(FILE *f) {
+    char magic[sizeof(MESH_BINARYMAGIC)-1];
+    long posn=ftell(f);
+    size_t n=fread(magic, 1, sizeof(magic), f);
+    fseek(f, posn, SEEK_SET);
 
-    /* Open the file */
-    FILE *f = file_openrelative(file, "r");
-    if (!f) {
-        morpho_runtimeerror(v, MESH_FILENOTFOUND, file);
-        return NULL;
+    return (n==sizeof(magic) && memcmp(magic, MESH_BINARYMAGIC, sizeof(magic))==0);
+}
+
+/** Loads a mesh from a binary file. The file is mapped into memory and the arrays copied directly into the mesh. */
+static objectmesh *mesh_loadbinary(vm *v, FILE *f, char *file) {
+    char *base; size_t size;
+    if (!matrixio_map(f, &base, &size)) goto mesh_loadbinaryerr;
+
+    objectmesh *out=NULL;
+    meshioheader hdr;
+    bool success=false;
+
+    if (size<sizeof(meshioheader)) goto mesh_loadbinarycleanup;
+    memcpy(&hdr, base, sizeof(meshioheader));
+    if (hdr.version!=MESH_BINARYVERSION ||
+        hdr.nvertices<0 || hdr.nsections<0 ||
+        hdr.dim>MESH_GRADE_VOLUME) goto mesh_loadbinarycleanup;
+
+    size_t vertsize=sizeof(double)*(size_t) hdr.dim*(size_t) hdr.nvertices;
+    size_t offset=sizeof(meshioheader)+MATRIXIO_ALIGN(vertsize);
+    if (offset>size) goto mesh_loadbinarycleanup;
+
+    out=object_newmesh(hdr.dim, hdr.nvertices, (double *) (base+sizeof(meshioheader)));
+    if (!out || !out->vert || !mesh_checkconnectivity(out)) goto mesh_loadbinarycleanup;
+
+    for (int i=0; i<hdr.nsections; i++) {
+        meshiosection sec;
+        if (offset+sizeof(meshiosection)>size) goto mesh_loadbinarycleanup;
+        memcpy(&sec, base+offset, sizeof(meshiosection));
+        offset+=sizeof(meshiosection);
+
+        if (sec.grade<1 || sec.grade>(int) hdr.dim ||
+            sec.nelements<0 || sec.nentries<0 || sec.nentries>INT_MAX ||
+            mesh_getconnectivityelement(out, 0, sec.grade)) goto mesh_loadbinarycleanup;
+
+        objectsparse *conn=mesh_newconnectivityelement(out, 0, sec.grade);
+        if (!conn ||
+            matrixio_readccs(base, size, &offset, hdr.nvertices, sec.nelements, (int) sec.nentries, false, &conn->ccs)!=MATRIXIO_OK) goto mesh_loadbinarycleanup;
     }
+    success=true;
+
+mesh_loadbinarycleanup:
+    munmap(base, size);
+    if (success) return out;
+    if (out) object_free((object *) out);
+
+mesh_loadbinaryerr:
+    morpho_runtimeerror(v, MESH_LOADBINARY, file);
+    return NULL;
+}
+
+/* -------------------------------------
+ * Streaming reader for .mesh files
+ * ------------------------------------- */
+
+/** Size of the chunks in which .mesh files are read */
+#define MESH_READCHUNK 65536
 
-    grade g=-1; /* The current grade we're loading */
-    int ndim=-1; /* Dimensionality of the mesh */
-    int nv=0; /* Number of vertices */
-    int fline=0;
+/** Maximum number of values read from a line of a .mesh file */
+#define MESH_MAXLINEVALUES 5
+
+typedef struct {
+    FILE *f;
+    char *buffer; // Holds the current chunk of the file
+    size_t capacity; // Size of the buffer, excluding space for a terminator
+    size_t posn; // Start of the next line
+    size_t count; // Number of bytes in the buffer
+    bool eof;
+    bool failed; // Set if the buffer couldn't be enlarged
+    int line; // Current line number
+} meshreader;
+
+static bool meshreader_init(meshreader *r, FILE *f) {
+    r->f=f;
+    r->capacity=MESH_READCHUNK;
+    r->posn=0;
+    r->count=0;
+    r->eof=false;
+    r->failed=false;
+    r->line=0;
+    r->buffer=MORPHO_MALLOC(r->capacity+1);
+    return r->buffer;
+}
+
+static void meshreader_clear(meshreader *r) {
+    if (r->buffer) MORPHO_FREE(r->buffer);
+    r->buffer=NULL;
+}
+
+/** Gets the next line of the file
+ * @returns the line as a null terminated string in the reader's buffer, valid until the next call, or NULL at the end of the file */
+static char *meshreader_nextline(meshreader *r) {
+    for (;;) {
+        char *start=r->buffer+r->posn;
+        char *nl=memchr(start, '\n', r->count-r->posn);
+
+        if (nl || (r->eof && r->posn<r->count)) {
+            char *end=(nl ? nl : r->buffer+r->count);
+            *end='\0';
+            r->posn=(nl ? (size_t) (nl-r->buffer)+1 : r->count);
+            r->line++;
+            return start;
+        }
+        if (r->eof) return NULL;
+
+        /* Move the partial line to the start of the buffer and read another chunk */
+        size_t remainder=r->count-r->posn;
+        memmove(r->buffer, start, remainder);
+        r->posn=0;
+        r->count=remainder;
+
+        if (r->count==r->capacity) { // The line is longer than the buffer
+            char *new=MORPHO_REALLOC(r->buffer, 2*r->capacity+1);
+            if (!new) { r->failed=true; return NULL; }
+            r->buffer=new;
+            r->capacity*=2;
+        }
+
+        size_t n=fread(r->buffer+r->count, 1, r->capacity-r->count, r->f);
+        r->count+=n;
+        if (n==0) r->eof=true;
+    }
+}
+
+/** A number read from a .mesh file */
+typedef struct {
+    bool isinteger;
+    int ival;
+    double val;
+} meshvalue;
+
+/** Powers of ten that are exactly representable as doubles */
+static const double mesh_pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+/** Scans a number. Decimal numbers with up to 15 significant digits and small exponents are
+ *  converted exactly by a single multiplication or division; other numbers are passed to strtod.
+ * @param[in] s - start of the number
+ * @param[out] out - the value read
+ * @returns a pointer to the character after the number, or NULL if no number was found */
+static char *mesh_scannumber(char *s, meshvalue *out) {
+    char *start=s;
+    bool neg=false, digits=false, isinteger=true;
+    uint64_t mantissa=0;
+    int nsig=0, exp10=0;
+
+    if (*s=='-' || *s=='+') { neg=(*s=='-'); s++; }
+
+    for (; *s>='0' && *s<='9'; s++) {
+        digits=true;
+        if (mantissa==0 && *s=='0') continue;
+        if (nsig<19) { mantissa=mantissa*10+(*s-'0'); nsig++; }
+        else { exp10++; nsig++; }
+    }
+
+    if (*s=='.') {
+        isinteger=false;
+        for (s++; *s>='0' && *s<='9'; s++) {
+            digits=true;
+            if (mantissa==0 && *s=='0') { exp10--; continue; }
+            if (nsig<19) { mantissa=mantissa*10+(*s-'0'); exp10--; }
+            nsig++;
+        }
+    }
+    if (!digits) return NULL;
+
+    if (*s=='e' || *s=='E') {
+        char *e=s+1;
+        bool eneg=false;
+        int ev=0;
+        isinteger=false;
+        if (*e=='-' || *e=='+') { eneg=(*e=='-'); e++; }
+        if (!(*e>='0' && *e<='9')) return NULL;
+        for (; *e>='0' && *e<='9'; e++) if (ev<10000) ev=ev*10+(*e-'0');
+        exp10+=(eneg ? -ev : ev);
+        s=e;
+    }
 
-    value val[5]; /* Values to read in per line */
-    unsigned int n; /* Number of values read */
+    out->isinteger=(isinteger && mantissa<=INT_MAX);
+    if (out->isinteger) out->ival=(neg ? -((int) mantissa) : (int) mantissa);
 
-    dictionary vdict; // Record how the file's vertex ids map to ours.
-    dictionary_init(&vdict);
+    if (nsig<=15 && exp10>=-22 && exp10<=22) {
+        double x=(double) mantissa;
+        x=(exp10<0 ? x/mesh_pow10[-exp10] : x*mesh_pow10[exp10]);
+        out->val=(neg ? -x : x);
+    } else out->val=strtod(start, NULL);
+
+    return s;
+}
+
+/** Scans a line of a .mesh file for numbers separated by whitespace or commas
+ * @param[in] line - the line
+ * @param[in] nmax - maximum number of values to read
+ * @param[out] val - values read
+ * @returns the number of values read, or -1 if the line contains something other than numbers */
+static int mesh_scanline(char *line, int nmax, meshvalue *val) {
+    char *s=line;
+    int n=0;
+
+    while (n<nmax) {
+        while (*s==' ' || *s=='\t' || *s=='\r' || *s==',' || *s=='\v' || *s=='\f') s++;
+        if (*s=='\0' || (s[0]=='/' && s[1]=='/')) break;
+
+        s=mesh_scannumber(s, val+n);
+        if (!s) return -1;
+        if (!(*s==' ' || *s=='\t' || *s=='\r' || *s==',' || *s=='\v' || *s=='\f' || *s=='\0' || *s=='/')) return -1;
+        n++;
+    }
+
+    return n;
+}
+
+/** Maps vertex ids in a .mesh file onto vertex indices. Files almost always number vertices
+ *  consecutively, so the map is an offset until an id out of sequence is found; a dictionary is used thereafter. */
+typedef struct {
+    int nv;
+    int first;
+    bool dense;
+    dictionary dict;
+} meshidmap;
+
+static void meshidmap_init(meshidmap *map) {
+    map->nv=0;
+    map->first=0;
+    map->dense=true;
+    dictionary_init(&map->dict);
+}
+
+static void meshidmap_clear(meshidmap *map) {
+    dictionary_clear(&map->dict);
+}
+
+/** Records the id of the next vertex */
+static bool meshidmap_add(meshidmap *map, int id) {
+    if (map->nv==0) map->first=id;
+
+    if (map->dense && id!=map->first+map->nv) {
+        map->dense=false;
+        for (int i=0; i<map->nv; i++) {
+            if (!dictionary_insert(&map->dict, MORPHO_INTEGER(map->first+i), MORPHO_INTEGER(i))) return false;
+        }
+    }
+
+    if (!map->dense && !dictionary_insert(&map->dict, MORPHO_INTEGER(id), MORPHO_INTEGER(map->nv))) return false;
+    map->nv++;
+    return true;
+}
+
+/** Finds the vertex index corresponding to an id */
+static bool meshidmap_get(meshidmap *map, int id, elementid *out) {
+    if (map->dense) {
+        long indx=(long) id-map->first;
+        if (indx<0 || indx>=map->nv) return false;
+        *out=(elementid) indx;
+        return true;
+    }
+
+    value val;
+    if (dictionary_get(&map->dict, MORPHO_INTEGER(id), &val) && MORPHO_ISINTEGER(val)) {
+        *out=MORPHO_GETINTEGERVALUE(val);
+        return true;
+    }
+    return false;
+}
+
+/** Loads a mesh from a file in the .mesh text format. Connectivity is assembled directly in CCS format:
+ *  the vertex ids of each element are sorted as they would be on conversion from a DOK matrix. */
+static objectmesh *mesh_loadtext(vm *v, FILE *f) {
+    objectmesh *out=NULL;
+    meshreader reader;
+    meshidmap map;
+    meshvalue val[MESH_MAXLINEVALUES];
+
+    varray_double vert; // Vertex positions
+    varray_elementid cptr[MESH_GRADE_VOLUME+1]; // Column pointers for each grade
+    varray_elementid rix[MESH_GRADE_VOLUME+1]; // Row indices for each grade
+
+    grade g=-1; // The current grade
+    int ndim=-1; // Dimensionality of the mesh
 
-    varray_double vert; // Hold the vertex positions
     varray_doubleinit(&vert);
+    for (grade i=0; i<=MESH_GRADE_VOLUME; i++) {
+        varray_elementidinit(&cptr[i]);
+        varray_elementidinit(&rix[i]);
+    }
+    meshidmap_init(&map);
 
-    varray_char line; // Buffer to hold a line from the file
-    varray_charinit(&line);
-
-    /* Load vertices */
-    do {
-        line.count=0; // Reset buffer contents.
-        file_readlineintovarray(f, &line);
-        fline++;
-
-        if (!mesh_checksection(line.data, &g)) {
-            /* Convert the string to an array of values */
-            if (parse_stringtovaluearray(line.data, 5, val, &n, &err)) {
-                if (n>0 && g==0) {
-                    /* Check dimensionality */
-                    if (ndim<0) ndim=n-1;
-                    else if (n-1!=ndim) {
-                        morpho_runtimeerror(v, MESH_LOADVERTEXDIM, fline);
-                        goto meshload_cleanup;
-                    }
+    if (!meshreader_init(&reader, f)) {
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        goto meshloadtext_cleanup;
+    }
 
-                    /* Add the vertex */
-                    for (unsigned int k=0; k<ndim; k++) {
-                        double coord;
-                        if (!morpho_valuetofloat(val[k+1], &coord)) {
-                            morpho_runtimeerror(v, MESH_LOADVERTEXCOORD, fline);
-                            goto meshload_cleanup;
-                        }
-                        varray_doubleadd(&vert, &coord, 1);
-                    }
+    for (char *line=meshreader_nextline(&reader); line; line=meshreader_nextline(&reader)) {
+        if (isalpha((unsigned char) line[0]) && mesh_checksection(line, &g)) continue;
 
-                    /* Keey a record of the id in the file */
-                    dictionary_insert(&vdict, val[0], MORPHO_INTEGER(nv));
-                    nv++;
-                }
-            } else {
-                morpho_runtimeerror(v, MESH_LOADPARSEERR, fline);
-                goto meshload_cleanup;
-            }
+        int n=mesh_scanline(line, MESH_MAXLINEVALUES, val);
+        if (n<0) {
+            morpho_runtimeerror(v, MESH_LOADPARSEERR, reader.line);
+            goto meshloadtext_cleanup;
         }
-    } while (!feof(f) && g<1);
+        if (n==0 || g<0) continue;
+
+        if (g==MESH_GRADE_VERTEX) {
+            /* Check dimensionality */
+            if (ndim<0) ndim=n-1;
+            else if (n-1!=ndim) {
+                morpho_runtimeerror(v, MESH_LOADVERTEXDIM, reader.line);
+                goto meshloadtext_cleanup;
+            }
 
-    /* Create the mesh */
-    out=object_newmesh(ndim, nv, vert.data);
-
-    /* Now continue to parse the file for the remaining elements */
-    while (!feof(f)) {
-        line.count=0; // Reset buffer contents.
-        file_readlineintovarray(f, &line);
-        fline++;
-
-        /* Check if this is a section header */
-        if (line.count>0 && !mesh_checksection(line.data, &g)) {
-            /* Convert the string to an array of values */
-            if (parse_stringtovaluearray(line.data, 5, val, &n, &err)) {
-                if (n>0) {
-                    elementid vid[g+1];
-                    /* Check number of vertices is consistent with the grade */
-                    if (n-1!=g+1) {
-                        morpho_runtimeerror(v, MESH_LOADVERTEXNUM, fline);
-                        goto meshload_cleanup;
-                    }
+            if (!val[0].isinteger) {
+                morpho_runtimeerror(v, MESH_LOADVERTEXID, reader.line);
+                goto meshloadtext_cleanup;
+            }
 
-                    for (unsigned int i=0; i<g+1; i++) {
-                        /* Look up our corresponding vertex id */
-                        value vx;
-                        if (dictionary_get(&vdict, val[i+1], &vx)) {
-                            if (MORPHO_ISINTEGER(vx)) {
-                                vid[i]=MORPHO_GETINTEGERVALUE(vx);
-                            } else {
-                                morpho_runtimeerror(v, MESH_LOADVERTEXID, fline);
-                                goto meshload_cleanup;
-                            }
-                        } else {
-                            morpho_runtimeerror(v, MESH_LOADVERTEXNOTFOUND, fline);
-                            goto meshload_cleanup;
-                        }
-                    }
+            for (int k=0; k<ndim; k++) varray_doublewrite(&vert, val[k+1].val);
+            if (!meshidmap_add(&map, val[0].ival)) {
+                morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+                goto meshloadtext_cleanup;
+            }
+        } else {
+            elementid vid[MESH_MAXLINEVALUES];
+            int nvid=0;
 
-                    mesh_addelementwithvertices(out, g, vid);
+            /* Check number of vertices is consistent with the grade */
+            if (n-1!=g+1) {
+                morpho_runtimeerror(v, MESH_LOADVERTEXNUM, reader.line);
+                goto meshloadtext_cleanup;
+            }
+
+            for (int i=1; i<n; i++) {
+                /* Look up our corresponding vertex id */
+                elementid id;
+                if (!val[i].isinteger) {
+                    morpho_runtimeerror(v, MESH_LOADVERTEXID, reader.line);
+                    goto meshloadtext_cleanup;
+                }
+                if (!meshidmap_get(&map, val[i].ival, &id)) {
+                    morpho_runtimeerror(v, MESH_LOADVERTEXNOTFOUND, reader.line);
+                    goto meshloadtext_cleanup;
                 }
+
+                /* Insert into the sorted list of vertices, ignoring duplicates */
+                int k=nvid;
+                while (k>0 && vid[k-1]>id) k--;
+                if (k>0 && vid[k-1]==id) continue;
+                for (int j=nvid; j>k; j--) vid[j]=vid[j-1];
+                vid[k]=id;
+                nvid++;
             }
+
+            if (cptr[g].count==0) varray_elementidwrite(&cptr[g], 0);
+            varray_elementidadd(&rix[g], vid, nvid);
+            varray_elementidwrite(&cptr[g], rix[g].count);
         }
+    }
 
+    if (reader.failed) {
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        goto meshloadtext_cleanup;
     }
-    fclose(f);
 
-    mesh_freezeconnectivity(out);
+    /* Create the mesh */
+    if (ndim<0) ndim=0;
+    out=object_newmesh(ndim, map.nv, vert.data);
+    if (!out || !mesh_checkconnectivity(out)) goto meshloadtext_allocerr;
+
+    for (grade i=1; i<=ndim && i<=MESH_GRADE_VOLUME; i++) {
+        if (cptr[i].count==0) continue;
+
+        objectsparse *conn=mesh_newconnectivityelement(out, 0, i);
+        int nel=cptr[i].count-1, nentries=rix[i].count;
+        if (!conn || !sparseccs_resize(&conn->ccs, map.nv, nel, nentries, false)) goto meshloadtext_allocerr;
 
-meshload_cleanup:
+        memcpy(conn->ccs.cptr, cptr[i].data, sizeof(int)*(nel+1));
+        memcpy(conn->ccs.rix, rix[i].data, sizeof(int)*nentries);
+    }
+
+    goto meshloadtext_cleanup;
 
-    varray_charclear(&line);
-    dictionary_clear(&vdict);
+meshloadtext_allocerr:
+    if (out) object_free((object *) out);
+    out=NULL;
+    morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+meshloadtext_cleanup:
+    meshreader_clear(&reader);
+    meshidmap_clear(&map);
     varray_doubleclear(&vert);
+    for (grade i=0; i<=MESH_GRADE_VOLUME; i++) {
+        varray_elementidclear(&cptr[i]);
+        varray_elementidclear(&rix[i]);
+    }
+
+    return out;
+}
+
+/** Loads a mesh file, detecting whether it is in the .mesh text format or the binary format. */
+objectmesh *mesh_load(vm *v, char *file) {
+    objectmesh *out = NULL;
+    error err;
+    error_init(&err);
+
+    /* Open the file */
+    FILE *f = file_openrelative(file, "rb");
+    if (!f) {
+        morpho_runtimeerror(v, MESH_FILENOTFOUND, file);
+        return NULL;
+    }
+
+    if (mesh_isbinary(f)) {
+        out=mesh_loadbinary(v, f, file);
+        fclose(f);
+        return out;
+    }
+
+    out=mesh_loadtext(v, f);
+    fclose(f);
 
     return out;
 }
@@ -986,11 +1532,8 @@ meshload_cleanup:
  * Mesh exporter
  * ********************************************************************** */
 
-bool mesh_save(objectmesh *m, char *file) {
-    /* Open the file */
-    FILE *f = file_openrelative(file, "w");
-    if (!f) return false;
-
+/** Writes a mesh in the .mesh text format */
+static bool mesh_savetext(objectmesh *m, FILE *f) {
     /* Export vertices */
     fprintf(f, "%s\n\n", MESH_VERTSECTION);
     for (unsigned int i=0; i<mesh_nvertices(m); i++) {
@@ -1027,10 +1570,91 @@ bool mesh_save(objectmesh *m, char *file) {
         }
     }
 
-    fclose(f);
+    return !ferror(f);
+}
+
+/** Writes zero bytes to pad an array to the alignment boundary */
+static bool mesh_pad(FILE *f, size_t n) {
+    char zero[8] = { 0 };
+    size_t npad=MATRIXIO_ALIGN(n)-n;
+    return (npad==0 || fwrite(zero, 1, npad, f)==npad);
+}
+
+/** Writes a mesh in the binary format */
+static bool mesh_savebinary(objectmesh *m, FILE *f) {
+    meshioheader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, MESH_BINARYMAGIC, sizeof(hdr.magic));
+    hdr.version=MESH_BINARYVERSION;
+    hdr.dim=m->dim;
+    hdr.nvertices=mesh_nvertices(m);
+    for (grade g=1; g<=m->dim; g++) if (mesh_getconnectivityelement(m, 0, g)) hdr.nsections++;
+    if (fwrite(&hdr, sizeof(hdr), 1, f)!=1) return false;
+
+    size_t nel=(size_t) m->dim*(size_t) hdr.nvertices;
+    if (nel>0 && fwrite(m->vert->elements, sizeof(double), nel, f)!=nel) return false;
+    if (!mesh_pad(f, nel*sizeof(double))) return false;
+
+    for (grade g=1; g<=m->dim; g++) {
+        objectsparse *conn=mesh_getconnectivityelement(m, 0, g);
+        if (!conn) continue;
+        if (!sparse_checkformat(conn, SPARSE_CCS, true, false)) return false;
+
+        meshiosection sec = { .grade=g, .nelements=conn->ccs.ncols, .nentries=conn->ccs.nentries };
+        if (fwrite(&sec, sizeof(sec), 1, f)!=1) return false;
+
+        sparseccs pattern=conn->ccs; // Connectivity matrices are stored without values
+        pattern.values=NULL;
+        if (!matrixio_writeccs(f, &pattern)) return false;
+    }
+
+    return true;
+}
+
+/** Decides whether to use the binary format, from an explicit format label or, if none is given, the file extension
+ * @param[in] fname - file name
+ * @param[in] format - nil or a string
+ * @param[out] binary - true if the binary format should be used
+ * @returns false if the format label isn't recognized */
+static bool mesh_usebinary(char *fname, value format, bool *binary) {
+    if (MORPHO_ISSTRING(format)) {
+        char *label=MORPHO_GETCSTRING(format);
+        if (strcasecmp(label, MESH_TEXTFORMAT)==0) *binary=false;
+        else if (strcasecmp(label, MESH_BINARYFORMAT)==0 ||
+                 strcasecmp(label, MESH_BINARYEXTENSION)==0) *binary=true;
+        else return false;
+    } else if (MORPHO_ISNIL(format)) {
+        char *ext=strrchr(fname, '.');
+        *binary=(ext && strcasecmp(ext+1, MESH_BINARYEXTENSION)==0);
+    } else return false;
+
     return true;
 }
 
+/** Saves a mesh, raising an error on failure
+ * @param[in] v - the virtual machine in use
+ * @param[in] m - mesh to save
+ * @param[in] file - file name
+ * @param[in] format - nil to select the format from the file extension, or a format label
+ * @returns true on success */
+bool mesh_save(vm *v, objectmesh *m, char *file, value format) {
+    bool binary;
+    if (!mesh_usebinary(file, format, &binary)) {
+        morpho_runtimeerror(v, MESH_SAVEARGS);
+        return false;
+    }
+
+    FILE *f = file_openrelative(file, "wb");
+    bool success=false;
+    if (f) {
+        success=(binary ? mesh_savebinary(m, f) : mesh_savetext(m, f));
+        if (fclose(f)!=0) success=false;
+    }
+
+    if (!success) morpho_runtimeerror(v, MESH_WRITEFAILED, file);
+    return success;
+}
+
 /* **********************************************************************
  * Mesh veneer class
  * ********************************************************************** */
@@ -1058,13 +1682,13 @@ value mesh_constructor(vm *v, int nargs, value *args) {
     return out;
 }
 
-/** Print the mesh */
+/** Save the mesh */
 value Mesh_save(vm *v, int nargs, value *args) {
     objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
 
-    if (nargs==1 && MORPHO_ISSTRING(MORPHO_GETARG(args, 0))) {
-        mesh_save(m, MORPHO_GETCSTRING(MORPHO_GETARG(args, 0)));
-    }
+    if ((nargs==1 || nargs==2) && MORPHO_ISSTRING(MORPHO_GETARG(args, 0))) {
+        mesh_save(v, m, MORPHO_GETCSTRING(MORPHO_GETARG(args, 0)), (nargs==2 ? MORPHO_GETARG(args, 1) : MORPHO_NIL));
+    } else morpho_runtimeerror(v, MESH_SAVEARGS);
 
     return MORPHO_NIL;
 }
@@ -1105,6 +1729,7 @@ value Mesh_setvertexmatrix(vm *v, int nargs, value *args) {
         } else {
             if (m->dim==0) m->dim=mat->nrows;
             m->vert=mat;
+            meshindex_moved(m);
         }
     }
 
@@ -1143,6 +1768,7 @@ value Mesh_setvertexposition(vm *v, int nargs, value *args) {
         objectmatrix *mat = MORPHO_GETMATRIX(MORPHO_GETARG(args, 1));
 
         if (!matrix_setcolumn(m->vert, id, mat->elements)) morpho_runtimeerror(v, MESH_INVLDID);
+        meshindex_moved(m);
     } else morpho_runtimeerror(v, MESH_STVRTPSNARGS);
 
     return MORPHO_NIL;
@@ -1285,6 +1911,512 @@ value Mesh_clone(vm *v, int nargs, value *args) {
     return out;
 }
 
+/* -------------------------------------
+ * Spatial queries
+ * ------------------------------------- */
+
+/** Reads a position from a Matrix or List with one entry per spatial dimension */
+static bool mesh_positionfromvalue(objectmesh *m, value in, double *x) {
+    if (MORPHO_ISMATRIX(in)) {
+        objectmatrix *a=MORPHO_GETMATRIX(in);
+        if (a->nrows*a->ncols!=m->dim) return false;
+        for (unsigned int k=0; k<m->dim; k++) x[k]=a->elements[k];
+        return true;
+    } else if (MORPHO_ISLIST(in)) {
+        objectlist *l=MORPHO_GETLIST(in);
+        if (l->val.count!=m->dim) return false;
+        for (unsigned int k=0; k<m->dim; k++) if (!morpho_valuetofloat(l->val.data[k], x+k)) return false;
+        return true;
+    }
+    return false;
+}
+
+/** Processes the arguments common to the spatial queries: a position, a parameter and an optional grade
+ * @param[in] m - the mesh
+ * @param[in] nargs - number of arguments
+ * @param[in] args - the arguments
+ * @param[in] nfixed - number of arguments before the optional grade
+ * @param[out] x - the position
+ * @param[out] g - the grade
+ * @returns true if the arguments were valid */
+static bool mesh_queryargs(objectmesh *m, int nargs, value *args, int nfixed, double *x, grade *g) {
+    *g=MESH_GRADE_VERTEX;
+    if (nargs==nfixed+1 && MORPHO_ISINTEGER(MORPHO_GETARG(args, nfixed))) {
+        *g=MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, nfixed));
+    } else if (nargs!=nfixed) return false;
+
+    return mesh_positionfromvalue(m, MORPHO_GETARG(args, 0), x);
+}
+
+/** Checks that a mesh has elements of a given grade, raising an error if not */
+static bool mesh_checkgrade(vm *v, objectmesh *m, grade g) {
+    if (g==MESH_GRADE_VERTEX || (g>0 && g<=m->dim && mesh_getconnectivityelement(m, 0, g))) return true;
+    morpho_runtimeerror(v, MESH_NOGRADE, g);
+    return false;
+}
+
+/** Converts a list of element ids to a List */
+static value mesh_idlist(vm *v, varray_elementid *ids) {
+    value out=MORPHO_NIL;
+    objectlist *new=object_newlist(0, NULL);
+
+    if (new && (ids->count==0 || list_resize(new, ids->count))) {
+        for (unsigned int i=0; i<ids->count; i++) new->val.data[i]=MORPHO_INTEGER(ids->data[i]);
+        new->val.count=ids->count;
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    } else {
+        if (new) object_free((object *) new);
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    }
+
+    return out;
+}
+
+/** Finds the nearest element to a point */
+value Mesh_nearest(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    double x[m->dim+1];
+    grade g;
+    value out=MORPHO_NIL;
+
+    if (mesh_queryargs(m, nargs, args, 1, x, &g)) {
+        elementid id;
+        if (mesh_checkgrade(v, m, g) &&
+            meshindex_nearest(m, g, x, &id, NULL)) out=MORPHO_INTEGER(id);
+    } else morpho_runtimeerror(v, MESH_NEARESTARGS);
+
+    return out;
+}
+
+/** Finds the k nearest elements to a point */
+value Mesh_knearest(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    double x[m->dim+1];
+    grade g;
+    value out=MORPHO_NIL;
+
+    if (mesh_queryargs(m, nargs, args, 2, x, &g) &&
+        MORPHO_ISINTEGER(MORPHO_GETARG(args, 1))) {
+        varray_elementid ids;
+        varray_elementidinit(&ids);
+
+        if (mesh_checkgrade(v, m, g)) {
+            if (meshindex_knearest(m, g, x, MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 1)), &ids)) out=mesh_idlist(v, &ids);
+            else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        }
+
+        varray_elementidclear(&ids);
+    } else morpho_runtimeerror(v, MESH_KNEARESTARGS);
+
+    return out;
+}
+
+/** Finds all elements within a given distance of a point */
+value Mesh_inradius(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    double x[m->dim+1], r;
+    grade g;
+    value out=MORPHO_NIL;
+
+    if (mesh_queryargs(m, nargs, args, 2, x, &g) &&
+        morpho_valuetofloat(MORPHO_GETARG(args, 1), &r)) {
+        varray_elementid ids;
+        varray_elementidinit(&ids);
+
+        if (mesh_checkgrade(v, m, g)) {
+            if (meshindex_inradius(m, g, x, r, &ids)) out=mesh_idlist(v, &ids);
+            else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        }
+
+        varray_elementidclear(&ids);
+    } else morpho_runtimeerror(v, MESH_INRADIUSARGS);
+
+    return out;
+}
+
+/** Finds all elements whose bounding boxes intersect a box */
+value Mesh_inbox(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    double lower[m->dim+1], upper[m->dim+1];
+    grade g;
+    value out=MORPHO_NIL;
+
+    if (mesh_queryargs(m, nargs, args, 2, lower, &g) &&
+        mesh_positionfromvalue(m, MORPHO_GETARG(args, 1), upper)) {
+        varray_elementid ids;
+        varray_elementidinit(&ids);
+
+        if (mesh_checkgrade(v, m, g)) {
+            if (meshindex_inbox(m, g, lower, upper, &ids)) out=mesh_idlist(v, &ids);
+            else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        }
+
+        varray_elementidclear(&ids);
+    } else morpho_runtimeerror(v, MESH_INBOXARGS);
+
+    return out;
+}
+
+/** Refits the spatial index after vertices have been moved */
+value Mesh_refit(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    meshindex_refit(m);
+    return MORPHO_NIL;
+}
+
+static value mesh_methodoption;
+
+/** Renumbers vertices and elements to improve locality, remapping any Fields and Selections supplied.
+    Returns a List containing, for each grade, a List of the new id of each element. */
+value Mesh_reorder(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    value method=MORPHO_NIL;
+    value out=MORPHO_NIL;
+    int nfixed=nargs;
+    meshreordermethod mthd=MESHREORDER_HILBERT;
+
+    if (!builtin_options(v, nargs, args, &nfixed, 1, mesh_methodoption, &method)) return MORPHO_NIL;
+
+    if (MORPHO_ISSTRING(method)) {
+        char *label=MORPHO_GETCSTRING(method);
+        if (strcasecmp(label, MESHREORDER_RCMLABEL)==0) mthd=MESHREORDER_RCM;
+        else if (strcasecmp(label, MESHREORDER_HILBERTLABEL)!=0) { morpho_runtimeerror(v, MESH_REORDERMETHOD); return MORPHO_NIL; }
+    } else if (!MORPHO_ISNIL(method)) { morpho_runtimeerror(v, MESH_REORDERMETHOD); return MORPHO_NIL; }
+
+    /* Check the objects to remap before modifying the mesh */
+    for (int i=0; i<nfixed; i++) {
+        value obj=MORPHO_GETARG(args, i);
+        if (!((MORPHO_ISFIELD(obj) && MORPHO_GETFIELD(obj)->mesh==m) ||
+              (MORPHO_ISSELECTION(obj) && MORPHO_GETSELECTION(obj)->mesh==m))) {
+            morpho_runtimeerror(v, MESH_REORDERARGS);
+            return MORPHO_NIL;
+        }
+    }
+
+    grade maxg=mesh_maxgrade(m);
+    varray_elementid perm[m->dim+1];
+    for (grade g=0; g<=m->dim; g++) varray_elementidinit(&perm[g]);
+
+    bool success=meshreorder_reorder(m, mthd, perm);
+    for (int i=0; success && i<nfixed; i++) success=meshreorder_remap(m, MORPHO_GETARG(args, i), perm);
+
+    /* Return the permutations */
+    value lists[maxg+2];
+    int nlists=0;
+    for (grade g=0; success && g<=maxg; g++) {
+        objectlist *new=object_newlist(0, NULL);
+        if (new && (perm[g].count==0 || list_resize(new, perm[g].count))) {
+            for (unsigned int i=0; i<perm[g].count; i++) new->val.data[i]=MORPHO_INTEGER(perm[g].data[i]);
+            new->val.count=perm[g].count;
+            lists[nlists++]=MORPHO_OBJECT(new);
+        } else {
+            if (new) object_free((object *) new);
+            success=false;
+        }
+    }
+
+    objectlist *new=(success ? object_newlist(nlists, lists) : NULL);
+    if (new) {
+        lists[nlists]=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, nlists+1, lists);
+        out=lists[nlists];
+    } else {
+        for (int i=0; i<nlists; i++) object_free(MORPHO_GETOBJECT(lists[i]));
+        success=false;
+    }
+
+    if (!success) morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+    for (grade g=0; g<=m->dim; g++) varray_elementidclear(&perm[g]);
+    return out;
+}
+
+static value mesh_selectionoption;
+
+/** Adds an object to the list of those to transfer to a refined mesh, expanding Lists */
+static bool mesh_refinetarget(objectmesh *m, value obj, varray_value *targets) {
+    if (MORPHO_ISLIST(obj)) {
+        objectlist *list=MORPHO_GETLIST(obj);
+        for (unsigned int i=0; i<list->val.count; i++) {
+            if (MORPHO_ISLIST(list->val.data[i]) || !mesh_refinetarget(m, list->val.data[i], targets)) return false;
+        }
+        return true;
+    } else if (MORPHO_ISMESH(obj) && MORPHO_GETMESH(obj)==m) return true;
+
+    if (!((MORPHO_ISFIELD(obj) && MORPHO_GETFIELD(obj)->mesh==m) ||
+          (MORPHO_ISSELECTION(obj) && MORPHO_GETSELECTION(obj)->mesh==m))) return false;
+    varray_valuewrite(targets, obj);
+    return true;
+}
+
+/** Refines the mesh, or the elements in a selection, transferring any Fields and Selections supplied.
+    Returns a Dictionary that maps the mesh and each object to its refined counterpart. */
+value Mesh_refine(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    value selection=MORPHO_NIL;
+    value out=MORPHO_NIL;
+    int nfixed=nargs;
+
+    if (!builtin_options(v, nargs, args, &nfixed, 1, mesh_selectionoption, &selection)) return MORPHO_NIL;
+
+    bool success=(MORPHO_ISNIL(selection) ||
+                  (MORPHO_ISSELECTION(selection) && MORPHO_GETSELECTION(selection)->mesh==m));
+
+    varray_value targets;
+    varray_valueinit(&targets);
+    for (int i=0; success && i<nfixed; i++) success=mesh_refinetarget(m, MORPHO_GETARG(args, i), &targets);
+
+    if (!success) {
+        morpho_runtimeerror(v, MESH_REFINEARGS);
+        varray_valueclear(&targets);
+        return MORPHO_NIL;
+    }
+
+    meshrefinement ref;
+    if (!meshrefine_refine(m, (MORPHO_ISNIL(selection) ? NULL : MORPHO_GETSELECTION(selection)), &ref)) {
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        varray_valueclear(&targets);
+        return MORPHO_NIL;
+    }
+
+    value objs[targets.count+2];
+    int nobjs=0;
+    objectdictionary *dict=object_newdictionary();
+    success=(dict!=NULL);
+    if (dict) objs[nobjs++]=MORPHO_OBJECT(dict);
+    objs[nobjs++]=MORPHO_OBJECT(ref.new);
+    if (success) success=dictionary_insert(&dict->dict, MORPHO_SELF(args), MORPHO_OBJECT(ref.new));
+
+    for (unsigned int i=0; success && i<targets.count; i++) {
+        if (dictionary_get(&dict->dict, targets.data[i], NULL)) continue; // Already transferred
+        success=meshrefine_adapt(&ref, targets.data[i], &objs[nobjs]);
+        if (success) success=dictionary_insert(&dict->dict, targets.data[i], objs[nobjs++]);
+    }
+
+    if (success) {
+        morpho_bindobjects(v, nobjs, objs);
+        out=objs[0];
+    } else {
+        for (int i=0; i<nobjs; i++) object_free(MORPHO_GETOBJECT(objs[i]));
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    }
+
+    meshrefine_clear(&ref);
+    varray_valueclear(&targets);
+    return out;
+}
+
+static value mesh_fixoption;
+
+/** Equiangulates the triangles of the mesh in place by flipping edges, leaving fixed edges and faces unchanged.
+    Returns the number of edges flipped. */
+value Mesh_equiangulate(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    value fix=MORPHO_NIL;
+    int nfixed=nargs;
+
+    if (!builtin_options(v, nargs, args, &nfixed, 1, mesh_fixoption, &fix)) return MORPHO_NIL;
+
+    if (nfixed!=0 || !(MORPHO_ISNIL(fix) || (MORPHO_ISSELECTION(fix) && MORPHO_GETSELECTION(fix)->mesh==m))) {
+        morpho_runtimeerror(v, MESH_EQUIANGULATEARGS);
+        return MORPHO_NIL;
+    }
+
+    if (!mesh_getconnectivityelement(m, 0, MESH_GRADE_AREA)) {
+        morpho_runtimeerror(v, MESH_NOGRADE, MESH_GRADE_AREA);
+        return MORPHO_NIL;
+    }
+
+    int nflips=0;
+    if (!meshflip_equiangulate(m, (MORPHO_ISNIL(fix) ? NULL : MORPHO_GETSELECTION(fix)), &nflips)) {
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        return MORPHO_NIL;
+    }
+
+    return MORPHO_INTEGER(nflips);
+}
+
+static value mesh_lengthoption;
+
+/** Prunes the mesh by collapsing edges of the elements in a selection, or edges shorter than a given length,
+    transferring any Fields and Selections supplied. Returns a Dictionary that maps the mesh and each object to
+    its pruned counterpart. */
+value Mesh_prune(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    value selection=MORPHO_NIL, fix=MORPHO_NIL, length=MORPHO_NIL;
+    value out=MORPHO_NIL;
+    double l=0.0;
+    int nfixed=nargs;
+
+    if (!builtin_options(v, nargs, args, &nfixed, 3, mesh_selectionoption, &selection, mesh_fixoption, &fix, mesh_lengthoption, &length)) return MORPHO_NIL;
+
+    bool success=((MORPHO_ISNIL(selection) || (MORPHO_ISSELECTION(selection) && MORPHO_GETSELECTION(selection)->mesh==m)) &&
+                  (MORPHO_ISNIL(fix) || (MORPHO_ISSELECTION(fix) && MORPHO_GETSELECTION(fix)->mesh==m)) &&
+                  (MORPHO_ISNIL(length) || (morpho_valuetofloat(length, &l) && l>0.0)) &&
+                  !(MORPHO_ISNIL(selection) && MORPHO_ISNIL(length)));
+
+    varray_value targets;
+    varray_valueinit(&targets);
+    for (int i=0; success && i<nfixed; i++) success=mesh_refinetarget(m, MORPHO_GETARG(args, i), &targets);
+
+    if (!success) {
+        morpho_runtimeerror(v, MESH_PRUNEARGS);
+        varray_valueclear(&targets);
+        return MORPHO_NIL;
+    }
+
+    meshpruning prune;
+    if (!meshprune_prune(m, (MORPHO_ISNIL(selection) ? NULL : MORPHO_GETSELECTION(selection)),
+                         (MORPHO_ISNIL(fix) ? NULL : MORPHO_GETSELECTION(fix)), l, &prune)) {
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        varray_valueclear(&targets);
+        return MORPHO_NIL;
+    }
+
+    value objs[targets.count+2];
+    int nobjs=0;
+    objectdictionary *dict=object_newdictionary();
+    success=(dict!=NULL);
+    if (dict) objs[nobjs++]=MORPHO_OBJECT(dict);
+    objs[nobjs++]=MORPHO_OBJECT(prune.new);
+    if (success) success=dictionary_insert(&dict->dict, MORPHO_SELF(args), MORPHO_OBJECT(prune.new));
+
+    for (unsigned int i=0; success && i<targets.count; i++) {
+        if (dictionary_get(&dict->dict, targets.data[i], NULL)) continue; // Already transferred
+        success=meshprune_adapt(&prune, targets.data[i], &objs[nobjs]);
+        if (success) success=dictionary_insert(&dict->dict, targets.data[i], objs[nobjs++]);
+    }
+
+    if (success) {
+        morpho_bindobjects(v, nobjs, objs);
+        out=objs[0];
+    } else {
+        for (int i=0; i<nobjs; i++) object_free(MORPHO_GETOBJECT(objs[i]));
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    }
+
+    meshprune_clear(&prune);
+    varray_valueclear(&targets);
+    return out;
+}
+
+static value mesh_ontooption;
+static value mesh_interpolateoption;
+
+/** Slices the mesh along a plane, transferring any Fields and Selections supplied. Returns a Dictionary that maps
+    the mesh and each object to its slice. */
+value Mesh_slice(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    value onto=MORPHO_NIL, interpolate=MORPHO_TRUE;
+    value out=MORPHO_NIL;
+    double x0[m->dim], n[m->dim], norm=0.0;
+    int nfixed=nargs;
+
+    if (!builtin_options(v, nargs, args, &nfixed, 2, mesh_ontooption, &onto, mesh_interpolateoption, &interpolate)) return MORPHO_NIL;
+
+    bool success=(nfixed>=2 && (MORPHO_ISNIL(onto) || MORPHO_ISMESH(onto)) &&
+                  mesh_positionfromvalue(m, MORPHO_GETARG(args, 0), x0) &&
+                  mesh_positionfromvalue(m, MORPHO_GETARG(args, 1), n));
+    if (success) {
+        for (int k=0; k<m->dim; k++) norm+=n[k]*n[k];
+        success=(norm>0.0);
+    }
+
+    varray_value targets;
+    varray_valueinit(&targets);
+    for (int i=2; success && i<nfixed; i++) success=mesh_refinetarget(m, MORPHO_GETARG(args, i), &targets);
+
+    if (!success) {
+        morpho_runtimeerror(v, MESH_SLICEARGS);
+        varray_valueclear(&targets);
+        return MORPHO_NIL;
+    }
+
+    meshslicing slice;
+    if (!meshslice_slice(m, x0, n, (MORPHO_ISNIL(onto) ? NULL : MORPHO_GETMESH(onto)), &slice)) {
+        if (MORPHO_ISNIL(onto)) morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        else morpho_runtimeerror(v, MESH_SLICEONTO);
+        varray_valueclear(&targets);
+        return MORPHO_NIL;
+    }
+
+    value objs[targets.count+2];
+    int nobjs=0;
+    objectdictionary *dict=object_newdictionary();
+    success=(dict!=NULL);
+    if (dict) objs[nobjs++]=MORPHO_OBJECT(dict);
+    if (MORPHO_ISNIL(onto)) objs[nobjs++]=MORPHO_OBJECT(slice.new);
+    if (success) success=dictionary_insert(&dict->dict, MORPHO_SELF(args), MORPHO_OBJECT(slice.new));
+
+    for (unsigned int i=0; success && i<targets.count; i++) {
+        if (dictionary_get(&dict->dict, targets.data[i], NULL)) continue; // Already transferred
+        success=meshslice_adapt(&slice, targets.data[i], !MORPHO_ISFALSE(interpolate), &objs[nobjs]);
+        if (success) success=dictionary_insert(&dict->dict, targets.data[i], objs[nobjs++]);
+    }
+
+    if (success) {
+        morpho_bindobjects(v, nobjs, objs);
+        out=objs[0];
+    } else {
+        for (int i=0; i<nobjs; i++) object_free(MORPHO_GETOBJECT(objs[i]));
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    }
+
+    meshslice_clear(&slice);
+    varray_valueclear(&targets);
+    return out;
+}
+
+static value mesh_toloption;
+
+/** Adds a Mesh, or the Meshes in a List, to a list of meshes to merge */
+static bool mesh_mergetarget(value target, varray_value *meshes) {
+    if (MORPHO_ISMESH(target)) return varray_valueadd(meshes, &target, 1);
+    if (!MORPHO_ISLIST(target)) return false;
+    objectlist *list=MORPHO_GETLIST(target);
+    for (int i=0; i<list->val.count; i++) {
+        if (!MORPHO_ISMESH(list->val.data[i]) ||
+            !varray_valueadd(meshes, &list->val.data[i], 1)) return false;
+    }
+    return true;
+}
+
+/** Merges the mesh with other meshes, welding vertices that lie within a tolerance of each other and removing
+    duplicate elements. Returns the merged mesh. */
+value Mesh_merge(vm *v, int nargs, value *args) {
+    value tol=MORPHO_FLOAT(MESH_MERGEDEFAULTTOL);
+    value out=MORPHO_NIL;
+    int nfixed=nargs;
+    double t=0.0;
+
+    if (!builtin_options(v, nargs, args, &nfixed, 1, mesh_toloption, &tol)) return MORPHO_NIL;
+
+    varray_value meshes;
+    varray_valueinit(&meshes);
+    bool success=(morpho_valuetofloat(tol, &t) && t>=0.0 &&
+                  varray_valueadd(&meshes, &MORPHO_SELF(args), 1));
+    for (int i=0; success && i<nfixed; i++) success=mesh_mergetarget(MORPHO_GETARG(args, i), &meshes);
+
+    if (!success) {
+        morpho_runtimeerror(v, MESH_MERGEARGS);
+        varray_valueclear(&meshes);
+        return MORPHO_NIL;
+    }
+
+    objectmesh *m[meshes.count];
+    for (int i=0; i<meshes.count; i++) m[i]=MORPHO_GETMESH(meshes.data[i]);
+
+    objectmesh *new=meshmerge_merge(meshes.count, m, t);
+    if (new) {
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+    varray_valueclear(&meshes);
+    return out;
+}
+
 MORPHO_BEGINCLASS(Mesh)
 MORPHO_METHOD(MORPHO_PRINT_METHOD, Mesh_print, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_SAVE_METHOD, Mesh_save, BUILTIN_FLAGSEMPTY),
@@ -1298,6 +2430,17 @@ MORPHO_METHOD(MESH_ADDGRADE_METHOD, Mesh_addgrade, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MESH_REMOVEGRADE_METHOD, Mesh_removegrade, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MESH_ADDSYMMETRY_METHOD, Mesh_addsymmetry, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MESH_MAXGRADE_METHOD, Mesh_maxgrade, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_NEAREST_METHOD, Mesh_nearest, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_KNEAREST_METHOD, Mesh_knearest, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_INRADIUS_METHOD, Mesh_inradius, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_INBOX_METHOD, Mesh_inbox, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_REFIT_METHOD, Mesh_refit, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_REORDER_METHOD, Mesh_reorder, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_REFINE_METHOD, Mesh_refine, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_EQUIANGULATE_METHOD, Mesh_equiangulate, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_PRUNE_METHOD, Mesh_prune, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_SLICE_METHOD, Mesh_slice, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_MERGE_METHOD, Mesh_merge, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_COUNT_METHOD, Mesh_count, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_CLONE_METHOD, Mesh_clone, BUILTIN_FLAGSEMPTY)
 MORPHO_ENDCLASS
@@ -1321,7 +2464,31 @@ void mesh_initialize(void) {
     value meshclass=builtin_addclass(MESH_CLASSNAME, MORPHO_GETCLASSDEFINITION(Mesh), objclass);
     object_setveneerclass(OBJECT_MESH, meshclass);
 
+    mesh_methodoption=builtin_internsymbolascstring(MESH_METHODOPTION);
+    mesh_selectionoption=builtin_internsymbolascstring(MESH_SELECTIONOPTION);
+    mesh_fixoption=builtin_internsymbolascstring(MESH_FIXOPTION);
+    mesh_lengthoption=builtin_internsymbolascstring(MESH_LENGTHOPTION);
+    mesh_ontooption=builtin_internsymbolascstring(MESH_ONTOOPTION);
+    mesh_interpolateoption=builtin_internsymbolascstring(MESH_INTERPOLATEOPTION);
+    mesh_toloption=builtin_internsymbolascstring(MESH_TOLOPTION);
+
     morpho_defineerror(MESH_FILENOTFOUND, ERROR_HALT, MESH_FILENOTFOUND_MSG);
+    morpho_defineerror(MESH_LOADBINARY, ERROR_HALT, MESH_LOADBINARY_MSG);
+    morpho_defineerror(MESH_NEARESTARGS, ERROR_HALT, MESH_NEARESTARGS_MSG);
+    morpho_defineerror(MESH_KNEARESTARGS, ERROR_HALT, MESH_KNEARESTARGS_MSG);
+    morpho_defineerror(MESH_INRADIUSARGS, ERROR_HALT, MESH_INRADIUSARGS_MSG);
+    morpho_defineerror(MESH_INBOXARGS, ERROR_HALT, MESH_INBOXARGS_MSG);
+    morpho_defineerror(MESH_NOGRADE, ERROR_HALT, MESH_NOGRADE_MSG);
+    morpho_defineerror(MESH_REORDERARGS, ERROR_HALT, MESH_REORDERARGS_MSG);
+    morpho_defineerror(MESH_REORDERMETHOD, ERROR_HALT, MESH_REORDERMETHOD_MSG);
+    morpho_defineerror(MESH_REFINEARGS, ERROR_HALT, MESH_REFINEARGS_MSG);
+    morpho_defineerror(MESH_EQUIANGULATEARGS, ERROR_HALT, MESH_EQUIANGULATEARGS_MSG);
+    morpho_defineerror(MESH_PRUNEARGS, ERROR_HALT, MESH_PRUNEARGS_MSG);
+    morpho_defineerror(MESH_SLICEARGS, ERROR_HALT, MESH_SLICEARGS_MSG);
+    morpho_defineerror(MESH_SLICEONTO, ERROR_HALT, MESH_SLICEONTO_MSG);
+    morpho_defineerror(MESH_MERGEARGS, ERROR_HALT, MESH_MERGEARGS_MSG);
+    morpho_defineerror(MESH_SAVEARGS, ERROR_HALT, MESH_SAVEARGS_MSG);
+    morpho_defineerror(MESH_WRITEFAILED, ERROR_HALT, MESH_WRITEFAILED_MSG);
     morpho_defineerror(MESH_VERTMTRXDIM, ERROR_HALT, MESH_VERTMTRXDIM_MSG);
     morpho_defineerror(MESH_LOADVERTEXDIM, ERROR_HALT, MESH_LOADVERTEXDIM_MSG);
     morpho_defineerror(MESH_LOADVERTEXCOORD, ERROR_HALT, MESH_LOADVERTEXCOORD_MSG);
@@ -8,9 +8,12 @@
 #ifndef mesh_h
 #define mesh_h
 
+#include <stdio.h>
+#include <stdint.h>
 #include "varray.h"
 #include "matrix.h"
 #include "sparse.h"
+#include "threadpool.h"
 
 /* -------------------------------------------------------
  * Mesh object
@@ -19,12 +22,20 @@
 extern objecttype objectmeshtype;
 #define OBJECT_MESH objectmeshtype
 
+/** Spatial index used to accelerate geometric queries; see meshindex.h */
+typedef struct smeshindex meshindex;
+
+/** Cached adjacency lists used by neighbor queries; see meshadjacency.h */
+typedef struct smeshadjacency meshadjacency;
+
 typedef struct {
     object obj;
     unsigned int dim;
     objectmatrix *vert;
     objectarray *conn;
     object *link;
+    meshindex *index;
+    meshadjacency *adjacency;
 } objectmesh;
 
 /** Tests whether an object is a mesh */
@@ -47,6 +58,34 @@ objectmesh *object_newmesh(unsigned int dim, unsigned int nv, double *v);
 #define MESH_FACESECTION "faces"
 #define MESH_VOLSECTION  "volumes"
 
+/** Format labels accepted by the save method */
+#define MESH_TEXTFORMAT                    "mesh"
+#define MESH_BINARYFORMAT                  "binary"
+
+/** File extension that selects the binary format on save */
+#define MESH_BINARYEXTENSION               "bmesh"
+
+/** The binary format consists of a header, the vertex matrix and a section for each grade of element.
+    Arrays are aligned to 8 bytes (see matrixio.h) so that the file can be mapped into memory and copied without parsing.
+    Vertices:  double vert[dim*nvertices] (column major, as in the vertex matrix)
+    Sections:  meshiosection followed by int32 cptr[nelements+1], int32 rix[nentries] of the grade 0 -> g connectivity */
+#define MESH_BINARYMAGIC                   "MORPHOMS"
+#define MESH_BINARYVERSION                 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t dim;
+    int32_t nvertices;
+    int32_t nsections;
+} meshioheader;
+
+typedef struct {
+    int32_t grade;
+    int32_t nelements;
+    int64_t nentries;
+} meshiosection;
+
 #define MESH_VERTEXMATRIX_METHOD           "vertexmatrix"
 #define MESH_SETVERTEXMATRIX_METHOD        "setvertexmatrix"
 
@@ -62,6 +101,32 @@ objectmesh *object_newmesh(unsigned int dim, unsigned int nv, double *v);
 
 #define MESH_TRANSFORM_METHOD              "transform"
 
+#define MESH_NEAREST_METHOD                "nearest"
+#define MESH_KNEAREST_METHOD               "knearest"
+#define MESH_INRADIUS_METHOD               "inradius"
+#define MESH_INBOX_METHOD                  "inbox"
+#define MESH_REFIT_METHOD                  "refit"
+
+#define MESH_REORDER_METHOD                "reorder"
+#define MESH_METHODOPTION                  "method"
+
+#define MESH_REFINE_METHOD                 "refine"
+#define MESH_SELECTIONOPTION               "selection"
+
+#define MESH_EQUIANGULATE_METHOD           "equiangulate"
+#define MESH_FIXOPTION                     "fix"
+
+#define MESH_PRUNE_METHOD                  "prune"
+#define MESH_LENGTHOPTION                  "length"
+
+#define MESH_SLICE_METHOD                  "slice"
+#define MESH_ONTOOPTION                    "onto"
+#define MESH_INTERPOLATEOPTION             "interpolate"
+
+#define MESH_MERGE_METHOD                  "merge"
+#define MESH_TOLOPTION                     "tol"
+#define MESH_MERGEDEFAULTTOL               1e-12
+
 typedef int grade;
 typedef int elementid;
 
@@ -96,6 +161,15 @@ DECLARE_VARRAY(elementid, elementid);
 #define MESH_FILENOTFOUND                    "MshFlNtFnd"
 #define MESH_FILENOTFOUND_MSG                "Mesh file '%s' not found."
 
+#define MESH_LOADBINARY                      "MshLdBnry"
+#define MESH_LOADBINARY_MSG                  "Binary mesh file '%s' is corrupt or has an unsupported version."
+
+#define MESH_SAVEARGS                        "MshSvArgs"
+#define MESH_SAVEARGS_MSG                    "Method 'save' expects a file name and, optionally, a format."
+
+#define MESH_WRITEFAILED                     "MshWrtFld"
+#define MESH_WRITEFAILED_MSG                 "Couldn't write mesh file '%s'."
+
 #define MESH_STVRTPSNARGS                    "MshStVrtPsnArgs"
 #define MESH_STVRTPSNARGS_MSG                "Method 'setvertexposition' expects a vertex id and a position matrix as arguments."
 
@@ -123,9 +197,51 @@ DECLARE_VARRAY(elementid, elementid);
 #define MESH_ADDSYMNOMTCH                    "MshAddSymNoMtch"
 #define MESH_ADDSYMNOMTCH_MSG                "Addsymmetry found no matching vertices."
 
+#define MESH_NEARESTARGS                     "MshNrstArgs"
+#define MESH_NEARESTARGS_MSG                 "Method 'nearest' expects a position and, optionally, a grade."
+
+#define MESH_KNEARESTARGS                    "MshKNrstArgs"
+#define MESH_KNEARESTARGS_MSG                "Method 'knearest' expects a position, a number of elements to find and, optionally, a grade."
+
+#define MESH_INRADIUSARGS                    "MshInRdsArgs"
+#define MESH_INRADIUSARGS_MSG                "Method 'inradius' expects a position, a radius and, optionally, a grade."
+
+#define MESH_INBOXARGS                       "MshInBxArgs"
+#define MESH_INBOXARGS_MSG                   "Method 'inbox' expects the lower and upper corners of a box and, optionally, a grade."
+
+#define MESH_NOGRADE                         "MshNoGrd"
+#define MESH_NOGRADE_MSG                     "Mesh has no elements of grade %i."
+
+#define MESH_REORDERARGS                     "MshRrdrArgs"
+#define MESH_REORDERARGS_MSG                 "Method 'reorder' expects Fields or Selections on the mesh and, optionally, a method."
+
+#define MESH_REORDERMETHOD                   "MshRrdrMthd"
+#define MESH_REORDERMETHOD_MSG               "Unknown reordering method: expected 'hilbert' or 'rcm'."
+
+#define MESH_REFINEARGS                      "MshRfnArgs"
+#define MESH_REFINEARGS_MSG                  "Method 'refine' expects Fields or Selections on the mesh, or Lists of them, and optionally a selection of elements to refine."
+
+#define MESH_EQUIANGULATEARGS                "MshEqnglArgs"
+#define MESH_EQUIANGULATEARGS_MSG            "Method 'equiangulate' expects no arguments and optionally a selection of elements to fix."
+
+#define MESH_PRUNEARGS                       "MshPrnArgs"
+#define MESH_PRUNEARGS_MSG                   "Method 'prune' expects Fields or Selections on the mesh, or Lists of them, and a selection of elements to collapse, a maximum edge length, or both, optionally with a selection of fixed vertices."
+
+#define MESH_SLICEARGS                       "MshSlcArgs"
+#define MESH_SLICEARGS_MSG                   "Method 'slice' expects a point on the plane and a nonzero normal, each with one entry per dimension, followed by Fields or Selections on the mesh, or Lists of them."
+
+#define MESH_SLICEONTO                       "MshSlcOnto"
+#define MESH_SLICEONTO_MSG                   "The mesh supplied with 'onto' is not a slice of this mesh along the same plane."
+
+#define MESH_MERGEARGS                       "MshMrgArgs"
+#define MESH_MERGEARGS_MSG                   "Method 'merge' expects Meshes, or Lists of them, and optionally a non-negative tolerance."
+
 #define MESH_CONSTRUCTORARGS                  "MshArgs"
 #define MESH_CONSTRUCTORARGS_MSG              "Mesh expects either a single file name or no argurments"
 
+/** Number of tuples above which connectivity is generated in parallel */
+#define MESH_PARALLELTHRESHOLD 65536
+
 /* Tolerances */
 
 /** This controls how close two points can be before they're indistinct */
@@ -140,6 +256,7 @@ grade mesh_maxgrade(objectmesh *mesh);
 
 bool mesh_checkconnectivity(objectmesh *mesh);
 objectsparse *mesh_newconnectivityelement(objectmesh *mesh, unsigned int row, unsigned int col);
+bool mesh_setconnectivityelement(objectmesh *mesh, unsigned int row, unsigned int col, objectsparse *el);
 objectsparse *mesh_addgrade(objectmesh *mesh, grade g);
 objectsparse *mesh_addconnectivityelement(objectmesh *mesh, unsigned int row, unsigned int col);
 objectsparse *mesh_getconnectivityelement(objectmesh *mesh, unsigned int row, unsigned int col);
@@ -149,6 +266,14 @@ bool mesh_getconnectivity(objectsparse *conn, elementid id, int *nentries, int *
 void mesh_freezeconnectivity(objectmesh *mesh);
 void mesh_resetconnectivity(objectmesh *m);
 
+void mesh_sorttuple(int n, elementid *tuple);
+int mesh_ncombinations(int k, int n);
+void mesh_elementtuples(int nel, int *entries, int n, elementid *out);
+bool mesh_uniquetuples(int n, int ntuples, elementid *tuples, char *isnew);
+
+int mesh_ntasks(size_t work);
+bool mesh_runtasks(int ntasks, workfn fn, void *tasks, size_t tasksize);
+
 bool mesh_getvertexcoordinates(objectmesh *mesh, elementid id, double *val);
 bool mesh_getvertexcoordinatesaslist(objectmesh *mesh, elementid id, double **out);
 bool mesh_getvertexcoordinatesasvalues(objectmesh *mesh, elementid id, value *val);
@@ -156,6 +281,10 @@ bool mesh_getvertexcoordinatesasvalues(objectmesh *mesh, elementid id, value *va
 bool mesh_getsynonyms(objectmesh *mesh, grade g, elementid id, varray_elementid *synonymids);
 int mesh_findneighbors(objectmesh *mesh, grade g, elementid id, grade target, varray_elementid *neighbors);
 
+bool mesh_isbinary(FILE *f);
+objectmesh *mesh_load(vm *v, char *file);
+bool mesh_save(vm *v, objectmesh *m, char *file, value format);
+
 void mesh_initialize(void);
 
 #endif /* mesh_h */
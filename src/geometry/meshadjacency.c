@@ -0,0 +1,322 @@
+/** @file meshadjacency.c
+ *  @author T J Atherton
+ *
+ *  @brief Cached adjacency lists for fast neighbor queries on meshes
+ */
+
+#include "morpho.h"
+#include "classes.h"
+#include "meshadjacency.h"
+
+/* **********************************************************************
+ * Adjacency lists
+ * ********************************************************************** */
+
+static meshadjacencylist *meshadjacency_newlist(grade g, grade target) {
+    meshadjacencylist *new=MORPHO_MALLOC(sizeof(meshadjacencylist));
+    if (new) {
+        new->g=g;
+        new->target=target;
+        new->down=new->conn=new->sym=NULL;
+        new->ndown=new->nconn=new->nsym=0;
+        new->nelements=0;
+        varray_intinit(&new->ptr);
+        varray_elementidinit(&new->ids);
+    }
+    return new;
+}
+
+static void meshadjacency_freelist(meshadjacencylist *list) {
+    if (!list) return;
+    varray_intclear(&list->ptr);
+    varray_elementidclear(&list->ids);
+    MORPHO_FREE(list);
+}
+
+/** Number of entries in a connectivity matrix in CCS format */
+static int meshadjacency_nentries(objectsparse *s) {
+    return (s && s->ccs.cptr ? s->ccs.nentries : 0);
+}
+
+/** Number of entries in a symmetry matrix, which is stored in DOK format */
+static int meshadjacency_nsymmetries(objectsparse *s) {
+    return (s ? s->dok.dict.count : 0);
+}
+
+/** Gets the slice of a list for a given element */
+static bool meshadjacency_slice(meshadjacencylist *list, elementid id, int *n, elementid **ids) {
+    if (id<0 || id>=list->nelements) return false;
+    *n=list->ptr.data[id+1]-list->ptr.data[id];
+    *ids=list->ids.data+list->ptr.data[id];
+    return true;
+}
+
+/** Removes duplicates from each list, preserving the order of first occurrence */
+static void meshadjacency_unique(meshadjacencylist *list) {
+    int n=0;
+    for (int i=0; i<list->nelements; i++) {
+        int start=n;
+        for (int k=list->ptr.data[i]; k<list->ptr.data[i+1]; k++) {
+            elementid id=list->ids.data[k];
+            int j;
+            for (j=start; j<n; j++) if (list->ids.data[j]==id) break;
+            if (j==n) list->ids.data[n++]=id;
+        }
+        list->ptr.data[i]=start;
+    }
+    list->ptr.data[list->nelements]=n;
+    list->ids.count=n;
+}
+
+/* **********************************************************************
+ * The adjacency cache
+ * ********************************************************************** */
+
+/** Frees a mesh's adjacency lists */
+void meshadjacency_free(meshadjacency *adj) {
+    if (!adj) return;
+    for (int i=0; i<(MESH_GRADE_VOLUME+1)*(MESH_GRADE_VOLUME+1); i++) meshadjacency_freelist(adj->neighbors[i]);
+    for (int i=0; i<=MESH_GRADE_VOLUME; i++) meshadjacency_freelist(adj->synonyms[i]);
+    MORPHO_FREE(adj);
+}
+
+/** Discards the adjacency lists; call this when the connectivity of a mesh changes */
+void meshadjacency_invalidate(objectmesh *mesh) {
+    meshadjacency_free(mesh->adjacency);
+    mesh->adjacency=NULL;
+}
+
+/** Ensures a mesh has an adjacency cache */
+static bool meshadjacency_check(objectmesh *mesh) {
+    if (mesh->adjacency) return true;
+    meshadjacency *new=MORPHO_MALLOC(sizeof(meshadjacency));
+    if (!new) return false;
+    for (int i=0; i<(MESH_GRADE_VOLUME+1)*(MESH_GRADE_VOLUME+1); i++) new->neighbors[i]=NULL;
+    for (int i=0; i<=MESH_GRADE_VOLUME; i++) new->synonyms[i]=NULL;
+    mesh->adjacency=new;
+    return true;
+}
+
+static bool meshadjacency_validgrades(grade g, grade target) {
+    return (g>=0 && g<=MESH_GRADE_VOLUME && target>0 && target<=MESH_GRADE_VOLUME);
+}
+
+/** Checks whether a neighbor list is consistent with the current connectivity */
+static bool meshadjacency_neighborsvalid(objectmesh *mesh, meshadjacencylist *list) {
+    if (!list) return false;
+    objectsparse *down=(list->g>0 ? mesh_getconnectivityelement(mesh, 0, list->g) : NULL);
+    objectsparse *conn=mesh_getconnectivityelement(mesh, list->target, 0);
+    objectsparse *sym=mesh_getconnectivityelement(mesh, 0, 0);
+
+    return (list->down==down && list->ndown==meshadjacency_nentries(down) &&
+            list->conn==conn && list->nconn==meshadjacency_nentries(conn) &&
+            list->sym==sym && list->nsym==meshadjacency_nsymmetries(sym));
+}
+
+/** Adds the elements that contain vertex v to the neighbor list of element id */
+static void meshadjacency_insert(meshadjacencylist *list, objectsparse *conn, int v, elementid id, int *mark) {
+    if (v<0 || v>=conn->ccs.ncols) return;
+    for (int k=conn->ccs.cptr[v]; k<conn->ccs.cptr[v+1]; k++) {
+        elementid e=conn->ccs.rix[k];
+        if (list->g==list->target && e==id) continue;
+        if (mark[e]!=id) {
+            mark[e]=id;
+            varray_elementidwrite(&list->ids, e);
+        }
+    }
+}
+
+/** Builds the lists of elements of grade target that share a vertex, or a vertex related by a symmetry,
+ *  with each element of grade g. Elements are listed in the order found by mesh_findneighbors.
+ *  Call this before evaluating in parallel; queries from multiple threads are then safe.
+ * @returns true if the lists are available */
+bool meshadjacency_buildneighbors(objectmesh *mesh, grade g, grade target) {
+    if (!meshadjacency_validgrades(g, target) || !meshadjacency_check(mesh)) return false;
+    meshadjacencylist **list=&mesh->adjacency->neighbors[g*(MESH_GRADE_VOLUME+1)+target];
+    if (meshadjacency_neighborsvalid(mesh, *list)) return true;
+
+    meshadjacency_freelist(*list);
+    *list=NULL;
+
+    objectsparse *down=NULL, *conn, *sym;
+    if (g>0) {
+        down=mesh_getconnectivityelement(mesh, 0, g);
+        if (!down || !sparse_checkformat(down, SPARSE_CCS, true, false)) return false;
+    }
+    conn=mesh_getconnectivityelement(mesh, target, 0);
+    if (!conn || !sparse_checkformat(conn, SPARSE_CCS, true, false)) return false;
+    sym=mesh_getconnectivityelement(mesh, 0, 0);
+    if (sym && !sparse_checkformat(sym, SPARSE_CCS, true, false)) return false;
+
+    int nv=mesh_nvertices(mesh), ntarget=0;
+    int nel=(g>0 ? down->ccs.ncols : nv);
+    for (int k=0; k<conn->ccs.nentries; k++) if (conn->ccs.rix[k]>=ntarget) ntarget=conn->ccs.rix[k]+1;
+
+    meshadjacencylist *new=meshadjacency_newlist(g, target);
+    int *mark=MORPHO_MALLOC(sizeof(int)*(ntarget>0 ? ntarget : 1));
+    int *tptr=NULL, *tcol=NULL; // Transpose of the symmetry matrix
+    bool success=false;
+    if (!new || !mark) goto meshadjacency_buildneighbors_cleanup;
+    for (int i=0; i<ntarget; i++) mark[i]=-1;
+
+    if (sym) {
+        tptr=MORPHO_MALLOC(sizeof(int)*(nv+1));
+        tcol=MORPHO_MALLOC(sizeof(int)*(sym->ccs.nentries>0 ? sym->ccs.nentries : 1));
+        if (!tptr || !tcol) goto meshadjacency_buildneighbors_cleanup;
+
+        for (int i=0; i<=nv; i++) tptr[i]=0;
+        for (int k=0; k<sym->ccs.nentries; k++) if (sym->ccs.rix[k]<nv) tptr[sym->ccs.rix[k]+1]++;
+        for (int i=0; i<nv; i++) tptr[i+1]+=tptr[i];
+        for (int c=0; c<sym->ccs.ncols; c++) {
+            for (int k=sym->ccs.cptr[c]; k<sym->ccs.cptr[c+1]; k++) {
+                int r=sym->ccs.rix[k];
+                if (r<nv) tcol[tptr[r]++]=c;
+            }
+        }
+        for (int i=nv; i>0; i--) tptr[i]=tptr[i-1];
+        tptr[0]=0;
+    }
+
+    if (!varray_intresize(&new->ptr, nel+1)) goto meshadjacency_buildneighbors_cleanup;
+
+    for (elementid id=0; id<nel; id++) {
+        int nvert, *vids, vvid=id;
+        varray_intwrite(&new->ptr, new->ids.count);
+
+        if (g>0) {
+            nvert=down->ccs.cptr[id+1]-down->ccs.cptr[id];
+            vids=down->ccs.rix+down->ccs.cptr[id];
+        } else {
+            nvert=1; vids=&vvid;
+        }
+
+        for (int k=0; k<nvert; k++) meshadjacency_insert(new, conn, vids[k], id, mark);
+
+        /* Elements that contain images of the element's vertices, or vertices of which they are images */
+        if (sym) {
+            for (int k=0; k<nvert; k++) {
+                int v=vids[k];
+                if (v<sym->ccs.ncols) {
+                    for (int l=sym->ccs.cptr[v]; l<sym->ccs.cptr[v+1]; l++) meshadjacency_insert(new, conn, sym->ccs.rix[l], id, mark);
+                }
+                if (v<nv) {
+                    for (int l=tptr[v]; l<tptr[v+1]; l++) meshadjacency_insert(new, conn, tcol[l], id, mark);
+                }
+            }
+        }
+    }
+    varray_intwrite(&new->ptr, new->ids.count);
+
+    new->nelements=nel;
+    new->down=down; new->ndown=meshadjacency_nentries(down);
+    new->conn=conn; new->nconn=meshadjacency_nentries(conn);
+    new->sym=sym; new->nsym=meshadjacency_nsymmetries(sym);
+    *list=new;
+    new=NULL;
+    success=true;
+
+meshadjacency_buildneighbors_cleanup:
+    meshadjacency_freelist(new);
+    if (mark) MORPHO_FREE(mark);
+    if (tptr) MORPHO_FREE(tptr);
+    if (tcol) MORPHO_FREE(tcol);
+    return success;
+}
+
+/** Builds the lists of elements of grade g related to each element by a symmetry.
+ *  Elements are listed in the order found by mesh_getsynonyms.
+ * @returns true if the lists are available */
+bool meshadjacency_buildsynonyms(objectmesh *mesh, grade g) {
+    if (g<0 || g>MESH_GRADE_VOLUME || !meshadjacency_check(mesh)) return false;
+    meshadjacencylist **list=&mesh->adjacency->synonyms[g];
+    objectsparse *sym=mesh_getconnectivityelement(mesh, g, g);
+    if (*list && (*list)->sym==sym && (*list)->nsym==meshadjacency_nsymmetries(sym)) return true;
+
+    meshadjacency_freelist(*list);
+    *list=NULL;
+
+    meshadjacencylist *new=meshadjacency_newlist(g, g);
+    if (!new) return false;
+
+    int nel=mesh_nelementsforgrade(mesh, g), i, j;
+    void *ctr;
+    if (sym) {
+        ctr=sparsedok_loopstart(&sym->dok);
+        while (sparsedok_loop(&sym->dok, &ctr, &i, &j)) {
+            if (i>=nel) nel=i+1;
+            if (j>=nel) nel=j+1;
+        }
+    }
+
+    /* Count the entries for each element, then fill them in the order of the DOK loop */
+    if (!varray_intresize(&new->ptr, nel+1)) goto meshadjacency_buildsynonyms_cleanup;
+    for (int k=0; k<=nel; k++) new->ptr.data[k]=0;
+    new->ptr.count=nel+1;
+    new->nelements=nel;
+
+    if (sym) {
+        ctr=sparsedok_loopstart(&sym->dok);
+        while (sparsedok_loop(&sym->dok, &ctr, &i, &j)) {
+            new->ptr.data[i+1]++;
+            new->ptr.data[j+1]++;
+        }
+    }
+    for (int k=0; k<nel; k++) new->ptr.data[k+1]+=new->ptr.data[k];
+
+    int n=new->ptr.data[nel];
+    if (n>0) {
+        if (!varray_elementidresize(&new->ids, n)) goto meshadjacency_buildsynonyms_cleanup;
+        new->ids.count=n;
+
+        ctr=sparsedok_loopstart(&sym->dok);
+        while (sparsedok_loop(&sym->dok, &ctr, &i, &j)) {
+            new->ids.data[new->ptr.data[i]++]=j;
+            new->ids.data[new->ptr.data[j]++]=i;
+        }
+        for (int k=nel; k>0; k--) new->ptr.data[k]=new->ptr.data[k-1];
+        new->ptr.data[0]=0;
+        meshadjacency_unique(new);
+    }
+
+    new->sym=sym;
+    new->nsym=meshadjacency_nsymmetries(sym);
+    *list=new;
+    return true;
+
+meshadjacency_buildsynonyms_cleanup:
+    meshadjacency_freelist(new);
+    return false;
+}
+
+/* **********************************************************************
+ * Queries
+ * ********************************************************************** */
+
+/** Gets the cached neighbors of element id of grade g in grade target.
+ *  Lists are not built on demand, as this may be called from several threads at once.
+ * @param[out] n - number of neighbors
+ * @param[out] ids - the neighbors; the array belongs to the mesh
+ * @returns true if the neighbors are available, false if the lists must be built */
+bool meshadjacency_neighbors(objectmesh *mesh, grade g, elementid id, grade target, int *n, elementid **ids) {
+    if (!mesh->adjacency || !meshadjacency_validgrades(g, target)) return false;
+    meshadjacencylist *list=mesh->adjacency->neighbors[g*(MESH_GRADE_VOLUME+1)+target];
+
+    return (meshadjacency_neighborsvalid(mesh, list) &&
+            meshadjacency_slice(list, id, n, ids));
+}
+
+/** Gets the cached synonyms of element id of grade g
+ * @param[out] n - number of synonyms
+ * @param[out] ids - the synonyms; the array belongs to the mesh
+ * @returns true if the synonyms are available, false if the lists must be built */
+bool meshadjacency_synonyms(objectmesh *mesh, grade g, elementid id, int *n, elementid **ids) {
+    if (!mesh->adjacency || g<0 || g>MESH_GRADE_VOLUME) return false;
+    meshadjacencylist *list=mesh->adjacency->synonyms[g];
+    objectsparse *sym=mesh_getconnectivityelement(mesh, g, g);
+
+    if (!list || list->sym!=sym || list->nsym!=meshadjacency_nsymmetries(sym)) return false;
+    if (id>=0 && id<list->nelements) return meshadjacency_slice(list, id, n, ids);
+
+    *n=0; // Elements with no synonyms
+    return (id>=0);
+}
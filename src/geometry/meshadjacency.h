@@ -0,0 +1,51 @@
+/** @file meshadjacency.h
+ *  @author T J Atherton
+ *
+ *  @brief Cached adjacency lists for fast neighbor queries on meshes
+ */
+
+#ifndef meshadjacency_h
+#define meshadjacency_h
+
+#include "mesh.h"
+
+/* -------------------------------------------------------
+ * Adjacency lists
+ * ------------------------------------------------------- */
+
+/** Functionals such as the curvatures need, for every element, the elements of some grade that share a
+    vertex with it (taking symmetries into account) and the elements related to it by symmetries.
+    These lists are computed for the whole mesh at once and stored in compressed sparse row (CSR) form,
+    so that each query is a slice of an array. The lists are discarded whenever the connectivity changes. */
+
+typedef struct {
+    grade g; // Grade of the elements whose neighbors are listed
+    grade target; // Grade of the neighbors
+    objectsparse *down; // Connectivity the lists were built from, used to detect changes
+    objectsparse *conn;
+    objectsparse *sym;
+    int ndown, nconn, nsym; // Number of entries in each when built
+    int nelements;
+    varray_int ptr; // Neighbors of element i are ids[ptr[i]] ... ids[ptr[i+1]-1]
+    varray_elementid ids;
+} meshadjacencylist;
+
+struct smeshadjacency {
+    meshadjacencylist *neighbors[(MESH_GRADE_VOLUME+1)*(MESH_GRADE_VOLUME+1)];
+    meshadjacencylist *synonyms[MESH_GRADE_VOLUME+1];
+};
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+void meshadjacency_free(meshadjacency *adj);
+void meshadjacency_invalidate(objectmesh *mesh);
+
+bool meshadjacency_buildneighbors(objectmesh *mesh, grade g, grade target);
+bool meshadjacency_buildsynonyms(objectmesh *mesh, grade g);
+
+bool meshadjacency_neighbors(objectmesh *mesh, grade g, elementid id, grade target, int *n, elementid **ids);
+bool meshadjacency_synonyms(objectmesh *mesh, grade g, elementid id, int *n, elementid **ids);
+
+#endif /* meshadjacency_h */
@@ -0,0 +1,257 @@
+/** @file meshflip.c
+ *  @author T J Atherton
+ *
+ *  @brief Improvement of triangulated meshes by edge flips
+ */
+
+#include <string.h>
+
+#include "morpho.h"
+#include "classes.h"
+#include "meshflip.h"
+#include "meshindex.h"
+#include "meshadjacency.h"
+
+/* **********************************************************************
+ * Adjacency
+ * ********************************************************************** */
+
+/** Adjacency between the vertices, edges and faces of a triangulated mesh, updated as edges are flipped */
+typedef struct {
+    objectmesh *mesh;
+    double *x; // Vertex positions
+    int dim;
+    int nv, ne, nf;
+    sparseccs *edges; // Vertices of each edge
+    sparseccs *faces; // Vertices of each face
+    varray_int *vedges; // Edges incident on each vertex
+    int *eface; // Two faces adjacent to each edge
+    int *nface; // Number of faces adjacent to each edge
+    int *fedge; // Three edges of each face
+} meshflip;
+
+static void meshflip_clear(meshflip *f) {
+    if (f->vedges) {
+        for (int i=0; i<f->nv; i++) varray_intclear(&f->vedges[i]);
+        MORPHO_FREE(f->vedges);
+    }
+    if (f->eface) MORPHO_FREE(f->eface);
+    if (f->nface) MORPHO_FREE(f->nface);
+    if (f->fedge) MORPHO_FREE(f->fedge);
+}
+
+/** Returns the vertex of edge e other than v */
+static elementid meshflip_other(meshflip *f, int e, elementid v) {
+    elementid *ev=f->edges->rix+f->edges->cptr[e];
+    return (ev[0]==v ? ev[1] : ev[0]);
+}
+
+/** Finds the edge between two vertices, or -1 */
+static int meshflip_findedge(meshflip *f, elementid a, elementid b) {
+    varray_int *list=&f->vedges[a];
+    for (unsigned int i=0; i<list->count; i++) if (meshflip_other(f, list->data[i], a)==b) return list->data[i];
+    return -1;
+}
+
+static void meshflip_removeedge(varray_int *list, int e) {
+    for (unsigned int i=0; i<list->count; i++) {
+        if (list->data[i]==e) { list->data[i]=list->data[--list->count]; return; }
+    }
+}
+
+/** Builds the adjacency from the connectivity of edges and faces */
+static bool meshflip_build(meshflip *f) {
+    f->vedges=MORPHO_MALLOC(sizeof(varray_int)*(f->nv>0 ? f->nv : 1));
+    f->eface=MORPHO_MALLOC(sizeof(int)*2*(f->ne>0 ? f->ne : 1));
+    f->nface=MORPHO_MALLOC(sizeof(int)*(f->ne>0 ? f->ne : 1));
+    f->fedge=MORPHO_MALLOC(sizeof(int)*3*(f->nf>0 ? f->nf : 1));
+    if (!f->vedges || !f->eface || !f->nface || !f->fedge) return false;
+
+    for (int i=0; i<f->nv; i++) varray_intinit(&f->vedges[i]);
+    for (int e=0; e<f->ne; e++) {
+        f->nface[e]=0;
+        elementid *ev=f->edges->rix+f->edges->cptr[e];
+        if (f->edges->cptr[e+1]-f->edges->cptr[e]!=2 || ev[0]==ev[1]) { f->nface[e]=-1; continue; } // Never flip malformed edges
+        if (!varray_intwrite(&f->vedges[ev[0]], e) && f->vedges[ev[0]].count==0) return false;
+        if (!varray_intwrite(&f->vedges[ev[1]], e) && f->vedges[ev[1]].count==0) return false;
+    }
+
+    for (int i=0; i<f->nf; i++) {
+        elementid *fv=f->faces->rix+f->faces->cptr[i];
+        bool wellformed=(f->faces->cptr[i+1]-f->faces->cptr[i]==3);
+
+        for (int k=0; k<3; k++) {
+            int e=(wellformed ? meshflip_findedge(f, fv[k], fv[(k+1)%3]) : -1);
+            f->fedge[3*i+k]=e;
+            if (e<0 || f->nface[e]<0) continue;
+            if (f->nface[e]<2) f->eface[2*e+f->nface[e]]=i;
+            f->nface[e]++;
+        }
+
+        if (!wellformed) continue;
+        for (int k=0; k<3; k++) { // Edges of a face that lacks some of its edges cannot be flipped
+            if (f->fedge[3*i+k]<0) for (int j=0; j<3; j++) if (f->fedge[3*i+j]>=0) f->nface[f->fedge[3*i+j]]=-1;
+        }
+    }
+
+    return true;
+}
+
+/* **********************************************************************
+ * Flips
+ * ********************************************************************** */
+
+static double meshflip_distance(meshflip *f, elementid a, elementid b) {
+    double d=0;
+    for (int k=0; k<f->dim; k++) {
+        double dx=f->x[a*f->dim+k]-f->x[b*f->dim+k];
+        d+=dx*dx;
+    }
+    return sqrt(d);
+}
+
+/** Tests whether the angles opposite an edge (p,q) in triangles with third vertices c0 and c1 sum to more than pi */
+static bool meshflip_test(meshflip *f, elementid p, elementid q, elementid c0, elementid c1) {
+    double a=meshflip_distance(f, p, q), // Common edge
+           b=meshflip_distance(f, p, c0), // Edges of face 0
+           c=meshflip_distance(f, q, c0),
+           d=meshflip_distance(f, p, c1), // Edges of face 1
+           e=meshflip_distance(f, q, c1);
+
+    return ((b*b + c*c - a*a)*d*e + (d*d + e*e - a*a)*b*c) < 0;
+}
+
+/** Returns the vertex of face i not on edge (p,q) */
+static elementid meshflip_opposite(meshflip *f, int i, elementid p, elementid q) {
+    elementid *fv=f->faces->rix+f->faces->cptr[i];
+    for (int k=0; k<3; k++) if (fv[k]!=p && fv[k]!=q) return fv[k];
+    return -1;
+}
+
+/** Returns the edge of face i that joins vertex v to a vertex other than w */
+static int meshflip_faceedge(meshflip *f, int i, elementid v, elementid w) {
+    for (int k=0; k<3; k++) {
+        int e=f->fedge[3*i+k];
+        elementid *ev=f->edges->rix+f->edges->cptr[e];
+        if ((ev[0]==v || ev[1]==v) && ev[0]!=w && ev[1]!=w) return e;
+    }
+    return -1;
+}
+
+static void meshflip_replaceface(meshflip *f, int e, int old, int new) {
+    for (int k=0; k<2; k++) if (f->eface[2*e+k]==old) f->eface[2*e+k]=new;
+}
+
+static void meshflip_setelement(elementid *el, int n, elementid *vids) {
+    memcpy(el, vids, sizeof(elementid)*n);
+    mesh_sorttuple(n, el);
+}
+
+/** Flips edge e if permitted and beneficial
+ * @param[out] nbrs - the four edges around a flipped edge
+ * @returns true if the edge was flipped */
+static bool meshflip_flip(meshflip *f, objectselection *fix, int e, int *nbrs) {
+    if (f->nface[e]!=2) return false;
+    if (fix && selection_isselected(fix, MESH_GRADE_LINE, e)) return false;
+
+    int f0=f->eface[2*e], f1=f->eface[2*e+1];
+    if (fix && (selection_isselected(fix, MESH_GRADE_AREA, f0) || selection_isselected(fix, MESH_GRADE_AREA, f1))) return false;
+
+    elementid p=f->edges->rix[f->edges->cptr[e]], q=f->edges->rix[f->edges->cptr[e]+1];
+    if (f->vedges[p].count<4 || f->vedges[q].count<4) return false; // Skip if connectivity deficient
+
+    elementid c0=meshflip_opposite(f, f0, p, q), c1=meshflip_opposite(f, f1, p, q);
+    if (c0<0 || c1<0 || c0==c1 || meshflip_findedge(f, c0, c1)>=0) return false;
+    if (!meshflip_test(f, p, q, c0, c1)) return false;
+
+    int epc0=meshflip_faceedge(f, f0, p, q), eqc0=meshflip_faceedge(f, f0, q, p);
+    int epc1=meshflip_faceedge(f, f1, p, q), eqc1=meshflip_faceedge(f, f1, q, p);
+    if (epc0<0 || eqc0<0 || epc1<0 || eqc1<0) return false;
+
+    /* Face 0 becomes (p, c0, c1) and face 1 becomes (q, c0, c1) */
+    elementid nf0[3] = { p, c0, c1 }, nf1[3] = { q, c0, c1 }, ne[2] = { c0, c1 };
+    meshflip_setelement(f->faces->rix+f->faces->cptr[f0], 3, nf0);
+    meshflip_setelement(f->faces->rix+f->faces->cptr[f1], 3, nf1);
+    meshflip_setelement(f->edges->rix+f->edges->cptr[e], 2, ne);
+
+    meshflip_replaceface(f, eqc0, f0, f1);
+    meshflip_replaceface(f, epc1, f1, f0);
+    int fe0[3] = { e, epc0, epc1 }, fe1[3] = { e, eqc0, eqc1 };
+    memcpy(f->fedge+3*f0, fe0, sizeof(fe0));
+    memcpy(f->fedge+3*f1, fe1, sizeof(fe1));
+
+    meshflip_removeedge(&f->vedges[p], e);
+    meshflip_removeedge(&f->vedges[q], e);
+    varray_intwrite(&f->vedges[c0], e);
+    varray_intwrite(&f->vedges[c1], e);
+
+    nbrs[0]=epc0; nbrs[1]=eqc0; nbrs[2]=epc1; nbrs[3]=eqc1;
+    return true;
+}
+
+/* **********************************************************************
+ * Equiangulation
+ * ********************************************************************** */
+
+/** Equiangulates the triangles of a mesh in place, keeping the ids of edges and faces
+ * @param[in] mesh - the mesh
+ * @param[in] fix - selection of edges and faces that must not be changed, or NULL
+ * @param[out] nflips - number of edges flipped
+ * @returns true on success, false if the mesh has no faces or allocation failed */
+bool meshflip_equiangulate(objectmesh *mesh, objectselection *fix, int *nflips) {
+    objectsparse *faces=mesh_getconnectivityelement(mesh, 0, MESH_GRADE_AREA);
+    if (!faces || !sparse_checkformat(faces, SPARSE_CCS, true, false)) return false;
+    objectsparse *edges=mesh_addgrade(mesh, MESH_GRADE_LINE);
+    if (!edges || !sparse_checkformat(edges, SPARSE_CCS, true, false)) return false;
+
+    meshflip f = { .mesh=mesh, .x=mesh->vert->elements, .dim=mesh->dim, .nv=mesh_nvertices(mesh),
+                   .ne=edges->ccs.ncols, .nf=faces->ccs.ncols, .edges=&edges->ccs, .faces=&faces->ccs };
+    int *queue=NULL;
+    char *queued=NULL;
+    bool success=false;
+    *nflips=0;
+
+    if (!meshflip_build(&f)) goto meshflip_equiangulate_cleanup;
+
+    /* Test every edge, requeueing the edges around each flip */
+    queue=MORPHO_MALLOC(sizeof(int)*(f.ne>0 ? f.ne : 1));
+    queued=MORPHO_MALLOC(sizeof(char)*(f.ne>0 ? f.ne : 1));
+    if (!queue || !queued) goto meshflip_equiangulate_cleanup;
+
+    for (int e=0; e<f.ne; e++) { queue[e]=e; queued[e]=true; }
+    long maxflips=((long) f.ne)*MESHFLIP_MAXFLIPSPEREDGE;
+    int head=0, count=f.ne;
+
+    while (count>0 && *nflips<maxflips) {
+        int e=queue[head], nbrs[4];
+        head=(head+1) % f.ne;
+        count--;
+        queued[e]=false;
+
+        if (!meshflip_flip(&f, fix, e, nbrs)) continue;
+        (*nflips)++;
+
+        for (int k=0; k<4; k++) {
+            if (queued[nbrs[k]]) continue;
+            queue[(head+count) % f.ne]=nbrs[k];
+            queued[nbrs[k]]=true;
+            count++;
+        }
+    }
+
+    if (*nflips>0) { // Remove stale data that depends on the connectivity
+        sparse_removeformat(edges, SPARSE_DOK);
+        sparse_removeformat(faces, SPARSE_DOK);
+        mesh_resetconnectivity(mesh);
+        meshindex_invalidate(mesh, MESH_GRADE_LINE);
+        meshindex_invalidate(mesh, MESH_GRADE_AREA);
+        meshadjacency_invalidate(mesh);
+    }
+    success=true;
+
+meshflip_equiangulate_cleanup:
+    meshflip_clear(&f);
+    if (queue) MORPHO_FREE(queue);
+    if (queued) MORPHO_FREE(queued);
+    return success;
+}
@@ -0,0 +1,32 @@
+/** @file meshflip.h
+ *  @author T J Atherton
+ *
+ *  @brief Improvement of triangulated meshes by edge flips
+ */
+
+#ifndef meshflip_h
+#define meshflip_h
+
+#include "mesh.h"
+#include "selection.h"
+
+/* -------------------------------------------------------
+ * Equiangulation
+ * ------------------------------------------------------- */
+
+/** Equiangulation replaces an edge shared by two triangles with the other diagonal of the quadrilateral they form
+    whenever the angles opposite the edge sum to more than pi, which makes the triangulation locally Delaunay.
+    Flipping an edge changes only the two triangles, their four outer edges and the four vertices involved, so the
+    adjacency between vertices, edges and faces is updated in place and each flip takes constant time. Edges around
+    a flipped edge are queued to be tested again, so that the process continues until no edge needs flipping. */
+
+/** Limits the total number of flips to this multiple of the number of edges, in case roundoff causes cycles */
+#define MESHFLIP_MAXFLIPSPEREDGE 100
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+bool meshflip_equiangulate(objectmesh *mesh, objectselection *fix, int *nflips);
+
+#endif /* meshflip_h */
@@ -0,0 +1,473 @@
+/** @file meshgen.c
+ *  @author T J Atherton
+ *
+ *  @brief Native core of the meshgen module's mesh generator
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "morpho.h"
+#include "classes.h"
+#include "common.h"
+#include "delaunay.h"
+#include "meshgen.h"
+
+/* **********************************************************************
+ * Mesh generator
+ * ********************************************************************** */
+
+typedef struct {
+    vm *v;
+    int dim;
+    int n;                       // Number of points
+    value fn;                    // Domain function
+    value weight;                // Weight function, or nil for uniform elements
+    double h0;                   // Element size
+    double *x;                   // Coordinates of the points
+    double *x0;                  // Coordinates at the last triangulation
+    double *f;                   // Value of the domain function at each point
+    char *fixed;                 // Whether each point lies on the bounding box
+    varray_elementid simplices;  // Simplices of the current triangulation that lie inside the domain
+    varray_elementid bars;       // Pairs of vertices that form the edges of these simplices
+} meshgenerator;
+
+static void meshgen_clear(meshgenerator *g) {
+    if (g->x) MORPHO_FREE(g->x);
+    if (g->x0) MORPHO_FREE(g->x0);
+    if (g->f) MORPHO_FREE(g->f);
+    if (g->fixed) MORPHO_FREE(g->fixed);
+    varray_elementidclear(&g->simplices);
+    varray_elementidclear(&g->bars);
+}
+
+/** Evaluates a function of a point, given as a column Matrix, at each of n points */
+static bool meshgen_evaluate(meshgenerator *g, value fn, int n, double *x, double *f) {
+    value ret=MORPHO_NIL;
+    for (int i=0; i<n; i++) {
+        objectmatrix *m=object_newmatrix(g->dim, 1, false);
+        if (!m) {
+            morpho_runtimeerror(g->v, ERROR_ALLOCATIONFAILED);
+            return false;
+        }
+        memcpy(m->elements, x+i*g->dim, sizeof(double)*g->dim);
+        value pt=MORPHO_OBJECT(m);
+        morpho_bindobjects(g->v, 1, &pt);
+
+        if (!morpho_call(g->v, fn, 1, &pt, &ret)) return false;
+        if (!morpho_valuetofloat(ret, f+i)) {
+            morpho_runtimeerror(g->v, MESHGEN_VALUE);
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Orders pairs of vertex ids */
+static int meshgen_comparebars(const void *a, const void *b) {
+    const elementid *p=a, *q=b;
+    if (p[0]!=q[0]) return (p[0]<q[0] ? -1 : 1);
+    if (p[1]!=q[1]) return (p[1]<q[1] ? -1 : 1);
+    return 0;
+}
+
+/** Triangulates the points, keeping simplices whose centroids lie in the domain, and finds their edges */
+static bool meshgen_triangulate(meshgenerator *g) {
+    int dim=g->dim, nv=dim+1;
+    bool success=false;
+    double *c=NULL;
+
+    varray_elementid all;
+    varray_elementidinit(&all);
+
+    delaunaystatus status=delaunay_triangulate(dim, g->n, g->x, &all);
+    if (status==DELAUNAY_DEGENERATEPOINTS) {
+        morpho_runtimeerror(g->v, MESHGEN_DEGENERATE, dim+1, (dim==2 ? "line" : "plane"));
+        goto meshgen_triangulate_cleanup;
+    } else if (status!=DELAUNAY_OK) goto meshgen_triangulate_allocfailed;
+
+    int nel=all.count/nv;
+    c=MORPHO_MALLOC(sizeof(double)*(dim+1)*(nel>0 ? nel : 1));
+    if (!c) goto meshgen_triangulate_allocfailed;
+
+    double *fc=c+dim*nel;
+    for (int i=0; i<nel; i++) {
+        elementid *el=all.data+i*nv;
+        for (int k=0; k<dim; k++) {
+            double sum=0;
+            for (int j=0; j<nv; j++) sum+=g->x[el[j]*dim+k];
+            c[i*dim+k]=sum/nv;
+        }
+    }
+    if (!meshgen_evaluate(g, g->fn, nel, c, fc)) goto meshgen_triangulate_cleanup;
+
+    g->simplices.count=0;
+    g->bars.count=0;
+    for (int i=0; i<nel; i++) {
+        if (!(fc[i]>0)) continue;
+        elementid *el=all.data+i*nv;
+        if (!varray_elementidadd(&g->simplices, el, nv)) goto meshgen_triangulate_allocfailed;
+        for (int a=0; a<nv; a++) {
+            for (int b=a+1; b<nv; b++) {
+                elementid bar[2] = { (el[a]<el[b] ? el[a] : el[b]), (el[a]<el[b] ? el[b] : el[a]) };
+                if (!varray_elementidadd(&g->bars, bar, 2)) goto meshgen_triangulate_allocfailed;
+            }
+        }
+    }
+
+    // Remove edges shared between simplices
+    int nbars=g->bars.count/2, nunique=0;
+    qsort(g->bars.data, nbars, sizeof(elementid)*2, meshgen_comparebars);
+    for (int i=0; i<nbars; i++) {
+        elementid *bar=g->bars.data+2*i;
+        if (nunique>0 && meshgen_comparebars(bar, g->bars.data+2*(nunique-1))==0) continue;
+        g->bars.data[2*nunique]=bar[0];
+        g->bars.data[2*nunique+1]=bar[1];
+        nunique++;
+    }
+    g->bars.count=2*nunique;
+
+    memcpy(g->x0, g->x, sizeof(double)*dim*g->n);
+    success=true;
+    goto meshgen_triangulate_cleanup;
+
+meshgen_triangulate_allocfailed:
+    morpho_runtimeerror(g->v, ERROR_ALLOCATIONFAILED);
+
+meshgen_triangulate_cleanup:
+    if (c) MORPHO_FREE(c);
+    varray_elementidclear(&all);
+    return success;
+}
+
+/** Projects points that lie outside the domain towards its boundary by a Newton step, using a forward difference
+ *  gradient and the values of the domain function in g->f. If update is set, these values are then recomputed for
+ *  the points that moved, and dxmax, if provided, holds the largest distance moved. */
+static bool meshgen_project(meshgenerator *g, bool update, double *dxmax) {
+    int dim=g->dim, n=g->n, nout=0;
+    bool success=false;
+    double eps=MESHGEN_FDSTEP*g->h0, d2max=0;
+
+    int *out=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    double *xh=MORPHO_MALLOC(sizeof(double)*(2*dim+1)*(n>0 ? n : 1));
+    if (!out || !xh) {
+        morpho_runtimeerror(g->v, ERROR_ALLOCATIONFAILED);
+        goto meshgen_project_cleanup;
+    }
+
+    for (int i=0; i<n; i++) if (!g->fixed[i] && g->f[i]<0) out[nout++]=i;
+    if (nout==0) {
+        success=true;
+        goto meshgen_project_cleanup;
+    }
+
+    double *grad=xh+dim*nout, *fh=grad+dim*nout;
+    for (int k=0; k<dim; k++) {
+        for (int j=0; j<nout; j++) {
+            memcpy(xh+j*dim, g->x+out[j]*dim, sizeof(double)*dim);
+            xh[j*dim+k]+=eps;
+        }
+        if (!meshgen_evaluate(g, g->fn, nout, xh, fh)) goto meshgen_project_cleanup;
+        for (int j=0; j<nout; j++) grad[j*dim+k]=(fh[j]-g->f[out[j]])/eps;
+    }
+
+    for (int j=0; j<nout; j++) {
+        double g2=0;
+        for (int k=0; k<dim; k++) g2+=grad[j*dim+k]*grad[j*dim+k];
+        if (!(g2>0)) continue;
+        double s=g->f[out[j]]/g2;
+        for (int k=0; k<dim; k++) g->x[out[j]*dim+k]-=s*grad[j*dim+k];
+        if (s*s*g2>d2max) d2max=s*s*g2;
+    }
+
+    if (update) {
+        for (int j=0; j<nout; j++) memcpy(xh+j*dim, g->x+out[j]*dim, sizeof(double)*dim);
+        if (!meshgen_evaluate(g, g->fn, nout, xh, fh)) goto meshgen_project_cleanup;
+        for (int j=0; j<nout; j++) g->f[out[j]]=fh[j];
+    }
+    success=true;
+
+meshgen_project_cleanup:
+    if (dxmax) *dxmax=sqrt(d2max);
+    if (out) MORPHO_FREE(out);
+    if (xh) MORPHO_FREE(xh);
+    return success;
+}
+
+/** Moves the points by a fraction of the spring forces on them and projects any that leave the domain back onto
+ *  its boundary. On exit, dpmax holds the largest distance moved by a point that remained inside the domain. */
+static bool meshgen_step(meshgenerator *g, double fscale, double *dpmax) {
+    int dim=g->dim, n=g->n, nbars=g->bars.count/2;
+    bool success=false;
+
+    // Workspace for the bar vectors, lengths, preferred lengths and midpoints, then the forces
+    double *bar=MORPHO_MALLOC(sizeof(double)*((2*dim+2)*(nbars>0 ? nbars : 1)+dim*n));
+    if (!bar) {
+        morpho_runtimeerror(g->v, ERROR_ALLOCATIONFAILED);
+        return false;
+    }
+    double *len=bar+dim*nbars, *hbar=len+nbars, *mid=hbar+nbars, *force=mid+dim*nbars;
+
+    double suml=0, sumh=0;
+    for (int i=0; i<nbars; i++) {
+        elementid a=g->bars.data[2*i], b=g->bars.data[2*i+1];
+        double l2=0;
+        for (int k=0; k<dim; k++) {
+            double d=g->x[a*dim+k]-g->x[b*dim+k];
+            bar[i*dim+k]=d;
+            mid[i*dim+k]=(g->x[a*dim+k]+g->x[b*dim+k])/2;
+            l2+=d*d;
+        }
+        len[i]=sqrt(l2);
+    }
+
+    if (MORPHO_ISNIL(g->weight)) {
+        for (int i=0; i<nbars; i++) hbar[i]=1.0;
+    } else if (!meshgen_evaluate(g, g->weight, nbars, mid, hbar)) goto meshgen_step_cleanup;
+
+    for (int i=0; i<nbars; i++) {
+        suml+=pow(len[i], dim);
+        sumh+=pow(hbar[i], dim);
+    }
+    double scale=(sumh>0 ? fscale*pow(suml/sumh, 1.0/dim) : 0);
+
+    // Springs only repel, so that points spread out to fill the domain
+    memset(force, 0, sizeof(double)*dim*n);
+    for (int i=0; i<nbars; i++) {
+        double l0=scale*hbar[i];
+        if (!(len[i]<l0) || !(len[i]>0)) continue;
+        double s=(l0-len[i])/len[i];
+        elementid a=g->bars.data[2*i], b=g->bars.data[2*i+1];
+        for (int k=0; k<dim; k++) {
+            force[a*dim+k]+=s*bar[i*dim+k];
+            force[b*dim+k]-=s*bar[i*dim+k];
+        }
+    }
+
+    for (int i=0; i<n; i++) {
+        if (g->fixed[i]) continue;
+        for (int k=0; k<dim; k++) g->x[i*dim+k]+=MESHGEN_DELTAT*force[i*dim+k];
+    }
+
+    if (!meshgen_evaluate(g, g->fn, n, g->x, g->f)) goto meshgen_step_cleanup;
+
+    *dpmax=0;
+    for (int i=0; i<n; i++) {
+        if (g->fixed[i] || g->f[i]<0) continue;
+        double d2=0;
+        for (int k=0; k<dim; k++) d2+=force[i*dim+k]*force[i*dim+k];
+        if (d2>*dpmax) *dpmax=d2;
+    }
+    *dpmax=MESHGEN_DELTAT*sqrt(*dpmax);
+
+    success=meshgen_project(g, false, NULL);
+
+meshgen_step_cleanup:
+    MORPHO_FREE(bar);
+    return success;
+}
+
+/** Finds the norm of the displacement of all the points since the last triangulation */
+static double meshgen_displacement(meshgenerator *g) {
+    double d2=0;
+    for (int i=0; i<g->n*g->dim; i++) d2+=(g->x[i]-g->x0[i])*(g->x[i]-g->x0[i]);
+    return sqrt(d2);
+}
+
+/** Creates a Mesh from the current points and triangulation */
+static objectmesh *meshgen_newmesh(meshgenerator *g) {
+    int dim=g->dim, nv=dim+1;
+    int nel=g->simplices.count/nv, nbars=g->bars.count/2;
+
+    objectmesh *new=object_newmesh(dim, g->n, g->x);
+    objectsparse *conn=object_newsparse(NULL, NULL);
+    objectsparse *edges=object_newsparse(NULL, NULL);
+    if (new && new->vert && conn && edges &&
+        sparseccs_resize(&conn->ccs, g->n, nel, nel*nv, false) &&
+        sparseccs_resize(&edges->ccs, g->n, nbars, nbars*2, false)) {
+        memcpy(conn->ccs.rix, g->simplices.data, sizeof(elementid)*g->simplices.count);
+        for (int i=0; i<=nel; i++) conn->ccs.cptr[i]=i*nv;
+        memcpy(edges->ccs.rix, g->bars.data, sizeof(elementid)*g->bars.count);
+        for (int i=0; i<=nbars; i++) edges->ccs.cptr[i]=i*2;
+        mesh_setconnectivityelement(new, 0, 1, edges);
+        mesh_setconnectivityelement(new, 0, dim, conn);
+        mesh_freezeconnectivity(new);
+        return new;
+    }
+
+    if (edges) object_free((object *) edges);
+    if (conn) object_free((object *) conn);
+    if (new) object_free((object *) new);
+    return NULL;
+}
+
+/* **********************************************************************
+ * DistMesh
+ * ********************************************************************** */
+
+static value meshgen_weightoption;
+static value meshgen_fscaleoption;
+static value meshgen_ttoloption;
+static value meshgen_dptoloption;
+static value meshgen_xtoloption;
+static value meshgen_maxiterationsoption;
+
+/** Copies the coordinates of a corner given as a Matrix or a List */
+static bool meshgen_corner(value in, int dim, double *x) {
+    if (MORPHO_ISMATRIX(in)) {
+        objectmatrix *a=MORPHO_GETMATRIX(in);
+        if (matrix_countdof(a)!=dim) return false;
+        memcpy(x, a->elements, sizeof(double)*dim);
+        return true;
+    } else if (MORPHO_ISLIST(in)) {
+        objectlist *l=MORPHO_GETLIST(in);
+        if (l->val.count!=dim) return false;
+        for (int k=0; k<dim; k++) if (!morpho_valuetofloat(l->val.data[k], x+k)) return false;
+        return true;
+    }
+    return false;
+}
+
+/** Finds the dimension and number of a List of points, or of the columns of a Matrix */
+static bool meshgen_countpoints(value pts, int *dim, int *n) {
+    if (MORPHO_ISMATRIX(pts)) {
+        objectmatrix *m=MORPHO_GETMATRIX(pts);
+        *dim=m->nrows;
+        *n=m->ncols;
+    } else if (MORPHO_ISLIST(pts)) {
+        objectlist *list=MORPHO_GETLIST(pts);
+        *n=list->val.count;
+        if (*n==0 || !MORPHO_ISMATRIX(list->val.data[0])) return false;
+        *dim=matrix_countdof(MORPHO_GETMATRIX(list->val.data[0]));
+        for (int i=1; i<*n; i++) {
+            value p=list->val.data[i];
+            if (!MORPHO_ISMATRIX(p) || matrix_countdof(MORPHO_GETMATRIX(p))!=*dim) return false;
+        }
+    } else return false;
+    return (*dim>=2 && *dim<=3);
+}
+
+/** Copies the coordinates of the ith point */
+static void meshgen_getpoint(value pts, int dim, int i, double *x) {
+    if (MORPHO_ISMATRIX(pts)) memcpy(x, MORPHO_GETMATRIX(pts)->elements+i*dim, sizeof(double)*dim);
+    else memcpy(x, MORPHO_GETMATRIX(MORPHO_GETLIST(pts)->val.data[i])->elements, sizeof(double)*dim);
+}
+
+/** Generates a Mesh of the region where a function is positive from an initial set of points */
+value meshgen_distmesh(vm *v, int nargs, value *args) {
+    value weight=MORPHO_NIL, fscale=MORPHO_FLOAT(MESHGEN_FSCALE), ttol=MORPHO_FLOAT(MESHGEN_TTOL),
+          dptol=MORPHO_FLOAT(MESHGEN_DPTOL), xtol=MORPHO_FLOAT(MESHGEN_XTOL),
+          maxiterations=MORPHO_INTEGER(MESHGEN_MAXITERATIONS);
+    value out=MORPHO_NIL;
+    int nfixed=nargs;
+
+    if (!builtin_options(v, nargs, args, &nfixed, 6, meshgen_weightoption, &weight,
+                         meshgen_fscaleoption, &fscale, meshgen_ttoloption, &ttol,
+                         meshgen_dptoloption, &dptol, meshgen_xtoloption, &xtol,
+                         meshgen_maxiterationsoption, &maxiterations)) return MORPHO_NIL;
+
+    meshgenerator g = { .v=v, .fn=MORPHO_NIL, .weight=weight };
+    varray_elementidinit(&g.simplices);
+    varray_elementidinit(&g.bars);
+
+    double lower[3], upper[3], fs, tt, dp, xt;
+    int npts=0;
+    value pts=MORPHO_NIL;
+    if (nfixed!=5 || !MORPHO_ISCALLABLE(MORPHO_GETARG(args, 0)) ||
+        !(MORPHO_ISNIL(weight) || MORPHO_ISCALLABLE(weight)) ||
+        !meshgen_countpoints((pts=MORPHO_GETARG(args, 1)), &g.dim, &npts) ||
+        !meshgen_corner(MORPHO_GETARG(args, 2), g.dim, lower) ||
+        !meshgen_corner(MORPHO_GETARG(args, 3), g.dim, upper) ||
+        !morpho_valuetofloat(MORPHO_GETARG(args, 4), &g.h0) || !(g.h0>0) ||
+        !morpho_valuetofloat(fscale, &fs) || !morpho_valuetofloat(ttol, &tt) ||
+        !morpho_valuetofloat(dptol, &dp) || !morpho_valuetofloat(xtol, &xt) ||
+        !MORPHO_ISINTEGER(maxiterations) || MORPHO_GETINTEGERVALUE(maxiterations)<0) {
+        morpho_runtimeerror(v, MESHGEN_ARGS);
+        return MORPHO_NIL;
+    }
+    g.fn=MORPHO_GETARG(args, 0);
+    int dim=g.dim;
+
+    g.x=MORPHO_MALLOC(sizeof(double)*dim*(npts>0 ? npts : 1));
+    g.x0=MORPHO_MALLOC(sizeof(double)*dim*(npts>0 ? npts : 1));
+    g.f=MORPHO_MALLOC(sizeof(double)*(npts>0 ? npts : 1));
+    g.fixed=MORPHO_MALLOC(sizeof(char)*(npts>0 ? npts : 1));
+    if (!g.x || !g.x0 || !g.f || !g.fixed) {
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        goto meshgen_distmesh_cleanup;
+    }
+
+    // Keep only the points inside the domain, and fix those on the bounding box
+    for (int i=0; i<npts; i++) meshgen_getpoint(pts, dim, i, g.x+i*dim);
+    if (!meshgen_evaluate(&g, g.fn, npts, g.x, g.f)) goto meshgen_distmesh_cleanup;
+
+    for (int i=0; i<npts; i++) {
+        if (!(g.f[i]>0)) continue;
+        double *x=g.x+g.n*dim;
+        memmove(x, g.x+i*dim, sizeof(double)*dim);
+        g.fixed[g.n]=false;
+        for (int k=0; k<dim; k++) {
+            if (fabs(x[k]-lower[k])<xt || fabs(x[k]-upper[k])<xt) g.fixed[g.n]=true;
+        }
+        g.n++;
+    }
+
+    if (!meshgen_triangulate(&g)) goto meshgen_distmesh_cleanup;
+
+    int niter=MORPHO_GETINTEGERVALUE(maxiterations);
+    for (int iter=0; iter<niter; iter++) {
+        bool converged=false;
+        for (int step=0; step<MESHGEN_MAXSTEPS; step++) {
+            double dpmax;
+            if (!meshgen_step(&g, fs, &dpmax)) goto meshgen_distmesh_cleanup;
+            if (dpmax<dp*g.h0) {
+                converged=true;
+                break;
+            }
+            if (meshgen_displacement(&g)>tt*g.h0) break;
+        }
+
+        if (!meshgen_triangulate(&g)) goto meshgen_distmesh_cleanup;
+        if (converged) break;
+    }
+
+    // Finish projecting points that lie outside onto the boundary
+    if (niter>0) {
+        if (!meshgen_evaluate(&g, g.fn, g.n, g.x, g.f)) goto meshgen_distmesh_cleanup;
+        for (int iter=0; iter<MESHGEN_MAXPROJECTIONS; iter++) {
+            double dxmax;
+            if (!meshgen_project(&g, true, &dxmax)) goto meshgen_distmesh_cleanup;
+            if (dxmax<MESHGEN_PROJECTIONTOL*g.h0) break;
+        }
+    }
+
+    objectmesh *new=meshgen_newmesh(&g);
+    if (new) {
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+meshgen_distmesh_cleanup:
+    meshgen_clear(&g);
+    return out;
+}
+
+/* **********************************************************************
+ * Initialization
+ * ********************************************************************** */
+
+void meshgen_initialize(void) {
+    builtin_addfunction(MESHGEN_FUNCTION, meshgen_distmesh, BUILTIN_FLAGSEMPTY);
+
+    meshgen_weightoption=builtin_internsymbolascstring(MESHGEN_WEIGHTOPTION);
+    meshgen_fscaleoption=builtin_internsymbolascstring(MESHGEN_FSCALEOPTION);
+    meshgen_ttoloption=builtin_internsymbolascstring(MESHGEN_TTOLOPTION);
+    meshgen_dptoloption=builtin_internsymbolascstring(MESHGEN_DPTOLOPTION);
+    meshgen_xtoloption=builtin_internsymbolascstring(MESHGEN_XTOLOPTION);
+    meshgen_maxiterationsoption=builtin_internsymbolascstring(MESHGEN_MAXITERATIONSOPTION);
+
+    morpho_defineerror(MESHGEN_ARGS, ERROR_HALT, MESHGEN_ARGS_MSG);
+    morpho_defineerror(MESHGEN_VALUE, ERROR_HALT, MESHGEN_VALUE_MSG);
+    morpho_defineerror(MESHGEN_DEGENERATE, ERROR_HALT, MESHGEN_DEGENERATE_MSG);
+}
@@ -0,0 +1,86 @@
+/** @file meshgen.h
+ *  @author T J Atherton
+ *
+ *  @brief Native core of the meshgen module's mesh generator
+ */
+
+#ifndef meshgen_h
+#define meshgen_h
+
+#include "mesh.h"
+
+/* -------------------------------------------------------
+ * Mesh generation
+ * ------------------------------------------------------- */
+
+/** Meshes the region where a domain function is positive, following the distmesh algorithm of Persson and Strang,
+    SIAM Rev. 46(2), 329-345 (2004). Points that lie outside the domain are discarded and the remainder are
+    Delaunay triangulated, keeping only those simplices whose centroids lie inside. Each edge then acts as a spring
+    that pushes its endpoints apart if it is shorter than a preferred length, proportional to the weight function
+    at its midpoint and scaled so that the springs are slightly compressed overall. Points are moved a fixed
+    fraction of the total force on them, except those that lie on the faces of the bounding box, and any that leave
+    the domain are projected back onto its boundary by a Newton step using a finite difference gradient. The
+    points are retriangulated whenever the norm of their displacement since the last triangulation exceeds a
+    tolerance, and the process stops once no interior point moves further than a small fraction of the element
+    size in a step, after which any points outside are projected onto the boundary. Each pass over the points
+    evaluates the domain and weight functions for every point in a single loop. */
+
+#define MESHGEN_FUNCTION                    "DistMesh"
+
+#define MESHGEN_WEIGHTOPTION                "weight"
+#define MESHGEN_FSCALEOPTION                "fscale"
+#define MESHGEN_TTOLOPTION                  "ttol"
+#define MESHGEN_DPTOLOPTION                 "dptol"
+#define MESHGEN_XTOLOPTION                  "xtol"
+#define MESHGEN_MAXITERATIONSOPTION         "maxiterations"
+
+/** Default ratio of the preferred edge length to the mean edge length */
+#define MESHGEN_FSCALE                      1.2
+
+/** Default norm of the displacement of the points, relative to the element size, before retriangulation */
+#define MESHGEN_TTOL                        0.5
+
+/** Default convergence tolerance on the largest step, relative to the element size */
+#define MESHGEN_DPTOL                       1e-3
+
+/** Default tolerance used to identify points on the bounding box */
+#define MESHGEN_XTOL                        1e-12
+
+/** Default maximum number of retriangulations */
+#define MESHGEN_MAXITERATIONS               100
+
+/** Maximum number of steps taken between retriangulations */
+#define MESHGEN_MAXSTEPS                    100
+
+/** Fraction of the force used to move each point per step */
+#define MESHGEN_DELTAT                      0.2
+
+/** Maximum number of Newton steps used to project points onto the boundary once the points have converged */
+#define MESHGEN_MAXPROJECTIONS              10
+
+/** Convergence tolerance for the final projection, relative to the element size */
+#define MESHGEN_PROJECTIONTOL               1e-12
+
+/** Step used for finite difference gradients, relative to the element size */
+#define MESHGEN_FDSTEP                      1e-8
+
+/* -------------------------------------------------------
+ * Errors
+ * ------------------------------------------------------- */
+
+#define MESHGEN_ARGS                        "DstMshArgs"
+#define MESHGEN_ARGS_MSG                    "DistMesh expects a domain function, a List of points or a Matrix whose columns are points, lower and upper corners of a bounding box in two or three dimensions and a positive element size."
+
+#define MESHGEN_VALUE                       "DstMshVal"
+#define MESHGEN_VALUE_MSG                   "DistMesh domain and weight functions must return a number for each point."
+
+#define MESHGEN_DEGENERATE                  "DstMshDgnrt"
+#define MESHGEN_DEGENERATE_MSG              "DistMesh requires at least %i points inside the domain that do not all lie on a %s."
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+void meshgen_initialize(void);
+
+#endif /* meshgen_h */
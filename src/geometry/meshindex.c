@@ -0,0 +1,693 @@
+/** @file meshindex.c
+ *  @author T J Atherton
+ *
+ *  @brief Spatial indices for fast geometric queries on meshes
+ */
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include "morpho.h"
+#include "classes.h"
+#include "meshindex.h"
+
+/* **********************************************************************
+ * Element geometry
+ * ********************************************************************** */
+
+static double meshindex_dot(int dim, double *a, double *b) {
+    double sum=0.0;
+    for (int k=0; k<dim; k++) sum+=a[k]*b[k];
+    return sum;
+}
+
+static double meshindex_pointdistsq(int dim, double *x, double *a) {
+    double sum=0.0;
+    for (int k=0; k<dim; k++) sum+=(x[k]-a[k])*(x[k]-a[k]);
+    return sum;
+}
+
+/** Squared distance from x to the segment ab */
+static double meshindex_segmentdistsq(int dim, double *x, double *a, double *b) {
+    double ab[dim], ax[dim];
+    for (int k=0; k<dim; k++) { ab[k]=b[k]-a[k]; ax[k]=x[k]-a[k]; }
+
+    double l=meshindex_dot(dim, ab, ab), t=0.0;
+    if (l>0.0) t=meshindex_dot(dim, ax, ab)/l;
+    if (t<0.0) t=0.0;
+    if (t>1.0) t=1.0;
+
+    double sum=0.0;
+    for (int k=0; k<dim; k++) sum+=(ax[k]-t*ab[k])*(ax[k]-t*ab[k]);
+    return sum;
+}
+
+/** Squared distance from x to the triangle abc. The closest point is found by classifying x against the
+ *  Voronoi regions of the vertices, edges and face using only dot products, so this works in any dimension. */
+static double meshindex_triangledistsq(int dim, double *x, double *a, double *b, double *c) {
+    double ab[dim], ac[dim], ax[dim], bx[dim], cx[dim], p[dim];
+    for (int k=0; k<dim; k++) {
+        ab[k]=b[k]-a[k]; ac[k]=c[k]-a[k];
+        ax[k]=x[k]-a[k]; bx[k]=x[k]-b[k]; cx[k]=x[k]-c[k];
+    }
+
+    double d1=meshindex_dot(dim, ab, ax), d2=meshindex_dot(dim, ac, ax);
+    if (d1<=0.0 && d2<=0.0) return meshindex_pointdistsq(dim, x, a);
+
+    double d3=meshindex_dot(dim, ab, bx), d4=meshindex_dot(dim, ac, bx);
+    if (d3>=0.0 && d4<=d3) return meshindex_pointdistsq(dim, x, b);
+
+    double vc=d1*d4-d3*d2;
+    if (vc<=0.0 && d1>=0.0 && d3<=0.0) return meshindex_segmentdistsq(dim, x, a, b);
+
+    double d5=meshindex_dot(dim, ab, cx), d6=meshindex_dot(dim, ac, cx);
+    if (d6>=0.0 && d5<=d6) return meshindex_pointdistsq(dim, x, c);
+
+    double vb=d5*d2-d1*d6;
+    if (vb<=0.0 && d2>=0.0 && d6<=0.0) return meshindex_segmentdistsq(dim, x, a, c);
+
+    double va=d3*d6-d5*d4;
+    if (va<=0.0 && (d4-d3)>=0.0 && (d5-d6)>=0.0) return meshindex_segmentdistsq(dim, x, b, c);
+
+    double denom=va+vb+vc;
+    if (denom<=0.0) { // Degenerate triangle
+        double d=meshindex_segmentdistsq(dim, x, a, b), e=meshindex_segmentdistsq(dim, x, b, c);
+        return (d<e ? d : e);
+    }
+
+    double v=vb/denom, w=vc/denom;
+    for (int k=0; k<dim; k++) p[k]=a[k]+v*ab[k]+w*ac[k];
+    return meshindex_pointdistsq(dim, x, p);
+}
+
+/** Squared distance from x to the tetrahedron abcd */
+static double meshindex_tetrahedrondistsq(int dim, double *x, double *a, double *b, double *c, double *d) {
+    if (dim==3) { // Check if the point lies inside by computing its barycentric coordinates
+        double e1[3], e2[3], e3[3], r[3];
+        for (int k=0; k<3; k++) { e1[k]=b[k]-a[k]; e2[k]=c[k]-a[k]; e3[k]=d[k]-a[k]; r[k]=x[k]-a[k]; }
+
+        double det = e1[0]*(e2[1]*e3[2]-e2[2]*e3[1]) - e2[0]*(e1[1]*e3[2]-e1[2]*e3[1]) + e3[0]*(e1[1]*e2[2]-e1[2]*e2[1]);
+        if (fabs(det)>0.0) {
+            double l1 = ( r[0]*(e2[1]*e3[2]-e2[2]*e3[1]) - e2[0]*(r[1]*e3[2]-r[2]*e3[1]) + e3[0]*(r[1]*e2[2]-r[2]*e2[1]))/det;
+            double l2 = (e1[0]*(r[1]*e3[2]-r[2]*e3[1]) - r[0]*(e1[1]*e3[2]-e1[2]*e3[1]) + e3[0]*(e1[1]*r[2]-e1[2]*r[1]))/det;
+            double l3 = (e1[0]*(e2[1]*r[2]-e2[2]*r[1]) - e2[0]*(e1[1]*r[2]-e1[2]*r[1]) + r[0]*(e1[1]*e2[2]-e1[2]*e2[1]))/det;
+            if (l1>=0.0 && l2>=0.0 && l3>=0.0 && l1+l2+l3<=1.0) return 0.0;
+        }
+    }
+
+    double dist[4] = { meshindex_triangledistsq(dim, x, a, b, c), meshindex_triangledistsq(dim, x, a, b, d),
+                       meshindex_triangledistsq(dim, x, a, c, d), meshindex_triangledistsq(dim, x, b, c, d) };
+    double best=dist[0];
+    for (int i=1; i<4; i++) if (dist[i]<best) best=dist[i];
+    return best;
+}
+
+/** Squared distance from a point to an element defined by a list of vertex ids */
+static double meshindex_elementdistsq(objectmesh *mesh, int nv, int *vids, double *x) {
+    int dim=mesh->dim;
+    double *v[4];
+    for (int i=0; i<nv && i<4; i++) v[i]=mesh->vert->elements+dim*vids[i];
+
+    switch (nv) {
+        case 1: return meshindex_pointdistsq(dim, x, v[0]);
+        case 2: return meshindex_segmentdistsq(dim, x, v[0], v[1]);
+        case 3: return meshindex_triangledistsq(dim, x, v[0], v[1], v[2]);
+        case 4: return meshindex_tetrahedrondistsq(dim, x, v[0], v[1], v[2], v[3]);
+        default: break;
+    }
+
+    double best=DBL_MAX; // Fall back on the nearest vertex
+    for (int i=0; i<nv; i++) {
+        double d=meshindex_pointdistsq(dim, x, mesh->vert->elements+dim*vids[i]);
+        if (d<best) best=d;
+    }
+    return best;
+}
+
+/* **********************************************************************
+ * Bounding volume hierarchies
+ * ********************************************************************** */
+
+/** Gets the vertex ids of an element indexed by a BVH for grade>0 */
+static void meshbvh_itemvertices(meshbvh *bvh, int item, int *nv, int **vids) {
+    sparseccs *ccs=&bvh->conn->ccs;
+    *nv=ccs->cptr[item+1]-ccs->cptr[item];
+    *vids=ccs->rix+ccs->cptr[item];
+}
+
+/** Squared distance from a point to an item */
+static double meshbvh_itemdistsq(meshbvh *bvh, objectmesh *mesh, int item, double *x) {
+    if (!bvh->conn) return meshindex_pointdistsq(bvh->dim, x, mesh->vert->elements+bvh->dim*item);
+
+    int nv, *vids;
+    meshbvh_itemvertices(bvh, item, &nv, &vids);
+    return meshindex_elementdistsq(mesh, nv, vids, x);
+}
+
+/** Computes the bounding box of an item, expanding lower and upper */
+static void meshbvh_itembounds(meshbvh *bvh, objectmesh *mesh, int item, double *lower, double *upper) {
+    int dim=bvh->dim, nv=1, *vids=&item;
+    if (bvh->conn) meshbvh_itemvertices(bvh, item, &nv, &vids);
+
+    for (int i=0; i<nv; i++) {
+        double *x=mesh->vert->elements+dim*vids[i];
+        for (int k=0; k<dim; k++) {
+            if (x[k]<lower[k]) lower[k]=x[k];
+            if (x[k]>upper[k]) upper[k]=x[k];
+        }
+    }
+}
+
+/** Squared distance from a point to a node's bounding box */
+static double meshbvh_boxdistsq(meshbvh *bvh, int node, double *x) {
+    double *lower=bvh->bounds+2*bvh->dim*node, *upper=lower+bvh->dim;
+    double sum=0.0;
+    for (int k=0; k<bvh->dim; k++) {
+        double d=0.0;
+        if (x[k]<lower[k]) d=lower[k]-x[k];
+        else if (x[k]>upper[k]) d=x[k]-upper[k];
+        sum+=d*d;
+    }
+    return sum;
+}
+
+/** Tests whether two boxes overlap */
+static bool meshbvh_overlap(int dim, double *alower, double *aupper, double *blower, double *bupper) {
+    for (int k=0; k<dim; k++) if (aupper[k]<blower[k] || alower[k]>bupper[k]) return false;
+    return true;
+}
+
+/** Recomputes bounding boxes from the current vertex positions. Children always follow their parent, so
+ *  working backwards through the nodes visits every child before its parent. */
+static void meshbvh_refit(meshbvh *bvh, objectmesh *mesh) {
+    int dim=bvh->dim;
+
+    for (int i=bvh->nnodes-1; i>=0; i--) {
+        meshbvhnode *node=bvh->nodes+i;
+        double *lower=bvh->bounds+2*dim*i, *upper=lower+dim;
+        for (int k=0; k<dim; k++) { lower[k]=DBL_MAX; upper[k]=-DBL_MAX; }
+
+        if (node->child<0) {
+            for (int j=node->start; j<node->start+node->count; j++) {
+                meshbvh_itembounds(bvh, mesh, bvh->items[j], lower, upper);
+            }
+        } else {
+            for (int c=node->child; c<node->child+2; c++) {
+                double *clower=bvh->bounds+2*dim*c, *cupper=clower+dim;
+                for (int k=0; k<dim; k++) {
+                    if (clower[k]<lower[k]) lower[k]=clower[k];
+                    if (cupper[k]>upper[k]) upper[k]=cupper[k];
+                }
+            }
+        }
+    }
+}
+
+/** Partially sorts items so that the item at position n has the value it would have if the list were sorted
+ *  by the centroid coordinate on a given axis, with smaller values before it and larger values after */
+static void meshbvh_select(int *items, int lo, int hi, int n, double *centroid, int dim, int axis) {
+    while (hi>lo) {
+        double pivot=centroid[dim*items[(lo+hi)/2]+axis];
+        int i=lo, j=hi;
+        while (i<=j) {
+            while (centroid[dim*items[i]+axis]<pivot) i++;
+            while (centroid[dim*items[j]+axis]>pivot) j--;
+            if (i<=j) { int t=items[i]; items[i]=items[j]; items[j]=t; i++; j--; }
+        }
+        if (n<=j) hi=j;
+        else if (n>=i) lo=i;
+        else break;
+    }
+}
+
+static void meshbvh_free(meshbvh *bvh) {
+    if (!bvh) return;
+    if (bvh->items) MORPHO_FREE(bvh->items);
+    if (bvh->nodes) MORPHO_FREE(bvh->nodes);
+    if (bvh->bounds) MORPHO_FREE(bvh->bounds);
+    MORPHO_FREE(bvh);
+}
+
+/** Builds a BVH for elements of a given grade
+ * @param[in] mesh - the mesh
+ * @param[in] g - grade
+ * @param[in] conn - connectivity matrix for the grade, or NULL for vertices
+ * @returns the new BVH, or NULL on failure */
+static meshbvh *meshbvh_new(objectmesh *mesh, grade g, objectsparse *conn) {
+    meshbvh *bvh=MORPHO_MALLOC(sizeof(meshbvh));
+    if (!bvh) return NULL;
+
+    int dim=mesh->dim;
+    bvh->g=g;
+    bvh->dim=dim;
+    bvh->conn=conn;
+    bvh->nitems=(conn ? conn->ccs.ncols : mesh_nvertices(mesh));
+    bvh->nentries=(conn ? conn->ccs.nentries : bvh->nitems);
+    bvh->nnodes=0;
+
+    int maxnodes=(bvh->nitems>0 ? 2*bvh->nitems : 1);
+    bvh->items=MORPHO_MALLOC(sizeof(int)*(bvh->nitems>0 ? bvh->nitems : 1));
+    bvh->nodes=MORPHO_MALLOC(sizeof(meshbvhnode)*maxnodes);
+    bvh->bounds=MORPHO_MALLOC(sizeof(double)*2*(dim>0 ? dim : 1)*maxnodes);
+    double *centroid=MORPHO_MALLOC(sizeof(double)*(dim>0 ? dim : 1)*(bvh->nitems>0 ? bvh->nitems : 1));
+
+    if (!(bvh->items && bvh->nodes && bvh->bounds && centroid)) {
+        if (centroid) MORPHO_FREE(centroid);
+        meshbvh_free(bvh);
+        return NULL;
+    }
+
+    /* Compute centroids of each item */
+    for (int i=0; i<bvh->nitems; i++) {
+        int nv=1, *vids=&i;
+        if (conn) meshbvh_itemvertices(bvh, i, &nv, &vids);
+
+        double *c=centroid+dim*i;
+        for (int k=0; k<dim; k++) c[k]=0.0;
+        for (int j=0; j<nv; j++) {
+            double *x=mesh->vert->elements+dim*vids[j];
+            for (int k=0; k<dim; k++) c[k]+=x[k];
+        }
+        for (int k=0; k<dim && nv>0; k++) c[k]/=nv;
+        bvh->items[i]=i;
+    }
+
+    /* Split nodes in the order they are created */
+    bvh->nodes[0]=(meshbvhnode) { .child=-1, .start=0, .count=bvh->nitems };
+    bvh->nnodes=1;
+
+    for (int i=0; i<bvh->nnodes; i++) {
+        meshbvhnode *node=bvh->nodes+i;
+        if (node->count<=MESHINDEX_LEAFSIZE) continue;
+
+        /* Find the widest extent of the centroids */
+        int axis=0;
+        double width=0.0;
+        for (int k=0; k<dim; k++) {
+            double lo=DBL_MAX, hi=-DBL_MAX;
+            for (int j=node->start; j<node->start+node->count; j++) {
+                double c=centroid[dim*bvh->items[j]+k];
+                if (c<lo) lo=c;
+                if (c>hi) hi=c;
+            }
+            if (hi-lo>width) { width=hi-lo; axis=k; }
+        }
+        if (width<=0.0) continue; // All centroids coincide
+
+        int mid=node->start+node->count/2;
+        meshbvh_select(bvh->items, node->start, node->start+node->count-1, mid, centroid, dim, axis);
+
+        int start=node->start, count=node->count;
+        node->child=bvh->nnodes;
+        bvh->nodes[bvh->nnodes++]=(meshbvhnode) { .child=-1, .start=start, .count=mid-start };
+        bvh->nodes[bvh->nnodes++]=(meshbvhnode) { .child=-1, .start=mid, .count=start+count-mid };
+    }
+
+    MORPHO_FREE(centroid);
+    meshbvh_refit(bvh, mesh);
+
+    return bvh;
+}
+
+/* **********************************************************************
+ * Mesh indices
+ * ********************************************************************** */
+
+/** Frees a mesh index */
+void meshindex_free(meshindex *index) {
+    if (!index) return;
+    for (grade g=0; g<=MESH_GRADE_VOLUME; g++) meshbvh_free(index->bvh[g]);
+    if (index->x) MORPHO_FREE(index->x);
+    MORPHO_FREE(index);
+}
+
+/** Discards the BVH for a given grade, e.g. because connectivity has changed */
+void meshindex_invalidate(objectmesh *mesh, grade g) {
+    if (!mesh->index || g<0 || g>MESH_GRADE_VOLUME) return;
+    meshbvh_free(mesh->index->bvh[g]);
+    mesh->index->bvh[g]=NULL;
+}
+
+/** Records that vertices have moved; the index is refit before it is next used */
+void meshindex_moved(objectmesh *mesh) {
+    if (mesh->index) mesh->index->stale=true;
+}
+
+/** Records the vertex positions the index is fit to. If the copy can't be made, every query refits. */
+static void meshindex_snapshot(objectmesh *mesh) {
+    meshindex *index=mesh->index;
+    size_t n=(mesh->vert ? mesh->vert->nrows*mesh->vert->ncols : 0);
+    if (index->x) MORPHO_FREE(index->x);
+    index->x=(n>0 ? MORPHO_MALLOC(sizeof(double)*n) : NULL);
+    if (index->x) memcpy(index->x, mesh->vert->elements, sizeof(double)*n);
+}
+
+/** Tests whether the vertices differ from those the index was last fit to. The vertex matrix is
+    shared with morpho code and may be modified in place, so this compares positions rather than
+    relying on callers to report moves. */
+static bool meshindex_hasmoved(objectmesh *mesh) {
+    meshindex *index=mesh->index;
+    size_t n=(mesh->vert ? mesh->vert->nrows*mesh->vert->ncols : 0);
+    if (n==0) return false;
+    return (!index->x || memcmp(index->x, mesh->vert->elements, sizeof(double)*n)!=0);
+}
+
+/** Refits the index to the current vertex positions */
+void meshindex_refit(objectmesh *mesh) {
+    meshindex *index=mesh->index;
+    if (!index) return;
+    if (index->vert==mesh->vert && index->nvertices==mesh_nvertices(mesh)) {
+        for (grade g=0; g<=MESH_GRADE_VOLUME; g++) if (index->bvh[g]) meshbvh_refit(index->bvh[g], mesh);
+    } else {
+        for (grade g=0; g<=MESH_GRADE_VOLUME; g++) meshindex_invalidate(mesh, g);
+        index->vert=mesh->vert;
+        index->nvertices=mesh_nvertices(mesh);
+    }
+    meshindex_snapshot(mesh);
+    index->stale=false;
+}
+
+/** Gets a BVH for a given grade, building or refitting it if necessary
+ * @returns the BVH or NULL if the grade is absent or the BVH couldn't be built */
+static meshbvh *meshindex_getbvh(objectmesh *mesh, grade g) {
+    if (g<0 || g>mesh->dim || g>MESH_GRADE_VOLUME) return NULL;
+
+    objectsparse *conn=NULL;
+    if (g>0) {
+        conn=mesh_getconnectivityelement(mesh, 0, g);
+        if (!conn || !sparse_checkformat(conn, SPARSE_CCS, true, false)) return NULL;
+    }
+
+    if (!mesh->index) {
+        mesh->index=MORPHO_MALLOC(sizeof(meshindex));
+        if (!mesh->index) return NULL;
+        memset(mesh->index, 0, sizeof(meshindex));
+        mesh->index->vert=mesh->vert;
+        mesh->index->nvertices=mesh_nvertices(mesh);
+        meshindex_snapshot(mesh);
+    }
+
+    meshindex *index=mesh->index;
+    if (index->vert!=mesh->vert || index->nvertices!=mesh_nvertices(mesh)) { // The vertex matrix was replaced
+        for (grade i=0; i<=MESH_GRADE_VOLUME; i++) meshindex_invalidate(mesh, i);
+        index->vert=mesh->vert;
+        index->nvertices=mesh_nvertices(mesh);
+        meshindex_snapshot(mesh);
+        index->stale=false;
+    }
+
+    meshbvh *bvh=index->bvh[g];
+    if (bvh && conn && (bvh->conn!=conn || bvh->nitems!=conn->ccs.ncols || bvh->nentries!=conn->ccs.nentries)) {
+        meshindex_invalidate(mesh, g);
+        bvh=NULL;
+    }
+
+    if (index->stale || meshindex_hasmoved(mesh)) meshindex_refit(mesh);
+
+    if (!bvh) bvh=index->bvh[g]=meshbvh_new(mesh, g, conn);
+
+    return bvh;
+}
+
+/* **********************************************************************
+ * Queries
+ * ********************************************************************** */
+
+static int meshindex_compareid(const void *a, const void *b) {
+    int x=*(int *) a, y=*(int *) b;
+    return (x>y)-(x<y);
+}
+
+/** Finds the element of a given grade nearest to a point
+ * @param[in] mesh - the mesh
+ * @param[in] g - grade of element to find
+ * @param[in] x - the point
+ * @param[out] id - the nearest element; ties are resolved in favor of the lowest id
+ * @param[out] dist - distance to the element (optional)
+ * @returns true on success, false if there are no elements or the index couldn't be built */
+bool meshindex_nearest(objectmesh *mesh, grade g, double *x, elementid *id, double *dist) {
+    meshbvh *bvh=meshindex_getbvh(mesh, g);
+    if (!bvh || bvh->nitems==0) return false;
+
+    double best=DBL_MAX;
+    int bestid=-1;
+
+    varray_int stack;
+    varray_intinit(&stack);
+    varray_intwrite(&stack, 0);
+
+    while (stack.count>0) {
+        int n=stack.data[--stack.count];
+        if (meshbvh_boxdistsq(bvh, n, x)>best) continue;
+
+        meshbvhnode *node=bvh->nodes+n;
+        if (node->child<0) {
+            for (int j=node->start; j<node->start+node->count; j++) {
+                int item=bvh->items[j];
+                double d=meshbvh_itemdistsq(bvh, mesh, item, x);
+                if (d<best || (d==best && item<bestid)) { best=d; bestid=item; }
+            }
+        } else { // Visit the nearer child first
+            int a=node->child, b=node->child+1;
+            if (meshbvh_boxdistsq(bvh, a, x)>meshbvh_boxdistsq(bvh, b, x)) { int t=a; a=b; b=t; }
+            varray_intwrite(&stack, b);
+            varray_intwrite(&stack, a);
+        }
+    }
+    varray_intclear(&stack);
+
+    *id=bestid;
+    if (dist) *dist=sqrt(best);
+    return true;
+}
+
+/** Restores the max-heap property after the root of a heap is replaced */
+static void meshindex_siftdown(int n, double *d, int *id) {
+    int i=0;
+    for (;;) {
+        int l=2*i+1, r=l+1, m=i;
+        if (l<n && (d[l]>d[m] || (d[l]==d[m] && id[l]>id[m]))) m=l;
+        if (r<n && (d[r]>d[m] || (d[r]==d[m] && id[r]>id[m]))) m=r;
+        if (m==i) return;
+        double td=d[i]; d[i]=d[m]; d[m]=td;
+        int ti=id[i]; id[i]=id[m]; id[m]=ti;
+        i=m;
+    }
+}
+
+/** Restores the max-heap property after an element is added at position n-1 */
+static void meshindex_siftup(int n, double *d, int *id) {
+    int i=n-1;
+    while (i>0) {
+        int p=(i-1)/2;
+        if (d[p]>d[i] || (d[p]==d[i] && id[p]>id[i])) return;
+        double td=d[i]; d[i]=d[p]; d[p]=td;
+        int ti=id[i]; id[i]=id[p]; id[p]=ti;
+        i=p;
+    }
+}
+
+/** Finds the k elements of a given grade nearest to a point
+ * @param[in] mesh - the mesh
+ * @param[in] g - grade of element to find
+ * @param[in] x - the point
+ * @param[in] k - number of elements to find
+ * @param[out] out - element ids in order of increasing distance
+ * @returns true on success */
+bool meshindex_knearest(objectmesh *mesh, grade g, double *x, int k, varray_elementid *out) {
+    meshbvh *bvh=meshindex_getbvh(mesh, g);
+    if (!bvh) return false;
+    if (k>bvh->nitems) k=bvh->nitems;
+    if (k<=0) return true;
+
+    double *hd=MORPHO_MALLOC(sizeof(double)*k);
+    int *hid=MORPHO_MALLOC(sizeof(int)*k), n=0;
+    if (!(hd && hid)) {
+        if (hd) MORPHO_FREE(hd);
+        if (hid) MORPHO_FREE(hid);
+        return false;
+    }
+
+    varray_int stack;
+    varray_intinit(&stack);
+    varray_intwrite(&stack, 0);
+
+    while (stack.count>0) {
+        int nd=stack.data[--stack.count];
+        if (n==k && meshbvh_boxdistsq(bvh, nd, x)>hd[0]) continue;
+
+        meshbvhnode *node=bvh->nodes+nd;
+        if (node->child<0) {
+            for (int j=node->start; j<node->start+node->count; j++) {
+                int item=bvh->items[j];
+                double d=meshbvh_itemdistsq(bvh, mesh, item, x);
+                if (n<k) {
+                    hd[n]=d; hid[n]=item; n++;
+                    meshindex_siftup(n, hd, hid);
+                } else if (d<hd[0] || (d==hd[0] && item<hid[0])) {
+                    hd[0]=d; hid[0]=item;
+                    meshindex_siftdown(n, hd, hid);
+                }
+            }
+        } else {
+            int a=node->child, b=node->child+1;
+            if (meshbvh_boxdistsq(bvh, a, x)>meshbvh_boxdistsq(bvh, b, x)) { int t=a; a=b; b=t; }
+            varray_intwrite(&stack, b);
+            varray_intwrite(&stack, a);
+        }
+    }
+    varray_intclear(&stack);
+
+    /* Pop the heap to sort by increasing distance */
+    out->count=0;
+    if (varray_elementidresize(out, k)) {
+        out->count=k;
+        for (int i=k-1; i>=0; i--) {
+            out->data[i]=hid[0];
+            hd[0]=hd[n-1]; hid[0]=hid[n-1]; n--;
+            meshindex_siftdown(n, hd, hid);
+        }
+    }
+
+    MORPHO_FREE(hd);
+    MORPHO_FREE(hid);
+    return (out->count==k);
+}
+
+/** Finds all elements of a given grade within a distance r of a point
+ * @param[in] mesh - the mesh
+ * @param[in] g - grade of element to find
+ * @param[in] x - the point
+ * @param[in] r - the radius
+ * @param[out] out - element ids in increasing order
+ * @returns true on success */
+bool meshindex_inradius(objectmesh *mesh, grade g, double *x, double r, varray_elementid *out) {
+    meshbvh *bvh=meshindex_getbvh(mesh, g);
+    if (!bvh) return false;
+
+    double r2=r*r;
+    out->count=0;
+
+    varray_int stack;
+    varray_intinit(&stack);
+    if (bvh->nitems>0) varray_intwrite(&stack, 0);
+
+    while (stack.count>0) {
+        int n=stack.data[--stack.count];
+        if (meshbvh_boxdistsq(bvh, n, x)>r2) continue;
+
+        meshbvhnode *node=bvh->nodes+n;
+        if (node->child<0) {
+            for (int j=node->start; j<node->start+node->count; j++) {
+                int item=bvh->items[j];
+                if (meshbvh_itemdistsq(bvh, mesh, item, x)<=r2) varray_elementidwrite(out, item);
+            }
+        } else {
+            varray_intwrite(&stack, node->child);
+            varray_intwrite(&stack, node->child+1);
+        }
+    }
+    varray_intclear(&stack);
+
+    if (out->count>1) qsort(out->data, out->count, sizeof(elementid), meshindex_compareid);
+    return true;
+}
+
+/** Finds all elements of a given grade whose bounding boxes intersect a box
+ * @param[in] mesh - the mesh
+ * @param[in] g - grade of element to find
+ * @param[in] lower - lower corner of the box
+ * @param[in] upper - upper corner of the box
+ * @param[out] out - element ids in increasing order
+ * @returns true on success */
+bool meshindex_inbox(objectmesh *mesh, grade g, double *lower, double *upper, varray_elementid *out) {
+    meshbvh *bvh=meshindex_getbvh(mesh, g);
+    if (!bvh) return false;
+
+    int dim=bvh->dim;
+    double ilower[dim], iupper[dim];
+    out->count=0;
+
+    varray_int stack;
+    varray_intinit(&stack);
+    if (bvh->nitems>0) varray_intwrite(&stack, 0);
+
+    while (stack.count>0) {
+        int n=stack.data[--stack.count];
+        double *nlower=bvh->bounds+2*dim*n;
+        if (!meshbvh_overlap(dim, nlower, nlower+dim, lower, upper)) continue;
+
+        meshbvhnode *node=bvh->nodes+n;
+        if (node->child<0) {
+            for (int j=node->start; j<node->start+node->count; j++) {
+                int item=bvh->items[j];
+                for (int k=0; k<dim; k++) { ilower[k]=DBL_MAX; iupper[k]=-DBL_MAX; }
+                meshbvh_itembounds(bvh, mesh, item, ilower, iupper);
+                if (meshbvh_overlap(dim, ilower, iupper, lower, upper)) varray_elementidwrite(out, item);
+            }
+        } else {
+            varray_intwrite(&stack, node->child);
+            varray_intwrite(&stack, node->child+1);
+        }
+    }
+    varray_intclear(&stack);
+
+    if (out->count>1) qsort(out->data, out->count, sizeof(elementid), meshindex_compareid);
+    return true;
+}
+
+/** Signed distances of the lower and upper extremes of a box from a plane, scaled by the length of the normal */
+static void meshbvh_planerange(int dim, double *lower, double *upper, double *x0, double *n, double *min, double *max) {
+    *min=*max=0.0;
+    for (int k=0; k<dim; k++) {
+        double a=n[k]*(lower[k]-x0[k]), b=n[k]*(upper[k]-x0[k]);
+        *min+=(a<b ? a : b);
+        *max+=(a<b ? b : a);
+    }
+}
+
+/** Finds all elements of a given grade whose bounding boxes meet a plane
+ * @param[in] mesh - the mesh
+ * @param[in] g - grade of element to find
+ * @param[in] x0 - a point on the plane
+ * @param[in] n - normal to the plane
+ * @param[out] out - element ids in increasing order
+ * @returns true on success */
+bool meshindex_plane(objectmesh *mesh, grade g, double *x0, double *n, varray_elementid *out) {
+    meshbvh *bvh=meshindex_getbvh(mesh, g);
+    if (!bvh) return false;
+
+    int dim=bvh->dim;
+    double ilower[dim], iupper[dim], min, max;
+    out->count=0;
+
+    varray_int stack;
+    varray_intinit(&stack);
+    if (bvh->nitems>0) varray_intwrite(&stack, 0);
+
+    while (stack.count>0) {
+        int i=stack.data[--stack.count];
+        double *nlower=bvh->bounds+2*dim*i;
+        meshbvh_planerange(dim, nlower, nlower+dim, x0, n, &min, &max);
+        if (min>0.0 || max<0.0) continue;
+
+        meshbvhnode *node=bvh->nodes+i;
+        if (node->child<0) {
+            for (int j=node->start; j<node->start+node->count; j++) {
+                int item=bvh->items[j];
+                for (int k=0; k<dim; k++) { ilower[k]=DBL_MAX; iupper[k]=-DBL_MAX; }
+                meshbvh_itembounds(bvh, mesh, item, ilower, iupper);
+                meshbvh_planerange(dim, ilower, iupper, x0, n, &min, &max);
+                if (min<=0.0 && max>=0.0) varray_elementidwrite(out, item);
+            }
+        } else {
+            varray_intwrite(&stack, node->child);
+            varray_intwrite(&stack, node->child+1);
+        }
+    }
+    varray_intclear(&stack);
+
+    if (out->count>1) qsort(out->data, out->count, sizeof(elementid), meshindex_compareid);
+    return true;
+}
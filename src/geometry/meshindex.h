@@ -0,0 +1,69 @@
+/** @file meshindex.h
+ *  @author T J Atherton
+ *
+ *  @brief Spatial indices for fast geometric queries on meshes
+ */
+
+#ifndef meshindex_h
+#define meshindex_h
+
+#include "mesh.h"
+
+/* -------------------------------------------------------
+ * Bounding volume hierarchies
+ * ------------------------------------------------------- */
+
+/** A mesh index holds a bounding volume hierarchy (BVH) for each grade that has been queried.
+    Each BVH is a binary tree of axis aligned bounding boxes, built by splitting the items at the median
+    of their centroids along the widest axis; for vertices this is a k-d tree. Before each query the
+    vertex positions are checked against those the tree was fit to; if any have moved, the tree is
+    refit by recomputing the boxes from the leaves up, which keeps queries correct without rebuilding
+    the tree. */
+
+/** Maximum number of items in a leaf */
+#define MESHINDEX_LEAFSIZE 8
+
+/** A node of a BVH. Interior nodes have two children stored consecutively from child;
+    leaves refer to a contiguous range of the item list. */
+typedef struct {
+    int child; // Index of the first child, or -1 for a leaf
+    int start; // First item
+    int count; // Number of items
+} meshbvhnode;
+
+typedef struct {
+    grade g; // Grade of the elements indexed
+    int dim; // Dimension of the space
+    objectsparse *conn; // Connectivity the tree was built from (NULL for vertices)
+    int nitems; // Number of elements
+    int nentries; // Number of entries in the connectivity matrix when built
+    int *items; // Element ids ordered so that each leaf covers a contiguous range
+    int nnodes; // Number of nodes
+    meshbvhnode *nodes;
+    double *bounds; // Lower and upper corners of each node's box, 2*dim per node
+} meshbvh;
+
+struct smeshindex {
+    objectmatrix *vert; // Vertex matrix the index was built for
+    int nvertices;
+    bool stale; // Set if vertices have moved since the last refit
+    double *x; // Vertex positions at the last refit, used to detect moves made in place
+    meshbvh *bvh[MESH_GRADE_VOLUME+1];
+};
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+void meshindex_free(meshindex *index);
+void meshindex_invalidate(objectmesh *mesh, grade g);
+void meshindex_moved(objectmesh *mesh);
+void meshindex_refit(objectmesh *mesh);
+
+bool meshindex_nearest(objectmesh *mesh, grade g, double *x, elementid *id, double *dist);
+bool meshindex_knearest(objectmesh *mesh, grade g, double *x, int k, varray_elementid *out);
+bool meshindex_inradius(objectmesh *mesh, grade g, double *x, double r, varray_elementid *out);
+bool meshindex_inbox(objectmesh *mesh, grade g, double *lower, double *upper, varray_elementid *out);
+bool meshindex_plane(objectmesh *mesh, grade g, double *x0, double *n, varray_elementid *out);
+
+#endif /* meshindex_h */
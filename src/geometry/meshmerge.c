@@ -0,0 +1,298 @@
+/** @file meshmerge.c
+ *  @author T J Atherton
+ *
+ *  @brief Merging of meshes with welding of coincident vertices
+ */
+
+#include <float.h>
+#include <string.h>
+
+#include "morpho.h"
+#include "classes.h"
+#include "meshmerge.h"
+
+/* **********************************************************************
+ * Vertex welding
+ * ********************************************************************** */
+
+/** A cell of the grid, with the welded vertices that lie in it. The cell is identified by the cell
+    coordinates of its vertices, so no key is stored and any dimension is supported. */
+typedef struct {
+    int head; // First vertex in the cell, or -1 if the entry is empty
+} meshmergecell;
+
+/** Uniform hash grid of welded vertices */
+typedef struct {
+    int dim;
+    double h; // Cell size
+    double tol;
+    double *x; // Positions of all vertices to be welded
+    int64_t *cells; // Cell of each vertex
+    meshmergecell *table;
+    size_t capacity; // Power of two
+    int *next; // Next welded vertex in the same cell
+    int *weld; // Welded vertex each vertex maps to
+    int nwelded;
+    int *welded; // Original vertex for each welded vertex
+} meshmergegrid;
+
+static uint64_t meshmerge_hashcell(int dim, int64_t *cell) {
+    uint64_t hash=14695981039346656037ULL;
+    for (int k=0; k<dim; k++) {
+        hash^=(uint64_t) cell[k];
+        hash*=1099511628211ULL;
+        hash^=hash>>29;
+    }
+    return hash;
+}
+
+/** Finds the table entry for a cell, which is empty if the cell holds no vertices */
+static meshmergecell *meshmerge_findcell(meshmergegrid *grid, int64_t *cell) {
+    size_t mask=grid->capacity-1;
+    for (size_t i=meshmerge_hashcell(grid->dim, cell) & mask; ; i=(i+1) & mask) {
+        meshmergecell *entry=grid->table+i;
+        if (entry->head<0) return entry;
+        int64_t *ecell=grid->cells+((size_t) grid->welded[entry->head])*grid->dim;
+        if (memcmp(ecell, cell, sizeof(int64_t)*grid->dim)==0) return entry;
+    }
+}
+
+typedef struct {
+    meshmergegrid *grid;
+    int start, end;
+} meshmergecelltask;
+
+/** Computes the cells of a range of vertices */
+static bool meshmerge_celltask(void *arg) {
+    meshmergecelltask *task=(meshmergecelltask *) arg;
+    meshmergegrid *grid=task->grid;
+    for (int i=task->start; i<task->end; i++) {
+        for (int k=0; k<grid->dim; k++) grid->cells[i*grid->dim+k]=(int64_t) floor(grid->x[i*grid->dim+k]/grid->h);
+    }
+    return true;
+}
+
+static double meshmerge_dist2(meshmergegrid *grid, int i, int j) {
+    double d=0.0;
+    for (int k=0; k<grid->dim; k++) {
+        double dx=grid->x[i*grid->dim+k]-grid->x[j*grid->dim+k];
+        d+=dx*dx;
+    }
+    return d;
+}
+
+/** Welds vertex i to the nearest earlier vertex within the tolerance, or creates a new welded vertex */
+static void meshmerge_weldvertex(meshmergegrid *grid, int i) {
+    int dim=grid->dim, best=-1, noffsets=1;
+    double bestd=grid->tol*grid->tol;
+    int64_t *c=grid->cells+i*dim;
+    for (int k=0; k<dim; k++) noffsets*=3;
+
+    for (int o=0; o<noffsets; o++) { // Search the 3^dim neighboring cells
+        int64_t cell[dim];
+        for (int k=0, r=o; k<dim; k++, r/=3) cell[k]=c[k]+(r%3)-1;
+        meshmergecell *entry=meshmerge_findcell(grid, cell);
+        for (int w=entry->head; w>=0; w=grid->next[w]) {
+            double d=meshmerge_dist2(grid, i, grid->welded[w]);
+            if (d<bestd || (d==bestd && (best<0 || w<best))) { bestd=d; best=w; }
+        }
+    }
+
+    if (best>=0) { grid->weld[i]=best; return; }
+
+    int w=grid->nwelded++;
+    grid->welded[w]=i;
+    grid->weld[i]=w;
+    meshmergecell *entry=meshmerge_findcell(grid, c);
+    grid->next[w]=entry->head;
+    entry->head=w;
+}
+
+static void meshmerge_cleargrid(meshmergegrid *grid) {
+    if (grid->x) MORPHO_FREE(grid->x);
+    if (grid->cells) MORPHO_FREE(grid->cells);
+    if (grid->table) MORPHO_FREE(grid->table);
+    if (grid->next) MORPHO_FREE(grid->next);
+    if (grid->weld) MORPHO_FREE(grid->weld);
+    if (grid->welded) MORPHO_FREE(grid->welded);
+}
+
+/** Collects the vertices of all meshes and welds them */
+static bool meshmerge_weld(int nmeshes, objectmesh **meshes, int dim, int nv, meshmergegrid *grid) {
+    grid->dim=dim;
+    grid->nwelded=0;
+    for (grid->capacity=16; grid->capacity<2*((size_t) nv); grid->capacity*=2);
+    grid->x=MORPHO_MALLOC(sizeof(double)*dim*(nv>0 ? nv : 1));
+    grid->cells=MORPHO_MALLOC(sizeof(int64_t)*dim*(nv>0 ? nv : 1));
+    grid->table=MORPHO_MALLOC(sizeof(meshmergecell)*grid->capacity);
+    grid->next=MORPHO_MALLOC(sizeof(int)*(nv>0 ? nv : 1));
+    grid->weld=MORPHO_MALLOC(sizeof(int)*(nv>0 ? nv : 1));
+    grid->welded=MORPHO_MALLOC(sizeof(int)*(nv>0 ? nv : 1));
+    if (!grid->x || !grid->cells || !grid->table || !grid->next || !grid->weld || !grid->welded) return false;
+    for (size_t i=0; i<grid->capacity; i++) grid->table[i].head=-1;
+
+    /* Gather the vertices, padding those of lower dimensional meshes with zeros */
+    double maxabs=0.0;
+    for (int m=0, i=0; m<nmeshes; m++) {
+        int mdim=meshes[m]->dim, mnv=mesh_nvertices(meshes[m]);
+        double *mx=(mnv>0 ? meshes[m]->vert->elements : NULL);
+        for (int j=0; j<mnv; j++, i++) {
+            for (int k=0; k<dim; k++) {
+                double xk=(k<mdim ? mx[j*mdim+k] : 0.0);
+                grid->x[i*dim+k]=xk;
+                if (fabs(xk)>maxabs) maxabs=fabs(xk);
+            }
+        }
+    }
+
+    /* Cells must be no smaller than the tolerance, and large enough that cell indices don't overflow */
+    grid->h=grid->tol;
+    if (grid->h<maxabs*1e-15) grid->h=maxabs*1e-15;
+    if (grid->h<=0.0) grid->h=1.0;
+
+    int ntasks=mesh_ntasks(nv);
+    meshmergecelltask tasks[ntasks];
+    for (int i=0; i<ntasks; i++) {
+        tasks[i] = (meshmergecelltask) { .grid=grid, .start=(int) (((long) nv*i)/ntasks), .end=(int) (((long) nv*(i+1))/ntasks) };
+    }
+    mesh_runtasks(ntasks, meshmerge_celltask, tasks, sizeof(meshmergecelltask));
+
+    /* Welding depends on the order of insertion, so is performed sequentially */
+    for (int i=0; i<nv; i++) meshmerge_weldvertex(grid, i);
+    return true;
+}
+
+/* **********************************************************************
+ * Element deduplication
+ * ********************************************************************** */
+
+typedef struct {
+    sparseccs *ccs;
+    int *weld; // Welded vertex for each vertex of the mesh
+    int n;
+    elementid start, end;
+    elementid *tuples; // Output for the first element in the range
+    char *valid;
+} meshmergeelementtask;
+
+/** Maps a range of elements onto welded vertices, marking those that are malformed or have collapsed */
+static bool meshmerge_elementtask(void *arg) {
+    meshmergeelementtask *task=(meshmergeelementtask *) arg;
+    int n=task->n;
+    for (elementid id=task->start; id<task->end; id++) {
+        elementid *t=task->tuples+((size_t) (id-task->start))*n;
+        char *valid=task->valid+(id-task->start);
+        int nel=task->ccs->cptr[id+1]-task->ccs->cptr[id];
+
+        *valid=(nel==n);
+        for (int k=0; k<n; k++) t[k]=(*valid ? task->weld[task->ccs->rix[task->ccs->cptr[id]+k]] : 0);
+        mesh_sorttuple(n, t);
+        for (int k=1; k<n && *valid; k++) if (t[k]==t[k-1]) *valid=false;
+    }
+    return true;
+}
+
+/** Merges the elements of grade g from all meshes into the new mesh */
+static bool meshmerge_grade(int nmeshes, objectmesh **meshes, int *vertexoffset, meshmergegrid *grid, grade g, objectmesh *out) {
+    int n=g+1, ntuples=0;
+    objectsparse *conn[nmeshes];
+    for (int m=0; m<nmeshes; m++) {
+        conn[m]=(g<=mesh_maxgrade(meshes[m]) ? mesh_getconnectivityelement(meshes[m], 0, g) : NULL);
+        if (conn[m] && !sparse_checkformat(conn[m], SPARSE_CCS, true, false)) return false;
+        if (conn[m]) ntuples+=conn[m]->ccs.ncols;
+    }
+
+    bool success=false;
+    elementid *tuples=MORPHO_MALLOC(sizeof(elementid)*n*(ntuples>0 ? ntuples : 1));
+    char *valid=MORPHO_MALLOC(sizeof(char)*(ntuples>0 ? ntuples : 1));
+    char *isnew=MORPHO_MALLOC(sizeof(char)*(ntuples>0 ? ntuples : 1));
+    objectsparse *new=object_newsparse(NULL, NULL);
+    if (!tuples || !valid || !isnew || !new) goto meshmerge_grade_cleanup;
+
+    /* Map the elements of each mesh onto welded vertices, dividing the work among tasks */
+    for (int m=0, offset=0; m<nmeshes; m++) {
+        if (!conn[m]) continue;
+        int nel=conn[m]->ccs.ncols, ntasks=mesh_ntasks(((size_t) nel)*n);
+        meshmergeelementtask tasks[ntasks];
+        for (int i=0; i<ntasks; i++) {
+            elementid start=(elementid) (((long) nel*i)/ntasks);
+            tasks[i] = (meshmergeelementtask) { .ccs=&conn[m]->ccs, .weld=grid->weld+vertexoffset[m], .n=n,
+                                                .start=start, .end=(elementid) (((long) nel*(i+1))/ntasks),
+                                                .tuples=tuples+((size_t) offset+start)*n, .valid=valid+offset+start };
+        }
+        mesh_runtasks(ntasks, meshmerge_elementtask, tasks, sizeof(meshmergeelementtask));
+        offset+=nel;
+    }
+
+    if (ntuples>0 && !mesh_uniquetuples(n, ntuples, tuples, isnew)) goto meshmerge_grade_cleanup;
+
+    int nnew=0;
+    for (int k=0; k<ntuples; k++) if (isnew[k] && valid[k]) nnew++;
+    if (nnew==0) { success=true; goto meshmerge_grade_cleanup; }
+
+    if (!sparseccs_resize(&new->ccs, grid->nwelded, nnew, nnew*n, false)) goto meshmerge_grade_cleanup;
+    for (int k=0, j=0; k<ntuples; k++) {
+        if (!isnew[k] || !valid[k]) continue;
+        memcpy(new->ccs.rix+((size_t) j)*n, tuples+((size_t) k)*n, sizeof(elementid)*n);
+        j++;
+    }
+    for (int i=0; i<=nnew; i++) new->ccs.cptr[i]=i*n;
+
+    mesh_setconnectivityelement(out, 0, g, new);
+    new=NULL;
+    success=true;
+
+meshmerge_grade_cleanup:
+    if (new) object_free((object *) new);
+    if (tuples) MORPHO_FREE(tuples);
+    if (valid) MORPHO_FREE(valid);
+    if (isnew) MORPHO_FREE(isnew);
+    return success;
+}
+
+/* **********************************************************************
+ * Merging
+ * ********************************************************************** */
+
+/** Merges meshes into a new mesh
+ * @param[in] nmeshes - number of meshes
+ * @param[in] meshes - the meshes to merge
+ * @param[in] tol - vertices closer than this to an earlier vertex are welded to it
+ * @returns the merged mesh, or NULL if allocation failed */
+objectmesh *meshmerge_merge(int nmeshes, objectmesh **meshes, double tol) {
+    meshmergegrid grid = { .tol=(tol>0.0 ? tol : 0.0) };
+    int dim=0, nv=0, maxg=0, vertexoffset[nmeshes>0 ? nmeshes : 1];
+    objectmesh *out=NULL;
+    double *x=NULL;
+
+    for (int m=0; m<nmeshes; m++) {
+        vertexoffset[m]=nv;
+        if (meshes[m]->dim>dim) dim=meshes[m]->dim;
+        nv+=mesh_nvertices(meshes[m]);
+        grade g=mesh_maxgrade(meshes[m]);
+        if (g>maxg) maxg=g;
+    }
+
+    if (!meshmerge_weld(nmeshes, meshes, dim, nv, &grid)) goto meshmerge_merge_cleanup;
+
+    x=MORPHO_MALLOC(sizeof(double)*dim*(grid.nwelded>0 ? grid.nwelded : 1));
+    if (!x) goto meshmerge_merge_cleanup;
+    for (int w=0; w<grid.nwelded; w++) memcpy(x+w*dim, grid.x+grid.welded[w]*dim, sizeof(double)*dim);
+
+    out=object_newmesh(dim, grid.nwelded, x);
+    if (!out || (grid.nwelded>0 && !out->vert)) goto meshmerge_merge_cleanup;
+
+    for (grade g=1; g<=maxg; g++) {
+        if (!meshmerge_grade(nmeshes, meshes, vertexoffset, &grid, g, out)) {
+            object_free((object *) out);
+            out=NULL;
+            goto meshmerge_merge_cleanup;
+        }
+    }
+    mesh_freezeconnectivity(out);
+
+meshmerge_merge_cleanup:
+    if (x) MORPHO_FREE(x);
+    meshmerge_cleargrid(&grid);
+    return out;
+}
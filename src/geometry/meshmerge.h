@@ -0,0 +1,28 @@
+/** @file meshmerge.h
+ *  @author T J Atherton
+ *
+ *  @brief Merging of meshes with welding of coincident vertices
+ */
+
+#ifndef meshmerge_h
+#define meshmerge_h
+
+#include "mesh.h"
+
+/* -------------------------------------------------------
+ * Merging
+ * ------------------------------------------------------- */
+
+/** Meshes are merged by welding each vertex to an earlier vertex that lies within a tolerance of it, and then
+    removing duplicate elements. Vertices are binned into a uniform grid of cells at least as large as the
+    tolerance, so that candidates for welding are found by searching the neighboring cells. Elements of each grade
+    are renumbered onto the welded vertices and deduplicated by hashing their sorted vertex tuples; elements that
+    collapse onto a repeated vertex are dropped. Vertices and elements keep the order of their first occurrence. */
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+objectmesh *meshmerge_merge(int nmeshes, objectmesh **meshes, double tol);
+
+#endif /* meshmerge_h */
@@ -0,0 +1,642 @@
+/** @file meshprune.c
+ *  @author T J Atherton
+ *
+ *  @brief Coarsening of meshes by collapsing edges
+ */
+
+#include <string.h>
+
+#include "morpho.h"
+#include "classes.h"
+#include "meshprune.h"
+#include "field.h"
+#include "selection.h"
+
+/* **********************************************************************
+ * Pruner data structure
+ * ********************************************************************** */
+
+typedef struct {
+    double length; // Length of the edge when it was queued
+    int edge;
+} meshprunequeueentry;
+
+typedef struct {
+    objectmesh *mesh;
+    int nv, dim, maxg;
+    double *x;
+    objectsparse *conn[MESH_GRADE_VOLUME+1];
+
+    int nedges;
+    elementid *edges; // Candidate edges, in ascending vertex order
+
+    int nqueue;
+    meshprunequeueentry *queue; // Binary min-heap of edges ordered by length
+
+    int *root; // Union-find forest of clusters
+    int *size; // Number of vertices in each cluster
+    double *sum; // Sum of the positions of the vertices in each cluster
+    elementid *fixed; // Fixed vertex in each cluster, or -1
+    int *member; // Circular list of the vertices in each cluster
+
+    grade top; // Highest grade present, whose elements are checked before each collapse
+    int *vptr; // Elements of the highest grade containing vertex v are velement[vptr[v]] ... velement[vptr[v+1]-1]
+    elementid *velement;
+    int *mark; // Workspace to find the common neighbors of two clusters
+    int stamp;
+} meshpruner;
+
+static void meshprune_freepruner(meshpruner *p) {
+    if (p->edges) MORPHO_FREE(p->edges);
+    if (p->queue) MORPHO_FREE(p->queue);
+    if (p->root) MORPHO_FREE(p->root);
+    if (p->size) MORPHO_FREE(p->size);
+    if (p->sum) MORPHO_FREE(p->sum);
+    if (p->fixed) MORPHO_FREE(p->fixed);
+    if (p->member) MORPHO_FREE(p->member);
+    if (p->vptr) MORPHO_FREE(p->vptr);
+    if (p->velement) MORPHO_FREE(p->velement);
+    if (p->mark) MORPHO_FREE(p->mark);
+}
+
+/* **********************************************************************
+ * Priority queue
+ * ********************************************************************** */
+
+static bool meshprune_before(meshprunequeueentry *a, meshprunequeueentry *b) {
+    return (a->length<b->length || (a->length==b->length && a->edge<b->edge));
+}
+
+/** Restores the min-heap property after the root of the queue is replaced */
+static void meshprune_siftdown(meshpruner *p) {
+    meshprunequeueentry *q=p->queue;
+    int i=0, n=p->nqueue;
+    for (;;) {
+        int l=2*i+1, r=l+1, m=i;
+        if (l<n && meshprune_before(&q[l], &q[m])) m=l;
+        if (r<n && meshprune_before(&q[r], &q[m])) m=r;
+        if (m==i) return;
+        meshprunequeueentry t=q[i]; q[i]=q[m]; q[m]=t;
+        i=m;
+    }
+}
+
+/** Restores the min-heap property after an entry is added at the end of the queue */
+static void meshprune_siftup(meshpruner *p) {
+    meshprunequeueentry *q=p->queue;
+    int i=p->nqueue-1;
+    while (i>0) {
+        int par=(i-1)/2;
+        if (!meshprune_before(&q[i], &q[par])) return;
+        meshprunequeueentry t=q[i]; q[i]=q[par]; q[par]=t;
+        i=par;
+    }
+}
+
+/** Adds an edge to the queue; there is always room since each edge is queued at most once at a time */
+static void meshprune_push(meshpruner *p, int edge, double length) {
+    p->queue[p->nqueue++] = (meshprunequeueentry) { .length=length, .edge=edge };
+    meshprune_siftup(p);
+}
+
+static meshprunequeueentry meshprune_pop(meshpruner *p) {
+    meshprunequeueentry top=p->queue[0];
+    p->queue[0]=p->queue[--p->nqueue];
+    meshprune_siftdown(p);
+    return top;
+}
+
+/* **********************************************************************
+ * Clusters
+ * ********************************************************************** */
+
+static int meshprune_find(meshpruner *p, int v) {
+    while (p->root[v]!=v) {
+        p->root[v]=p->root[p->root[v]];
+        v=p->root[v];
+    }
+    return v;
+}
+
+/** Position of the vertex that replaces a cluster */
+static void meshprune_center(meshpruner *p, int c, double *x) {
+    if (p->fixed[c]>=0) {
+        for (int k=0; k<p->dim; k++) x[k]=p->x[p->fixed[c]*p->dim+k];
+    } else {
+        for (int k=0; k<p->dim; k++) x[k]=p->sum[c*p->dim+k]/p->size[c];
+    }
+}
+
+/** Distance between the vertices that replace two clusters */
+static double meshprune_distance(meshpruner *p, int a, int b) {
+    double xa[p->dim], xb[p->dim], d=0.0;
+    meshprune_center(p, a, xa);
+    meshprune_center(p, b, xb);
+    for (int k=0; k<p->dim; k++) d+=(xa[k]-xb[k])*(xa[k]-xb[k]);
+    return sqrt(d);
+}
+
+/** Position of the vertex that would replace the union of two clusters */
+static void meshprune_joinedcenter(meshpruner *p, int a, int b, double *x) {
+    if (p->fixed[a]>=0) meshprune_center(p, a, x);
+    else if (p->fixed[b]>=0) meshprune_center(p, b, x);
+    else for (int k=0; k<p->dim; k++) x[k]=(p->sum[a*p->dim+k]+p->sum[b*p->dim+k])/(p->size[a]+p->size[b]);
+}
+
+static void meshprune_join(meshpruner *p, int a, int b) {
+    if (p->size[a]<p->size[b]) { int t=a; a=b; b=t; }
+    int t=p->member[a]; p->member[a]=p->member[b]; p->member[b]=t; // Splice the lists of members
+    p->root[b]=a;
+    p->size[a]+=p->size[b];
+    for (int k=0; k<p->dim; k++) p->sum[a*p->dim+k]+=p->sum[b*p->dim+k];
+    if (p->fixed[a]<0) p->fixed[a]=p->fixed[b];
+}
+
+/* **********************************************************************
+ * Validity of collapses
+ * ********************************************************************** */
+
+/** Indexes the elements of the highest grade by vertex */
+static bool meshprune_index(meshpruner *p) {
+    for (p->top=p->maxg; p->top>0 && !p->conn[p->top]; p->top--);
+    p->member=MORPHO_MALLOC(sizeof(int)*(p->nv>0 ? p->nv : 1));
+    p->mark=MORPHO_MALLOC(sizeof(int)*(p->nv>0 ? p->nv : 1));
+    p->vptr=MORPHO_MALLOC(sizeof(int)*(p->nv+1));
+    if (!p->member || !p->mark || !p->vptr) return false;
+    for (int i=0; i<p->nv; i++) { p->member[i]=i; p->mark[i]=0; }
+    for (int i=0; i<=p->nv; i++) p->vptr[i]=0;
+    p->stamp=0;
+    if (p->top<MESH_GRADE_AREA) return true;
+
+    sparseccs *ccs=&p->conn[p->top]->ccs;
+    for (int i=0; i<ccs->cptr[ccs->ncols]; i++) p->vptr[ccs->rix[i]+1]++;
+    for (int i=0; i<p->nv; i++) p->vptr[i+1]+=p->vptr[i];
+
+    p->velement=MORPHO_MALLOC(sizeof(elementid)*(p->vptr[p->nv]>0 ? p->vptr[p->nv] : 1));
+    int *fill=MORPHO_MALLOC(sizeof(int)*(p->nv>0 ? p->nv : 1));
+    if (!p->velement || !fill) { if (fill) MORPHO_FREE(fill); return false; }
+    memcpy(fill, p->vptr, sizeof(int)*p->nv);
+    for (elementid id=0; id<ccs->ncols; id++) {
+        for (int i=ccs->cptr[id]; i<ccs->cptr[id+1]; i++) p->velement[fill[ccs->rix[i]]++]=id;
+    }
+    MORPHO_FREE(fill);
+    return true;
+}
+
+/** Signed measure of an element of the highest grade whose vertices are at x: the signed area of a triangle in
+    two dimensions or the signed volume of a tetrahedron in three. Triangles in three dimensions return their
+    normal in n instead. */
+static double meshprune_measure(meshpruner *p, double **x, double *n) {
+    double s[3][3];
+    int dim=p->dim;
+    for (int i=0; i<p->top; i++) for (int k=0; k<3; k++) s[i][k]=(k<dim ? x[i+1][k]-x[0][k] : 0.0);
+
+    if (p->top==MESH_GRADE_AREA) {
+        n[0]=s[0][1]*s[1][2]-s[0][2]*s[1][1];
+        n[1]=s[0][2]*s[1][0]-s[0][0]*s[1][2];
+        n[2]=s[0][0]*s[1][1]-s[0][1]*s[1][0];
+        return n[2];
+    }
+    return s[0][0]*(s[1][1]*s[2][2]-s[1][2]*s[2][1])-s[0][1]*(s[1][0]*s[2][2]-s[1][2]*s[2][0])+s[0][2]*(s[1][0]*s[2][1]-s[1][1]*s[2][0]);
+}
+
+/** Checks that no element of the highest grade that contains cluster c, but not cluster o, is inverted or
+    degenerated when c is moved to x */
+static bool meshprune_checkorientation(meshpruner *p, int c, int o, double *x) {
+    sparseccs *ccs=&p->conn[p->top]->ccs;
+    int n=p->top+1;
+    int v=c;
+    do {
+        for (int j=p->vptr[v]; j<p->vptr[v+1]; j++) {
+            elementid *vids=ccs->rix+ccs->cptr[p->velement[j]];
+            int r[n];
+            bool skip=false;
+            for (int i=0; i<n; i++) {
+                r[i]=meshprune_find(p, vids[i]);
+                if (r[i]==o) skip=true;
+                for (int k=0; k<i; k++) if (r[k]==r[i]) skip=true;
+            }
+            if (skip) continue; // Removed by the collapse, or already degenerate
+
+            double pos[n][p->dim], *before[n], *after[n], nb[3], na[3];
+            for (int i=0; i<n; i++) {
+                meshprune_center(p, r[i], pos[i]);
+                before[i]=after[i]=pos[i];
+                if (r[i]==c) after[i]=x;
+            }
+            double mb=meshprune_measure(p, before, nb), ma=meshprune_measure(p, after, na);
+            if (p->top==MESH_GRADE_AREA && p->dim==3) {
+                if (nb[0]*na[0]+nb[1]*na[1]+nb[2]*na[2]<=0.0) return false;
+            } else if (mb*ma<=0.0) return false;
+        }
+        v=p->member[v];
+    } while (v!=c);
+    return true;
+}
+
+/** Marks the neighbors of cluster c through elements of the highest grade with the current stamp */
+static void meshprune_markneighbors(meshpruner *p, int c, int stamp) {
+    sparseccs *ccs=&p->conn[p->top]->ccs;
+    int v=c;
+    do {
+        for (int j=p->vptr[v]; j<p->vptr[v+1]; j++) {
+            elementid id=p->velement[j];
+            for (int i=ccs->cptr[id]; i<ccs->cptr[id+1]; i++) {
+                int r=meshprune_find(p, ccs->rix[i]);
+                if (r!=c) p->mark[r]=stamp;
+            }
+        }
+        v=p->member[v];
+    } while (v!=c);
+}
+
+/** Counts the neighbors of cluster c through elements of the highest grade that have been marked with stamp, and
+    remarks them with stamp+1 so each is counted once */
+static int meshprune_countcommon(meshpruner *p, int c, int stamp) {
+    sparseccs *ccs=&p->conn[p->top]->ccs;
+    int count=0, v=c;
+    do {
+        for (int j=p->vptr[v]; j<p->vptr[v+1]; j++) {
+            elementid id=p->velement[j];
+            for (int i=ccs->cptr[id]; i<ccs->cptr[id+1]; i++) {
+                int r=meshprune_find(p, ccs->rix[i]);
+                if (r!=c && p->mark[r]==stamp) { p->mark[r]=stamp+1; count++; }
+            }
+        }
+        v=p->member[v];
+    } while (v!=c);
+    return count;
+}
+
+/** Counts the distinct vertices opposite the edge ab in triangles that contain it */
+static int meshprune_countopposite(meshpruner *p, int a, int b, int stamp) {
+    sparseccs *ccs=&p->conn[p->top]->ccs;
+    int count=0, v=a;
+    do {
+        for (int j=p->vptr[v]; j<p->vptr[v+1]; j++) {
+            elementid id=p->velement[j];
+            int r[3], hasb=0;
+            for (int i=0; i<3; i++) { r[i]=meshprune_find(p, ccs->rix[ccs->cptr[id]+i]); if (r[i]==b) hasb=1; }
+            if (!hasb) continue;
+            for (int i=0; i<3; i++) if (r[i]!=a && r[i]!=b && p->mark[r[i]]!=stamp) { p->mark[r[i]]=stamp; count++; }
+        }
+        v=p->member[v];
+    } while (v!=a);
+    return count;
+}
+
+/** Checks whether collapsing the edge between two clusters leaves a valid mesh. In triangulated surfaces the two
+    clusters must share no neighbors other than the vertices opposite their common edge, which preserves the
+    topology, and no element may be inverted by moving its vertices to the new position. */
+static bool meshprune_cancollapse(meshpruner *p, int a, int b) {
+    if (p->top<MESH_GRADE_AREA || p->top>MESH_GRADE_VOLUME || p->top>p->dim) return true;
+
+    if (p->top==MESH_GRADE_AREA) {
+        int stamp=(p->stamp+=3);
+        meshprune_markneighbors(p, a, stamp);
+        int common=meshprune_countcommon(p, b, stamp);
+        if (common!=meshprune_countopposite(p, a, b, stamp+2)) return false;
+    }
+
+    double x[p->dim];
+    meshprune_joinedcenter(p, a, b, x);
+    return (meshprune_checkorientation(p, a, b, x) && meshprune_checkorientation(p, b, a, x));
+}
+
+/* **********************************************************************
+ * Collapsing edges
+ * ********************************************************************** */
+
+static bool meshprune_isselected(objectselection *sel, grade g, elementid id) {
+    if (!sel) return true;
+    if (sel->mode==SELECT_SOME && g>=sel->ngrades) return false;
+    return selection_isselected(sel, g, id);
+}
+
+/** Finds the edges of selected elements */
+static bool meshprune_edges(meshpruner *p, objectselection *sel) {
+    varray_elementid pairs;
+    varray_elementidinit(&pairs);
+    bool success=false;
+    char *isnew=NULL;
+
+    for (grade g=1; g<=p->maxg; g++) {
+        if (!p->conn[g]) continue;
+        sparseccs *ccs=&p->conn[g]->ccs;
+        for (elementid id=0; id<ccs->ncols; id++) {
+            if (!meshprune_isselected(sel, g, id)) continue;
+            int nel=ccs->cptr[id+1]-ccs->cptr[id];
+            elementid *vids=ccs->rix+ccs->cptr[id];
+            for (int i=0; i<nel; i++) for (int j=i+1; j<nel; j++) {
+                if (vids[i]==vids[j]) continue;
+                elementid e[2] = { vids[i], vids[j] };
+                mesh_sorttuple(2, e);
+                if (!varray_elementidadd(&pairs, e, 2)) goto meshprune_edges_cleanup;
+            }
+        }
+    }
+
+    int npairs=pairs.count/2;
+    isnew=MORPHO_MALLOC(sizeof(char)*(npairs>0 ? npairs : 1));
+    if (!isnew || (npairs>0 && !mesh_uniquetuples(2, npairs, pairs.data, isnew))) goto meshprune_edges_cleanup;
+
+    p->nedges=0;
+    for (int i=0; i<npairs; i++) if (isnew[i]) p->nedges++;
+    p->edges=MORPHO_MALLOC(sizeof(elementid)*2*(p->nedges>0 ? p->nedges : 1));
+    if (!p->edges) goto meshprune_edges_cleanup;
+    for (int i=0, k=0; i<npairs; i++) if (isnew[i]) {
+        p->edges[2*k]=pairs.data[2*i];
+        p->edges[2*k+1]=pairs.data[2*i+1];
+        k++;
+    }
+    success=true;
+
+meshprune_edges_cleanup:
+    if (isnew) MORPHO_FREE(isnew);
+    varray_elementidclear(&pairs);
+    return success;
+}
+
+/** Collapses queued edges shortest first, forming clusters of vertices */
+static bool meshprune_collapse(meshpruner *p, objectselection *fix, double length) {
+    p->queue=MORPHO_MALLOC(sizeof(meshprunequeueentry)*(p->nedges>0 ? p->nedges : 1));
+    p->root=MORPHO_MALLOC(sizeof(int)*(p->nv>0 ? p->nv : 1));
+    p->size=MORPHO_MALLOC(sizeof(int)*(p->nv>0 ? p->nv : 1));
+    p->sum=MORPHO_MALLOC(sizeof(double)*p->dim*(p->nv>0 ? p->nv : 1));
+    p->fixed=MORPHO_MALLOC(sizeof(elementid)*(p->nv>0 ? p->nv : 1));
+    if (!p->queue || !p->root || !p->size || !p->sum || !p->fixed || !meshprune_index(p)) return false;
+
+    for (int i=0; i<p->nv; i++) {
+        p->root[i]=i;
+        p->size[i]=1;
+        p->fixed[i]=(fix && selection_isselected(fix, MESH_GRADE_VERTEX, i) ? i : -1);
+    }
+    memcpy(p->sum, p->x, sizeof(double)*p->dim*p->nv);
+
+    p->nqueue=0;
+    for (int e=0; e<p->nedges; e++) meshprune_push(p, e, meshprune_distance(p, p->edges[2*e], p->edges[2*e+1]));
+
+    while (p->nqueue>0) {
+        meshprunequeueentry top=meshprune_pop(p);
+        int a=meshprune_find(p, p->edges[2*top.edge]), b=meshprune_find(p, p->edges[2*top.edge+1]);
+        if (a==b || (p->fixed[a]>=0 && p->fixed[b]>=0)) continue;
+
+        /* The clusters may have moved since the edge was queued; if so, requeue it with its current length */
+        double d=meshprune_distance(p, a, b);
+        if (d>top.length*(1+1e-12)) { meshprune_push(p, top.edge, d); continue; }
+        if (length>0.0 && d>length) continue;
+
+        if (meshprune_cancollapse(p, a, b)) meshprune_join(p, a, b);
+    }
+    return true;
+}
+
+/* **********************************************************************
+ * Building the pruned mesh
+ * ********************************************************************** */
+
+/** Numbers the new vertices: vertices that were not collapsed keep their order, followed by one vertex per cluster */
+static bool meshprune_numbervertices(meshpruner *p, meshpruning *prune, double **x) {
+    if (!varray_elementidresize(&prune->vmap, p->nv)) return false;
+    prune->vmap.count=p->nv;
+    elementid *vmap=prune->vmap.data;
+
+    int nnew=0;
+    for (int i=0; i<p->nv; i++) {
+        int c=meshprune_find(p, i);
+        vmap[i]=(p->size[c]==1 ? nnew++ : -1);
+    }
+    for (int i=0; i<p->nv; i++) { // Number clusters in order of their first vertex
+        int c=meshprune_find(p, i);
+        if (p->size[c]>1 && vmap[c]<0) vmap[c]=nnew++;
+    }
+
+    *x=MORPHO_MALLOC(sizeof(double)*p->dim*(nnew>0 ? nnew : 1));
+    if (!*x) return false;
+    for (int i=0; i<p->nv; i++) {
+        int c=meshprune_find(p, i);
+        vmap[i]=vmap[c];
+        if (i==c) meshprune_center(p, c, *x+vmap[i]*p->dim);
+    }
+    return true;
+}
+
+typedef struct {
+    sparseccs *ccs;
+    elementid *vmap;
+    int n;
+    elementid start, end;
+    elementid *tuples;
+    char *valid;
+} meshprunetask;
+
+/** Maps a range of elements onto the new vertices, marking those that are malformed or have collapsed */
+static bool meshprune_elementtask(void *arg) {
+    meshprunetask *task=(meshprunetask *) arg;
+    int n=task->n;
+    for (elementid id=task->start; id<task->end; id++) {
+        elementid *t=task->tuples+((size_t) id)*n;
+        int nel=task->ccs->cptr[id+1]-task->ccs->cptr[id];
+
+        task->valid[id]=(nel==n);
+        for (int k=0; k<n; k++) t[k]=(task->valid[id] ? task->vmap[task->ccs->rix[task->ccs->cptr[id]+k]] : 0);
+        mesh_sorttuple(n, t);
+        for (int k=1; k<n && task->valid[id]; k++) if (t[k]==t[k-1]) task->valid[id]=false;
+    }
+    return true;
+}
+
+/** Builds the elements of grade g in the pruned mesh */
+static bool meshprune_grade(meshpruner *p, meshpruning *prune, grade g) {
+    sparseccs *ccs=&p->conn[g]->ccs;
+    int n=g+1, nel=ccs->ncols, ntasks=mesh_ntasks(((size_t) nel)*(g+1));
+    meshprunetask tasks[ntasks];
+    bool success=false;
+
+    elementid *tuples=MORPHO_MALLOC(sizeof(elementid)*n*(nel>0 ? nel : 1));
+    char *valid=MORPHO_MALLOC(sizeof(char)*(nel>0 ? nel : 1));
+    char *isnew=MORPHO_MALLOC(sizeof(char)*(nel>0 ? nel : 1));
+    objectsparse *new=object_newsparse(NULL, NULL);
+    if (!tuples || !valid || !isnew || !new) goto meshprune_grade_cleanup;
+
+    for (int i=0; i<ntasks; i++) {
+        tasks[i] = (meshprunetask) { .ccs=ccs, .vmap=prune->vmap.data, .n=n, .tuples=tuples, .valid=valid,
+                                     .start=(elementid) (((long) nel*i)/ntasks), .end=(elementid) (((long) nel*(i+1))/ntasks) };
+    }
+    mesh_runtasks(ntasks, meshprune_elementtask, tasks, sizeof(meshprunetask));
+
+    if (nel>0 && !mesh_uniquetuples(n, nel, tuples, isnew)) goto meshprune_grade_cleanup;
+
+    int nnew=0;
+    for (int k=0; k<nel; k++) if (isnew[k] && valid[k]) nnew++;
+    if (nnew==0) { success=true; goto meshprune_grade_cleanup; }
+
+    if (!varray_elementidresize(&prune->parent[g], nnew) ||
+        !sparseccs_resize(&new->ccs, mesh_nvertices(prune->new), nnew, nnew*n, false)) goto meshprune_grade_cleanup;
+    for (int k=0, j=0; k<nel; k++) {
+        if (!isnew[k] || !valid[k]) continue;
+        memcpy(new->ccs.rix+((size_t) j)*n, tuples+((size_t) k)*n, sizeof(elementid)*n);
+        prune->parent[g].data[j]=k;
+        j++;
+    }
+    for (int i=0; i<=nnew; i++) new->ccs.cptr[i]=i*n;
+    prune->parent[g].count=nnew;
+
+    mesh_setconnectivityelement(prune->new, 0, g, new);
+    new=NULL;
+    success=true;
+
+meshprune_grade_cleanup:
+    if (new) object_free((object *) new);
+    if (tuples) MORPHO_FREE(tuples);
+    if (valid) MORPHO_FREE(valid);
+    if (isnew) MORPHO_FREE(isnew);
+    return success;
+}
+
+/* **********************************************************************
+ * Pruning
+ * ********************************************************************** */
+
+/** Prunes a mesh
+ * @param[in] mesh - the mesh to prune
+ * @param[in] sel - selection of elements whose edges may be collapsed, or NULL to consider every edge
+ * @param[in] fix - selection of vertices that may not move, or NULL
+ * @param[in] length - edges longer than this are not collapsed; zero or less to collapse every candidate edge
+ * @param[out] prune - the pruned mesh and the relation between its elements and those of the old mesh;
+ *                     call meshprune_clear when finished with it
+ * @returns true on success */
+bool meshprune_prune(objectmesh *mesh, objectselection *sel, objectselection *fix, double length, meshpruning *prune) {
+    meshpruner p = { .mesh=mesh, .nv=mesh_nvertices(mesh), .dim=mesh->dim, .maxg=mesh_maxgrade(mesh) };
+    bool success=false;
+    double *x=NULL;
+
+    prune->old=mesh;
+    prune->new=NULL;
+    prune->nv=p.nv;
+    varray_elementidinit(&prune->vmap);
+    for (grade g=0; g<=MESH_GRADE_VOLUME; g++) varray_elementidinit(&prune->parent[g]);
+
+    if (p.nv>0) p.x=mesh->vert->elements;
+    if (p.maxg>MESH_GRADE_VOLUME) p.maxg=MESH_GRADE_VOLUME;
+    for (grade g=1; g<=p.maxg; g++) {
+        p.conn[g]=mesh_getconnectivityelement(mesh, 0, g);
+        if (p.conn[g] && !sparse_checkformat(p.conn[g], SPARSE_CCS, true, false)) goto meshprune_prune_cleanup;
+    }
+
+    if (!meshprune_edges(&p, sel) ||
+        !meshprune_collapse(&p, fix, length) ||
+        !meshprune_numbervertices(&p, prune, &x)) goto meshprune_prune_cleanup;
+
+    /* Create the new mesh; each vertex records the first old vertex mapped onto it */
+    int nnew=0;
+    for (int i=0; i<p.nv; i++) if (prune->vmap.data[i]>=nnew) nnew=prune->vmap.data[i]+1;
+    prune->new=object_newmesh(p.dim, nnew, x);
+    if (!prune->new || (nnew>0 && !prune->new->vert)) goto meshprune_prune_cleanup;
+
+    if (!varray_elementidresize(&prune->parent[0], nnew)) goto meshprune_prune_cleanup;
+    for (int i=0; i<nnew; i++) prune->parent[0].data[i]=-1;
+    for (int i=p.nv-1; i>=0; i--) prune->parent[0].data[prune->vmap.data[i]]=i;
+    prune->parent[0].count=nnew;
+
+    for (grade g=1; g<=p.maxg; g++) {
+        if (p.conn[g] && !meshprune_grade(&p, prune, g)) goto meshprune_prune_cleanup;
+    }
+    mesh_freezeconnectivity(prune->new);
+    success=true;
+
+meshprune_prune_cleanup:
+    meshprune_freepruner(&p);
+    if (x) MORPHO_FREE(x);
+    if (!success) {
+        if (prune->new) object_free((object *) prune->new);
+        prune->new=NULL;
+        meshprune_clear(prune);
+    }
+    return success;
+}
+
+/** Frees the data structures associated with a pruning; the new mesh is not freed */
+void meshprune_clear(meshpruning *prune) {
+    varray_elementidclear(&prune->vmap);
+    for (grade g=0; g<=MESH_GRADE_VOLUME; g++) varray_elementidclear(&prune->parent[g]);
+}
+
+/* **********************************************************************
+ * Transferring objects to the pruned mesh
+ * ********************************************************************** */
+
+/** Creates a field on the pruned mesh. Values on vertices are averaged over the vertices collapsed onto them, and
+    elements take the value of the element they came from. */
+static objectfield *meshprune_adaptfield(meshpruning *prune, objectfield *field) {
+    objectfield *new=object_newfield(prune->new, field->prototype, field->dof);
+    if (!new) return NULL;
+    field_zero(new);
+
+    unsigned int psize=field->psize;
+    for (grade g=0; g<field->ngrades && g<new->ngrades && g<=MESH_GRADE_VOLUME; g++) {
+        unsigned int nold=mesh_nelementsforgrade(prune->old, g), nnew=prune->parent[g].count;
+        unsigned int block=field->dof[g]*psize;
+        if (!block || field->offset[g]+nold*field->dof[g]>field->nelements ||
+            new->offset[g]+nnew*new->dof[g]>new->nelements) continue;
+
+        double *src=field->data.elements+field->offset[g]*psize;
+        double *dest=new->data.elements+new->offset[g]*psize;
+
+        if (g==MESH_GRADE_VERTEX) {
+            int *count=MORPHO_MALLOC(sizeof(int)*(nnew>0 ? nnew : 1));
+            if (!count) { object_free((object *) new); return NULL; }
+            for (unsigned int i=0; i<nnew; i++) count[i]=0;
+            for (int i=0; i<prune->nv; i++) {
+                elementid j=prune->vmap.data[i];
+                for (unsigned int k=0; k<block; k++) dest[j*block+k]+=src[i*block+k];
+                count[j]++;
+            }
+            for (unsigned int i=0; i<nnew; i++) {
+                if (count[i]>1) for (unsigned int k=0; k<block; k++) dest[i*block+k]/=count[i];
+            }
+            MORPHO_FREE(count);
+        } else {
+            for (unsigned int i=0; i<nnew; i++) memcpy(dest+i*block, src+prune->parent[g].data[i]*block, sizeof(double)*block);
+        }
+    }
+
+    return new;
+}
+
+/** Creates a selection on the pruned mesh. A vertex is selected if any vertex collapsed onto it was selected, and an
+    element is selected if the element it came from was. */
+static objectselection *meshprune_adaptselection(meshpruning *prune, objectselection *sel) {
+    objectselection *new=object_newselection(prune->new);
+    if (!new) return NULL;
+    if (sel->mode!=SELECT_SOME) { new->mode=sel->mode; return new; }
+
+    for (int i=0; i<prune->nv; i++) {
+        if (selection_isselected(sel, MESH_GRADE_VERTEX, i)) selection_selectwithid(new, MESH_GRADE_VERTEX, prune->vmap.data[i], true);
+    }
+
+    for (grade g=1; g<sel->ngrades && g<new->ngrades && g<=MESH_GRADE_VOLUME; g++) {
+        if (!sel->selected[g].count) continue;
+        for (elementid id=0; id<prune->parent[g].count; id++) {
+            if (selection_isselected(sel, g, prune->parent[g].data[id])) selection_selectwithid(new, g, id, true);
+        }
+    }
+
+    return new;
+}
+
+/** Transfers a Field or Selection on the old mesh to the pruned mesh
+ * @param[in] prune - the pruning
+ * @param[in] obj - the Field or Selection
+ * @param[out] out - the new object, which is unbound
+ * @returns true on success, false if obj is not a Field or Selection on the old mesh or allocation failed */
+bool meshprune_adapt(meshpruning *prune, value obj, value *out) {
+    object *new=NULL;
+    if (MORPHO_ISFIELD(obj) && MORPHO_GETFIELD(obj)->mesh==prune->old) {
+        new=(object *) meshprune_adaptfield(prune, MORPHO_GETFIELD(obj));
+    } else if (MORPHO_ISSELECTION(obj) && MORPHO_GETSELECTION(obj)->mesh==prune->old) {
+        new=(object *) meshprune_adaptselection(prune, MORPHO_GETSELECTION(obj));
+    }
+    if (new) *out=MORPHO_OBJECT(new);
+    return new;
+}
@@ -0,0 +1,45 @@
+/** @file meshprune.h
+ *  @author T J Atherton
+ *
+ *  @brief Coarsening of meshes by collapsing edges
+ */
+
+#ifndef meshprune_h
+#define meshprune_h
+
+#include "mesh.h"
+#include "selection.h"
+
+/* -------------------------------------------------------
+ * Pruning
+ * ------------------------------------------------------- */
+
+/** Pruning collapses edges, merging their endpoints into a single vertex. Candidate edges are those of selected
+    elements, or every edge of the mesh if there is no selection, and are collapsed shortest first using a priority
+    queue. Vertices joined by collapsed edges form clusters that are replaced by a vertex at their centroid; the
+    length of an edge is the distance between the clusters it joins, which is updated lazily as clusters grow. If a
+    maximum length is given, edges that are longer when they reach the front of the queue are not collapsed. Fixed
+    vertices never move: a cluster containing one is placed at it, and edges that would join two fixed vertices
+    are not collapsed. A collapse is also skipped if it would invert an element of the highest grade or, in a
+    triangulated surface, join two clusters that share a neighbor not opposite their common edge, which would
+    change the topology. Elements are renumbered onto the new vertices, and those that collapse or duplicate an
+    earlier element are removed. Each new element records the element of the old mesh it came from, so that Fields
+    and Selections can be transferred to the new mesh. */
+
+typedef struct {
+    objectmesh *old; // The mesh that was pruned
+    objectmesh *new; // The pruned mesh
+    int nv; // Number of vertices in the old mesh
+    varray_elementid vmap; // New vertex each old vertex is mapped to
+    varray_elementid parent[MESH_GRADE_VOLUME+1]; // Element of the old mesh each new element came from
+} meshpruning;
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+bool meshprune_prune(objectmesh *mesh, objectselection *sel, objectselection *fix, double length, meshpruning *prune);
+bool meshprune_adapt(meshpruning *prune, value obj, value *out);
+void meshprune_clear(meshpruning *prune);
+
+#endif /* meshprune_h */
@@ -0,0 +1,757 @@
+/** @file meshrefine.c
+ *  @author T J Atherton
+ *
+ *  @brief Refinement of meshes by subdivision of their elements
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "morpho.h"
+#include "classes.h"
+#include "meshrefine.h"
+#include "field.h"
+#include "selection.h"
+
+/* **********************************************************************
+ * Edges
+ * ********************************************************************** */
+
+/** Working state for a refinement */
+typedef struct {
+    objectmesh *mesh;
+    int nv; // Number of vertices in the old mesh
+    int dim; // Dimension of the space
+    double *x; // Vertex positions in the old mesh
+    grade maxg;
+    objectsparse *conn[MESH_GRADE_VOLUME+1]; // Connectivity of each grade present in the old mesh
+
+    int nedges;
+    elementid *edges; // Vertex ids of each edge, in ascending order
+    int *vptr; // Edges whose lower vertex is a are vedge[vptr[a]] ... vedge[vptr[a+1]-1]
+    int *vedge;
+    char *marked; // Edges to split
+    elementid *midpoint; // Vertex inserted at the midpoint of each edge, or -1
+
+    elementid *support; // Pair of old vertices each new vertex lies between
+
+    int nchildren[MESH_GRADE_VOLUME+1];
+    elementid *children[MESH_GRADE_VOLUME+1]; // Elements produced by subdividing each grade
+    elementid *parent[MESH_GRADE_VOLUME+1]; // Element each child was produced from
+} meshrefiner;
+
+static void meshrefine_freerefiner(meshrefiner *r) {
+    if (r->edges) MORPHO_FREE(r->edges);
+    if (r->vptr) MORPHO_FREE(r->vptr);
+    if (r->vedge) MORPHO_FREE(r->vedge);
+    if (r->marked) MORPHO_FREE(r->marked);
+    if (r->midpoint) MORPHO_FREE(r->midpoint);
+    for (grade g=0; g<=MESH_GRADE_VOLUME; g++) {
+        if (r->children[g]) MORPHO_FREE(r->children[g]);
+        if (r->parent[g]) MORPHO_FREE(r->parent[g]);
+    }
+}
+
+/** Finds the edges of every element and indexes them by their lower vertex */
+static bool meshrefine_edges(meshrefiner *r) {
+    size_t ntuples=0;
+    for (grade g=1; g<=r->maxg; g++) {
+        if (!r->conn[g]) continue;
+        sparseccs *ccs=&r->conn[g]->ccs;
+        for (elementid id=0; id<ccs->ncols; id++) ntuples+=mesh_ncombinations(ccs->cptr[id+1]-ccs->cptr[id], 2);
+    }
+    if (ntuples>INT_MAX) return false;
+
+    char *isnew=MORPHO_MALLOC(sizeof(char)*(ntuples>0 ? ntuples : 1));
+    r->edges=MORPHO_MALLOC(sizeof(elementid)*2*(ntuples>0 ? ntuples : 1));
+    r->vptr=MORPHO_MALLOC(sizeof(int)*(r->nv+1));
+    if (!isnew || !r->edges || !r->vptr) goto meshrefine_edges_cleanup;
+
+    size_t k=0;
+    for (grade g=1; g<=r->maxg; g++) {
+        if (!r->conn[g]) continue;
+        sparseccs *ccs=&r->conn[g]->ccs;
+        for (elementid id=0; id<ccs->ncols; id++) {
+            int nel=ccs->cptr[id+1]-ccs->cptr[id];
+            if (nel<2) continue;
+            mesh_elementtuples(nel, ccs->rix+ccs->cptr[id], 2, r->edges+2*k);
+            k+=mesh_ncombinations(nel, 2);
+        }
+    }
+
+    if (!mesh_uniquetuples(2, (int) ntuples, r->edges, isnew)) goto meshrefine_edges_cleanup;
+
+    /* Keep the first occurrence of each edge */
+    r->nedges=0;
+    for (k=0; k<ntuples; k++) {
+        if (!isnew[k]) continue;
+        r->edges[2*r->nedges]=r->edges[2*k];
+        r->edges[2*r->nedges+1]=r->edges[2*k+1];
+        r->nedges++;
+    }
+    MORPHO_FREE(isnew);
+    isnew=NULL;
+
+    r->vedge=MORPHO_MALLOC(sizeof(int)*(r->nedges>0 ? r->nedges : 1));
+    r->marked=MORPHO_MALLOC(sizeof(char)*(r->nedges>0 ? r->nedges : 1));
+    r->midpoint=MORPHO_MALLOC(sizeof(elementid)*(r->nedges>0 ? r->nedges : 1));
+    if (!r->vedge || !r->marked || !r->midpoint) return false;
+
+    /* Index the edges by their lower vertex */
+    for (int i=0; i<=r->nv; i++) r->vptr[i]=0;
+    for (int e=0; e<r->nedges; e++) r->vptr[r->edges[2*e]+1]++;
+    for (int i=0; i<r->nv; i++) r->vptr[i+1]+=r->vptr[i];
+    for (int e=0; e<r->nedges; e++) {
+        elementid a=r->edges[2*e];
+        r->vedge[r->vptr[a]++]=e;
+    }
+    for (int i=r->nv; i>0; i--) r->vptr[i]=r->vptr[i-1];
+    r->vptr[0]=0;
+
+    memset(r->marked, 0, sizeof(char)*r->nedges);
+    return true;
+
+meshrefine_edges_cleanup:
+    if (isnew) MORPHO_FREE(isnew);
+    return false;
+}
+
+/** Finds the edge between two vertices, returning -1 if there is none */
+static int meshrefine_findedge(meshrefiner *r, elementid a, elementid b) {
+    if (a>b) { elementid t=a; a=b; b=t; }
+    for (int k=r->vptr[a]; k<r->vptr[a+1]; k++) {
+        if (r->edges[2*r->vedge[k]+1]==b) return r->vedge[k];
+    }
+    return -1;
+}
+
+/** Finds the vertex inserted on the edge between two vertices, returning -1 if the edge is not split */
+static elementid meshrefine_midpoint(meshrefiner *r, elementid a, elementid b) {
+    int e=meshrefine_findedge(r, a, b);
+    return (e>=0 ? r->midpoint[e] : -1);
+}
+
+/** Squared distance between two vertices of the refined mesh */
+static double meshrefine_dist2(meshrefiner *r, elementid p, elementid q) {
+    double *xp0=r->x+r->support[2*p]*r->dim, *xp1=r->x+r->support[2*p+1]*r->dim;
+    double *xq0=r->x+r->support[2*q]*r->dim, *xq1=r->x+r->support[2*q+1]*r->dim;
+    double d=0;
+    for (int k=0; k<r->dim; k++) {
+        double dx=0.5*(xp0[k]+xp1[k])-0.5*(xq0[k]+xq1[k]);
+        d+=dx*dx;
+    }
+    return d;
+}
+
+/* **********************************************************************
+ * Marking
+ * ********************************************************************** */
+
+/** Marks every edge of an element */
+static void meshrefine_markelement(meshrefiner *r, int nel, elementid *vids) {
+    for (int i=0; i<nel; i++) {
+        for (int j=i+1; j<nel; j++) {
+            int e=meshrefine_findedge(r, vids[i], vids[j]);
+            if (e>=0) r->marked[e]=true;
+        }
+    }
+}
+
+/** Marks the edges of selected elements, or all edges if there is no selection */
+static void meshrefine_mark(meshrefiner *r, objectselection *sel) {
+    if (sel && sel->mode==SELECT_NONE) return;
+
+    for (grade g=1; g<=r->maxg; g++) {
+        if (!r->conn[g]) continue;
+        sparseccs *ccs=&r->conn[g]->ccs;
+
+        if (!sel || sel->mode==SELECT_ALL) {
+            for (elementid id=0; id<ccs->ncols; id++) {
+                meshrefine_markelement(r, ccs->cptr[id+1]-ccs->cptr[id], ccs->rix+ccs->cptr[id]);
+            }
+        } else if (g<sel->ngrades) {
+            dictionary *dict=&sel->selected[g];
+            for (unsigned int k=0; k<dict->capacity; k++) {
+                value key=dict->contents[k].key;
+                if (!MORPHO_ISINTEGER(key)) continue;
+                elementid id=MORPHO_GETINTEGERVALUE(key);
+                if (id<0 || id>=ccs->ncols) continue;
+                meshrefine_markelement(r, ccs->cptr[id+1]-ccs->cptr[id], ccs->rix+ccs->cptr[id]);
+            }
+        }
+    }
+}
+
+/** A tetrahedron can be subdivided conformingly if none, all, or only edges in a single face are marked */
+static bool meshrefine_tetconforming(meshrefiner *r, elementid *v) {
+    bool touched[4] = { false, false, false, false };
+    int nmarked=0;
+
+    for (int i=0; i<4; i++) {
+        for (int j=i+1; j<4; j++) {
+            int e=meshrefine_findedge(r, v[i], v[j]);
+            if (e>=0 && r->marked[e]) { nmarked++; touched[i]=touched[j]=true; }
+        }
+    }
+
+    if (nmarked==0 || nmarked==6) return true;
+    for (int i=0; i<4; i++) if (!touched[i]) return true;
+    return false;
+}
+
+/** Promotes tetrahedra that cannot be subdivided conformingly to regular refinement, until none remain */
+static void meshrefine_closure(meshrefiner *r) {
+    if (r->maxg<MESH_GRADE_VOLUME || !r->conn[MESH_GRADE_VOLUME]) return;
+    sparseccs *ccs=&r->conn[MESH_GRADE_VOLUME]->ccs;
+    bool changed;
+
+    do {
+        changed=false;
+        for (elementid id=0; id<ccs->ncols; id++) {
+            elementid *v=ccs->rix+ccs->cptr[id];
+            if (ccs->cptr[id+1]-ccs->cptr[id]!=4 || meshrefine_tetconforming(r, v)) continue;
+            meshrefine_markelement(r, 4, v);
+            changed=true;
+        }
+    } while (changed);
+}
+
+/** Numbers the vertices inserted at the midpoints of marked edges after the old vertices */
+static bool meshrefine_numbervertices(meshrefiner *r, meshrefinement *ref) {
+    int nnew=r->nv;
+    for (int e=0; e<r->nedges; e++) r->midpoint[e]=(r->marked[e] ? nnew++ : -1);
+
+    if (!varray_elementidresize(&ref->support, 2*nnew)) return false;
+    ref->support.count=2*nnew;
+    r->support=ref->support.data;
+
+    for (elementid i=0; i<r->nv; i++) r->support[2*i]=r->support[2*i+1]=i;
+    for (int e=0; e<r->nedges; e++) {
+        if (r->midpoint[e]<0) continue;
+        r->support[2*r->midpoint[e]]=r->edges[2*e];
+        r->support[2*r->midpoint[e]+1]=r->edges[2*e+1];
+    }
+    return true;
+}
+
+/* **********************************************************************
+ * Subdivision of elements
+ * ********************************************************************** */
+
+/** Divides an edge in two if it is marked */
+static int meshrefine_splitline(meshrefiner *r, elementid *v, elementid *out) {
+    elementid m=meshrefine_midpoint(r, v[0], v[1]);
+    if (m<0) { out[0]=v[0]; out[1]=v[1]; return 1; }
+
+    out[0]=v[0]; out[1]=m;
+    out[2]=m; out[3]=v[1];
+    return 2;
+}
+
+/** Subdivides a triangle according to which of its edges are marked:
+            .            .            .
+          / | \        / | \        /   \
+         /  |  \      /  |  *      * --- *
+        /   |   \    /   | / \    /  \  /  \
+      . --- * -- . . --- * -- . . --- * -- .
+    With two marked edges, the remaining quadrilateral is divided along its shorter diagonal; ties are broken by
+    vertex id so that a face shared by two elements is divided identically in both. */
+static int meshrefine_splittriangle(meshrefiner *r, elementid *v, elementid *out) {
+    elementid m[3]; // m[i] lies on the edge opposite v[i]
+    int nmarked=0, marked=-1, unmarked=-1;
+
+    for (int i=0; i<3; i++) {
+        m[i]=meshrefine_midpoint(r, v[(i+1)%3], v[(i+2)%3]);
+        if (m[i]>=0) { nmarked++; marked=i; } else unmarked=i;
+    }
+
+    switch (nmarked) {
+        case 0:
+            for (int i=0; i<3; i++) out[i]=v[i];
+            return 1;
+        case 1: {
+            elementid a=v[(marked+1)%3], b=v[(marked+2)%3], c=v[marked];
+            elementid t[6] = { a, m[marked], c, m[marked], b, c };
+            memcpy(out, t, sizeof(t));
+            return 2;
+        }
+        case 2: {
+            elementid s=v[unmarked], x=v[(unmarked+1)%3], y=v[(unmarked+2)%3];
+            elementid mx=m[(unmarked+2)%3], my=m[(unmarked+1)%3]; // Midpoints of sx and sy
+            if (x>y) { elementid t=x; x=y; y=t; t=mx; mx=my; my=t; }
+
+            elementid t[9] = { s, mx, my, mx, x, my, x, y, my };
+            if (meshrefine_dist2(r, x, my)>meshrefine_dist2(r, y, mx)) {
+                t[5]=y; t[6]=mx; t[7]=y; t[8]=my;
+            }
+            memcpy(out, t, sizeof(t));
+            return 3;
+        }
+        default:
+            for (int i=0; i<3; i++) {
+                out[3*i]=v[i]; out[3*i+1]=m[(i+1)%3]; out[3*i+2]=m[(i+2)%3];
+            }
+            out[9]=m[0]; out[10]=m[1]; out[11]=m[2];
+            return 4;
+    }
+}
+
+/** Subdivides a tetrahedron. If all edges are marked, it is divided into four corner tetrahedra and an inner
+    octahedron, which is split into four along its shortest diagonal. Otherwise the marked edges lie in a single
+    face, which is subdivided as a triangle and joined to the opposite vertex.
+ * @returns the number of children, or -1 if the marked edges cannot be subdivided conformingly */
+static int meshrefine_splittet(meshrefiner *r, elementid *v, elementid *out) {
+    elementid m[4][4];
+    bool touched[4] = { false, false, false, false };
+    int nmarked=0;
+
+    for (int i=0; i<4; i++) {
+        m[i][i]=v[i];
+        for (int j=i+1; j<4; j++) {
+            m[i][j]=m[j][i]=meshrefine_midpoint(r, v[i], v[j]);
+            if (m[i][j]>=0) { nmarked++; touched[i]=touched[j]=true; }
+        }
+    }
+
+    if (nmarked==6) {
+        int n=0;
+        for (int i=0; i<4; i++) { // Corners
+            for (int j=0; j<4; j++) out[n++]=m[i][j];
+        }
+
+        int diag[3][4] = { { 0, 1, 2, 3 }, { 0, 2, 1, 3 }, { 0, 3, 1, 2 } };
+        int best=0;
+        double dmin=meshrefine_dist2(r, m[0][1], m[2][3]);
+        for (int k=1; k<3; k++) {
+            double d=meshrefine_dist2(r, m[diag[k][0]][diag[k][1]], m[diag[k][2]][diag[k][3]]);
+            if (d<dmin) { dmin=d; best=k; }
+        }
+
+        int a=diag[best][0], b=diag[best][1], c=diag[best][2], d=diag[best][3];
+        elementid ring[5] = { m[a][c], m[a][d], m[b][d], m[b][c], m[a][c] };
+        for (int k=0; k<4; k++) {
+            out[n++]=m[a][b]; out[n++]=m[c][d]; out[n++]=ring[k]; out[n++]=ring[k+1];
+        }
+        return 8;
+    }
+
+    for (int p=0; p<4; p++) {
+        if (touched[p]) continue;
+        elementid face[3], tri[12];
+        for (int i=0, k=0; i<4; i++) if (i!=p) face[k++]=v[i];
+
+        int ntri=meshrefine_splittriangle(r, face, tri);
+        for (int i=0; i<ntri; i++) {
+            memcpy(out+4*i, tri+3*i, sizeof(elementid)*3);
+            out[4*i+3]=v[p];
+        }
+        return ntri;
+    }
+
+    return -1;
+}
+
+/** Maximum number of children of an element */
+#define MESHREFINE_MAXCHILDREN 8
+
+/** Subdivides an element, writing the sorted vertex ids of its children to out
+ * @returns the number of children, or -1 on failure */
+static int meshrefine_split(meshrefiner *r, grade g, int nel, elementid *v, elementid *out) {
+    int n=-1;
+    if (nel!=g+1) return -1;
+
+    switch (g) {
+        case MESH_GRADE_LINE: n=meshrefine_splitline(r, v, out); break;
+        case MESH_GRADE_AREA: n=meshrefine_splittriangle(r, v, out); break;
+        case MESH_GRADE_VOLUME: n=meshrefine_splittet(r, v, out); break;
+    }
+
+    for (int i=0; i<n; i++) mesh_sorttuple(g+1, out+i*(g+1));
+    return n;
+}
+
+/** Counts the distinct old vertices that the vertices of an element are interpolated from */
+static int meshrefine_supportsize(meshrefiner *r, int n, elementid *v) {
+    elementid s[2*n];
+    for (int i=0; i<n; i++) { s[2*i]=r->support[2*v[i]]; s[2*i+1]=r->support[2*v[i]+1]; }
+    mesh_sorttuple(2*n, s);
+
+    int count=1;
+    for (int i=1; i<2*n; i++) if (s[i]!=s[i-1]) count++;
+    return count;
+}
+
+/** Finds the elements of n vertices within a child of k vertices that lie in the interior of an old element
+    of higher grade; the other elements of the child lie within an old element of their own grade.
+ * @param[out] out - the elements found, or NULL to count them
+ * @returns the number of elements */
+static int meshrefine_interior(meshrefiner *r, int k, elementid *child, int n, elementid *out) {
+    int ncomb=mesh_ncombinations(k, n), nfound=0;
+    elementid tuples[ncomb*n];
+    mesh_elementtuples(k, child, n, tuples);
+
+    for (int i=0; i<ncomb; i++) {
+        if (meshrefine_supportsize(r, n, tuples+i*n)<=n) continue;
+        if (out) memcpy(out+nfound*n, tuples+i*n, sizeof(elementid)*n);
+        nfound++;
+    }
+    return nfound;
+}
+
+/* -------------------------------------
+ * Parallel passes
+ * ------------------------------------- */
+
+typedef struct {
+    meshrefiner *r;
+    grade g; // Grade of the elements processed
+    int n; // Number of vertices in the lower elements extracted from children
+    elementid start, end; // Range of elements to process
+    int *offset; // Number of elements produced from each element, then the index of the first
+    elementid *out; // Elements produced
+    elementid *parent; // Element each was produced from
+    bool write; // Whether to count or write the elements
+    bool success;
+} meshrefinetask;
+
+/** Subdivides a range of elements of the old mesh */
+static bool meshrefine_splittask(void *arg) {
+    meshrefinetask *task = (meshrefinetask *) arg;
+    sparseccs *ccs=&task->r->conn[task->g]->ccs;
+    int n=task->g+1;
+    elementid children[MESHREFINE_MAXCHILDREN*(MESH_GRADE_VOLUME+1)];
+
+    for (elementid id=task->start; id<task->end; id++) {
+        int nchildren=meshrefine_split(task->r, task->g, ccs->cptr[id+1]-ccs->cptr[id], ccs->rix+ccs->cptr[id], children);
+        if (nchildren<0) return true;
+
+        if (task->write) {
+            memcpy(task->out+((size_t) task->offset[id])*n, children, sizeof(elementid)*nchildren*n);
+            for (int i=0; i<nchildren; i++) task->parent[task->offset[id]+i]=id;
+        } else task->offset[id]=nchildren;
+    }
+    task->success=true;
+    return true;
+}
+
+/** Extracts lower elements from a range of children */
+static bool meshrefine_interiortask(void *arg) {
+    meshrefinetask *task = (meshrefinetask *) arg;
+    meshrefiner *r=task->r;
+    int k=task->g+1;
+
+    for (elementid id=task->start; id<task->end; id++) {
+        elementid *child=r->children[task->g]+((size_t) id)*k;
+        if (task->write) {
+            meshrefine_interior(r, k, child, task->n, task->out+((size_t) task->offset[id])*task->n);
+        } else task->offset[id]=meshrefine_interior(r, k, child, task->n, NULL);
+    }
+    task->success=true;
+    return true;
+}
+
+/** Runs a pass over nitems elements, dividing the work between tasks */
+static bool meshrefine_run(int nitems, workfn fn, meshrefinetask *proto) {
+    int ntasks=mesh_ntasks(((size_t) nitems)*MESHREFINE_MAXCHILDREN);
+    meshrefinetask tasks[ntasks];
+    for (int i=0; i<ntasks; i++) {
+        tasks[i]=*proto;
+        tasks[i].start=(elementid) (((long) nitems*i)/ntasks);
+        tasks[i].end=(elementid) (((long) nitems*(i+1))/ntasks);
+        tasks[i].success=false;
+    }
+
+    mesh_runtasks(ntasks, fn, tasks, sizeof(meshrefinetask));
+    for (int i=0; i<ntasks; i++) if (!tasks[i].success) return false;
+    return true;
+}
+
+/** Converts counts into offsets, returning the total or -1 on overflow */
+static int meshrefine_offsets(int n, int *offset) {
+    long total=0;
+    for (int i=0; i<n; i++) {
+        int c=offset[i];
+        offset[i]=(int) total;
+        total+=c;
+    }
+    offset[n]=(int) total;
+    return (total>INT_MAX ? -1 : (int) total);
+}
+
+/** Subdivides the elements of a grade */
+static bool meshrefine_children(meshrefiner *r, grade g) {
+    int nel=r->conn[g]->ccs.ncols, n=g+1;
+    bool success=false;
+    int *offset=MORPHO_MALLOC(sizeof(int)*(nel+1));
+    if (!offset) return false;
+
+    meshrefinetask proto = { .r=r, .g=g, .offset=offset, .write=false };
+    if (!meshrefine_run(nel, meshrefine_splittask, &proto)) goto meshrefine_children_cleanup;
+
+    int total=meshrefine_offsets(nel, offset);
+    if (total<0) goto meshrefine_children_cleanup;
+    r->children[g]=MORPHO_MALLOC(sizeof(elementid)*n*(total>0 ? total : 1));
+    r->parent[g]=MORPHO_MALLOC(sizeof(elementid)*(total>0 ? total : 1));
+    if (!r->children[g] || !r->parent[g]) goto meshrefine_children_cleanup;
+    r->nchildren[g]=total;
+
+    proto.out=r->children[g];
+    proto.parent=r->parent[g];
+    proto.write=true;
+    success=meshrefine_run(nel, meshrefine_splittask, &proto);
+
+meshrefine_children_cleanup:
+    MORPHO_FREE(offset);
+    return success;
+}
+
+/** Finds the distinct elements of grade g that lie in the interior of refined elements of higher grade
+ * @param[out] out - the elements found; free with MORPHO_FREE
+ * @param[out] nout - the number of elements found
+ * @returns true on success */
+static bool meshrefine_interiorelements(meshrefiner *r, grade g, elementid **out, int *nout) {
+    int n=g+1, ntotal=0;
+    int *offset[MESH_GRADE_VOLUME+1];
+    elementid *tuples=NULL;
+    char *isnew=NULL;
+    bool success=false;
+
+    for (grade h=0; h<=MESH_GRADE_VOLUME; h++) offset[h]=NULL;
+
+    /* Count the candidates drawn from the children of each higher grade */
+    for (grade h=g+1; h<=r->maxg; h++) {
+        if (!r->children[h]) continue;
+        int nch=r->nchildren[h];
+        offset[h]=MORPHO_MALLOC(sizeof(int)*(nch+1));
+        if (!offset[h]) goto meshrefine_interiorelements_cleanup;
+
+        meshrefinetask proto = { .r=r, .g=h, .n=n, .offset=offset[h], .write=false };
+        if (!meshrefine_run(nch, meshrefine_interiortask, &proto)) goto meshrefine_interiorelements_cleanup;
+        int total=meshrefine_offsets(nch, offset[h]);
+        if (total<0 || (long) ntotal+total>INT_MAX) goto meshrefine_interiorelements_cleanup;
+        ntotal+=total;
+    }
+
+    tuples=MORPHO_MALLOC(sizeof(elementid)*n*(ntotal>0 ? ntotal : 1));
+    isnew=MORPHO_MALLOC(sizeof(char)*(ntotal>0 ? ntotal : 1));
+    if (!tuples || !isnew) goto meshrefine_interiorelements_cleanup;
+
+    /* Write the candidates, then keep the first occurrence of each */
+    size_t start=0;
+    for (grade h=g+1; h<=r->maxg; h++) {
+        if (!offset[h]) continue;
+        meshrefinetask proto = { .r=r, .g=h, .n=n, .offset=offset[h], .out=tuples+start*n, .write=true };
+        if (!meshrefine_run(r->nchildren[h], meshrefine_interiortask, &proto)) goto meshrefine_interiorelements_cleanup;
+        start+=offset[h][r->nchildren[h]];
+    }
+
+    if (!mesh_uniquetuples(n, ntotal, tuples, isnew)) goto meshrefine_interiorelements_cleanup;
+
+    int nunique=0;
+    for (int k=0; k<ntotal; k++) {
+        if (isnew[k]) memmove(tuples+((size_t) nunique++)*n, tuples+((size_t) k)*n, sizeof(elementid)*n);
+    }
+    *out=tuples;
+    *nout=nunique;
+    tuples=NULL;
+    success=true;
+
+meshrefine_interiorelements_cleanup:
+    for (grade h=0; h<=MESH_GRADE_VOLUME; h++) if (offset[h]) MORPHO_FREE(offset[h]);
+    if (tuples) MORPHO_FREE(tuples);
+    if (isnew) MORPHO_FREE(isnew);
+    return success;
+}
+
+/** Assembles the connectivity of a grade in the new mesh from the children and the interior elements */
+static bool meshrefine_assemble(meshrefiner *r, meshrefinement *ref, grade g) {
+    int n=g+1, ninterior=0;
+    elementid *interior=NULL;
+    if (!meshrefine_interiorelements(r, g, &interior, &ninterior)) return false;
+
+    int nchildren=r->nchildren[g], nel=nchildren+ninterior;
+    bool success=false;
+    objectsparse *new=object_newsparse(NULL, NULL);
+    if (!new || !sparseccs_resize(&new->ccs, ref->new->vert->ncols, nel, nel*n, false)) goto meshrefine_assemble_cleanup;
+
+    memcpy(new->ccs.rix, r->children[g], sizeof(elementid)*nchildren*n);
+    memcpy(new->ccs.rix+((size_t) nchildren)*n, interior, sizeof(elementid)*ninterior*n);
+    for (int i=0; i<=nel; i++) new->ccs.cptr[i]=i*n;
+
+    /* Record the parent of each element */
+    if (!varray_elementidresize(&ref->parent[g], nel)) goto meshrefine_assemble_cleanup;
+    memcpy(ref->parent[g].data, r->parent[g], sizeof(elementid)*nchildren);
+    for (int i=nchildren; i<nel; i++) ref->parent[g].data[i]=-1;
+    ref->parent[g].count=nel;
+
+    mesh_setconnectivityelement(ref->new, 0, g, new);
+    new=NULL;
+    success=true;
+
+meshrefine_assemble_cleanup:
+    if (new) object_free((object *) new);
+    if (interior) MORPHO_FREE(interior);
+    return success;
+}
+
+/* **********************************************************************
+ * Refinement
+ * ********************************************************************** */
+
+/** Refines a mesh
+ * @param[in] mesh - the mesh to refine
+ * @param[in] sel - selection of elements to refine, or NULL to refine every element
+ * @param[out] ref - the refined mesh and the relation between its elements and those of the old mesh;
+ *                   call meshrefine_clear when finished with it
+ * @returns true on success */
+bool meshrefine_refine(objectmesh *mesh, objectselection *sel, meshrefinement *ref) {
+    meshrefiner r = { .mesh=mesh, .nv=mesh_nvertices(mesh), .dim=mesh->dim, .x=mesh->vert->elements, .maxg=mesh_maxgrade(mesh) };
+    bool success=false;
+    double *x=NULL;
+
+    ref->old=mesh;
+    ref->new=NULL;
+    ref->nv=r.nv;
+    varray_elementidinit(&ref->support);
+    for (grade g=0; g<=MESH_GRADE_VOLUME; g++) varray_elementidinit(&ref->parent[g]);
+
+    if (r.maxg>MESH_GRADE_VOLUME) r.maxg=MESH_GRADE_VOLUME;
+    for (grade g=1; g<=r.maxg; g++) {
+        r.conn[g]=mesh_getconnectivityelement(mesh, 0, g);
+        if (r.conn[g] && !sparse_checkformat(r.conn[g], SPARSE_CCS, true, false)) goto meshrefine_refine_cleanup;
+    }
+
+    /* Mark the edges to split and number the new vertices */
+    if (!meshrefine_edges(&r)) goto meshrefine_refine_cleanup;
+    meshrefine_mark(&r, sel);
+    meshrefine_closure(&r);
+    if (!meshrefine_numbervertices(&r, ref)) goto meshrefine_refine_cleanup;
+
+    /* Create the new mesh */
+    int nnew=ref->support.count/2;
+    x=MORPHO_MALLOC(sizeof(double)*r.dim*(nnew>0 ? nnew : 1));
+    if (!x) goto meshrefine_refine_cleanup;
+    for (elementid i=0; i<nnew; i++) {
+        double *x0=r.x+r.support[2*i]*r.dim, *x1=r.x+r.support[2*i+1]*r.dim;
+        for (int k=0; k<r.dim; k++) x[i*r.dim+k]=(i<r.nv ? x0[k] : 0.5*(x0[k]+x1[k]));
+    }
+    ref->new=object_newmesh(r.dim, nnew, x);
+    if (!ref->new || !ref->new->vert) goto meshrefine_refine_cleanup;
+
+    /* Subdivide the elements of each grade, then add elements that lie within higher grades */
+    if (!varray_elementidresize(&ref->parent[0], nnew)) goto meshrefine_refine_cleanup;
+    for (elementid i=0; i<nnew; i++) ref->parent[0].data[i]=(i<r.nv ? i : -1);
+    ref->parent[0].count=nnew;
+    for (grade g=1; g<=r.maxg; g++) {
+        if (r.conn[g] && !meshrefine_children(&r, g)) goto meshrefine_refine_cleanup;
+    }
+    for (grade g=1; g<=r.maxg; g++) {
+        if (r.conn[g] && !meshrefine_assemble(&r, ref, g)) goto meshrefine_refine_cleanup;
+    }
+    mesh_freezeconnectivity(ref->new);
+    success=true;
+
+meshrefine_refine_cleanup:
+    meshrefine_freerefiner(&r);
+    if (x) MORPHO_FREE(x);
+    if (!success) {
+        if (ref->new) object_free((object *) ref->new);
+        ref->new=NULL;
+        meshrefine_clear(ref);
+    }
+    return success;
+}
+
+/** Frees the data structures associated with a refinement; the new mesh is not freed */
+void meshrefine_clear(meshrefinement *ref) {
+    varray_elementidclear(&ref->support);
+    for (grade g=0; g<=MESH_GRADE_VOLUME; g++) varray_elementidclear(&ref->parent[g]);
+}
+
+/* **********************************************************************
+ * Transferring objects to the refined mesh
+ * ********************************************************************** */
+
+/** Creates a field on the refined mesh. Values on new vertices are interpolated linearly, elements inherit the value
+    of the element they subdivide, and elements lying inside an element of higher grade are set to zero. */
+static objectfield *meshrefine_adaptfield(meshrefinement *ref, objectfield *field) {
+    objectfield *new=object_newfield(ref->new, field->prototype, field->dof);
+    if (!new) return NULL;
+    field_zero(new);
+
+    unsigned int psize=field->psize;
+    for (grade g=0; g<field->ngrades && g<new->ngrades && g<=MESH_GRADE_VOLUME; g++) {
+        unsigned int nold=mesh_nelementsforgrade(ref->old, g), nnew=ref->parent[g].count;
+        unsigned int block=field->dof[g]*psize;
+        if (!block || field->offset[g]+nold*field->dof[g]>field->nelements ||
+            new->offset[g]+nnew*new->dof[g]>new->nelements) continue;
+
+        double *src=field->data.elements+field->offset[g]*psize;
+        double *dest=new->data.elements+new->offset[g]*psize;
+
+        for (unsigned int i=0; i<nnew; i++) {
+            if (g==MESH_GRADE_VERTEX) {
+                double *a=src+ref->support.data[2*i]*block, *b=src+ref->support.data[2*i+1]*block;
+                for (unsigned int k=0; k<block; k++) dest[i*block+k]=0.5*(a[k]+b[k]);
+            } else if (ref->parent[g].data[i]>=0) {
+                memcpy(dest+i*block, src+ref->parent[g].data[i]*block, sizeof(double)*block);
+            }
+        }
+    }
+
+    return new;
+}
+
+/** Creates a selection on the refined mesh. Old vertices and elements that subdivide selected elements are selected;
+    a new vertex is selected if it belongs to a selected element with at least one selected old vertex. */
+static objectselection *meshrefine_adaptselection(meshrefinement *ref, objectselection *sel) {
+    objectselection *new=object_newselection(ref->new);
+    if (!new) return NULL;
+    if (sel->mode!=SELECT_SOME) { new->mode=sel->mode; return new; }
+
+    dictionary *vdict=&sel->selected[MESH_GRADE_VERTEX];
+    for (unsigned int k=0; k<vdict->capacity; k++) {
+        value key=vdict->contents[k].key;
+        if (MORPHO_ISINTEGER(key) && MORPHO_GETINTEGERVALUE(key)<ref->nv) {
+            selection_selectwithid(new, MESH_GRADE_VERTEX, MORPHO_GETINTEGERVALUE(key), true);
+        }
+    }
+
+    for (grade g=1; g<sel->ngrades && g<new->ngrades && g<=MESH_GRADE_VOLUME; g++) {
+        if (!sel->selected[g].count) continue;
+        objectsparse *conn=mesh_getconnectivityelement(ref->new, 0, g);
+        if (!conn) continue;
+
+        for (elementid id=0; id<ref->parent[g].count; id++) {
+            elementid parent=ref->parent[g].data[id];
+            if (parent<0 || !selection_isselected(sel, g, parent)) continue;
+            selection_selectwithid(new, g, id, true);
+
+            int nv, *vids;
+            if (!mesh_getconnectivity(conn, id, &nv, &vids)) continue;
+            bool vselected=false;
+            for (int i=0; i<nv; i++) if (vids[i]<ref->nv && selection_isselected(sel, MESH_GRADE_VERTEX, vids[i])) vselected=true;
+            if (vselected) for (int i=0; i<nv; i++) {
+                if (vids[i]>=ref->nv) selection_selectwithid(new, MESH_GRADE_VERTEX, vids[i], true);
+            }
+        }
+    }
+
+    return new;
+}
+
+/** Transfers a Field or Selection on the old mesh to the refined mesh
+ * @param[in] ref - the refinement
+ * @param[in] obj - the Field or Selection
+ * @param[out] out - the new object, which is unbound
+ * @returns true on success, false if obj is not a Field or Selection on the old mesh or allocation failed */
+bool meshrefine_adapt(meshrefinement *ref, value obj, value *out) {
+    object *new=NULL;
+    if (MORPHO_ISFIELD(obj) && MORPHO_GETFIELD(obj)->mesh==ref->old) {
+        new=(object *) meshrefine_adaptfield(ref, MORPHO_GETFIELD(obj));
+    } else if (MORPHO_ISSELECTION(obj) && MORPHO_GETSELECTION(obj)->mesh==ref->old) {
+        new=(object *) meshrefine_adaptselection(ref, MORPHO_GETSELECTION(obj));
+    }
+    if (new) *out=MORPHO_OBJECT(new);
+    return new;
+}
@@ -0,0 +1,42 @@
+/** @file meshrefine.h
+ *  @author T J Atherton
+ *
+ *  @brief Refinement of meshes by subdivision of their elements
+ */
+
+#ifndef meshrefine_h
+#define meshrefine_h
+
+#include "mesh.h"
+#include "selection.h"
+
+/* -------------------------------------------------------
+ * Refinement
+ * ------------------------------------------------------- */
+
+/** Refinement inserts a vertex at the midpoint of each marked edge and subdivides every element that contains a
+    marked edge. Edges are marked if they belong to a selected element, or to any element if there is no selection.
+    Elements with all edges marked are divided regularly ("red" refinement): edges in two, triangles in four and
+    tetrahedra in eight. Elements with some edges marked are divided conformingly ("green" refinement); a tetrahedron
+    whose marked edges do not all lie in one face is first promoted to red refinement, and this closure is
+    repeated until the marking is stable. Elements of lower grades lying inside refined elements are created
+    for each grade the mesh already possesses. Each new element records the element of the same grade in the old
+    mesh it lies in, so that Fields and Selections can be transferred to the new mesh. */
+
+typedef struct {
+    objectmesh *old; // The mesh that was refined
+    objectmesh *new; // The refined mesh
+    int nv; // Number of vertices in the old mesh, which keep their ids
+    varray_elementid support; // Pair of old vertices whose midpoint each new vertex lies at; equal for old vertices
+    varray_elementid parent[MESH_GRADE_VOLUME+1]; // Parent of each new element, or -1 if it lies inside a higher grade element
+} meshrefinement;
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+bool meshrefine_refine(objectmesh *mesh, objectselection *sel, meshrefinement *ref);
+bool meshrefine_adapt(meshrefinement *ref, value obj, value *out);
+void meshrefine_clear(meshrefinement *ref);
+
+#endif /* meshrefine_h */
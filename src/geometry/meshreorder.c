@@ -0,0 +1,501 @@
+/** @file meshreorder.c
+ *  @author T J Atherton
+ *
+ *  @brief Renumbering of mesh vertices and elements to improve memory locality
+ */
+
+#include <float.h>
+#include <string.h>
+
+#include "morpho.h"
+#include "classes.h"
+#include "meshreorder.h"
+#include "meshindex.h"
+#include "meshadjacency.h"
+#include "field.h"
+#include "selection.h"
+
+/* **********************************************************************
+ * Hilbert curve ordering
+ * ********************************************************************** */
+
+typedef struct {
+    uint64_t key;
+    int id;
+} meshreorderkey;
+
+static int meshreorder_cmpkey(const void *a, const void *b) {
+    const meshreorderkey *x=a, *y=b;
+    if (x->key!=y->key) return (x->key<y->key ? -1 : 1);
+    return x->id-y->id;
+}
+
+/** Computes the distance along the Hilbert curve of a point with integer coordinates X,
+ *  using J. Skilling, "Programming the Hilbert curve", AIP Conf. Proc. 707, 381 (2004).
+ *  @param[in] n - dimension
+ *  @param[in] X - coordinates, each of b bits; overwritten
+ *  @param[in] b - bits per coordinate */
+static uint64_t meshreorder_hilbertkey(int n, uint32_t *X, int b) {
+    uint32_t M=((uint32_t) 1)<<(b-1), P, Q, t;
+
+    /* Inverse undo */
+    for (Q=M; Q>1; Q>>=1) {
+        P=Q-1;
+        for (int i=0; i<n; i++) {
+            if (X[i] & Q) X[0]^=P;
+            else { t=(X[0]^X[i]) & P; X[0]^=t; X[i]^=t; }
+        }
+    }
+
+    /* Gray encode */
+    for (int i=1; i<n; i++) X[i]^=X[i-1];
+    t=0;
+    for (Q=M; Q>1; Q>>=1) if (X[n-1] & Q) t^=Q-1;
+    for (int i=0; i<n; i++) X[i]^=t;
+
+    /* Interleave the transposed bits to form the key */
+    uint64_t key=0;
+    for (int j=b-1; j>=0; j--) {
+        for (int i=0; i<n; i++) key=(key<<1) | ((X[i]>>j) & 1);
+    }
+    return key;
+}
+
+/** Orders points along a Hilbert curve through their bounding box
+ * @param[in] dim - dimension
+ * @param[in] n - number of points
+ * @param[in] x - coordinates of the points, stored consecutively
+ * @param[out] order - ids of the points in the order they lie along the curve
+ * @returns true on success */
+bool meshreorder_hilbertorder(int dim, int n, double *x, int *order) {
+    int b=MESHREORDER_HILBERTBITS(dim);
+    double lo[dim], extent=0.0;
+
+    meshreorderkey *keys=MORPHO_MALLOC(sizeof(meshreorderkey)*(n>0 ? n : 1));
+    if (!keys) return false;
+
+    for (int k=0; k<dim; k++) {
+        double hi=-DBL_MAX;
+        lo[k]=DBL_MAX;
+        for (int i=0; i<n; i++) {
+            if (x[i*dim+k]<lo[k]) lo[k]=x[i*dim+k];
+            if (x[i*dim+k]>hi) hi=x[i*dim+k];
+        }
+        if (hi-lo[k]>extent) extent=hi-lo[k];
+    }
+
+    /* Use the same scale along every axis so that the curve isn't distorted */
+    double scale=(extent>0.0 ? ((double) ((((uint64_t) 1)<<b)-1))/extent : 0.0);
+
+    for (int i=0; i<n; i++) {
+        uint32_t X[dim];
+        for (int k=0; k<dim; k++) X[k]=(uint32_t) ((x[i*dim+k]-lo[k])*scale);
+        keys[i].key=meshreorder_hilbertkey(dim, X, b);
+        keys[i].id=i;
+    }
+
+    qsort(keys, n, sizeof(meshreorderkey), meshreorder_cmpkey);
+    for (int i=0; i<n; i++) order[i]=keys[i].id;
+
+    MORPHO_FREE(keys);
+    return true;
+}
+
+/** Orders vertices along a Hilbert curve through their bounding box */
+static bool meshreorder_hilbert(objectmesh *mesh, int *order) {
+    return meshreorder_hilbertorder(mesh->dim, mesh_nvertices(mesh), mesh->vert->elements, order);
+}
+
+/* **********************************************************************
+ * Reverse Cuthill-McKee ordering
+ * ********************************************************************** */
+
+/** Vertex adjacency graph in compressed row form */
+typedef struct {
+    int nv;
+    int *ptr; // Neighbors of vertex i are adj[ptr[i]] ... adj[ptr[i]+deg[i]-1]
+    int *deg;
+    int *adj;
+} meshreordergraph;
+
+static int meshreorder_cmpint(const void *a, const void *b) {
+    return *(int *) a - *(int *) b;
+}
+
+static void meshreorder_freegraph(meshreordergraph *graph) {
+    if (graph->ptr) MORPHO_FREE(graph->ptr);
+    if (graph->deg) MORPHO_FREE(graph->deg);
+    if (graph->adj) MORPHO_FREE(graph->adj);
+}
+
+/** Builds the graph in which two vertices are adjacent if they share an element of any grade */
+static bool meshreorder_graph(objectmesh *mesh, meshreordergraph *graph) {
+    int nv=mesh_nvertices(mesh);
+    graph->nv=nv;
+    graph->ptr=MORPHO_MALLOC(sizeof(int)*(nv+1));
+    graph->deg=MORPHO_MALLOC(sizeof(int)*nv);
+    graph->adj=NULL;
+    if (!graph->ptr || !graph->deg) return false;
+
+    for (int i=0; i<nv; i++) graph->deg[i]=0;
+
+    /* Count the (possibly repeated) neighbors of each vertex */
+    for (grade g=1; g<=mesh->dim; g++) {
+        objectsparse *conn=mesh_getconnectivityelement(mesh, 0, g);
+        if (!conn || !sparse_checkformat(conn, SPARSE_CCS, true, false)) continue;
+        for (int j=0; j<conn->ccs.ncols; j++) {
+            int n=conn->ccs.cptr[j+1]-conn->ccs.cptr[j];
+            for (int k=conn->ccs.cptr[j]; k<conn->ccs.cptr[j+1]; k++) graph->deg[conn->ccs.rix[k]]+=n-1;
+        }
+    }
+
+    graph->ptr[0]=0;
+    for (int i=0; i<nv; i++) graph->ptr[i+1]=graph->ptr[i]+graph->deg[i];
+    if (graph->ptr[nv]>0) {
+        graph->adj=MORPHO_MALLOC(sizeof(int)*graph->ptr[nv]);
+        if (!graph->adj) return false;
+    }
+
+    /* Fill in the neighbors */
+    for (int i=0; i<nv; i++) graph->deg[i]=0;
+    for (grade g=1; g<=mesh->dim; g++) {
+        objectsparse *conn=mesh_getconnectivityelement(mesh, 0, g);
+        if (!conn || !conn->ccs.cptr) continue;
+        for (int j=0; j<conn->ccs.ncols; j++) {
+            for (int k=conn->ccs.cptr[j]; k<conn->ccs.cptr[j+1]; k++) {
+                int u=conn->ccs.rix[k];
+                for (int l=conn->ccs.cptr[j]; l<conn->ccs.cptr[j+1]; l++) {
+                    if (l!=k) graph->adj[graph->ptr[u]+graph->deg[u]++]=conn->ccs.rix[l];
+                }
+            }
+        }
+    }
+
+    /* Remove duplicates */
+    for (int i=0; i<nv; i++) {
+        int *a=graph->adj+graph->ptr[i], n=0;
+        qsort(a, graph->deg[i], sizeof(int), meshreorder_cmpint);
+        for (int k=0; k<graph->deg[i]; k++) if (n==0 || a[k]!=a[n-1]) a[n++]=a[k];
+        graph->deg[i]=n;
+    }
+
+    return true;
+}
+
+/** Breadth first search from root that visits its whole component.
+ *  @param[out] queue - vertices in the order visited
+ *  @param[out] count - number of vertices visited
+ *  @param[out] last - index in queue of the first vertex of the last level
+ *  @returns the number of levels */
+static int meshreorder_bfs(meshreordergraph *graph, int root, int *mark, int stamp, int *queue, int *count, int *last) {
+    int head=0, n=0, nlevels=0;
+    queue[n++]=root; mark[root]=stamp;
+
+    while (head<n) {
+        int end=n; // The current level occupies queue[head...end)
+        *last=head;
+        nlevels++;
+        for (; head<end; head++) {
+            int u=queue[head];
+            for (int k=0; k<graph->deg[u]; k++) {
+                int w=graph->adj[graph->ptr[u]+k];
+                if (mark[w]!=stamp) { mark[w]=stamp; queue[n++]=w; }
+            }
+        }
+    }
+
+    *count=n;
+    return nlevels;
+}
+
+/** Finds a pseudo-peripheral vertex in the component of start [George & Liu, SIAM J. Numer. Anal. 16, 1979] */
+static int meshreorder_peripheral(meshreordergraph *graph, int start, int *mark, int *stamp, int *queue) {
+    int root=start, count, last;
+    int nlevels=meshreorder_bfs(graph, root, mark, ++(*stamp), queue, &count, &last);
+
+    for (int iter=0; iter<8; iter++) {
+        /* Choose the vertex of lowest degree in the last level */
+        int c=queue[last];
+        for (int k=last+1; k<count; k++) if (graph->deg[queue[k]]<graph->deg[c]) c=queue[k];
+
+        int n=meshreorder_bfs(graph, c, mark, ++(*stamp), queue, &count, &last);
+        if (n<=nlevels) break;
+        root=c; nlevels=n;
+    }
+
+    return root;
+}
+
+/** Orders vertices by reverse Cuthill-McKee */
+static bool meshreorder_rcm(objectmesh *mesh, int *order) {
+    int nv=mesh_nvertices(mesh), n=0, stamp=0;
+    meshreordergraph graph = { .nv=nv, .ptr=NULL, .deg=NULL, .adj=NULL };
+    bool success=false;
+
+    int *mark=MORPHO_MALLOC(sizeof(int)*nv);
+    int *queue=MORPHO_MALLOC(sizeof(int)*nv);
+    bool *visited=MORPHO_MALLOC(sizeof(bool)*nv);
+    meshreorderkey *bydegree=MORPHO_MALLOC(sizeof(meshreorderkey)*nv);
+
+    if (!mark || !queue || !visited || !bydegree || !meshreorder_graph(mesh, &graph)) goto meshreorder_rcm_cleanup;
+
+    for (int i=0; i<nv; i++) {
+        mark[i]=0; visited[i]=false;
+        bydegree[i].key=graph.deg[i];
+        bydegree[i].id=i;
+    }
+    qsort(bydegree, nv, sizeof(meshreorderkey), meshreorder_cmpkey);
+
+    /* Number each component in turn, starting from the unvisited vertex of lowest degree */
+    for (int s=0; s<nv; s++) {
+        if (visited[bydegree[s].id]) continue;
+        int root=meshreorder_peripheral(&graph, bydegree[s].id, mark, &stamp, queue);
+
+        int head=n;
+        order[n++]=root; visited[root]=true;
+        while (head<n) {
+            int u=order[head++], first=n;
+            for (int k=0; k<graph.deg[u]; k++) {
+                int w=graph.adj[graph.ptr[u]+k];
+                if (!visited[w]) { visited[w]=true; order[n++]=w; }
+            }
+
+            /* Visit the new neighbors in order of increasing degree */
+            for (int i=first+1; i<n; i++) {
+                int w=order[i], j=i;
+                while (j>first && graph.deg[order[j-1]]>graph.deg[w]) { order[j]=order[j-1]; j--; }
+                order[j]=w;
+            }
+        }
+    }
+
+    /* Reverse */
+    for (int i=0; i<nv/2; i++) {
+        int t=order[i]; order[i]=order[nv-1-i]; order[nv-1-i]=t;
+    }
+    success=true;
+
+meshreorder_rcm_cleanup:
+    meshreorder_freegraph(&graph);
+    if (mark) MORPHO_FREE(mark);
+    if (queue) MORPHO_FREE(queue);
+    if (visited) MORPHO_FREE(visited);
+    if (bydegree) MORPHO_FREE(bydegree);
+    return success;
+}
+
+/* **********************************************************************
+ * Renumbering the mesh
+ * ********************************************************************** */
+
+/** Elements are sorted by their renumbered vertex ids, smallest first */
+typedef struct {
+    int n;
+    int v[MESH_GRADE_VOLUME+1];
+    int id;
+} meshreorderelement;
+
+static int meshreorder_cmpelement(const void *a, const void *b) {
+    const meshreorderelement *x=a, *y=b;
+    for (int k=0; k<x->n && k<y->n; k++) if (x->v[k]!=y->v[k]) return x->v[k]-y->v[k];
+    if (x->n!=y->n) return x->n-y->n;
+    return x->id-y->id;
+}
+
+/** Converts an ordering into a permutation, perm[old id] = new id */
+static bool meshreorder_setperm(int n, int *order, varray_elementid *perm) {
+    perm->count=0;
+    if (n>0 && !varray_elementidresize(perm, n)) return false;
+    for (int i=0; i<n; i++) perm->data[order[i]]=i;
+    perm->count=n;
+    return true;
+}
+
+/** Renumbers the vertices of a grade g connectivity matrix and sorts its elements */
+static bool meshreorder_connectivity(objectmesh *mesh, grade g, varray_elementid *vperm, varray_elementid *perm) {
+    objectsparse *conn=mesh_getconnectivityelement(mesh, 0, g);
+    if (!conn || !sparse_checkformat(conn, SPARSE_CCS, true, false)) return true;
+    sparseccs *ccs=&conn->ccs;
+    int nel=ccs->ncols;
+    bool success=false;
+
+    meshreorderelement *els=MORPHO_MALLOC(sizeof(meshreorderelement)*(nel>0 ? nel : 1));
+    int *order=MORPHO_MALLOC(sizeof(int)*(nel>0 ? nel : 1));
+    objectsparse *new=object_newsparse(NULL, NULL);
+    if (!els || !order || !new) goto meshreorder_connectivity_cleanup;
+
+    for (int j=0; j<nel; j++) {
+        els[j].n=0; els[j].id=j;
+        for (int k=ccs->cptr[j]; k<ccs->cptr[j+1] && els[j].n<=MESH_GRADE_VOLUME; k++) {
+            int v=vperm->data[ccs->rix[k]], l=els[j].n++;
+            while (l>0 && els[j].v[l-1]>v) { els[j].v[l]=els[j].v[l-1]; l--; }
+            els[j].v[l]=v;
+        }
+    }
+
+    qsort(els, nel, sizeof(meshreorderelement), meshreorder_cmpelement);
+    for (int j=0; j<nel; j++) order[j]=els[j].id;
+    if (!meshreorder_setperm(nel, order, perm)) goto meshreorder_connectivity_cleanup;
+
+    /* Build the new connectivity matrix with sorted row indices */
+    if (!sparseccs_resize(&new->ccs, ccs->nrows, nel, ccs->nentries, false)) goto meshreorder_connectivity_cleanup;
+    new->ccs.cptr[0]=0;
+    for (int j=0; j<nel; j++) {
+        int old=order[j], n=ccs->cptr[old+1]-ccs->cptr[old];
+        int *rix=new->ccs.rix+new->ccs.cptr[j];
+        for (int k=0; k<n; k++) rix[k]=vperm->data[ccs->rix[ccs->cptr[old]+k]];
+        qsort(rix, n, sizeof(int), meshreorder_cmpint);
+        new->ccs.cptr[j+1]=new->ccs.cptr[j]+n;
+    }
+
+    mesh_setconnectivityelement(mesh, 0, g, new);
+    new=NULL;
+    success=true;
+
+meshreorder_connectivity_cleanup:
+    if (els) MORPHO_FREE(els);
+    if (order) MORPHO_FREE(order);
+    if (new) object_free((object *) new);
+    return success;
+}
+
+/** Renumbers the vertices in the symmetry matrix */
+static bool meshreorder_symmetry(objectmesh *mesh, varray_elementid *vperm) {
+    objectsparse *sym=mesh_getconnectivityelement(mesh, 0, 0);
+    if (!sym) return true;
+
+    varray_int ij;
+    varray_value vals;
+    varray_intinit(&ij);
+    varray_valueinit(&vals);
+
+    int i, j;
+    void *ctr=sparsedok_loopstart(&sym->dok);
+    while (sparsedok_loop(&sym->dok, &ctr, &i, &j)) {
+        value val=MORPHO_NIL;
+        sparsedok_get(&sym->dok, i, j, &val);
+        varray_intwrite(&ij, vperm->data[i]);
+        varray_intwrite(&ij, vperm->data[j]);
+        varray_valuewrite(&vals, val);
+    }
+
+    int nrows=sym->dok.nrows, ncols=sym->dok.ncols;
+    sparsedok_clear(&sym->dok);
+    sparsedok_init(&sym->dok);
+    sparsedok_setdimensions(&sym->dok, nrows, ncols);
+    sparseccs_clear(&sym->ccs);
+    meshadjacency_invalidate(mesh);
+
+    bool success=true;
+    for (unsigned int k=0; k<vals.count; k++) {
+        if (!sparsedok_insert(&sym->dok, ij.data[2*k], ij.data[2*k+1], vals.data[k])) success=false;
+    }
+
+    varray_intclear(&ij);
+    varray_valueclear(&vals);
+    return success;
+}
+
+/** Renumbers the vertices and elements of a mesh.
+ * @param[in] mesh - the mesh to reorder
+ * @param[in] method - ordering to use for the vertices
+ * @param[out] perm - an array of mesh->dim+1 initialized varrays; on return perm[g].data[old id] is the new id of each element of grade g
+ * @returns true on success */
+bool meshreorder_reorder(objectmesh *mesh, meshreordermethod method, varray_elementid *perm) {
+    int nv=mesh_nvertices(mesh);
+    for (grade g=0; g<=mesh->dim; g++) perm[g].count=0;
+    if (nv==0) return true;
+
+    int *order=MORPHO_MALLOC(sizeof(int)*nv);
+    double *vcopy=MORPHO_MALLOC(sizeof(double)*nv*mesh->dim);
+    bool success=false;
+    if (!order || !vcopy) goto meshreorder_reorder_cleanup;
+
+    if (!(method==MESHREORDER_RCM ? meshreorder_rcm(mesh, order) : meshreorder_hilbert(mesh, order)) ||
+        !meshreorder_setperm(nv, order, &perm[MESH_GRADE_VERTEX])) goto meshreorder_reorder_cleanup;
+
+    /* Permute the columns of the vertex matrix */
+    int dim=mesh->dim;
+    memcpy(vcopy, mesh->vert->elements, sizeof(double)*nv*dim);
+    for (int i=0; i<nv; i++) {
+        memcpy(mesh->vert->elements+perm[0].data[i]*dim, vcopy+i*dim, sizeof(double)*dim);
+    }
+
+    /* Derived connectivity is regenerated on demand from the renumbered grade 0 rows */
+    mesh_resetconnectivity(mesh);
+
+    for (grade g=1; g<=mesh->dim; g++) {
+        if (!meshreorder_connectivity(mesh, g, &perm[MESH_GRADE_VERTEX], &perm[g])) goto meshreorder_reorder_cleanup;
+    }
+    if (!meshreorder_symmetry(mesh, &perm[MESH_GRADE_VERTEX])) goto meshreorder_reorder_cleanup;
+
+    for (grade g=0; g<=mesh->dim && g<=MESH_GRADE_VOLUME; g++) meshindex_invalidate(mesh, g);
+    success=true;
+
+meshreorder_reorder_cleanup:
+    if (order) MORPHO_FREE(order);
+    if (vcopy) MORPHO_FREE(vcopy);
+    return success;
+}
+
+/* **********************************************************************
+ * Remapping objects attached to a mesh
+ * ********************************************************************** */
+
+/** Moves the data in a field to follow its elements */
+static bool meshreorder_remapfield(objectfield *field, varray_elementid *perm) {
+    for (grade g=0; g<field->ngrades; g++) {
+        unsigned int nel=perm[g].count, block=field->dof[g]*field->psize;
+        if (!block || !nel || field->offset[g]+nel*field->dof[g]>field->nelements) continue;
+
+        double *data=field->data.elements+field->offset[g]*field->psize;
+        double *copy=MORPHO_MALLOC(sizeof(double)*nel*block);
+        if (!copy) return false;
+        memcpy(copy, data, sizeof(double)*nel*block);
+
+        for (unsigned int i=0; i<nel; i++) {
+            memcpy(data+perm[g].data[i]*block, copy+i*block, sizeof(double)*block);
+        }
+        MORPHO_FREE(copy);
+    }
+    return true;
+}
+
+/** Renumbers the elements in a selection */
+static bool meshreorder_remapselection(objectselection *sel, varray_elementid *perm) {
+    for (grade g=0; g<sel->ngrades; g++) {
+        dictionary *dict=&sel->selected[g], new;
+        if (!dict->count || !perm[g].count) continue;
+        dictionary_init(&new);
+
+        for (unsigned int k=0; k<dict->capacity; k++) {
+            value key=dict->contents[k].key;
+            if (MORPHO_ISINTEGER(key)) {
+                int id=MORPHO_GETINTEGERVALUE(key);
+                if (id>=0 && id<perm[g].count) key=MORPHO_INTEGER(perm[g].data[id]);
+                if (!dictionary_insert(&new, key, dict->contents[k].val)) {
+                    dictionary_clear(&new);
+                    return false;
+                }
+            }
+        }
+
+        dictionary_clear(dict);
+        *dict=new;
+    }
+    return true;
+}
+
+/** Updates a Field or Selection to follow a reordering of its mesh
+ * @param[in] mesh - the mesh that was reordered
+ * @param[in] obj - Field or Selection that refers to mesh
+ * @param[in] perm - permutations returned by meshreorder_reorder
+ * @returns true on success, false if obj is not a Field or Selection on mesh */
+bool meshreorder_remap(objectmesh *mesh, value obj, varray_elementid *perm) {
+    if (MORPHO_ISFIELD(obj) && MORPHO_GETFIELD(obj)->mesh==mesh) {
+        return meshreorder_remapfield(MORPHO_GETFIELD(obj), perm);
+    } else if (MORPHO_ISSELECTION(obj) && MORPHO_GETSELECTION(obj)->mesh==mesh) {
+        return meshreorder_remapselection(MORPHO_GETSELECTION(obj), perm);
+    }
+    return false;
+}
@@ -0,0 +1,41 @@
+/** @file meshreorder.h
+ *  @author T J Atherton
+ *
+ *  @brief Renumbering of mesh vertices and elements to improve memory locality
+ */
+
+#ifndef meshreorder_h
+#define meshreorder_h
+
+#include "mesh.h"
+
+/* -------------------------------------------------------
+ * Reordering
+ * ------------------------------------------------------- */
+
+/** Meshes produced by generators, refinement or merging often number vertices and elements in an order
+    unrelated to their position, so that neighboring elements refer to vertices that are far apart in memory.
+    Reordering renumbers the vertices along a space-filling (Hilbert) curve, or by reverse Cuthill-McKee (RCM)
+    which minimizes the bandwidth of the vertex adjacency graph, and then sorts the elements of each grade by their
+    renumbered vertices so that loops over elements sweep through the vertex matrix nearly sequentially. */
+
+typedef enum {
+    MESHREORDER_HILBERT,
+    MESHREORDER_RCM
+} meshreordermethod;
+
+#define MESHREORDER_HILBERTLABEL "hilbert"
+#define MESHREORDER_RCMLABEL     "rcm"
+
+/** Number of bits per coordinate used to quantize positions onto the Hilbert curve */
+#define MESHREORDER_HILBERTBITS(dim) ((dim)>1 ? 63/(dim) : 32)
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+bool meshreorder_reorder(objectmesh *mesh, meshreordermethod method, varray_elementid *perm);
+bool meshreorder_remap(objectmesh *mesh, value obj, varray_elementid *perm);
+bool meshreorder_hilbertorder(int dim, int n, double *x, int *order);
+
+#endif /* meshreorder_h */
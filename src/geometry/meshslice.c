@@ -0,0 +1,505 @@
+/** @file meshslice.c
+ *  @author T J Atherton
+ *
+ *  @brief Slicing of meshes along a plane
+ */
+
+#include <string.h>
+
+#include "morpho.h"
+#include "classes.h"
+#include "meshslice.h"
+#include "meshindex.h"
+#include "field.h"
+#include "selection.h"
+
+/* **********************************************************************
+ * Slicer data structure
+ * ********************************************************************** */
+
+typedef struct {
+    objectmesh *mesh;
+    int nv, dim, maxg;
+    double *x;
+    double *x0, *n; // The plane
+    objectsparse *conn[MESH_GRADE_VOLUME+1];
+
+    double *dist; // Signed distance of each vertex from the plane, scaled by the length of the normal
+    signed char *side; // Side of the plane each vertex lies on: -1, 0 or 1
+    varray_elementid sliced[MESH_GRADE_VOLUME+1]; // Elements of each grade that cross the plane
+
+    int npoints; // Number of vertices in the slice
+    elementid *points; // Pair of old vertices for each vertex of the slice
+    int *pptr; // Slice vertices whose lower support vertex is a are pvert[pptr[a]] ... pvert[pptr[a+1]-1]
+    elementid *pvert;
+
+    varray_elementid elements[MESH_GRADE_VOLUME]; // Elements of the slice, by grade
+    varray_elementid facets[MESH_GRADE_VOLUME]; // Facets lying in the plane, by grade, which may be shared by neighbours
+    varray_elementid facetparent[MESH_GRADE_VOLUME]; // Element each facet was found from
+} meshslicer;
+
+static void meshslice_freeslicer(meshslicer *s) {
+    if (s->dist) MORPHO_FREE(s->dist);
+    if (s->side) MORPHO_FREE(s->side);
+    if (s->points) MORPHO_FREE(s->points);
+    if (s->pptr) MORPHO_FREE(s->pptr);
+    if (s->pvert) MORPHO_FREE(s->pvert);
+    for (grade g=0; g<=MESH_GRADE_VOLUME; g++) varray_elementidclear(&s->sliced[g]);
+    for (grade g=0; g<MESH_GRADE_VOLUME; g++) {
+        varray_elementidclear(&s->elements[g]);
+        varray_elementidclear(&s->facets[g]);
+        varray_elementidclear(&s->facetparent[g]);
+    }
+}
+
+/* **********************************************************************
+ * Classifying vertices and elements
+ * ********************************************************************** */
+
+typedef struct {
+    meshslicer *s;
+    int start, end;
+} meshslicetask;
+
+/** Computes the signed distance of a range of vertices from the plane */
+static bool meshslice_classifytask(void *arg) {
+    meshslicetask *task=(meshslicetask *) arg;
+    meshslicer *s=task->s;
+    for (int i=task->start; i<task->end; i++) {
+        double d=0.0;
+        for (int k=0; k<s->dim; k++) d+=s->n[k]*(s->x[i*s->dim+k]-s->x0[k]);
+        s->dist[i]=d;
+        s->side[i]=(d>0.0)-(d<0.0);
+    }
+    return true;
+}
+
+static bool meshslice_classify(meshslicer *s) {
+    s->dist=MORPHO_MALLOC(sizeof(double)*(s->nv>0 ? s->nv : 1));
+    s->side=MORPHO_MALLOC(sizeof(signed char)*(s->nv>0 ? s->nv : 1));
+    if (!s->dist || !s->side) return false;
+
+    int ntasks=mesh_ntasks(((size_t) s->nv)*s->dim);
+    meshslicetask tasks[ntasks];
+    for (int i=0; i<ntasks; i++) {
+        tasks[i] = (meshslicetask) { .s=s, .start=(int) (((long) s->nv*i)/ntasks), .end=(int) (((long) s->nv*(i+1))/ntasks) };
+    }
+    return mesh_runtasks(ntasks, meshslice_classifytask, tasks, sizeof(meshslicetask));
+}
+
+/** Tests whether an element meets the plane in an element of one lower grade: either it has vertices strictly on
+    both sides of the plane, or all but one of its vertices lie in the plane so that one of its facets does */
+static bool meshslice_crosses(meshslicer *s, int nel, elementid *vids) {
+    bool plus=false, minus=false;
+    int nzero=0;
+    for (int i=0; i<nel; i++) {
+        if (s->side[vids[i]]>0) plus=true;
+        if (s->side[vids[i]]<0) minus=true;
+        if (s->side[vids[i]]==0) nzero++;
+    }
+    return (plus && minus) || (nel>1 && nzero==nel-1);
+}
+
+/** Finds the elements of each grade that cross the plane, using the spatial index to cull those far from it.
+    meshindex_plane refits the index first if vertices have moved since it was last used. */
+static bool meshslice_findelements(meshslicer *s) {
+    varray_elementid candidates;
+    varray_elementidinit(&candidates);
+
+    for (grade g=1; g<=s->maxg; g++) {
+        if (!s->conn[g]) continue;
+        sparseccs *ccs=&s->conn[g]->ccs;
+
+        if (!meshindex_plane(s->mesh, g, s->x0, s->n, &candidates)) { // Fall back to testing every element
+            candidates.count=0;
+            for (elementid id=0; id<ccs->ncols; id++) varray_elementidwrite(&candidates, id);
+        }
+
+        for (int i=0; i<candidates.count; i++) {
+            elementid id=candidates.data[i];
+            if (meshslice_crosses(s, ccs->cptr[id+1]-ccs->cptr[id], ccs->rix+ccs->cptr[id]) &&
+                !varray_elementidadd(&s->sliced[g], &id, 1)) {
+                varray_elementidclear(&candidates);
+                return false;
+            }
+        }
+    }
+
+    varray_elementidclear(&candidates);
+    return true;
+}
+
+/* **********************************************************************
+ * Vertices of the slice
+ * ********************************************************************** */
+
+/** Finds the points where an element meets the plane, as pairs of vertices in ascending order; a vertex that lies
+    in the plane is represented by a pair of itself. Returns the number of points. */
+static int meshslice_elementpoints(meshslicer *s, int nel, elementid *vids, elementid *out) {
+    int n=0;
+    for (int i=0; i<nel; i++) {
+        if (s->side[vids[i]]==0) { out[2*n]=out[2*n+1]=vids[i]; n++; continue; }
+        for (int j=i+1; j<nel; j++) {
+            if (s->side[vids[i]]*s->side[vids[j]]>=0) continue;
+            out[2*n]=vids[i]; out[2*n+1]=vids[j];
+            mesh_sorttuple(2, out+2*n);
+            n++;
+        }
+    }
+    return n;
+}
+
+/** Numbers the vertices of the slice in the order they are first met, and indexes them by lower support vertex */
+static bool meshslice_numberpoints(meshslicer *s) {
+    varray_elementid pairs;
+    varray_elementidinit(&pairs);
+    char *isnew=NULL;
+    bool success=false;
+
+    for (grade g=1; g<=s->maxg; g++) {
+        if (!s->conn[g]) continue;
+        sparseccs *ccs=&s->conn[g]->ccs;
+        for (int i=0; i<s->sliced[g].count; i++) {
+            elementid id=s->sliced[g].data[i], pts[2*MESH_GRADE_VOLUME*MESH_GRADE_VOLUME];
+            int nel=ccs->cptr[id+1]-ccs->cptr[id];
+            if (nel>MESH_GRADE_VOLUME+1) continue;
+            int npts=meshslice_elementpoints(s, nel, ccs->rix+ccs->cptr[id], pts);
+            if (!varray_elementidadd(&pairs, pts, 2*npts)) goto meshslice_numberpoints_cleanup;
+        }
+    }
+
+    int npairs=pairs.count/2;
+    isnew=MORPHO_MALLOC(sizeof(char)*(npairs>0 ? npairs : 1));
+    if (!isnew || (npairs>0 && !mesh_uniquetuples(2, npairs, pairs.data, isnew))) goto meshslice_numberpoints_cleanup;
+
+    s->npoints=0;
+    for (int i=0; i<npairs; i++) if (isnew[i]) s->npoints++;
+    s->points=MORPHO_MALLOC(sizeof(elementid)*2*(s->npoints>0 ? s->npoints : 1));
+    s->pptr=MORPHO_MALLOC(sizeof(int)*(s->nv+1));
+    s->pvert=MORPHO_MALLOC(sizeof(elementid)*(s->npoints>0 ? s->npoints : 1));
+    if (!s->points || !s->pptr || !s->pvert) goto meshslice_numberpoints_cleanup;
+
+    for (int i=0, k=0; i<npairs; i++) if (isnew[i]) {
+        s->points[2*k]=pairs.data[2*i];
+        s->points[2*k+1]=pairs.data[2*i+1];
+        k++;
+    }
+
+    for (int i=0; i<=s->nv; i++) s->pptr[i]=0;
+    for (int k=0; k<s->npoints; k++) s->pptr[s->points[2*k]+1]++;
+    for (int i=0; i<s->nv; i++) s->pptr[i+1]+=s->pptr[i];
+    for (int k=0; k<s->npoints; k++) s->pvert[s->pptr[s->points[2*k]]++]=k;
+    for (int i=s->nv; i>0; i--) s->pptr[i]=s->pptr[i-1];
+    s->pptr[0]=0;
+    success=true;
+
+meshslice_numberpoints_cleanup:
+    if (isnew) MORPHO_FREE(isnew);
+    varray_elementidclear(&pairs);
+    return success;
+}
+
+/** Finds the vertex of the slice that lies between a pair of old vertices in ascending order */
+static elementid meshslice_findpoint(meshslicer *s, elementid a, elementid b) {
+    for (int i=s->pptr[a]; i<s->pptr[a+1]; i++) {
+        elementid k=s->pvert[i];
+        if (s->points[2*k+1]==b) return k;
+    }
+    return -1;
+}
+
+/** Fraction of the distance along a pair of vertices at which it meets the plane */
+static double meshslice_weight(meshslicer *s, elementid a, elementid b) {
+    if (a==b) return 0.0;
+    return s->dist[a]/(s->dist[a]-s->dist[b]);
+}
+
+/* **********************************************************************
+ * Elements of the slice
+ * ********************************************************************** */
+
+static double meshslice_dist2(meshslicer *s, elementid *p, elementid *q) {
+    double d=0.0, up=meshslice_weight(s, p[0], p[1]), uq=meshslice_weight(s, q[0], q[1]);
+    for (int k=0; k<s->dim; k++) {
+        double xp=(1-up)*s->x[p[0]*s->dim+k]+up*s->x[p[1]*s->dim+k];
+        double xq=(1-uq)*s->x[q[0]*s->dim+k]+uq*s->x[q[1]*s->dim+k];
+        d+=(xp-xq)*(xp-xq);
+    }
+    return d;
+}
+
+/** Adds an element to the slice, recording the element it came from */
+static bool meshslice_addelement(meshslicer *s, meshslicing *slice, grade g, elementid *el, elementid parent) {
+    return varray_elementidadd(&s->elements[g], el, g+1) && varray_elementidadd(&slice->parent[g], &parent, 1);
+}
+
+/** Creates the elements of the slice that come from an element of grade g */
+static bool meshslice_element(meshslicer *s, meshslicing *slice, grade g, elementid id) {
+    sparseccs *ccs=&s->conn[g]->ccs;
+    int nel=ccs->cptr[id+1]-ccs->cptr[id];
+    elementid pts[2*MESH_GRADE_VOLUME*MESH_GRADE_VOLUME], v[MESH_GRADE_VOLUME+1];
+    if (nel!=g+1) return true;
+
+    int npts=meshslice_elementpoints(s, nel, ccs->rix+ccs->cptr[id], pts);
+    for (int i=0; i<npts; i++) v[i]=meshslice_findpoint(s, pts[2*i], pts[2*i+1]);
+
+    if (g==MESH_GRADE_LINE) { // The edge becomes a vertex; a vertex in the plane is kept by the first edge met
+        if (npts==1 && slice->parent[MESH_GRADE_VERTEX].data[v[0]]<0) slice->parent[MESH_GRADE_VERTEX].data[v[0]]=id;
+        return true;
+    }
+
+    if (npts==g) {
+        bool infacet=true;
+        for (int i=0; i<npts; i++) if (pts[2*i]!=pts[2*i+1]) infacet=false;
+        if (!infacet) return meshslice_addelement(s, slice, g-1, v, id);
+
+        /* A facet that lies in the plane is shared with any neighbour on the other side, so is added once both
+           have been seen */
+        mesh_sorttuple(g, v);
+        return varray_elementidadd(&s->facets[g-1], v, g) && varray_elementidadd(&s->facetparent[g-1], &id, 1);
+    }
+
+    if (g==MESH_GRADE_VOLUME && npts==4) {
+        /* The plane separates two vertices of the tetrahedron from the other two, cutting a quadrilateral whose
+           corners are, in cyclic order, on edges ac, ad, bd and bc. These are found in the order ac, ad, bc, bd
+           if a and b lie on one side, so the quadrilateral is divided along its shorter diagonal. */
+        int ac=0, ad=1, bc=2, bd=3;
+        elementid t1[3], t2[3];
+        if (meshslice_dist2(s, pts+2*ac, pts+2*bd)<=meshslice_dist2(s, pts+2*ad, pts+2*bc)) {
+            t1[0]=v[ac]; t1[1]=v[ad]; t1[2]=v[bd];
+            t2[0]=v[ac]; t2[1]=v[bd]; t2[2]=v[bc];
+        } else {
+            t1[0]=v[ad]; t1[1]=v[bd]; t1[2]=v[bc];
+            t2[0]=v[ad]; t2[1]=v[bc]; t2[2]=v[ac];
+        }
+        return meshslice_addelement(s, slice, MESH_GRADE_AREA, t1, id) &&
+               meshslice_addelement(s, slice, MESH_GRADE_AREA, t2, id);
+    }
+
+    return true;
+}
+
+/** Adds the facets lying in the plane to the slice, keeping only the first occurrence of each */
+static bool meshslice_addfacets(meshslicer *s, meshslicing *slice) {
+    for (grade g=1; g<MESH_GRADE_VOLUME; g++) {
+        int n=g+1, nfacets=s->facets[g].count/n;
+        if (!nfacets) continue;
+
+        char *isnew=MORPHO_MALLOC(sizeof(char)*nfacets);
+        bool success=(isnew && mesh_uniquetuples(n, nfacets, s->facets[g].data, isnew));
+        for (int i=0; success && i<nfacets; i++) {
+            if (isnew[i]) success=meshslice_addelement(s, slice, g, s->facets[g].data+i*n, s->facetparent[g].data[i]);
+        }
+        if (isnew) MORPHO_FREE(isnew);
+        if (!success) return false;
+    }
+    return true;
+}
+
+/** Checks that a mesh has the structure of the slice, so that objects can be transferred onto it */
+static bool meshslice_matches(meshslicer *s, objectmesh *onto) {
+    if (onto->dim!=s->dim || mesh_nvertices(onto)!=s->npoints) return false;
+    for (grade g=1; g<MESH_GRADE_VOLUME; g++) {
+        int nel=s->elements[g].count/(g+1);
+        objectsparse *conn=(g<=mesh_maxgrade(onto) ? mesh_getconnectivityelement(onto, 0, g) : NULL);
+        if ((conn ? conn->ccs.ncols : 0)!=nel) return false;
+    }
+    return true;
+}
+
+/** Creates the mesh of the slice */
+static bool meshslice_build(meshslicer *s, meshslicing *slice) {
+    double *x=MORPHO_MALLOC(sizeof(double)*s->dim*(s->npoints>0 ? s->npoints : 1));
+    if (!x) return false;
+    for (int k=0; k<s->npoints; k++) {
+        elementid a=s->points[2*k], b=s->points[2*k+1];
+        double u=slice->weight[k];
+        for (int j=0; j<s->dim; j++) x[k*s->dim+j]=(1-u)*s->x[a*s->dim+j]+u*s->x[b*s->dim+j];
+    }
+    slice->new=object_newmesh(s->dim, s->npoints, x);
+    MORPHO_FREE(x);
+    if (!slice->new || (s->npoints>0 && !slice->new->vert)) return false;
+
+    for (grade g=1; g<MESH_GRADE_VOLUME; g++) {
+        int n=g+1, nel=s->elements[g].count/n;
+        if (!nel) continue;
+
+        objectsparse *new=object_newsparse(NULL, NULL);
+        if (!new || !sparseccs_resize(&new->ccs, s->npoints, nel, nel*n, false)) {
+            if (new) object_free((object *) new);
+            return false;
+        }
+        memcpy(new->ccs.rix, s->elements[g].data, sizeof(elementid)*nel*n);
+        for (int i=0; i<=nel; i++) new->ccs.cptr[i]=i*n;
+        mesh_setconnectivityelement(slice->new, 0, g, new);
+    }
+    mesh_freezeconnectivity(slice->new);
+    return true;
+}
+
+/* **********************************************************************
+ * Slicing
+ * ********************************************************************** */
+
+/** Slices a mesh along a plane
+ * @param[in] mesh - the mesh to slice
+ * @param[in] x0 - a point on the plane
+ * @param[in] n - normal to the plane
+ * @param[in] onto - a mesh previously produced by slicing along the same plane to reuse, or NULL to create one
+ * @param[out] slice - the slice and the relation between its elements and those of the old mesh;
+ *                     call meshslice_clear when finished with it
+ * @returns true on success, false if allocation failed or onto doesn't match the slice */
+bool meshslice_slice(objectmesh *mesh, double *x0, double *n, objectmesh *onto, meshslicing *slice) {
+    meshslicer s = { .mesh=mesh, .nv=mesh_nvertices(mesh), .dim=mesh->dim, .maxg=mesh_maxgrade(mesh), .x0=x0, .n=n };
+    bool success=false;
+
+    slice->old=mesh;
+    slice->new=NULL;
+    slice->weight=NULL;
+    varray_elementidinit(&slice->support);
+    for (grade g=0; g<MESH_GRADE_VOLUME; g++) varray_elementidinit(&slice->parent[g]);
+    for (grade g=0; g<=MESH_GRADE_VOLUME; g++) varray_elementidinit(&s.sliced[g]);
+    for (grade g=0; g<MESH_GRADE_VOLUME; g++) {
+        varray_elementidinit(&s.elements[g]);
+        varray_elementidinit(&s.facets[g]);
+        varray_elementidinit(&s.facetparent[g]);
+    }
+
+    if (s.nv>0) s.x=mesh->vert->elements;
+    if (s.maxg>MESH_GRADE_VOLUME) s.maxg=MESH_GRADE_VOLUME;
+    for (grade g=1; g<=s.maxg; g++) {
+        s.conn[g]=mesh_getconnectivityelement(mesh, 0, g);
+        if (s.conn[g] && !sparse_checkformat(s.conn[g], SPARSE_CCS, true, false)) goto meshslice_slice_cleanup;
+    }
+
+    if (!meshslice_classify(&s) ||
+        !meshslice_findelements(&s) ||
+        !meshslice_numberpoints(&s)) goto meshslice_slice_cleanup;
+
+    /* Record where each vertex of the slice lies */
+    slice->weight=MORPHO_MALLOC(sizeof(double)*(s.npoints>0 ? s.npoints : 1));
+    if (!slice->weight ||
+        (s.npoints>0 && (!varray_elementidadd(&slice->support, s.points, 2*s.npoints) ||
+                         !varray_elementidresize(&slice->parent[MESH_GRADE_VERTEX], s.npoints)))) goto meshslice_slice_cleanup;
+    for (int k=0; k<s.npoints; k++) {
+        slice->weight[k]=meshslice_weight(&s, s.points[2*k], s.points[2*k+1]);
+        slice->parent[MESH_GRADE_VERTEX].data[k]=-1;
+    }
+    slice->parent[MESH_GRADE_VERTEX].count=s.npoints;
+
+    for (grade g=1; g<=s.maxg; g++) {
+        for (int i=0; i<s.sliced[g].count; i++) {
+            if (!meshslice_element(&s, slice, g, s.sliced[g].data[i])) goto meshslice_slice_cleanup;
+        }
+    }
+    if (!meshslice_addfacets(&s, slice)) goto meshslice_slice_cleanup;
+
+    if (onto) {
+        if (!meshslice_matches(&s, onto)) goto meshslice_slice_cleanup;
+        slice->new=onto;
+    } else if (!meshslice_build(&s, slice)) goto meshslice_slice_cleanup;
+    success=true;
+
+meshslice_slice_cleanup:
+    meshslice_freeslicer(&s);
+    if (!success) {
+        if (slice->new && slice->new!=onto) object_free((object *) slice->new);
+        slice->new=NULL;
+        meshslice_clear(slice);
+    }
+    return success;
+}
+
+/** Frees the data structures associated with a slice; the new mesh is not freed */
+void meshslice_clear(meshslicing *slice) {
+    varray_elementidclear(&slice->support);
+    if (slice->weight) MORPHO_FREE(slice->weight);
+    slice->weight=NULL;
+    for (grade g=0; g<MESH_GRADE_VOLUME; g++) varray_elementidclear(&slice->parent[g]);
+}
+
+/* **********************************************************************
+ * Transferring objects to the slice
+ * ********************************************************************** */
+
+/** Creates a field on the slice. Elements of each grade take the value of the element of one higher grade they
+    came from; vertices that don't come from an edge with a value are interpolated linearly, if requested. */
+static objectfield *meshslice_adaptfield(meshslicing *slice, objectfield *field, bool interpolate) {
+    int ngrades=mesh_maxgrade(slice->new)+1;
+    unsigned int dof[ngrades];
+    for (grade h=0; h<ngrades; h++) dof[h]=(h+1<field->ngrades ? field->dof[h+1] : 0);
+    if (field->dof[MESH_GRADE_VERTEX]>dof[MESH_GRADE_VERTEX]) dof[MESH_GRADE_VERTEX]=field->dof[MESH_GRADE_VERTEX];
+
+    objectfield *new=object_newfield(slice->new, field->prototype, dof);
+    if (!new) return NULL;
+    field_zero(new);
+
+    unsigned int psize=field->psize;
+    double *src=field->data.elements, *dest=new->data.elements;
+
+    /* Interpolate values on vertices */
+    unsigned int vblock=field->dof[MESH_GRADE_VERTEX]*psize, nvblock=new->dof[MESH_GRADE_VERTEX]*psize;
+    if (interpolate && vblock) {
+        for (elementid k=0; k<slice->parent[MESH_GRADE_VERTEX].count; k++) {
+            double u=slice->weight[k];
+            double *a=src+(field->offset[0]*psize)+slice->support.data[2*k]*vblock;
+            double *b=src+(field->offset[0]*psize)+slice->support.data[2*k+1]*vblock;
+            for (unsigned int j=0; j<vblock; j++) dest[new->offset[0]*psize+k*nvblock+j]=(1-u)*a[j]+u*b[j];
+        }
+    }
+
+    /* Copy values from elements of one higher grade */
+    for (grade h=0; h<ngrades && h+1<field->ngrades && h<MESH_GRADE_VOLUME; h++) {
+        unsigned int block=field->dof[h+1]*psize, nblock=new->dof[h]*psize;
+        if (!block) continue;
+        for (elementid id=0; id<slice->parent[h].count; id++) {
+            elementid parent=slice->parent[h].data[id];
+            if (parent<0) continue;
+            memcpy(dest+new->offset[h]*psize+id*nblock, src+field->offset[h+1]*psize+parent*block, sizeof(double)*block);
+        }
+    }
+
+    return new;
+}
+
+/** Creates a selection on the slice. A vertex is selected if the vertices it lies between are, and other elements
+    are selected if the element they came from was. */
+static objectselection *meshslice_adaptselection(meshslicing *slice, objectselection *sel) {
+    objectselection *new=object_newselection(slice->new);
+    if (!new) return NULL;
+    if (sel->mode!=SELECT_SOME) { new->mode=sel->mode; return new; }
+
+    for (elementid k=0; k<slice->parent[MESH_GRADE_VERTEX].count; k++) {
+        if (selection_isselected(sel, MESH_GRADE_VERTEX, slice->support.data[2*k]) &&
+            selection_isselected(sel, MESH_GRADE_VERTEX, slice->support.data[2*k+1])) {
+            selection_selectwithid(new, MESH_GRADE_VERTEX, k, true);
+        }
+    }
+
+    for (grade h=1; h<MESH_GRADE_VOLUME && h+1<sel->ngrades && h<new->ngrades; h++) {
+        if (!sel->selected[h+1].count) continue;
+        for (elementid id=0; id<slice->parent[h].count; id++) {
+            elementid parent=slice->parent[h].data[id];
+            if (parent>=0 && selection_isselected(sel, h+1, parent)) selection_selectwithid(new, h, id, true);
+        }
+    }
+
+    return new;
+}
+
+/** Transfers a Field or Selection on the old mesh to the slice
+ * @param[in] slice - the slice
+ * @param[in] obj - the Field or Selection
+ * @param[in] interpolate - whether to interpolate Field values onto vertices
+ * @param[out] out - the new object, which is unbound
+ * @returns true on success, false if obj is not a Field or Selection on the old mesh or allocation failed */
+bool meshslice_adapt(meshslicing *slice, value obj, bool interpolate, value *out) {
+    object *new=NULL;
+    if (MORPHO_ISFIELD(obj) && MORPHO_GETFIELD(obj)->mesh==slice->old) {
+        new=(object *) meshslice_adaptfield(slice, MORPHO_GETFIELD(obj), interpolate);
+    } else if (MORPHO_ISSELECTION(obj) && MORPHO_GETSELECTION(obj)->mesh==slice->old) {
+        new=(object *) meshslice_adaptselection(slice, MORPHO_GETSELECTION(obj));
+    }
+    if (new) *out=MORPHO_OBJECT(new);
+    return new;
+}
@@ -0,0 +1,41 @@
+/** @file meshslice.h
+ *  @author T J Atherton
+ *
+ *  @brief Slicing of meshes along a plane
+ */
+
+#ifndef meshslice_h
+#define meshslice_h
+
+#include "mesh.h"
+
+/* -------------------------------------------------------
+ * Slicing
+ * ------------------------------------------------------- */
+
+/** Slicing intersects each element with a plane, producing an element of one lower grade: edges become vertices,
+    triangles become lines and tetrahedra become triangles, or a pair of triangles where the plane cuts four edges.
+    Vertices are first classified by their signed distance from the plane, and only elements whose bounding boxes
+    meet the plane, found from the mesh's spatial index, are tested further. An element is sliced if it has
+    vertices strictly on both sides of the plane, or if one of its facets lies in the plane; such a facet, which
+    may be shared by elements on either side, becomes a single element of the slice. Each vertex of the slice lies either on an edge that crosses the
+    plane, at the point found by linear interpolation, or on a vertex that lies in the plane. Each new element
+    records the element of the old mesh it came from, so that Fields and Selections can be transferred. */
+
+typedef struct {
+    objectmesh *old; // The mesh that was sliced
+    objectmesh *new; // The slice
+    varray_elementid support; // Pair of old vertices each new vertex lies between; equal for vertices in the plane
+    double *weight; // Fraction of the distance from the first to the second support vertex
+    varray_elementid parent[MESH_GRADE_VOLUME]; // Element of one higher grade in the old mesh each new element came from, or -1
+} meshslicing;
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+bool meshslice_slice(objectmesh *mesh, double *x0, double *n, objectmesh *onto, meshslicing *slice);
+bool meshslice_adapt(meshslicing *slice, value obj, bool interpolate, value *out);
+void meshslice_clear(meshslicing *slice);
+
+#endif /* meshslice_h */
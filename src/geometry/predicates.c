@@ -0,0 +1,351 @@
+/** @file predicates.c
+ *  @author T J Atherton
+ *
+ *  @brief Robust geometric predicates
+ */
+
+#include <math.h>
+#include <float.h>
+
+#include "morpho.h"
+#include "predicates.h"
+
+/* **********************************************************************
+ * Expansion arithmetic
+ * ********************************************************************** */
+
+/** A number is represented exactly as an expansion: a sum of doubles ordered by increasing magnitude whose
+    nonzero bits don't overlap. The most significant component is last and carries the sign. */
+typedef struct {
+    int n;
+    double *x;
+} predexpansion;
+
+/** Expansions are allocated from a pool that is freed once the predicate has been evaluated */
+typedef struct {
+    int count, capacity;
+    double **blocks;
+    bool failed;
+} predpool;
+
+static double *predicates_alloc(predpool *pool, int n) {
+    if (pool->failed) return NULL;
+    if (pool->count>=pool->capacity) {
+        int capacity=(pool->capacity>0 ? 2*pool->capacity : 64);
+        double **blocks=MORPHO_REALLOC(pool->blocks, sizeof(double *)*capacity);
+        if (!blocks) { pool->failed=true; return NULL; }
+        pool->blocks=blocks;
+        pool->capacity=capacity;
+    }
+    double *new=MORPHO_MALLOC(sizeof(double)*(n>0 ? n : 1));
+    if (!new) { pool->failed=true; return NULL; }
+    pool->blocks[pool->count++]=new;
+    return new;
+}
+
+static void predicates_freepool(predpool *pool) {
+    for (int i=0; i<pool->count; i++) MORPHO_FREE(pool->blocks[i]);
+    if (pool->blocks) MORPHO_FREE(pool->blocks);
+}
+
+/** Exact sum a+b=x+y where x is the rounded sum */
+static inline void predicates_twosum(double a, double b, double *x, double *y) {
+    double s=a+b, bv=s-a, av=s-bv;
+    *x=s;
+    *y=(a-av)+(b-bv);
+}
+
+/** Exact sum a+b=x+y for |a|>=|b| */
+static inline void predicates_fasttwosum(double a, double b, double *x, double *y) {
+    double s=a+b;
+    *x=s;
+    *y=b-(s-a);
+}
+
+/** Exact product a*b=x+y where x is the rounded product */
+static inline void predicates_twoproduct(double a, double b, double *x, double *y) {
+    double p=a*b;
+    *x=p;
+    *y=fma(a, b, -p);
+}
+
+/** Exact difference of two doubles */
+static predexpansion predicates_diff(predpool *pool, double a, double b) {
+    predexpansion out = { .n=0, .x=predicates_alloc(pool, 2) };
+    if (!out.x) return out;
+    double x, y;
+    predicates_twosum(a, -b, &x, &y);
+    if (y!=0.0) out.x[out.n++]=y;
+    if (x!=0.0 || out.n==0) out.x[out.n++]=x;
+    return out;
+}
+
+/** Adds a double to an expansion, eliminating zero components */
+static int predicates_grow(int n, double *e, double b, double *h) {
+    double q=b, hh;
+    int k=0;
+    for (int i=0; i<n; i++) {
+        predicates_twosum(q, e[i], &q, &hh);
+        if (hh!=0.0) h[k++]=hh;
+    }
+    if (q!=0.0 || k==0) h[k++]=q;
+    return k;
+}
+
+/** Sum of two expansions */
+static predexpansion predicates_add(predpool *pool, predexpansion a, predexpansion b) {
+    predexpansion out = { .n=0, .x=NULL };
+    double *h0=predicates_alloc(pool, a.n+b.n), *h1=predicates_alloc(pool, a.n+b.n);
+    if (!h0 || !h1 || !a.x || !b.x) return out;
+
+    int n=a.n;
+    for (int i=0; i<n; i++) h0[i]=a.x[i];
+    for (int i=0; i<b.n; i++) {
+        n=predicates_grow(n, h0, b.x[i], h1);
+        double *t=h0; h0=h1; h1=t;
+    }
+
+    out.n=n;
+    out.x=h0;
+    return out;
+}
+
+/** Product of an expansion and a double, eliminating zero components */
+static int predicates_scale(int n, double *e, double b, double *h) {
+    double q, hh, p1, p0, sum;
+    int k=0;
+
+    predicates_twoproduct(e[0], b, &q, &hh);
+    if (hh!=0.0) h[k++]=hh;
+    for (int i=1; i<n; i++) {
+        predicates_twoproduct(e[i], b, &p1, &p0);
+        predicates_twosum(q, p0, &sum, &hh);
+        if (hh!=0.0) h[k++]=hh;
+        predicates_fasttwosum(p1, sum, &q, &hh);
+        if (hh!=0.0) h[k++]=hh;
+    }
+    if (q!=0.0 || k==0) h[k++]=q;
+    return k;
+}
+
+/** Product of two expansions */
+static predexpansion predicates_mul(predpool *pool, predexpansion a, predexpansion b) {
+    predexpansion out = { .n=0, .x=NULL };
+    if (!a.x || !b.x) return out;
+
+    for (int i=0; i<b.n; i++) {
+        predexpansion t = { .n=0, .x=predicates_alloc(pool, 2*a.n) };
+        if (!t.x) return out;
+        t.n=predicates_scale(a.n, a.x, b.x[i], t.x);
+        out=(i==0 ? t : predicates_add(pool, out, t));
+    }
+    return out;
+}
+
+static predexpansion predicates_neg(predpool *pool, predexpansion a) {
+    predexpansion out = { .n=a.n, .x=predicates_alloc(pool, a.n) };
+    if (!out.x || !a.x) return out;
+    for (int i=0; i<a.n; i++) out.x[i]=-a.x[i];
+    return out;
+}
+
+static predexpansion predicates_sub(predpool *pool, predexpansion a, predexpansion b) {
+    return predicates_add(pool, a, predicates_neg(pool, b));
+}
+
+/** a*d - b*c */
+static predexpansion predicates_det2(predpool *pool, predexpansion a, predexpansion b, predexpansion c, predexpansion d) {
+    return predicates_sub(pool, predicates_mul(pool, a, d), predicates_mul(pool, b, c));
+}
+
+/** Finds the sign of an expansion and frees the pool */
+static int predicates_sign(predpool *pool, predexpansion a) {
+    int sign=0;
+    if (!pool->failed && a.x && a.n>0) sign=(a.x[a.n-1]>0.0 ? 1 : (a.x[a.n-1]<0.0 ? -1 : 0));
+    predicates_freepool(pool);
+    return sign;
+}
+
+/* **********************************************************************
+ * Exact predicates
+ * ********************************************************************** */
+
+#define PREDICATES_POOL { .count=0, .capacity=0, .blocks=NULL, .failed=false }
+
+static int predicates_orient2dexact(double *a, double *b, double *c) {
+    predpool pool=PREDICATES_POOL;
+    predexpansion acx=predicates_diff(&pool, a[0], c[0]), acy=predicates_diff(&pool, a[1], c[1]),
+                  bcx=predicates_diff(&pool, b[0], c[0]), bcy=predicates_diff(&pool, b[1], c[1]);
+
+    return predicates_sign(&pool, predicates_det2(&pool, acx, acy, bcx, bcy));
+}
+
+/** Shewchuk's orient3d, which has the opposite sign to predicates_orient3d */
+static int predicates_orient3dexact(double *a, double *b, double *c, double *d) {
+    predpool pool=PREDICATES_POOL;
+    predexpansion ad[3], bd[3], cd[3];
+    for (int k=0; k<3; k++) {
+        ad[k]=predicates_diff(&pool, a[k], d[k]);
+        bd[k]=predicates_diff(&pool, b[k], d[k]);
+        cd[k]=predicates_diff(&pool, c[k], d[k]);
+    }
+
+    predexpansion bc=predicates_det2(&pool, bd[0], bd[1], cd[0], cd[1]), // bdx*cdy - bdy*cdx
+                  ca=predicates_det2(&pool, cd[0], cd[1], ad[0], ad[1]),
+                  ab=predicates_det2(&pool, ad[0], ad[1], bd[0], bd[1]);
+
+    predexpansion det=predicates_add(&pool, predicates_mul(&pool, ad[2], bc), predicates_mul(&pool, bd[2], ca));
+    det=predicates_add(&pool, det, predicates_mul(&pool, cd[2], ab));
+
+    return predicates_sign(&pool, det);
+}
+
+/** Squared length of a vector of n expansions */
+static predexpansion predicates_lift(predpool *pool, int n, predexpansion *x) {
+    predexpansion out=predicates_mul(pool, x[0], x[0]);
+    for (int k=1; k<n; k++) out=predicates_add(pool, out, predicates_mul(pool, x[k], x[k]));
+    return out;
+}
+
+static int predicates_incircleexact(double *a, double *b, double *c, double *d) {
+    predpool pool=PREDICATES_POOL;
+    predexpansion ad[2], bd[2], cd[2];
+    for (int k=0; k<2; k++) {
+        ad[k]=predicates_diff(&pool, a[k], d[k]);
+        bd[k]=predicates_diff(&pool, b[k], d[k]);
+        cd[k]=predicates_diff(&pool, c[k], d[k]);
+    }
+
+    predexpansion alift=predicates_lift(&pool, 2, ad), blift=predicates_lift(&pool, 2, bd), clift=predicates_lift(&pool, 2, cd);
+    predexpansion bc=predicates_det2(&pool, bd[0], bd[1], cd[0], cd[1]),
+                  ca=predicates_det2(&pool, cd[0], cd[1], ad[0], ad[1]),
+                  ab=predicates_det2(&pool, ad[0], ad[1], bd[0], bd[1]);
+
+    predexpansion det=predicates_add(&pool, predicates_mul(&pool, alift, bc), predicates_mul(&pool, blift, ca));
+    det=predicates_add(&pool, det, predicates_mul(&pool, clift, ab));
+
+    return predicates_sign(&pool, det);
+}
+
+/** Shewchuk's insphere, which has the opposite sign to predicates_insphere */
+static int predicates_insphereexact(double *a, double *b, double *c, double *d, double *e) {
+    predpool pool=PREDICATES_POOL;
+    predexpansion ae[3], be[3], ce[3], de[3];
+    for (int k=0; k<3; k++) {
+        ae[k]=predicates_diff(&pool, a[k], e[k]);
+        be[k]=predicates_diff(&pool, b[k], e[k]);
+        ce[k]=predicates_diff(&pool, c[k], e[k]);
+        de[k]=predicates_diff(&pool, d[k], e[k]);
+    }
+
+    predexpansion ab=predicates_det2(&pool, ae[0], ae[1], be[0], be[1]), // aex*bey - aey*bex
+                  bc=predicates_det2(&pool, be[0], be[1], ce[0], ce[1]),
+                  cd=predicates_det2(&pool, ce[0], ce[1], de[0], de[1]),
+                  da=predicates_det2(&pool, de[0], de[1], ae[0], ae[1]),
+                  ac=predicates_det2(&pool, ae[0], ae[1], ce[0], ce[1]),
+                  bd=predicates_det2(&pool, be[0], be[1], de[0], de[1]);
+
+    /* abc = aez*bc - bez*ac + cez*ab etc. */
+    predexpansion abc=predicates_add(&pool, predicates_sub(&pool, predicates_mul(&pool, ae[2], bc), predicates_mul(&pool, be[2], ac)), predicates_mul(&pool, ce[2], ab));
+    predexpansion bcd=predicates_add(&pool, predicates_sub(&pool, predicates_mul(&pool, be[2], cd), predicates_mul(&pool, ce[2], bd)), predicates_mul(&pool, de[2], bc));
+    predexpansion cda=predicates_add(&pool, predicates_add(&pool, predicates_mul(&pool, ce[2], da), predicates_mul(&pool, de[2], ac)), predicates_mul(&pool, ae[2], cd));
+    predexpansion dab=predicates_add(&pool, predicates_add(&pool, predicates_mul(&pool, de[2], ab), predicates_mul(&pool, ae[2], bd)), predicates_mul(&pool, be[2], da));
+
+    predexpansion alift=predicates_lift(&pool, 3, ae), blift=predicates_lift(&pool, 3, be),
+                  clift=predicates_lift(&pool, 3, ce), dlift=predicates_lift(&pool, 3, de);
+
+    predexpansion det=predicates_sub(&pool, predicates_mul(&pool, dlift, abc), predicates_mul(&pool, clift, dab));
+    det=predicates_add(&pool, det, predicates_sub(&pool, predicates_mul(&pool, blift, cda), predicates_mul(&pool, alift, bcd)));
+
+    return predicates_sign(&pool, det);
+}
+
+/* **********************************************************************
+ * Filtered predicates
+ * ********************************************************************** */
+
+#define PREDICATES_EPS (DBL_EPSILON/2)
+#define PREDICATES_SIGN(x) ((x)>0.0 ? 1 : -1)
+
+int predicates_orient2d(double *a, double *b, double *c) {
+    double detleft=(a[0]-c[0])*(b[1]-c[1]), detright=(a[1]-c[1])*(b[0]-c[0]);
+    double det=detleft-detright;
+    double errbound=(3.0+16.0*PREDICATES_EPS)*PREDICATES_EPS*(fabs(detleft)+fabs(detright));
+
+    if (det>errbound || -det>errbound) return PREDICATES_SIGN(det);
+    return predicates_orient2dexact(a, b, c);
+}
+
+int predicates_orient3d(double *a, double *b, double *c, double *d) {
+    double adx=a[0]-d[0], bdx=b[0]-d[0], cdx=c[0]-d[0],
+           ady=a[1]-d[1], bdy=b[1]-d[1], cdy=c[1]-d[1],
+           adz=a[2]-d[2], bdz=b[2]-d[2], cdz=c[2]-d[2];
+    double bdxcdy=bdx*cdy, cdxbdy=cdx*bdy,
+           cdxady=cdx*ady, adxcdy=adx*cdy,
+           adxbdy=adx*bdy, bdxady=bdx*ady;
+
+    double det=adz*(bdxcdy-cdxbdy) + bdz*(cdxady-adxcdy) + cdz*(adxbdy-bdxady);
+    double permanent=(fabs(bdxcdy)+fabs(cdxbdy))*fabs(adz) +
+                     (fabs(cdxady)+fabs(adxcdy))*fabs(bdz) +
+                     (fabs(adxbdy)+fabs(bdxady))*fabs(cdz);
+    double errbound=(7.0+56.0*PREDICATES_EPS)*PREDICATES_EPS*permanent;
+
+    if (det>errbound || -det>errbound) return -PREDICATES_SIGN(det);
+    return -predicates_orient3dexact(a, b, c, d);
+}
+
+int predicates_incircle(double *a, double *b, double *c, double *d) {
+    double adx=a[0]-d[0], bdx=b[0]-d[0], cdx=c[0]-d[0],
+           ady=a[1]-d[1], bdy=b[1]-d[1], cdy=c[1]-d[1];
+    double bdxcdy=bdx*cdy, cdxbdy=cdx*bdy, alift=adx*adx+ady*ady,
+           cdxady=cdx*ady, adxcdy=adx*cdy, blift=bdx*bdx+bdy*bdy,
+           adxbdy=adx*bdy, bdxady=bdx*ady, clift=cdx*cdx+cdy*cdy;
+
+    double det=alift*(bdxcdy-cdxbdy) + blift*(cdxady-adxcdy) + clift*(adxbdy-bdxady);
+    double permanent=(fabs(bdxcdy)+fabs(cdxbdy))*alift +
+                     (fabs(cdxady)+fabs(adxcdy))*blift +
+                     (fabs(adxbdy)+fabs(bdxady))*clift;
+    double errbound=(10.0+96.0*PREDICATES_EPS)*PREDICATES_EPS*permanent;
+
+    if (det>errbound || -det>errbound) return PREDICATES_SIGN(det);
+    return predicates_incircleexact(a, b, c, d);
+}
+
+int predicates_insphere(double *a, double *b, double *c, double *d, double *e) {
+    double aex=a[0]-e[0], bex=b[0]-e[0], cex=c[0]-e[0], dex=d[0]-e[0],
+           aey=a[1]-e[1], bey=b[1]-e[1], cey=c[1]-e[1], dey=d[1]-e[1],
+           aez=a[2]-e[2], bez=b[2]-e[2], cez=c[2]-e[2], dez=d[2]-e[2];
+
+    double aexbey=aex*bey, bexaey=bex*aey, ab=aexbey-bexaey,
+           bexcey=bex*cey, cexbey=cex*bey, bc=bexcey-cexbey,
+           cexdey=cex*dey, dexcey=dex*cey, cd=cexdey-dexcey,
+           dexaey=dex*aey, aexdey=aex*dey, da=dexaey-aexdey,
+           aexcey=aex*cey, cexaey=cex*aey, ac=aexcey-cexaey,
+           bexdey=bex*dey, dexbey=dex*bey, bd=bexdey-dexbey;
+
+    double abc=aez*bc - bez*ac + cez*ab,
+           bcd=bez*cd - cez*bd + dez*bc,
+           cda=cez*da + dez*ac + aez*cd,
+           dab=dez*ab + aez*bd + bez*da;
+
+    double alift=aex*aex + aey*aey + aez*aez,
+           blift=bex*bex + bey*bey + bez*bez,
+           clift=cex*cex + cey*cey + cez*cez,
+           dlift=dex*dex + dey*dey + dez*dez;
+
+    double det=(dlift*abc - clift*dab) + (blift*cda - alift*bcd);
+
+    double aezplus=fabs(aez), bezplus=fabs(bez), cezplus=fabs(cez), dezplus=fabs(dez),
+           aexbeyplus=fabs(aexbey), bexaeyplus=fabs(bexaey), bexceyplus=fabs(bexcey), cexbeyplus=fabs(cexbey),
+           cexdeyplus=fabs(cexdey), dexceyplus=fabs(dexcey), dexaeyplus=fabs(dexaey), aexdeyplus=fabs(aexdey),
+           aexceyplus=fabs(aexcey), cexaeyplus=fabs(cexaey), bexdeyplus=fabs(bexdey), dexbeyplus=fabs(dexbey);
+
+    double permanent=((cexdeyplus + dexceyplus)*bezplus + (dexbeyplus + bexdeyplus)*cezplus + (bexceyplus + cexbeyplus)*dezplus)*alift +
+                     ((dexaeyplus + aexdeyplus)*cezplus + (aexceyplus + cexaeyplus)*dezplus + (cexdeyplus + dexceyplus)*aezplus)*blift +
+                     ((aexbeyplus + bexaeyplus)*dezplus + (bexdeyplus + dexbeyplus)*aezplus + (dexaeyplus + aexdeyplus)*bezplus)*clift +
+                     ((bexceyplus + cexbeyplus)*aezplus + (cexaeyplus + aexceyplus)*bezplus + (aexbeyplus + bexaeyplus)*cezplus)*dlift;
+    double errbound=(16.0+224.0*PREDICATES_EPS)*PREDICATES_EPS*permanent;
+
+    if (det>errbound || -det>errbound) return -PREDICATES_SIGN(det);
+    return -predicates_insphereexact(a, b, c, d, e);
+}
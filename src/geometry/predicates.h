@@ -0,0 +1,35 @@
+/** @file predicates.h
+ *  @author T J Atherton
+ *
+ *  @brief Robust geometric predicates
+ */
+
+#ifndef predicates_h
+#define predicates_h
+
+/* -------------------------------------------------------
+ * Predicates
+ * ------------------------------------------------------- */
+
+/** Orientation and insphere tests decide the combinatorics of a mesh from the sign of a determinant, so roundoff
+    that flips the sign can produce inconsistent or tangled elements. These predicates evaluate the determinant in
+    floating point and check the result against a bound on its rounding error, following J. R. Shewchuk,
+    "Adaptive Precision Floating-Point Arithmetic and Fast Robust Geometric Predicates", Discrete Comput. Geom. 18,
+    305 (1997). In the rare cases the sign is uncertain, the determinant is recomputed exactly using expansion
+    arithmetic. Each predicate returns 1, -1 or 0. */
+
+/** Sign of the orientation of a triangle: positive if a, b, c are counterclockwise */
+int predicates_orient2d(double *a, double *b, double *c);
+
+/** Sign of the orientation of a tetrahedron: positive if d lies on the side of the plane through a, b, c from
+    which they appear counterclockwise, i.e. if (b-a, c-a, d-a) are right-handed */
+int predicates_orient3d(double *a, double *b, double *c, double *d);
+
+/** Positive if d lies inside the circle through a, b, c when these are counterclockwise; zero if cocircular */
+int predicates_incircle(double *a, double *b, double *c, double *d);
+
+/** Positive if e lies inside the sphere through a, b, c, d when predicates_orient3d(a,b,c,d) is positive;
+    zero if cospherical */
+int predicates_insphere(double *a, double *b, double *c, double *d, double *e);
+
+#endif /* predicates_h */
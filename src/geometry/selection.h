@@ -69,6 +69,7 @@ objectselection *object_newselection(objectmesh *mesh);
 
 void selection_clear(objectselection *s);
 
+void selection_selectwithid(objectselection *sel, grade g, elementid id, bool selected);
 bool selection_isselected(objectselection *sel, grade g, elementid id);
 void selection_initialize(void);
 
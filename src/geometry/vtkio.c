@@ -0,0 +1,898 @@
+/** @file vtkio.c
+ *  @author T J Atherton
+ *
+ *  @brief Reading and writing of meshes and fields in the VTK XML unstructured grid format
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <ctype.h>
+#include <sys/mman.h>
+
+#include "morpho.h"
+#include "classes.h"
+#include "file.h"
+#include "matrixio.h"
+#include "vtkio.h"
+
+/** Number of elements of computed arrays written at a time */
+#define VTKIO_CHUNK 1024
+
+static bool vtkio_littleendian(void) {
+    uint16_t x=1;
+    return *((uint8_t *) &x)==1;
+}
+
+/* **********************************************************************
+ * Output streams
+ * ********************************************************************** */
+
+static const char vtkio_base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/** Arrays are written through a stream that either passes bytes straight to the file or base64 encodes them;
+ *  encoding carries over between writes so that an array can be written in pieces */
+typedef struct {
+    FILE *f;
+    bool base64;
+    unsigned char pending[3]; // Bytes not yet encoded
+    int npending;
+} vtkiostream;
+
+/** Encodes up to three bytes as four characters, padding with '=' */
+static void vtkio_encodetriple(const unsigned char *in, int n, char *out) {
+    uint32_t t=((uint32_t) in[0])<<16 | (n>1 ? ((uint32_t) in[1])<<8 : 0) | (n>2 ? in[2] : 0);
+    out[0]=vtkio_base64[(t>>18) & 0x3f];
+    out[1]=vtkio_base64[(t>>12) & 0x3f];
+    out[2]=(n>1 ? vtkio_base64[(t>>6) & 0x3f] : '=');
+    out[3]=(n>2 ? vtkio_base64[t & 0x3f] : '=');
+}
+
+/** Writes n bytes to a stream */
+static bool vtkio_write(vtkiostream *s, const void *data, size_t n) {
+    if (!s->base64) return (n==0 || fwrite(data, 1, n, s->f)==n);
+
+    const unsigned char *p=data;
+    char out[4*VTKIO_CHUNK];
+    size_t nout=0;
+
+    while (n>0) {
+        if (s->npending>0 || n<3) { // Complete a triple from the bytes left over by the previous write
+            s->pending[s->npending++]=*(p++);
+            n--;
+            if (s->npending==3) {
+                vtkio_encodetriple(s->pending, 3, out+nout);
+                nout+=4;
+                s->npending=0;
+            }
+        } else {
+            vtkio_encodetriple(p, 3, out+nout);
+            p+=3; n-=3; nout+=4;
+        }
+
+        if (nout+4>sizeof(out) || n==0) {
+            if (fwrite(out, 1, nout, s->f)!=nout) return false;
+            nout=0;
+        }
+    }
+    return true;
+}
+
+/** Begins an array of n bytes by writing its count */
+static bool vtkio_begin(vtkiostream *s, size_t n) {
+    uint64_t count=n;
+    s->npending=0;
+    return vtkio_write(s, &count, sizeof(count));
+}
+
+/** Ends an array, encoding any remaining bytes */
+static bool vtkio_end(vtkiostream *s) {
+    if (!s->base64 || s->npending==0) return true;
+    char out[4];
+    vtkio_encodetriple(s->pending, s->npending, out);
+    s->npending=0;
+    return fwrite(out, 1, 4, s->f)==4;
+}
+
+/** Size in the file of an array of n bytes, including its count */
+static size_t vtkio_blocksize(bool base64, size_t n) {
+    n+=sizeof(uint64_t);
+    return (base64 ? 4*((n+2)/3) : n);
+}
+
+/* **********************************************************************
+ * Writer
+ * ********************************************************************** */
+
+typedef struct {
+    objectmesh *mesh;
+    int nv;
+    int nfields;
+    objectfield **fields;
+    char **names;
+
+    objectsparse *conn[MESH_GRADE_VOLUME+1]; // Connectivity of each grade written as cells
+    int ncells;
+    size_t nentries;
+} vtkiowriter;
+
+static const int vtkio_celltype[MESH_GRADE_VOLUME+1] = { VTKIO_VERTEX, VTKIO_LINE, VTKIO_TRIANGLE, VTKIO_TETRA };
+
+/** Writes the points, padding them to three dimensions if necessary */
+static bool vtkio_writepoints(vtkiowriter *w, vtkiostream *s) {
+    int dim=w->mesh->dim;
+    size_t n=(size_t) w->nv*3;
+    if (!vtkio_begin(s, n*sizeof(double))) return false;
+
+    if (dim==3) {
+        if (!vtkio_write(s, w->mesh->vert->elements, n*sizeof(double))) return false;
+    } else {
+        double buffer[3*VTKIO_CHUNK];
+        for (int i=0; i<w->nv; i+=VTKIO_CHUNK) {
+            int m=(w->nv-i<VTKIO_CHUNK ? w->nv-i : VTKIO_CHUNK);
+            for (int j=0; j<m; j++) {
+                for (int k=0; k<3; k++) buffer[3*j+k]=(k<dim ? w->mesh->vert->elements[(i+j)*dim+k] : 0.0);
+            }
+            if (!vtkio_write(s, buffer, sizeof(double)*3*m)) return false;
+        }
+    }
+    return vtkio_end(s);
+}
+
+/** Writes the connectivity of the elements of each grade */
+static bool vtkio_writeconnectivity(vtkiowriter *w, vtkiostream *s) {
+    if (!vtkio_begin(s, w->nentries*sizeof(int32_t))) return false;
+    for (grade g=1; g<=MESH_GRADE_VOLUME; g++) {
+        if (!w->conn[g]) continue;
+        sparseccs *ccs=&w->conn[g]->ccs;
+        if (!vtkio_write(s, ccs->rix, sizeof(int32_t)*ccs->cptr[ccs->ncols])) return false;
+    }
+    return vtkio_end(s);
+}
+
+/** Writes the offset of the end of each cell in the connectivity array */
+static bool vtkio_writeoffsets(vtkiowriter *w, vtkiostream *s) {
+    int32_t buffer[VTKIO_CHUNK];
+    int32_t start=0;
+    if (!vtkio_begin(s, (size_t) w->ncells*sizeof(int32_t))) return false;
+    for (grade g=1; g<=MESH_GRADE_VOLUME; g++) {
+        if (!w->conn[g]) continue;
+        sparseccs *ccs=&w->conn[g]->ccs;
+        for (int i=0; i<ccs->ncols; i+=VTKIO_CHUNK) {
+            int m=(ccs->ncols-i<VTKIO_CHUNK ? ccs->ncols-i : VTKIO_CHUNK);
+            for (int j=0; j<m; j++) buffer[j]=start+ccs->cptr[i+j+1];
+            if (!vtkio_write(s, buffer, sizeof(int32_t)*m)) return false;
+        }
+        start+=ccs->cptr[ccs->ncols];
+    }
+    return vtkio_end(s);
+}
+
+/** Writes the type of each cell */
+static bool vtkio_writetypes(vtkiowriter *w, vtkiostream *s) {
+    uint8_t buffer[VTKIO_CHUNK];
+    if (!vtkio_begin(s, (size_t) w->ncells)) return false;
+    for (grade g=1; g<=MESH_GRADE_VOLUME; g++) {
+        if (!w->conn[g]) continue;
+        memset(buffer, vtkio_celltype[g], VTKIO_CHUNK);
+        for (int i=0; i<w->conn[g]->ccs.ncols; i+=VTKIO_CHUNK) {
+            int m=(w->conn[g]->ccs.ncols-i<VTKIO_CHUNK ? w->conn[g]->ccs.ncols-i : VTKIO_CHUNK);
+            if (!vtkio_write(s, buffer, m)) return false;
+        }
+    }
+    return vtkio_end(s);
+}
+
+/** Writes the values of a Field on the vertices, which are stored contiguously at the start of the Field */
+static bool vtkio_writefield(vtkiowriter *w, objectfield *f, vtkiostream *s) {
+    size_t n=(size_t) w->nv*f->psize;
+    return vtkio_begin(s, n*sizeof(double)) &&
+           vtkio_write(s, f->data.elements, n*sizeof(double)) &&
+           vtkio_end(s);
+}
+
+/** Writes a mesh and fields to a file */
+static bool vtkio_save(vtkiowriter *w, FILE *f, bool base64) {
+    vtkiostream s = { .f=f, .base64=base64, .npending=0 };
+    size_t offset=0;
+
+    fprintf(f, "<?xml version=\"1.0\"?>\n");
+    fprintf(f, "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\">\n",
+            (vtkio_littleendian() ? "LittleEndian" : "BigEndian"));
+    fprintf(f, "  <UnstructuredGrid>\n");
+    fprintf(f, "    <Piece NumberOfPoints=\"%i\" NumberOfCells=\"%i\">\n", w->nv, w->ncells);
+
+    if (w->nfields>0) {
+        fprintf(f, "      <PointData>\n");
+        for (int i=0; i<w->nfields; i++) {
+            fprintf(f, "        <DataArray type=\"Float64\" Name=\"%s\" NumberOfComponents=\"%u\" format=\"appended\" offset=\"%zu\"/>\n",
+                    w->names[i], w->fields[i]->psize, offset);
+            offset+=vtkio_blocksize(base64, sizeof(double)*w->nv*w->fields[i]->psize);
+        }
+        fprintf(f, "      </PointData>\n");
+    }
+
+    fprintf(f, "      <Points>\n");
+    fprintf(f, "        <DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"appended\" offset=\"%zu\"/>\n", offset);
+    offset+=vtkio_blocksize(base64, sizeof(double)*3*w->nv);
+    fprintf(f, "      </Points>\n");
+
+    fprintf(f, "      <Cells>\n");
+    fprintf(f, "        <DataArray type=\"Int32\" Name=\"connectivity\" format=\"appended\" offset=\"%zu\"/>\n", offset);
+    offset+=vtkio_blocksize(base64, sizeof(int32_t)*w->nentries);
+    fprintf(f, "        <DataArray type=\"Int32\" Name=\"offsets\" format=\"appended\" offset=\"%zu\"/>\n", offset);
+    offset+=vtkio_blocksize(base64, sizeof(int32_t)*w->ncells);
+    fprintf(f, "        <DataArray type=\"UInt8\" Name=\"types\" format=\"appended\" offset=\"%zu\"/>\n", offset);
+    fprintf(f, "      </Cells>\n");
+
+    fprintf(f, "    </Piece>\n");
+    fprintf(f, "  </UnstructuredGrid>\n");
+    fprintf(f, "  <AppendedData encoding=\"%s\">\n   _", (base64 ? VTKIO_BASE64ENCODING : VTKIO_RAWENCODING));
+
+    for (int i=0; i<w->nfields; i++) if (!vtkio_writefield(w, w->fields[i], &s)) return false;
+    if (!vtkio_writepoints(w, &s) ||
+        !vtkio_writeconnectivity(w, &s) ||
+        !vtkio_writeoffsets(w, &s) ||
+        !vtkio_writetypes(w, &s)) return false;
+
+    fprintf(f, "\n  </AppendedData>\n</VTKFile>\n");
+    return !ferror(f);
+}
+
+/** Collects the elements to be written as cells */
+static bool vtkio_cells(vtkiowriter *w) {
+    w->ncells=0;
+    w->nentries=0;
+    for (grade g=0; g<=MESH_GRADE_VOLUME; g++) w->conn[g]=NULL;
+
+    for (grade g=1; g<=w->mesh->dim && g<=MESH_GRADE_VOLUME; g++) {
+        objectsparse *conn=mesh_getconnectivityelement(w->mesh, 0, g);
+        if (!conn) continue;
+        if (!sparse_checkformat(conn, SPARSE_CCS, true, false)) return false;
+        w->conn[g]=conn;
+        w->ncells+=conn->ccs.ncols;
+        w->nentries+=conn->ccs.cptr[conn->ccs.ncols];
+    }
+    return true;
+}
+
+/** Checks that a field name can be written in an attribute */
+static bool vtkio_checkname(char *name) {
+    if (!*name) return false;
+    for (char *c=name; *c; c++) if (isspace((unsigned char) *c) || strchr("<>&\"'", *c)) return false;
+    return true;
+}
+
+/* **********************************************************************
+ * Reader
+ * ********************************************************************** */
+
+typedef enum { VTKIO_INT8, VTKIO_UINT8, VTKIO_INT16, VTKIO_UINT16, VTKIO_INT32, VTKIO_UINT32,
+               VTKIO_INT64, VTKIO_UINT64, VTKIO_FLOAT32, VTKIO_FLOAT64, VTKIO_NTYPES } vtkiotype;
+
+static const char *vtkio_typenames[VTKIO_NTYPES] = { "Int8", "UInt8", "Int16", "UInt16", "Int32", "UInt32",
+                                                     "Int64", "UInt64", "Float32", "Float64" };
+static const size_t vtkio_typesizes[VTKIO_NTYPES] = { 1, 1, 2, 2, 4, 4, 8, 8, 4, 8 };
+
+typedef enum { VTKIO_NOSECTION, VTKIO_POINTS, VTKIO_CELLS, VTKIO_POINTDATA, VTKIO_OTHERSECTION } vtkiosection;
+
+typedef enum { VTKIO_ASCII, VTKIO_BINARY, VTKIO_APPENDED } vtkioformat;
+
+/** A DataArray described in the header */
+typedef struct {
+    vtkiosection section;
+    const char *name; // Name, not terminated, or NULL
+    size_t namelength;
+    vtkiotype type;
+    int ncomponents;
+    vtkioformat format;
+    size_t offset; // Offset into the appended data
+    const char *start, *end; // Contents of an inline array
+} vtkioarray;
+
+typedef struct {
+    vm *v;
+    char *file;
+    char *base;
+    size_t size;
+
+    size_t headersize; // Size of the block count preceding each array
+    int npoints, ncells;
+    bool haspiece;
+
+    vtkioarray *arrays;
+    int narrays;
+
+    const char *appended; // Start of the appended data, after the '_'
+    bool appendedbase64;
+} vtkioreader;
+
+/** Raises an error while reading */
+static bool vtkio_parseerror(vtkioreader *r, char *msg) {
+    morpho_runtimeerror(r->v, VTKIO_PARSEERR, r->file, msg);
+    return false;
+}
+
+static bool vtkio_unsupported(vtkioreader *r, char *msg) {
+    morpho_runtimeerror(r->v, VTKIO_UNSUPPORTED, r->file, msg);
+    return false;
+}
+
+/** Finds the value of an attribute in a tag */
+static bool vtkio_attribute(const char *attr, const char *end, const char *name, const char **val, size_t *length) {
+    size_t n=strlen(name);
+    for (const char *p=attr; p+n<end; p++) {
+        if (memcmp(p, name, n)!=0 || !(p==attr || isspace((unsigned char) p[-1]))) continue;
+        const char *q=p+n;
+        while (q<end && isspace((unsigned char) *q)) q++;
+        if (q>=end || *q!='=') continue;
+        q++;
+        while (q<end && isspace((unsigned char) *q)) q++;
+        if (q>=end || (*q!='"' && *q!='\'')) continue;
+        char quote=*(q++);
+        const char *e=memchr(q, quote, end-q);
+        if (!e) return false;
+        *val=q;
+        *length=e-q;
+        return true;
+    }
+    return false;
+}
+
+/** Tests whether an attribute has a given value */
+static bool vtkio_attributeis(const char *attr, const char *end, const char *name, const char *value) {
+    const char *val; size_t length;
+    return (vtkio_attribute(attr, end, name, &val, &length) && length==strlen(value) && memcmp(val, value, length)==0);
+}
+
+/** Reads an integer attribute */
+static bool vtkio_attributeint(const char *attr, const char *end, const char *name, long long *out) {
+    const char *val; size_t length;
+    char buffer[32];
+    if (!vtkio_attribute(attr, end, name, &val, &length) || length==0 || length>=sizeof(buffer)) return false;
+    memcpy(buffer, val, length);
+    buffer[length]='\0';
+    char *e;
+    *out=strtoll(buffer, &e, 10);
+    return (*e=='\0' && *out>=0);
+}
+
+/** Tests whether a tag has a given name */
+static bool vtkio_istag(const char *tag, size_t length, const char *name) {
+    return (length==strlen(name) && memcmp(tag, name, length)==0);
+}
+
+/** Records a DataArray */
+static bool vtkio_addarray(vtkioreader *r, vtkiosection section, const char *attr, const char *end, vtkioarray **out) {
+    vtkioarray *arrays=MORPHO_REALLOC(r->arrays, sizeof(vtkioarray)*(r->narrays+1));
+    if (!arrays) {
+        morpho_runtimeerror(r->v, ERROR_ALLOCATIONFAILED);
+        return false;
+    }
+    r->arrays=arrays;
+    vtkioarray *a=&arrays[r->narrays++];
+    memset(a, 0, sizeof(vtkioarray));
+    a->section=section;
+
+    if (!vtkio_attribute(attr, end, "Name", &a->name, &a->namelength)) a->name=NULL;
+
+    const char *type; size_t length;
+    if (!vtkio_attribute(attr, end, "type", &type, &length)) return vtkio_parseerror(r, "DataArray without a type");
+    for (a->type=0; a->type<VTKIO_NTYPES; a->type++) {
+        if (length==strlen(vtkio_typenames[a->type]) && memcmp(type, vtkio_typenames[a->type], length)==0) break;
+    }
+    if (a->type==VTKIO_NTYPES) return vtkio_unsupported(r, "data type");
+
+    long long ncomp=1;
+    if (vtkio_attribute(attr, end, "NumberOfComponents", &type, &length) &&
+        (!vtkio_attributeint(attr, end, "NumberOfComponents", &ncomp) || ncomp<1)) return vtkio_parseerror(r, "invalid number of components");
+    a->ncomponents=(int) ncomp;
+
+    if (vtkio_attributeis(attr, end, "format", "appended")) {
+        long long offset;
+        if (!vtkio_attributeint(attr, end, "offset", &offset)) return vtkio_parseerror(r, "appended DataArray without an offset");
+        a->format=VTKIO_APPENDED;
+        a->offset=(size_t) offset;
+    } else if (vtkio_attributeis(attr, end, "format", "binary")) {
+        a->format=VTKIO_BINARY;
+    } else if (vtkio_attributeis(attr, end, "format", "ascii")) {
+        a->format=VTKIO_ASCII;
+    } else return vtkio_unsupported(r, "DataArray format");
+
+    *out=a;
+    return true;
+}
+
+/** Reads the XML header up to the appended data */
+static bool vtkio_parseheader(vtkioreader *r) {
+    const char *p=r->base, *end=r->base+r->size;
+    vtkiosection section=VTKIO_NOSECTION;
+    bool isvtk=false;
+
+    while (p<end) {
+        const char *lt=memchr(p, '<', end-p);
+        if (!lt) break;
+        const char *gt=memchr(lt, '>', end-lt);
+        if (!gt) return vtkio_parseerror(r, "unterminated tag");
+        p=gt+1;
+
+        if (lt[1]=='?' || lt[1]=='!') continue;
+        bool close=(lt[1]=='/');
+        const char *tag=lt+(close ? 2 : 1), *t=tag;
+        while (t<gt && !isspace((unsigned char) *t) && *t!='/') t++;
+        size_t length=t-tag;
+        bool selfclose=(gt[-1]=='/');
+
+        if (vtkio_istag(tag, length, "Points") || vtkio_istag(tag, length, "Cells") ||
+            vtkio_istag(tag, length, "PointData") || vtkio_istag(tag, length, "CellData") ||
+            vtkio_istag(tag, length, "FieldData")) {
+            if (close || selfclose) section=VTKIO_NOSECTION;
+            else if (vtkio_istag(tag, length, "Points")) section=VTKIO_POINTS;
+            else if (vtkio_istag(tag, length, "Cells")) section=VTKIO_CELLS;
+            else if (vtkio_istag(tag, length, "PointData")) section=VTKIO_POINTDATA;
+            else section=VTKIO_OTHERSECTION;
+        } else if (close) {
+            continue;
+        } else if (vtkio_istag(tag, length, "VTKFile")) {
+            if (!vtkio_attributeis(t, gt, "type", "UnstructuredGrid")) return vtkio_unsupported(r, "dataset type other than UnstructuredGrid");
+            if (!vtkio_attributeis(t, gt, "byte_order", (vtkio_littleendian() ? "LittleEndian" : "BigEndian"))) return vtkio_unsupported(r, "byte order");
+            const char *val; size_t vlength;
+            if (vtkio_attribute(t, gt, "compressor", &val, &vlength)) return vtkio_unsupported(r, "compressed data");
+            if (vtkio_attributeis(t, gt, "header_type", "UInt64")) r->headersize=sizeof(uint64_t);
+            else if (!vtkio_attribute(t, gt, "header_type", &val, &vlength) ||
+                     vtkio_attributeis(t, gt, "header_type", "UInt32")) r->headersize=sizeof(uint32_t);
+            else return vtkio_unsupported(r, "header type");
+            isvtk=true;
+        } else if (vtkio_istag(tag, length, "Piece")) {
+            long long npoints, ncells;
+            if (r->haspiece) return vtkio_unsupported(r, "multiple pieces");
+            if (!vtkio_attributeint(t, gt, "NumberOfPoints", &npoints) ||
+                !vtkio_attributeint(t, gt, "NumberOfCells", &ncells) ||
+                npoints>INT_MAX || ncells>INT_MAX) return vtkio_parseerror(r, "invalid Piece");
+            r->npoints=(int) npoints;
+            r->ncells=(int) ncells;
+            r->haspiece=true;
+        } else if (vtkio_istag(tag, length, "DataArray")) {
+            vtkioarray *a=NULL;
+            if (!vtkio_addarray(r, section, t, gt, &a)) return false;
+            if (!selfclose) {
+                a->start=p;
+                for (a->end=p; a->end<end && *a->end!='<'; a->end++);
+            }
+        } else if (vtkio_istag(tag, length, "AppendedData")) {
+            r->appendedbase64=vtkio_attributeis(t, gt, "encoding", VTKIO_BASE64ENCODING);
+            if (!r->appendedbase64 && !vtkio_attributeis(t, gt, "encoding", VTKIO_RAWENCODING)) return vtkio_unsupported(r, "appended data encoding");
+            const char *u=memchr(p, '_', end-p);
+            if (!u) return vtkio_parseerror(r, "missing appended data");
+            r->appended=u+1;
+            break;
+        }
+    }
+
+    if (!isvtk) return vtkio_parseerror(r, "not a VTK XML file");
+    if (!r->haspiece) return vtkio_parseerror(r, "no Piece");
+    return true;
+}
+
+/** Decodes base64 characters until n bytes have been produced, skipping whitespace */
+static bool vtkio_decode(const char *in, const char *end, unsigned char *out, size_t n) {
+    uint32_t acc=0;
+    int nbits=0;
+    size_t nout=0;
+
+    for (const char *p=in; p<end && nout<n; p++) {
+        int c=(unsigned char) *p, val;
+        if (c>='A' && c<='Z') val=c-'A';
+        else if (c>='a' && c<='z') val=c-'a'+26;
+        else if (c>='0' && c<='9') val=c-'0'+52;
+        else if (c=='+') val=62;
+        else if (c=='/') val=63;
+        else if (isspace(c)) continue;
+        else break;
+
+        acc=(acc<<6) | val;
+        nbits+=6;
+        if (nbits>=8) {
+            nbits-=8;
+            out[nout++]=(unsigned char) ((acc>>nbits) & 0xff);
+        }
+    }
+    return nout==n;
+}
+
+/** Reads a block count */
+static size_t vtkio_blockcount(vtkioreader *r, const unsigned char *p) {
+    if (r->headersize==sizeof(uint64_t)) {
+        uint64_t n;
+        memcpy(&n, p, sizeof(n));
+        return (size_t) n;
+    }
+    uint32_t n;
+    memcpy(&n, p, sizeof(n));
+    return (size_t) n;
+}
+
+/** Finds the binary contents of an array, decoding it if necessary
+ * @param[in] r - the reader
+ * @param[in] a - the array
+ * @param[in] n - number of values expected
+ * @param[out] data - the data
+ * @param[out] alloc - memory allocated to hold the data, to be freed by the caller, or NULL
+ * @returns true on success */
+static bool vtkio_arraydata(vtkioreader *r, vtkioarray *a, size_t n, const char **data, char **alloc) {
+    size_t nbytes=n*vtkio_typesizes[a->type];
+    const char *end=r->base+r->size;
+    *alloc=NULL;
+
+    if (a->format==VTKIO_ASCII) {
+        double *values=MORPHO_MALLOC(sizeof(double)*(n>0 ? n : 1));
+        if (!values) {
+            morpho_runtimeerror(r->v, ERROR_ALLOCATIONFAILED);
+            return false;
+        }
+        const char *p=a->start;
+        for (size_t i=0; i<n; i++) {
+            char *e;
+            values[i]=strtod(p, &e);
+            if (e==p || e>a->end) {
+                MORPHO_FREE(values);
+                return vtkio_parseerror(r, "too few values in an ascii DataArray");
+            }
+            p=e;
+        }
+        a->type=VTKIO_FLOAT64; // Values are now stored as doubles
+        *alloc=(char *) values;
+        *data=*alloc;
+        return true;
+    }
+
+    const char *p;
+    bool base64;
+    if (a->format==VTKIO_APPENDED) {
+        if (!r->appended || r->appended+a->offset>end) return vtkio_parseerror(r, "DataArray offset out of range");
+        p=r->appended+a->offset;
+        base64=r->appendedbase64;
+    } else {
+        p=a->start;
+        end=a->end;
+        base64=true;
+    }
+
+    if (!base64) {
+        if (p+r->headersize>end) return vtkio_parseerror(r, "DataArray out of range");
+        size_t count=vtkio_blockcount(r, (const unsigned char *) p);
+        if (count<nbytes || count>(size_t) (end-p)-r->headersize) return vtkio_parseerror(r, "DataArray is too short");
+        *data=p+r->headersize;
+        return true;
+    }
+
+    unsigned char header[sizeof(uint64_t)];
+    if (!vtkio_decode(p, end, header, r->headersize)) return vtkio_parseerror(r, "DataArray out of range");
+    size_t count=vtkio_blockcount(r, header);
+    if (count<nbytes || count>(size_t) (end-p)) return vtkio_parseerror(r, "DataArray is too short");
+
+    *alloc=MORPHO_MALLOC(r->headersize+count);
+    if (!*alloc) {
+        morpho_runtimeerror(r->v, ERROR_ALLOCATIONFAILED);
+        return false;
+    }
+    if (!vtkio_decode(p, end, (unsigned char *) *alloc, r->headersize+count)) {
+        MORPHO_FREE(*alloc);
+        *alloc=NULL;
+        return vtkio_parseerror(r, "DataArray is too short");
+    }
+    *data=*alloc+r->headersize;
+    return true;
+}
+
+/** Gets the i'th value of an array of a given type */
+static double vtkio_value(vtkiotype type, const char *data, size_t i) {
+    const char *p=data+i*vtkio_typesizes[type];
+    switch (type) {
+        case VTKIO_INT8: { int8_t x; memcpy(&x, p, sizeof(x)); return x; }
+        case VTKIO_UINT8: { uint8_t x; memcpy(&x, p, sizeof(x)); return x; }
+        case VTKIO_INT16: { int16_t x; memcpy(&x, p, sizeof(x)); return x; }
+        case VTKIO_UINT16: { uint16_t x; memcpy(&x, p, sizeof(x)); return x; }
+        case VTKIO_INT32: { int32_t x; memcpy(&x, p, sizeof(x)); return x; }
+        case VTKIO_UINT32: { uint32_t x; memcpy(&x, p, sizeof(x)); return x; }
+        case VTKIO_INT64: { int64_t x; memcpy(&x, p, sizeof(x)); return (double) x; }
+        case VTKIO_UINT64: { uint64_t x; memcpy(&x, p, sizeof(x)); return (double) x; }
+        case VTKIO_FLOAT32: { float x; memcpy(&x, p, sizeof(x)); return x; }
+        case VTKIO_FLOAT64: { double x; memcpy(&x, p, sizeof(x)); return x; }
+        default: return 0;
+    }
+}
+
+/** Copies an array into doubles, directly if it is already stored as doubles */
+static bool vtkio_readdoubles(vtkioreader *r, vtkioarray *a, size_t n, double *out) {
+    const char *data=NULL;
+    char *alloc=NULL;
+    if (!vtkio_arraydata(r, a, n, &data, &alloc)) return false;
+    if (a->type==VTKIO_FLOAT64) memcpy(out, data, sizeof(double)*n);
+    else for (size_t i=0; i<n; i++) out[i]=vtkio_value(a->type, data, i);
+    if (alloc) MORPHO_FREE(alloc);
+    return true;
+}
+
+/** Finds an array by section and, optionally, name */
+static vtkioarray *vtkio_findarray(vtkioreader *r, vtkiosection section, const char *name) {
+    for (int i=0; i<r->narrays; i++) {
+        vtkioarray *a=&r->arrays[i];
+        if (a->section!=section) continue;
+        if (!name || (a->name && a->namelength==strlen(name) && memcmp(a->name, name, a->namelength)==0)) return a;
+    }
+    return NULL;
+}
+
+/** Creates a mesh from the points and cells */
+static objectmesh *vtkio_readmesh(vtkioreader *r) {
+    int nv=r->npoints, nc=r->ncells;
+    vtkioarray *pts=vtkio_findarray(r, VTKIO_POINTS, NULL);
+    if (!pts && nv>0) { vtkio_parseerror(r, "missing Points"); return NULL; }
+
+    objectmesh *out=NULL;
+    double *x=MORPHO_MALLOC(sizeof(double)*3*(nv>0 ? nv : 1));
+    double *cells=NULL;
+    double *offsets=NULL, *types=NULL;
+    bool success=false;
+    if (!x) goto vtkio_readmesh_alloc;
+
+    if (nv>0) {
+        if (pts->ncomponents!=3) {
+            vtkio_parseerror(r, "Points must have three components");
+            goto vtkio_readmesh_cleanup;
+        }
+        if (!vtkio_readdoubles(r, pts, (size_t) nv*3, x)) goto vtkio_readmesh_cleanup;
+    }
+
+    out=object_newmesh(3, nv, x);
+    if (!out || !out->vert || !mesh_checkconnectivity(out)) goto vtkio_readmesh_alloc;
+    if (nc==0) { success=true; goto vtkio_readmesh_cleanup; }
+
+    vtkioarray *conn=vtkio_findarray(r, VTKIO_CELLS, "connectivity");
+    vtkioarray *offs=vtkio_findarray(r, VTKIO_CELLS, "offsets");
+    vtkioarray *typ=vtkio_findarray(r, VTKIO_CELLS, "types");
+    if (!conn || !offs || !typ) {
+        vtkio_parseerror(r, "missing Cells");
+        goto vtkio_readmesh_cleanup;
+    }
+
+    offsets=MORPHO_MALLOC(sizeof(double)*2*nc);
+    if (!offsets) goto vtkio_readmesh_alloc;
+    types=offsets+nc;
+    if (!vtkio_readdoubles(r, offs, nc, offsets) ||
+        !vtkio_readdoubles(r, typ, nc, types)) goto vtkio_readmesh_cleanup;
+
+    if (!(offsets[nc-1]>=0 && offsets[nc-1]<=INT_MAX)) {
+        vtkio_parseerror(r, "invalid cell offsets");
+        goto vtkio_readmesh_cleanup;
+    }
+    size_t nentries=(size_t) offsets[nc-1];
+    cells=MORPHO_MALLOC(sizeof(double)*(nentries>0 ? nentries : 1));
+    if (!cells) goto vtkio_readmesh_alloc;
+    if (!vtkio_readdoubles(r, conn, nentries, cells)) goto vtkio_readmesh_cleanup;
+
+    // Count the elements of each grade
+    int count[MESH_GRADE_VOLUME+1] = { 0, 0, 0, 0 };
+    for (int i=0; i<nc; i++) {
+        size_t start=(i>0 ? (size_t) offsets[i-1] : 0), end=(size_t) offsets[i];
+        grade g;
+        for (g=0; g<=MESH_GRADE_VOLUME; g++) if (types[i]==vtkio_celltype[g]) break;
+        if (g>MESH_GRADE_VOLUME) {
+            vtkio_unsupported(r, "cell type other than vertex, line, triangle or tetrahedron");
+            goto vtkio_readmesh_cleanup;
+        }
+        if (end<start || end>nentries || (g>0 && end-start!=(size_t) g+1)) {
+            vtkio_parseerror(r, "invalid cell");
+            goto vtkio_readmesh_cleanup;
+        }
+        for (size_t j=start; j<end; j++) {
+            if (cells[j]<0 || cells[j]>=nv) {
+                vtkio_parseerror(r, "cell refers to a point that does not exist");
+                goto vtkio_readmesh_cleanup;
+            }
+        }
+        count[g]++;
+    }
+
+    for (grade g=1; g<=MESH_GRADE_VOLUME; g++) {
+        if (!count[g]) continue;
+        objectsparse *el=mesh_newconnectivityelement(out, 0, g);
+        if (!el || !sparseccs_resize(&el->ccs, nv, count[g], count[g]*(g+1), false)) goto vtkio_readmesh_alloc;
+
+        int k=0;
+        for (int i=0; i<nc; i++) {
+            if (types[i]!=vtkio_celltype[g]) continue;
+            size_t start=(i>0 ? (size_t) offsets[i-1] : 0);
+            el->ccs.cptr[k]=k*(g+1);
+            for (int j=0; j<=g; j++) el->ccs.rix[k*(g+1)+j]=(int) cells[start+j];
+            mesh_sorttuple(g+1, el->ccs.rix+k*(g+1)); // Vertex ids are stored in ascending order
+            k++;
+        }
+        el->ccs.cptr[k]=k*(g+1);
+    }
+    mesh_freezeconnectivity(out);
+    success=true;
+    goto vtkio_readmesh_cleanup;
+
+vtkio_readmesh_alloc:
+    morpho_runtimeerror(r->v, ERROR_ALLOCATIONFAILED);
+
+vtkio_readmesh_cleanup:
+    if (x) MORPHO_FREE(x);
+    if (offsets) MORPHO_FREE(offsets);
+    if (cells) MORPHO_FREE(cells);
+    if (!success && out) {
+        object_free((object *) out);
+        out=NULL;
+    }
+    return out;
+}
+
+/* **********************************************************************
+ * VTUSave and VTULoad
+ * ********************************************************************** */
+
+static value vtkio_encodingoption;
+
+/** Saves a Mesh and, optionally, Fields on its vertices */
+value vtkio_savefunction(vm *v, int nargs, value *args) {
+    value encoding=MORPHO_NIL;
+    int nfixed=nargs;
+    if (!builtin_options(v, nargs, args, &nfixed, 1, vtkio_encodingoption, &encoding)) return MORPHO_NIL;
+
+    bool base64=false;
+    if (MORPHO_ISSTRING(encoding) && strcmp(MORPHO_GETCSTRING(encoding), VTKIO_BASE64ENCODING)==0) base64=true;
+    else if (!(MORPHO_ISNIL(encoding) ||
+               (MORPHO_ISSTRING(encoding) && strcmp(MORPHO_GETCSTRING(encoding), VTKIO_RAWENCODING)==0))) nfixed=-1;
+
+    value fieldlist=(nfixed>2 ? MORPHO_GETARG(args, 2) : MORPHO_NIL);
+    value namelist=(nfixed>3 ? MORPHO_GETARG(args, 3) : MORPHO_NIL);
+    if (nfixed<2 || nfixed>4 ||
+        !MORPHO_ISSTRING(MORPHO_GETARG(args, 0)) ||
+        !MORPHO_ISMESH(MORPHO_GETARG(args, 1)) ||
+        !(MORPHO_ISNIL(fieldlist) || MORPHO_ISLIST(fieldlist)) ||
+        !(MORPHO_ISNIL(namelist) || MORPHO_ISLIST(namelist))) {
+        morpho_runtimeerror(v, VTKIO_SAVEARGS);
+        return MORPHO_NIL;
+    }
+
+    vtkiowriter w = { .mesh=MORPHO_GETMESH(MORPHO_GETARG(args, 1)) };
+    w.nv=mesh_nvertices(w.mesh);
+    w.nfields=(MORPHO_ISLIST(fieldlist) ? MORPHO_GETLIST(fieldlist)->val.count : 0);
+    objectfield *fields[w.nfields+1];
+    char *names[w.nfields+1];
+    w.fields=fields;
+    w.names=names;
+
+    bool valid=(w.mesh->dim<=3 &&
+                (MORPHO_ISNIL(namelist) || (int) MORPHO_GETLIST(namelist)->val.count==w.nfields));
+    for (int i=0; valid && i<w.nfields; i++) {
+        value f=MORPHO_GETLIST(fieldlist)->val.data[i];
+        valid=MORPHO_ISFIELD(f);
+        if (!valid) break;
+
+        fields[i]=MORPHO_GETFIELD(f);
+        valid=(fields[i]->mesh==w.mesh && fields[i]->dof[0]==1);
+        for (unsigned int g=1; valid && g<fields[i]->ngrades; g++) valid=(fields[i]->dof[g]==0);
+
+        if (MORPHO_ISLIST(namelist)) {
+            value name=MORPHO_GETLIST(namelist)->val.data[i];
+            valid=valid && MORPHO_ISSTRING(name) && vtkio_checkname(MORPHO_GETCSTRING(name));
+            if (valid) names[i]=MORPHO_GETCSTRING(name);
+        } else names[i]=(fields[i]->psize==1 ? "scalars" : "vectors");
+    }
+    if (!valid) {
+        morpho_runtimeerror(v, VTKIO_SAVEARGS);
+        return MORPHO_NIL;
+    }
+
+    char *file=MORPHO_GETCSTRING(MORPHO_GETARG(args, 0));
+    bool success=vtkio_cells(&w);
+    FILE *f=NULL;
+    if (success) success=((f=file_openrelative(file, "wb"))!=NULL);
+    if (success) success=vtkio_save(&w, f, base64);
+    if (f && fclose(f)!=0) success=false;
+
+    if (!success) morpho_runtimeerror(v, VTKIO_WRITEFAILED, file);
+    return MORPHO_NIL;
+}
+
+/** Records an object created while loading; the object is freed if it can't be recorded */
+static bool vtkio_keep(varray_value *objs, value obj) {
+    if (varray_valueadd(objs, &obj, 1)) return true;
+    object_free(MORPHO_GETOBJECT(obj));
+    return false;
+}
+
+/** Loads a Mesh and the Fields on its vertices, returning a List containing the Mesh and a Dictionary of Fields */
+value vtkio_loadfunction(vm *v, int nargs, value *args) {
+    if (nargs!=1 || !MORPHO_ISSTRING(MORPHO_GETARG(args, 0))) {
+        morpho_runtimeerror(v, VTKIO_LOADARGS);
+        return MORPHO_NIL;
+    }
+
+    vtkioreader r = { .v=v, .file=MORPHO_GETCSTRING(MORPHO_GETARG(args, 0)), .headersize=sizeof(uint32_t) };
+    FILE *f=file_openrelative(r.file, "rb");
+    if (!f) {
+        morpho_runtimeerror(v, VTKIO_FILENOTFOUND, r.file);
+        return MORPHO_NIL;
+    }
+
+    value out=MORPHO_NIL;
+    bool mapped=matrixio_map(f, &r.base, &r.size);
+    fclose(f);
+    if (!mapped) {
+        vtkio_parseerror(&r, "empty file");
+        return MORPHO_NIL;
+    }
+
+    varray_value objs; // Objects created, to be bound on success
+    varray_valueinit(&objs);
+    bool success=false;
+
+    if (!vtkio_parseheader(&r)) goto vtkio_load_cleanup;
+    objectmesh *mesh=vtkio_readmesh(&r);
+    if (!mesh) goto vtkio_load_cleanup;
+    if (!vtkio_keep(&objs, MORPHO_OBJECT(mesh))) goto vtkio_load_alloc;
+
+    objectdictionary *dict=object_newdictionary();
+    if (!dict || !vtkio_keep(&objs, MORPHO_OBJECT(dict))) goto vtkio_load_alloc;
+
+    for (int i=0; i<r.narrays; i++) {
+        vtkioarray *a=&r.arrays[i];
+        if (a->section!=VTKIO_POINTDATA || !a->name) continue;
+
+        value prototype=MORPHO_NIL;
+        if (a->ncomponents>1) {
+            objectmatrix *m=object_newmatrix(a->ncomponents, 1, true);
+            if (!m || !vtkio_keep(&objs, MORPHO_OBJECT(m))) goto vtkio_load_alloc;
+            prototype=MORPHO_OBJECT(m);
+        }
+
+        objectfield *field=object_newfield(mesh, prototype, NULL);
+        if (!field || !vtkio_keep(&objs, MORPHO_OBJECT(field))) goto vtkio_load_alloc;
+        if (!vtkio_readdoubles(&r, a, (size_t) r.npoints*a->ncomponents, field->data.elements)) goto vtkio_load_cleanup;
+
+        value name=object_stringfromcstring(a->name, a->namelength);
+        if (MORPHO_ISNIL(name) || !vtkio_keep(&objs, name) ||
+            !dictionary_insert(&dict->dict, name, MORPHO_OBJECT(field))) goto vtkio_load_alloc;
+    }
+
+    value contents[2] = { MORPHO_OBJECT(mesh), MORPHO_OBJECT(dict) };
+    objectlist *list=object_newlist(2, contents);
+    if (!list || !vtkio_keep(&objs, MORPHO_OBJECT(list))) goto vtkio_load_alloc;
+
+    morpho_bindobjects(v, objs.count, objs.data);
+    out=MORPHO_OBJECT(list);
+    success=true;
+    goto vtkio_load_cleanup;
+
+vtkio_load_alloc:
+    morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+vtkio_load_cleanup:
+    if (!success) for (unsigned int i=0; i<objs.count; i++) object_free(MORPHO_GETOBJECT(objs.data[i]));
+    varray_valueclear(&objs);
+    if (r.arrays) MORPHO_FREE(r.arrays);
+    munmap(r.base, r.size);
+    return out;
+}
+
+/* **********************************************************************
+ * Initialization
+ * ********************************************************************** */
+
+void vtkio_initialize(void) {
+    builtin_addfunction(VTKIO_SAVEFUNCTION, vtkio_savefunction, BUILTIN_FLAGSEMPTY);
+    builtin_addfunction(VTKIO_LOADFUNCTION, vtkio_loadfunction, BUILTIN_FLAGSEMPTY);
+
+    vtkio_encodingoption=builtin_internsymbolascstring(VTKIO_ENCODINGOPTION);
+
+    morpho_defineerror(VTKIO_SAVEARGS, ERROR_HALT, VTKIO_SAVEARGS_MSG);
+    morpho_defineerror(VTKIO_LOADARGS, ERROR_HALT, VTKIO_LOADARGS_MSG);
+    morpho_defineerror(VTKIO_WRITEFAILED, ERROR_HALT, VTKIO_WRITEFAILED_MSG);
+    morpho_defineerror(VTKIO_FILENOTFOUND, ERROR_HALT, VTKIO_FILENOTFOUND_MSG);
+    morpho_defineerror(VTKIO_PARSEERR, ERROR_HALT, VTKIO_PARSEERR_MSG);
+    morpho_defineerror(VTKIO_UNSUPPORTED, ERROR_HALT, VTKIO_UNSUPPORTED_MSG);
+}
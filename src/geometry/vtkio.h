@@ -0,0 +1,71 @@
+/** @file vtkio.h
+ *  @author T J Atherton
+ *
+ *  @brief Reading and writing of meshes and fields in the VTK XML unstructured grid format
+ */
+
+#ifndef vtkio_h
+#define vtkio_h
+
+#include "mesh.h"
+#include "field.h"
+
+/* -------------------------------------------------------
+ * File format
+ * ------------------------------------------------------- */
+
+/** Meshes are written as a single Piece of a VTK XML UnstructuredGrid (.vtu) file. The XML header describes
+    each array and gives its offset into an AppendedData section that follows, so that the arrays are written
+    in binary without any formatting. Each array is preceded by a 64 bit count of its bytes and is either raw or,
+    for portability, base64 encoded together with its count.
+        Points:      Float64[3*nvertices], padded with zeros for meshes of lower dimension
+        Cells:       Int32 connectivity, Int32 offsets and UInt8 types of the elements of each grade above 0
+        PointData:   Float64[psize*nvertices] for each Field with one entry per vertex
+    Where the layout already matches, as for the vertices of a three dimensional mesh, the connectivity of each
+    grade and the values of a Field, arrays are written directly from the Mesh or Field without copying.
+    The reader accepts appended, inline binary and ascii arrays of any numerical type, but not compressed data. */
+
+#define VTKIO_SAVEFUNCTION                  "VTUSave"
+#define VTKIO_LOADFUNCTION                  "VTULoad"
+
+#define VTKIO_ENCODINGOPTION                "encoding"
+
+/** Encodings of the appended data */
+#define VTKIO_RAWENCODING                   "raw"
+#define VTKIO_BASE64ENCODING                "base64"
+
+/** VTK cell types for each grade of element */
+#define VTKIO_VERTEX                        1
+#define VTKIO_LINE                          3
+#define VTKIO_TRIANGLE                      5
+#define VTKIO_TETRA                         10
+
+/* -------------------------------------------------------
+ * Errors
+ * ------------------------------------------------------- */
+
+#define VTKIO_SAVEARGS                      "VtuSvArgs"
+#define VTKIO_SAVEARGS_MSG                  "VTUSave expects a file name, a Mesh and, optionally, a List of Fields on its vertices and a List of their names, which must be strings without whitespace or markup characters."
+
+#define VTKIO_LOADARGS                      "VtuLdArgs"
+#define VTKIO_LOADARGS_MSG                  "VTULoad expects a file name."
+
+#define VTKIO_WRITEFAILED                   "VtuWrtFld"
+#define VTKIO_WRITEFAILED_MSG               "Couldn't write VTK file '%s'."
+
+#define VTKIO_FILENOTFOUND                  "VtuFlNtFnd"
+#define VTKIO_FILENOTFOUND_MSG              "VTK file '%s' not found."
+
+#define VTKIO_PARSEERR                      "VtuPrsErr"
+#define VTKIO_PARSEERR_MSG                  "VTK file '%s' is corrupt: %s."
+
+#define VTKIO_UNSUPPORTED                   "VtuUnsprtd"
+#define VTKIO_UNSUPPORTED_MSG               "VTK file '%s' uses an unsupported feature: %s."
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+void vtkio_initialize(void);
+
+#endif /* vtkio_h */
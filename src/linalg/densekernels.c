@@ -0,0 +1,510 @@
+/** @file densekernels.c
+ *  @author T J Atherton
+ *
+ *  @brief Vectorized elementwise, reduction and matrix multiplication kernels for dense matrices
+ */
+
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "morpho.h"
+#include "threadpool.h"
+#include "densekernels.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define DENSE_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define DENSE_NEON
+#include <arm_neon.h>
+#endif
+
+/* **********************************************************************
+ * Dispatch table
+ * ********************************************************************** */
+
+typedef void (*dense_axpbyfn) (size_t n, double alpha, double *x, double beta, double *y, double *out);
+typedef void (*dense_axpyfn) (size_t n, double alpha, double *x, double *y);
+typedef double (*dense_dotfn) (size_t n, double *x, double *y);
+typedef double (*dense_reducefn) (size_t n, double *x);
+typedef void (*dense_gemmkernelfn) (int kc, double *ap, double *b, int ldb, double *c, int ldc);
+
+typedef struct {
+    const char *isa;
+    dense_axpbyfn axpby;
+    dense_axpyfn axpy;
+    dense_dotfn dot;
+    dense_reducefn sumsq;
+    dense_reducefn sum;
+    dense_gemmkernelfn gemmkernel;
+} densekernels;
+
+/* **********************************************************************
+ * Portable kernels
+ * ********************************************************************** */
+
+static void dense_axpby_generic(size_t n, double alpha, double *x, double beta, double *y, double *out) {
+    for (size_t i=0; i<n; i++) out[i]=alpha*x[i]+beta*y[i];
+}
+
+/** x and y may be the same array, e.g. when a matrix is accumulated onto itself, so they are not declared restrict */
+static void dense_axpy_generic(size_t n, double alpha, double *x, double *y) {
+    for (size_t i=0; i<n; i++) y[i]+=alpha*x[i];
+}
+
+/** Uses four independent partial sums to break the dependency chain */
+static double dense_dot_generic(size_t n, double *x, double *y) {
+    double s[4]={0.0, 0.0, 0.0, 0.0};
+    size_t i=0;
+    for (; i+4<=n; i+=4) {
+        for (int k=0; k<4; k++) s[k]+=x[i+k]*y[i+k];
+    }
+    for (; i<n; i++) s[0]+=x[i]*y[i];
+    return (s[0]+s[1])+(s[2]+s[3]);
+}
+
+static double dense_sumsq_generic(size_t n, double *x) {
+    return dense_dot_generic(n, x, x);
+}
+
+/** Kahan summation */
+static double dense_sum_generic(size_t n, double *x) {
+    double sum=0.0, c=0.0, y, t;
+    for (size_t i=0; i<n; i++) {
+        y=x[i]-c;
+        t=sum+y;
+        c=(t-sum)-y;
+        sum=t;
+    }
+    return sum;
+}
+
+/** Computes c += ap*b for a full DENSE_MR x DENSE_NR tile, where ap is a packed strip of A */
+static void dense_gemmkernel_generic(int kc, double *ap, double *b, int ldb, double *c, int ldc) {
+    double acc[DENSE_NR][DENSE_MR];
+    memset(acc, 0, sizeof(acc));
+
+    for (int l=0; l<kc; l++) {
+        for (int j=0; j<DENSE_NR; j++) {
+            double bj=b[l+j*ldb];
+            for (int r=0; r<DENSE_MR; r++) acc[j][r]+=ap[l*DENSE_MR+r]*bj;
+        }
+    }
+
+    for (int j=0; j<DENSE_NR; j++) {
+        for (int r=0; r<DENSE_MR; r++) c[r+j*ldc]+=acc[j][r];
+    }
+}
+
+static densekernels dense_generic = {
+    .isa = "generic",
+    .axpby = dense_axpby_generic,
+    .axpy = dense_axpy_generic,
+    .dot = dense_dot_generic,
+    .sumsq = dense_sumsq_generic,
+    .sum = dense_sum_generic,
+    .gemmkernel = dense_gemmkernel_generic
+};
+
+/* **********************************************************************
+ * AVX2 kernels
+ * ********************************************************************** */
+
+#ifdef DENSE_AVX2
+#define DENSE_AVX2FN __attribute__((target("avx2,fma")))
+
+/** Sums the lanes of a vector */
+DENSE_AVX2FN static inline double dense_hsum_avx2(__m256d v) {
+    __m128d lo=_mm256_castpd256_pd128(v), hi=_mm256_extractf128_pd(v, 1);
+    lo=_mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+DENSE_AVX2FN static void dense_axpby_avx2(size_t n, double alpha, double *x, double beta, double *y, double *out) {
+    __m256d va=_mm256_set1_pd(alpha), vb=_mm256_set1_pd(beta);
+    size_t i=0;
+    for (; i+4<=n; i+=4) {
+        __m256d v=_mm256_mul_pd(vb, _mm256_loadu_pd(y+i));
+        _mm256_storeu_pd(out+i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x+i), v));
+    }
+    for (; i<n; i++) out[i]=alpha*x[i]+beta*y[i];
+}
+
+DENSE_AVX2FN static void dense_axpy_avx2(size_t n, double alpha, double *x, double *y) {
+    __m256d va=_mm256_set1_pd(alpha);
+    size_t i=0;
+    for (; i+8<=n; i+=8) {
+        __m256d y0=_mm256_fmadd_pd(va, _mm256_loadu_pd(x+i), _mm256_loadu_pd(y+i));
+        __m256d y1=_mm256_fmadd_pd(va, _mm256_loadu_pd(x+i+4), _mm256_loadu_pd(y+i+4));
+        _mm256_storeu_pd(y+i, y0);
+        _mm256_storeu_pd(y+i+4, y1);
+    }
+    for (; i<n; i++) y[i]+=alpha*x[i];
+}
+
+DENSE_AVX2FN static double dense_dot_avx2(size_t n, double *x, double *y) {
+    __m256d s0=_mm256_setzero_pd(), s1=_mm256_setzero_pd();
+    size_t i=0;
+    for (; i+8<=n; i+=8) {
+        s0=_mm256_fmadd_pd(_mm256_loadu_pd(x+i), _mm256_loadu_pd(y+i), s0);
+        s1=_mm256_fmadd_pd(_mm256_loadu_pd(x+i+4), _mm256_loadu_pd(y+i+4), s1);
+    }
+    double sum=dense_hsum_avx2(_mm256_add_pd(s0, s1));
+    for (; i<n; i++) sum+=x[i]*y[i];
+    return sum;
+}
+
+DENSE_AVX2FN static double dense_sumsq_avx2(size_t n, double *x) {
+    return dense_dot_avx2(n, x, x);
+}
+
+/** Kahan summation carried out independently in each lane */
+DENSE_AVX2FN static double dense_sum_avx2(size_t n, double *x) {
+    __m256d sum=_mm256_setzero_pd(), c=_mm256_setzero_pd();
+    size_t i=0;
+    for (; i+4<=n; i+=4) {
+        __m256d y=_mm256_sub_pd(_mm256_loadu_pd(x+i), c);
+        __m256d t=_mm256_add_pd(sum, y);
+        c=_mm256_sub_pd(_mm256_sub_pd(t, sum), y);
+        sum=t;
+    }
+
+    double s[4], cs[4];
+    _mm256_storeu_pd(s, sum);
+    _mm256_storeu_pd(cs, c);
+
+    double total=0.0, comp=0.0, y, t;
+    for (int k=0; k<4; k++) { // Combine lanes, retaining their compensations
+        y=s[k]-(cs[k]+comp);
+        t=total+y;
+        comp=(t-total)-y;
+        total=t;
+    }
+    for (; i<n; i++) {
+        y=x[i]-comp;
+        t=total+y;
+        comp=(t-total)-y;
+        total=t;
+    }
+    return total;
+}
+
+DENSE_AVX2FN static void dense_gemmkernel_avx2(int kc, double *ap, double *b, int ldb, double *c, int ldc) {
+    __m256d c00=_mm256_setzero_pd(), c01=_mm256_setzero_pd(), c10=_mm256_setzero_pd(), c11=_mm256_setzero_pd();
+    __m256d c20=_mm256_setzero_pd(), c21=_mm256_setzero_pd(), c30=_mm256_setzero_pd(), c31=_mm256_setzero_pd();
+    double *b0=b, *b1=b+ldb, *b2=b+2*ldb, *b3=b+3*ldb;
+
+    for (int l=0; l<kc; l++) {
+        __m256d a0=_mm256_loadu_pd(ap+l*DENSE_MR), a1=_mm256_loadu_pd(ap+l*DENSE_MR+4);
+        __m256d bj=_mm256_broadcast_sd(b0+l);
+        c00=_mm256_fmadd_pd(a0, bj, c00); c01=_mm256_fmadd_pd(a1, bj, c01);
+        bj=_mm256_broadcast_sd(b1+l);
+        c10=_mm256_fmadd_pd(a0, bj, c10); c11=_mm256_fmadd_pd(a1, bj, c11);
+        bj=_mm256_broadcast_sd(b2+l);
+        c20=_mm256_fmadd_pd(a0, bj, c20); c21=_mm256_fmadd_pd(a1, bj, c21);
+        bj=_mm256_broadcast_sd(b3+l);
+        c30=_mm256_fmadd_pd(a0, bj, c30); c31=_mm256_fmadd_pd(a1, bj, c31);
+    }
+
+    double *cj=c;
+    _mm256_storeu_pd(cj, _mm256_add_pd(_mm256_loadu_pd(cj), c00));
+    _mm256_storeu_pd(cj+4, _mm256_add_pd(_mm256_loadu_pd(cj+4), c01));
+    cj+=ldc;
+    _mm256_storeu_pd(cj, _mm256_add_pd(_mm256_loadu_pd(cj), c10));
+    _mm256_storeu_pd(cj+4, _mm256_add_pd(_mm256_loadu_pd(cj+4), c11));
+    cj+=ldc;
+    _mm256_storeu_pd(cj, _mm256_add_pd(_mm256_loadu_pd(cj), c20));
+    _mm256_storeu_pd(cj+4, _mm256_add_pd(_mm256_loadu_pd(cj+4), c21));
+    cj+=ldc;
+    _mm256_storeu_pd(cj, _mm256_add_pd(_mm256_loadu_pd(cj), c30));
+    _mm256_storeu_pd(cj+4, _mm256_add_pd(_mm256_loadu_pd(cj+4), c31));
+}
+
+static densekernels dense_avx2 = {
+    .isa = "avx2",
+    .axpby = dense_axpby_avx2,
+    .axpy = dense_axpy_avx2,
+    .dot = dense_dot_avx2,
+    .sumsq = dense_sumsq_avx2,
+    .sum = dense_sum_avx2,
+    .gemmkernel = dense_gemmkernel_avx2
+};
+#endif
+
+/* **********************************************************************
+ * NEON kernels
+ * ********************************************************************** */
+
+#ifdef DENSE_NEON
+static void dense_axpby_neon(size_t n, double alpha, double *x, double beta, double *y, double *out) {
+    float64x2_t va=vdupq_n_f64(alpha), vb=vdupq_n_f64(beta);
+    size_t i=0;
+    for (; i+2<=n; i+=2) {
+        float64x2_t v=vmulq_f64(vb, vld1q_f64(y+i));
+        vst1q_f64(out+i, vfmaq_f64(v, va, vld1q_f64(x+i)));
+    }
+    for (; i<n; i++) out[i]=alpha*x[i]+beta*y[i];
+}
+
+static void dense_axpy_neon(size_t n, double alpha, double *x, double *y) {
+    float64x2_t va=vdupq_n_f64(alpha);
+    size_t i=0;
+    for (; i+4<=n; i+=4) {
+        float64x2_t y0=vfmaq_f64(vld1q_f64(y+i), va, vld1q_f64(x+i));
+        float64x2_t y1=vfmaq_f64(vld1q_f64(y+i+2), va, vld1q_f64(x+i+2));
+        vst1q_f64(y+i, y0);
+        vst1q_f64(y+i+2, y1);
+    }
+    for (; i<n; i++) y[i]+=alpha*x[i];
+}
+
+static double dense_dot_neon(size_t n, double *x, double *y) {
+    float64x2_t s0=vdupq_n_f64(0.0), s1=vdupq_n_f64(0.0);
+    size_t i=0;
+    for (; i+4<=n; i+=4) {
+        s0=vfmaq_f64(s0, vld1q_f64(x+i), vld1q_f64(y+i));
+        s1=vfmaq_f64(s1, vld1q_f64(x+i+2), vld1q_f64(y+i+2));
+    }
+    double sum=vaddvq_f64(vaddq_f64(s0, s1));
+    for (; i<n; i++) sum+=x[i]*y[i];
+    return sum;
+}
+
+static double dense_sumsq_neon(size_t n, double *x) {
+    return dense_dot_neon(n, x, x);
+}
+
+/** Kahan summation carried out independently in each lane */
+static double dense_sum_neon(size_t n, double *x) {
+    float64x2_t sum=vdupq_n_f64(0.0), c=vdupq_n_f64(0.0);
+    size_t i=0;
+    for (; i+2<=n; i+=2) {
+        float64x2_t y=vsubq_f64(vld1q_f64(x+i), c);
+        float64x2_t t=vaddq_f64(sum, y);
+        c=vsubq_f64(vsubq_f64(t, sum), y);
+        sum=t;
+    }
+
+    double s[2], cs[2];
+    vst1q_f64(s, sum);
+    vst1q_f64(cs, c);
+
+    double total=0.0, comp=0.0, y, t;
+    for (int k=0; k<2; k++) { // Combine lanes, retaining their compensations
+        y=s[k]-(cs[k]+comp);
+        t=total+y;
+        comp=(t-total)-y;
+        total=t;
+    }
+    for (; i<n; i++) {
+        y=x[i]-comp;
+        t=total+y;
+        comp=(t-total)-y;
+        total=t;
+    }
+    return total;
+}
+
+static void dense_gemmkernel_neon(int kc, double *ap, double *b, int ldb, double *c, int ldc) {
+    float64x2_t acc[DENSE_NR][DENSE_MR/2];
+    for (int j=0; j<DENSE_NR; j++) for (int r=0; r<DENSE_MR/2; r++) acc[j][r]=vdupq_n_f64(0.0);
+
+    for (int l=0; l<kc; l++) {
+        float64x2_t a[DENSE_MR/2];
+        for (int r=0; r<DENSE_MR/2; r++) a[r]=vld1q_f64(ap+l*DENSE_MR+2*r);
+        for (int j=0; j<DENSE_NR; j++) {
+            float64x2_t bj=vdupq_n_f64(b[l+j*ldb]);
+            for (int r=0; r<DENSE_MR/2; r++) acc[j][r]=vfmaq_f64(acc[j][r], a[r], bj);
+        }
+    }
+
+    for (int j=0; j<DENSE_NR; j++) {
+        for (int r=0; r<DENSE_MR/2; r++) {
+            double *cp=c+j*ldc+2*r;
+            vst1q_f64(cp, vaddq_f64(vld1q_f64(cp), acc[j][r]));
+        }
+    }
+}
+
+static densekernels dense_neon = {
+    .isa = "neon",
+    .axpby = dense_axpby_neon,
+    .axpy = dense_axpy_neon,
+    .dot = dense_dot_neon,
+    .sumsq = dense_sumsq_neon,
+    .sum = dense_sum_neon,
+    .gemmkernel = dense_gemmkernel_neon
+};
+#endif
+
+/** Kernels in use */
+static densekernels *dense_kernels = &dense_generic;
+
+/* **********************************************************************
+ * Elementwise and reduction operations
+ * ********************************************************************** */
+
+/** Computes out = alpha*x + beta*y; out may be the same as x or y */
+void dense_axpby(size_t n, double alpha, double *x, double beta, double *y, double *out) {
+    dense_kernels->axpby(n, alpha, x, beta, y, out);
+}
+
+/** Computes y = y + alpha*x */
+void dense_axpy(size_t n, double alpha, double *x, double *y) {
+    dense_kernels->axpy(n, alpha, x, y);
+}
+
+/** Computes the inner product of x and y */
+double dense_dot(size_t n, double *x, double *y) {
+    return dense_kernels->dot(n, x, y);
+}
+
+/** Computes the 2-norm of x; falls back to a scaled calculation if the sum of squares over- or underflows */
+double dense_nrm2(size_t n, double *x) {
+    double sumsq=dense_kernels->sumsq(n, x);
+    if (isfinite(sumsq) && sumsq>=DBL_MIN) return sqrt(sumsq);
+
+    double scale=0.0, ssq=1.0;
+    for (size_t i=0; i<n; i++) {
+        if (x[i]!=0.0) {
+            double absxi=fabs(x[i]);
+            if (scale<absxi) {
+                ssq=1.0+ssq*(scale/absxi)*(scale/absxi);
+                scale=absxi;
+            } else ssq+=(absxi/scale)*(absxi/scale);
+        }
+    }
+    return scale*sqrt(ssq);
+}
+
+/** Sums the elements of x using compensated summation */
+double dense_sum(size_t n, double *x) {
+    return dense_kernels->sum(n, x);
+}
+
+/* **********************************************************************
+ * Matrix multiplication
+ * ********************************************************************** */
+
+/** Packs an mc x kc block of A into strips of DENSE_MR rows, padding the final strip with zeros */
+static void dense_packa(int mc, int kc, double *a, int lda, double *ap) {
+    for (int ir=0; ir<mc; ir+=DENSE_MR) {
+        int mr=(mc-ir<DENSE_MR ? mc-ir : DENSE_MR);
+        for (int l=0; l<kc; l++) {
+            double *src=a+ir+l*lda;
+            int r=0;
+            for (; r<mr; r++) ap[r]=src[r];
+            for (; r<DENSE_MR; r++) ap[r]=0.0;
+            ap+=DENSE_MR;
+        }
+    }
+}
+
+/** Computes c += ap*b for a partial tile */
+static void dense_gemmedge(int kc, int mr, int nr, double *ap, double *b, int ldb, double *c, int ldc) {
+    for (int j=0; j<nr; j++) {
+        for (int l=0; l<kc; l++) {
+            double bj=b[l+j*ldb];
+            for (int r=0; r<mr; r++) c[r+j*ldc]+=ap[l*DENSE_MR+r]*bj;
+        }
+    }
+}
+
+/** Work for a single thread: computes a block of columns of C */
+typedef struct {
+    int m, n, k;
+    double *a; int lda;
+    double *b; int ldb;
+    double *c; int ldc;
+    bool success;
+} densegemmtask;
+
+static bool dense_gemmpanel(void *arg) {
+    densegemmtask *task = (densegemmtask *) arg;
+    int m=task->m, n=task->n, k=task->k, ldb=task->ldb, ldc=task->ldc;
+    dense_gemmkernelfn kernel=dense_kernels->gemmkernel;
+
+    for (int j=0; j<n; j++) memset(task->c+j*ldc, 0, sizeof(double)*m);
+
+    double *ap=MORPHO_MALLOC(sizeof(double)*(DENSE_MC+DENSE_MR)*DENSE_KC);
+    if (!ap) { task->success=false; return false; }
+
+    for (int pc=0; pc<k; pc+=DENSE_KC) {
+        int kc=(k-pc<DENSE_KC ? k-pc : DENSE_KC);
+        for (int ic=0; ic<m; ic+=DENSE_MC) {
+            int mc=(m-ic<DENSE_MC ? m-ic : DENSE_MC);
+            dense_packa(mc, kc, task->a+ic+pc*task->lda, task->lda, ap);
+
+            for (int jr=0; jr<n; jr+=DENSE_NR) {
+                int nr=(n-jr<DENSE_NR ? n-jr : DENSE_NR);
+                double *bp=task->b+pc+jr*ldb;
+                for (int ir=0; ir<mc; ir+=DENSE_MR) {
+                    int mr=(mc-ir<DENSE_MR ? mc-ir : DENSE_MR);
+                    double *cp=task->c+ic+ir+jr*ldc, *apr=ap+ir*kc;
+                    if (mr==DENSE_MR && nr==DENSE_NR) kernel(kc, apr, bp, ldb, cp, ldc);
+                    else dense_gemmedge(kc, mr, nr, apr, bp, ldb, cp, ldc);
+                }
+            }
+        }
+    }
+
+    MORPHO_FREE(ap);
+    task->success=true;
+    return true;
+}
+
+/** Computes C = A B for column-major matrices, where A is m x k and B is k x n.
+ * @returns true on success, or false if workspace could not be allocated.
+ * @warning c must not overlap a or b. */
+bool dense_gemm(int m, int n, int k, double *a, int lda, double *b, int ldb, double *c, int ldc) {
+    densegemmtask task = { .m=m, .n=n, .k=k, .a=a, .lda=lda, .b=b, .ldb=ldb, .c=c, .ldc=ldc };
+
+    int nthreads=morpho_threadnumber();
+    threadpool *pool=NULL;
+    if (nthreads>1 && ((double) m)*n*k*2>DENSE_PARALLELTHRESHOLD && n>=2*DENSE_NR) pool=threadpool_shared();
+
+    if (!pool) return dense_gemmpanel(&task);
+
+    /* Divide the columns of C into panels, each a multiple of DENSE_NR wide */
+    int ntasks=(nthreads<n/DENSE_NR ? nthreads : n/DENSE_NR);
+    int width=(((n+ntasks-1)/ntasks+DENSE_NR-1)/DENSE_NR)*DENSE_NR;
+    densegemmtask tasks[ntasks];
+
+    int np=0;
+    for (int j0=0; j0<n; j0+=width, np++) {
+        tasks[np]=task;
+        tasks[np].n=(n-j0<width ? n-j0 : width);
+        tasks[np].b=b+j0*ldb;
+        tasks[np].c=c+j0*ldc;
+        tasks[np].success=false;
+        threadpool_add_task(pool, dense_gemmpanel, &tasks[np]);
+    }
+    threadpool_fence(pool);
+
+    bool success=true;
+    for (int i=0; i<np; i++) success &= tasks[i].success;
+    return success;
+}
+
+/* **********************************************************************
+ * Initialization
+ * ********************************************************************* */
+
+/** Returns the instruction set used by the kernels */
+const char *dense_isa(void) {
+    return dense_kernels->isa;
+}
+
+/** Selects the best available kernels for the running CPU */
+void dense_initialize(void) {
+#ifdef DENSE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) dense_kernels=&dense_avx2;
+#endif
+#ifdef DENSE_NEON
+    dense_kernels=&dense_neon;
+#endif
+}
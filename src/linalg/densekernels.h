@@ -0,0 +1,46 @@
+/** @file densekernels.h
+ *  @author T J Atherton
+ *
+ *  @brief Vectorized elementwise, reduction and matrix multiplication kernels for dense matrices
+ */
+
+#ifndef densekernels_h
+#define densekernels_h
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* -------------------------------------------------------
+ * Dense kernels
+ * ------------------------------------------------------- */
+
+/** These kernels act on contiguous arrays of doubles. The best implementation available on the
+    running CPU (AVX2 on x86-64, NEON on arm64, or portable C otherwise) is selected at startup by
+    dense_initialize(). They are used in preference to level 1 BLAS calls, whose reference
+    implementations are scalar. dense_gemm replaces cblas_dgemm for matrix multiplication if
+    MORPHO_LINALG_USE_NATIVEGEMM is defined */
+
+/** Register tile computed by the matrix multiplication microkernel */
+#define DENSE_MR 8
+#define DENSE_NR 4
+
+/** Cache blocking for matrix multiplication: blocks of A of size DENSE_MC x DENSE_KC are packed
+    so that they remain in the L2 cache while they are used */
+#define DENSE_MC 128
+#define DENSE_KC 256
+
+/** Number of floating point operations above which matrix multiplication is split between threads */
+#define DENSE_PARALLELTHRESHOLD (1<<22)
+
+void dense_axpby(size_t n, double alpha, double *x, double beta, double *y, double *out);
+void dense_axpy(size_t n, double alpha, double *x, double *y);
+double dense_dot(size_t n, double *x, double *y);
+double dense_nrm2(size_t n, double *x);
+double dense_sum(size_t n, double *x);
+bool dense_gemm(int m, int n, int k, double *a, int lda, double *b, int ldb, double *c, int ldc);
+
+const char *dense_isa(void);
+
+void dense_initialize(void);
+
+#endif /* densekernels_h */
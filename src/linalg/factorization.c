@@ -0,0 +1,515 @@
+/** @file factorization.c
+ *  @author T J Atherton
+ *
+ *  @brief Reusable dense matrix factorizations (LU, Cholesky, QR and SVD)
+ */
+
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include "morpho.h"
+#include "classes.h"
+
+#include "matrix.h"
+#include "factorization.h"
+
+/* **********************************************************************
+ * Factorization objects
+ * ********************************************************************** */
+
+objecttype objectfactorizationtype;
+
+/** Number of doubles needed to store a factorization */
+static size_t factorization_storage(factorizationtype type, int nrows, int ncols) {
+    size_t m=nrows, n=ncols, k=(nrows<ncols ? nrows : ncols);
+
+    switch (type) {
+        case FACTORIZATION_LU: return m*n + (n*sizeof(int)+sizeof(double)-1)/sizeof(double);
+        case FACTORIZATION_CHOLESKY: return m*n;
+        case FACTORIZATION_QR: return m*n + k;
+        case FACTORIZATION_SVD: return m*k + k + k*n;
+    }
+    return 0;
+}
+
+/** Function object definitions */
+size_t objectfactorization_sizefn(object *obj) {
+    objectfactorization *f = (objectfactorization *) obj;
+    return sizeof(objectfactorization)+sizeof(double)*factorization_storage(f->type, f->nrows, f->ncols);
+}
+
+void objectfactorization_printfn(object *obj, void *v) {
+    objectfactorization *f = (objectfactorization *) obj;
+    char *label[] = { "LU", "Cholesky", "QR", "SVD" };
+    morpho_printf(v, "<%s Factorization>", label[f->type]);
+}
+
+objecttypedefn objectfactorizationdefn = {
+    .printfn=objectfactorization_printfn,
+    .markfn=NULL,
+    .freefn=NULL,
+    .sizefn=objectfactorization_sizefn,
+    .hashfn=NULL,
+    .cmpfn=NULL
+};
+
+/** Creates an empty factorization object */
+static objectfactorization *object_newfactorization(factorizationtype type, int nrows, int ncols) {
+    size_t size=factorization_storage(type, nrows, ncols);
+    objectfactorization *new = (objectfactorization *) object_new(sizeof(objectfactorization)+size*sizeof(double), OBJECT_FACTORIZATION);
+
+    if (new) {
+        int k=(nrows<ncols ? nrows : ncols);
+        new->type=type;
+        new->nrows=nrows;
+        new->ncols=ncols;
+        new->factors=new->data;
+        new->values=NULL;
+        new->vt=NULL;
+        new->pivot=NULL;
+
+        switch (type) {
+            case FACTORIZATION_LU: new->pivot=(int *) (new->data+nrows*ncols); break;
+            case FACTORIZATION_CHOLESKY: break;
+            case FACTORIZATION_QR: new->values=new->data+nrows*ncols; break;
+            case FACTORIZATION_SVD:
+                new->values=new->data+nrows*k;
+                new->vt=new->values+k;
+                break;
+        }
+    }
+
+    return new;
+}
+
+/* **********************************************************************
+ * Factorizing
+ * ********************************************************************** */
+
+/** Computes the LU factorization */
+static objectmatrixerror factorization_lu(objectmatrix *a, objectfactorization *f) {
+    int n=a->nrows, info;
+    cblas_dcopy(n*n, a->elements, 1, f->factors, 1);
+#ifdef MORPHO_LINALG_USE_LAPACKE
+    info=LAPACKE_dgetrf(LAPACK_COL_MAJOR, n, n, f->factors, n, f->pivot);
+#else
+    dgetrf_(&n, &n, f->factors, &n, f->pivot, &info);
+#endif
+    return (info==0 ? MATRIX_OK : (info>0 ? MATRIX_SING : MATRIX_INVLD));
+}
+
+/** Computes the Cholesky factorization; only the upper triangle of a is used */
+static objectmatrixerror factorization_cholesky(objectmatrix *a, objectfactorization *f) {
+    int n=a->nrows, info;
+    cblas_dcopy(n*n, a->elements, 1, f->factors, 1);
+#ifdef MORPHO_LINALG_USE_LAPACKE
+    info=LAPACKE_dpotrf(LAPACK_COL_MAJOR, 'U', n, f->factors, n);
+#else
+    dpotrf_("U", &n, f->factors, &n, &info);
+#endif
+    return (info==0 ? MATRIX_OK : (info>0 ? MATRIX_SING : MATRIX_INVLD));
+}
+
+/** Computes the QR factorization */
+static objectmatrixerror factorization_qr(objectmatrix *a, objectfactorization *f) {
+    int m=a->nrows, n=a->ncols, info;
+    cblas_dcopy(m*n, a->elements, 1, f->factors, 1);
+#ifdef MORPHO_LINALG_USE_LAPACKE
+    info=LAPACKE_dgeqrf(LAPACK_COL_MAJOR, m, n, f->factors, m, f->values);
+#else
+    int lwork=-1; double wsize;
+    dgeqrf_(&m, &n, f->factors, &m, f->values, &wsize, &lwork, &info);
+    lwork=(int) wsize;
+    double *work=MORPHO_MALLOC(sizeof(double)*lwork);
+    if (!work) return MATRIX_ALLOC;
+    dgeqrf_(&m, &n, f->factors, &m, f->values, work, &lwork, &info);
+    MORPHO_FREE(work);
+#endif
+    return (info==0 ? MATRIX_OK : MATRIX_INVLD);
+}
+
+/** Computes the thin singular value decomposition */
+static objectmatrixerror factorization_svd(objectmatrix *a, objectfactorization *f) {
+    int m=a->nrows, n=a->ncols, k=(m<n ? m : n), info;
+    double *acopy=MORPHO_MALLOC(sizeof(double)*m*n);
+    if (!acopy) return MATRIX_ALLOC;
+    cblas_dcopy(m*n, a->elements, 1, acopy, 1);
+
+#ifdef MORPHO_LINALG_USE_LAPACKE
+    double superb[k];
+    info=LAPACKE_dgesvd(LAPACK_COL_MAJOR, 'S', 'S', m, n, acopy, m, f->values, f->factors, m, f->vt, k, superb);
+#else
+    int lwork=-1; double wsize;
+    dgesvd_("S", "S", &m, &n, acopy, &m, f->values, f->factors, &m, f->vt, &k, &wsize, &lwork, &info);
+    lwork=(int) wsize;
+    double *work=MORPHO_MALLOC(sizeof(double)*lwork);
+    if (work) {
+        dgesvd_("S", "S", &m, &n, acopy, &m, f->values, f->factors, &m, f->vt, &k, work, &lwork, &info);
+        MORPHO_FREE(work);
+    } else info=-1;
+#endif
+
+    MORPHO_FREE(acopy);
+    return (info==0 ? MATRIX_OK : MATRIX_FAILED);
+}
+
+/** Factorizes a matrix
+ * @param[in] a - matrix to factorize
+ * @param[in] type - type of factorization
+ * @param[out] out - the new factorization, which is unmanaged
+ * @returns objectmatrixerror indicating the status; MATRIX_OK indicates success. */
+objectmatrixerror factorization_new(objectmatrix *a, factorizationtype type, objectfactorization **out) {
+    if ((type==FACTORIZATION_LU || type==FACTORIZATION_CHOLESKY) && a->nrows!=a->ncols) return MATRIX_NSQ;
+    if (type==FACTORIZATION_QR && a->nrows<a->ncols) return MATRIX_INCMPTBLDIM;
+
+    objectfactorization *new=object_newfactorization(type, a->nrows, a->ncols);
+    if (!new) return MATRIX_ALLOC;
+
+    objectmatrixerror err=MATRIX_OK;
+    switch (type) {
+        case FACTORIZATION_LU: err=factorization_lu(a, new); break;
+        case FACTORIZATION_CHOLESKY: err=factorization_cholesky(a, new); break;
+        case FACTORIZATION_QR: err=factorization_qr(a, new); break;
+        case FACTORIZATION_SVD: err=factorization_svd(a, new); break;
+    }
+
+    if (err==MATRIX_OK) *out=new;
+    else object_free((object *) new);
+
+    return err;
+}
+
+/* **********************************************************************
+ * Using factorizations
+ * ********************************************************************** */
+
+/** Solves using a QR factorization in the least squares sense */
+static objectmatrixerror factorization_solveqr(objectfactorization *f, objectmatrix *b, objectmatrix *out) {
+    int m=f->nrows, n=f->ncols, nrhs=b->ncols, info;
+    double *work=MORPHO_MALLOC(sizeof(double)*m*nrhs);
+    if (!work) return MATRIX_ALLOC;
+    cblas_dcopy(m*nrhs, b->elements, 1, work, 1);
+
+#ifdef MORPHO_LINALG_USE_LAPACKE
+    info=LAPACKE_dormqr(LAPACK_COL_MAJOR, 'L', 'T', m, nrhs, n, f->factors, m, f->values, work, m);
+    if (info==0) info=LAPACKE_dtrtrs(LAPACK_COL_MAJOR, 'U', 'N', 'N', n, nrhs, f->factors, m, work, m);
+#else
+    int lwork=-1; double wsize;
+    dormqr_("L", "T", &m, &nrhs, &n, f->factors, &m, f->values, work, &m, &wsize, &lwork, &info);
+    lwork=(int) wsize;
+    double *qwork=MORPHO_MALLOC(sizeof(double)*lwork);
+    if (qwork) {
+        dormqr_("L", "T", &m, &nrhs, &n, f->factors, &m, f->values, work, &m, qwork, &lwork, &info);
+        MORPHO_FREE(qwork);
+    } else info=-1;
+    if (info==0) dtrtrs_("U", "N", "N", &n, &nrhs, f->factors, &m, work, &m, &info);
+#endif
+
+    if (info==0) for (int j=0; j<nrhs; j++) cblas_dcopy(n, work+j*m, 1, out->elements+j*n, 1);
+
+    MORPHO_FREE(work);
+    return (info==0 ? MATRIX_OK : (info>0 ? MATRIX_SING : MATRIX_INVLD));
+}
+
+/** Solves using the pseudoinverse from an SVD; singular values below a relative tolerance are discarded */
+static objectmatrixerror factorization_solvesvd(objectfactorization *f, objectmatrix *b, objectmatrix *out) {
+    int m=f->nrows, n=f->ncols, k=(m<n ? m : n), nrhs=b->ncols;
+    double *work=MORPHO_MALLOC(sizeof(double)*k*nrhs);
+    if (!work) return MATRIX_ALLOC;
+
+    // work = U^T b
+    cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, k, nrhs, m, 1.0, f->factors, m, b->elements, m, 0.0, work, k);
+
+    double tol=(k>0 ? f->values[0]*(m>n ? m : n)*DBL_EPSILON : 0.0);
+    for (int i=0; i<k; i++) {
+        double scale=(f->values[i]>tol ? 1.0/f->values[i] : 0.0);
+        cblas_dscal(nrhs, scale, work+i, k);
+    }
+
+    // out = V work
+    cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, n, nrhs, k, 1.0, f->vt, k, work, k, 0.0, out->elements, n);
+
+    MORPHO_FREE(work);
+    return MATRIX_OK;
+}
+
+/** Solves a.x = b using a factorization of a
+ * @param[in] f - the factorization
+ * @param[in] b - right hand side(s)
+ * @param[out] out - the solution x, which should have dimensions ncols x b->ncols.
+ * @returns objectmatrixerror indicating the status; MATRIX_OK indicates success.
+ * @details QR factorizations give the least squares solution and SVD factorizations the minimum norm least squares solution. */
+objectmatrixerror factorization_solve(objectfactorization *f, objectmatrix *b, objectmatrix *out) {
+    int n=f->ncols, nrhs=b->ncols, info=0;
+    if (b->nrows!=f->nrows || out->nrows!=f->ncols || out->ncols!=b->ncols) return MATRIX_INCMPTBLDIM;
+
+    switch (f->type) {
+        case FACTORIZATION_LU:
+            if (b!=out) cblas_dcopy(n*nrhs, b->elements, 1, out->elements, 1);
+#ifdef MORPHO_LINALG_USE_LAPACKE
+            info=LAPACKE_dgetrs(LAPACK_COL_MAJOR, 'N', n, nrhs, f->factors, n, f->pivot, out->elements, n);
+#else
+            dgetrs_("N", &n, &nrhs, f->factors, &n, f->pivot, out->elements, &n, &info);
+#endif
+            break;
+        case FACTORIZATION_CHOLESKY:
+            if (b!=out) cblas_dcopy(n*nrhs, b->elements, 1, out->elements, 1);
+#ifdef MORPHO_LINALG_USE_LAPACKE
+            info=LAPACKE_dpotrs(LAPACK_COL_MAJOR, 'U', n, nrhs, f->factors, n, out->elements, n);
+#else
+            dpotrs_("U", &n, &nrhs, f->factors, &n, out->elements, &n, &info);
+#endif
+            break;
+        case FACTORIZATION_QR: return factorization_solveqr(f, b, out);
+        case FACTORIZATION_SVD: return factorization_solvesvd(f, b, out);
+    }
+
+    return (info==0 ? MATRIX_OK : MATRIX_INVLD);
+}
+
+/** Computes the determinant of the factorized matrix
+ * @param[in] f - the factorization
+ * @param[out] out - the determinant
+ * @returns MATRIX_OK on success, MATRIX_NSQ if the matrix isn't square or MATRIX_INVLD if the factorization doesn't provide the determinant. */
+objectmatrixerror factorization_det(objectfactorization *f, double *out) {
+    int n=f->nrows;
+    if (f->nrows!=f->ncols) return MATRIX_NSQ;
+
+    double det=1.0;
+    for (int i=0; i<n; i++) det*=f->factors[i*(n+1)];
+
+    switch (f->type) {
+        case FACTORIZATION_LU: // Each row interchange flips the sign
+            for (int i=0; i<n; i++) if (f->pivot[i]!=i+1) det=-det;
+            break;
+        case FACTORIZATION_CHOLESKY:
+            det*=det;
+            break;
+        case FACTORIZATION_QR: // Each nontrivial Householder reflection has determinant -1
+            for (int i=0; i<n; i++) if (f->values[i]!=0.0) det=-det;
+            break;
+        case FACTORIZATION_SVD:
+            return MATRIX_INVLD;
+    }
+
+    *out=det;
+    return MATRIX_OK;
+}
+
+/** Updates a Cholesky factorization of a to that of a + x x^T, or a - x x^T if downdate is set
+ * @param[in] f - the factorization to update
+ * @param[in] x - vector of length nrows; overwritten
+ * @returns MATRIX_OK on success, MATRIX_SING if a downdate loses positive definiteness, MATRIX_INVLD for other factorizations.
+ * @details Uses O(n^2) Givens-style rotations rather than refactorizing, which costs O(n^3). */
+objectmatrixerror factorization_rankoneupdate(objectfactorization *f, double *x, bool downdate) {
+    if (f->type!=FACTORIZATION_CHOLESKY) return MATRIX_INVLD;
+    int n=f->nrows;
+    double *r=f->factors, sign=(downdate ? -1.0 : 1.0);
+
+    for (int k=0; k<n; k++) {
+        double rkk=r[k*(n+1)];
+        double r2=rkk*rkk + sign*x[k]*x[k];
+        if (r2<=0.0) return MATRIX_SING;
+
+        double rnew=sqrt(r2), c=rnew/rkk, s=x[k]/rkk;
+        r[k*(n+1)]=rnew;
+
+        for (int j=k+1; j<n; j++) {
+            double *rkj=r+k+j*n;
+            *rkj=(*rkj + sign*s*x[j])/c;
+            x[j]=c*x[j] - s*(*rkj);
+        }
+    }
+
+    return MATRIX_OK;
+}
+
+/* **********************************************************************
+ * Factorization veneer class
+ * ********************************************************************** */
+
+/** Raises the appropriate error for a factorization */
+static void factorization_raiseerror(vm *v, factorizationtype type, objectmatrixerror err) {
+    if (type==FACTORIZATION_CHOLESKY && err==MATRIX_SING) morpho_runtimeerror(v, FACTORIZATION_NOTPOSDEF);
+    else if (type==FACTORIZATION_QR && err==MATRIX_INCMPTBLDIM) morpho_runtimeerror(v, FACTORIZATION_QRDIM);
+    else matrix_raiseerror(v, err);
+}
+
+/** Factorizes a matrix, returning a managed factorization object or raising an error */
+value factorization_factorize(vm *v, objectmatrix *a, factorizationtype type) {
+    objectfactorization *new=NULL;
+    value out=MORPHO_NIL;
+
+    objectmatrixerror err=factorization_new(a, type, &new);
+    if (err==MATRIX_OK) {
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    } else factorization_raiseerror(v, type, err);
+
+    return out;
+}
+
+/** Solves a linear system against the factorized matrix */
+value Factorization_solve(vm *v, int nargs, value *args) {
+    objectfactorization *f=MORPHO_GETFACTORIZATION(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+
+    if (nargs==1 && MORPHO_ISMATRIX(MORPHO_GETARG(args, 0)) &&
+        MORPHO_GETMATRIX(MORPHO_GETARG(args, 0))->nrows==f->nrows) {
+        objectmatrix *b=MORPHO_GETMATRIX(MORPHO_GETARG(args, 0));
+        objectmatrix *new=object_newmatrix(f->ncols, b->ncols, false);
+        if (new) {
+            objectmatrixerror err=factorization_solve(f, b, new);
+            if (err==MATRIX_OK) {
+                out=MORPHO_OBJECT(new);
+                morpho_bindobjects(v, 1, &out);
+            } else {
+                object_free((object *) new);
+                matrix_raiseerror(v, err);
+            }
+        } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    } else morpho_runtimeerror(v, FACTORIZATION_SOLVEARGS);
+
+    return out;
+}
+
+/** Inverse (or pseudoinverse) of the factorized matrix */
+value Factorization_inverse(vm *v, int nargs, value *args) {
+    objectfactorization *f=MORPHO_GETFACTORIZATION(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+
+    objectmatrix *id=object_newmatrix(f->nrows, f->nrows, true);
+    objectmatrix *new=object_newmatrix(f->ncols, f->nrows, false);
+    if (id && new) {
+        for (int i=0; i<f->nrows; i++) id->elements[i*(f->nrows+1)]=1.0;
+        objectmatrixerror err=factorization_solve(f, id, new);
+        if (err==MATRIX_OK) {
+            out=MORPHO_OBJECT(new);
+            morpho_bindobjects(v, 1, &out);
+            new=NULL;
+        } else matrix_raiseerror(v, err);
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+    if (id) object_free((object *) id);
+    if (new) object_free((object *) new);
+
+    return out;
+}
+
+/** Determinant of the factorized matrix */
+value Factorization_det(vm *v, int nargs, value *args) {
+    objectfactorization *f=MORPHO_GETFACTORIZATION(MORPHO_SELF(args));
+    double det;
+
+    objectmatrixerror err=factorization_det(f, &det);
+    if (err==MATRIX_OK) return MORPHO_FLOAT(det);
+
+    if (err==MATRIX_INVLD) morpho_runtimeerror(v, FACTORIZATION_NOTSUPPORTED);
+    else matrix_raiseerror(v, err);
+    return MORPHO_NIL;
+}
+
+/** Common implementation of update and downdate */
+static value factorization_update(vm *v, int nargs, value *args, bool downdate) {
+    objectfactorization *f=MORPHO_GETFACTORIZATION(MORPHO_SELF(args));
+
+    if (f->type!=FACTORIZATION_CHOLESKY) {
+        morpho_runtimeerror(v, FACTORIZATION_NOTSUPPORTED);
+    } else if (nargs==1 && MORPHO_ISMATRIX(MORPHO_GETARG(args, 0)) &&
+        MORPHO_GETMATRIX(MORPHO_GETARG(args, 0))->nrows*MORPHO_GETMATRIX(MORPHO_GETARG(args, 0))->ncols==f->nrows) {
+        objectmatrix *x=MORPHO_GETMATRIX(MORPHO_GETARG(args, 0));
+        int n=f->nrows;
+        double *xcopy=MORPHO_MALLOC(sizeof(double)*n);
+        double *rcopy=MORPHO_MALLOC(sizeof(double)*n*n);
+
+        if (xcopy && rcopy) {
+            cblas_dcopy(n, x->elements, 1, xcopy, 1);
+            cblas_dcopy(n*n, f->factors, 1, rcopy, 1);
+            if (factorization_rankoneupdate(f, xcopy, downdate)!=MATRIX_OK) {
+                cblas_dcopy(n*n, rcopy, 1, f->factors, 1); // Leave the factorization unchanged on failure
+                morpho_runtimeerror(v, FACTORIZATION_NOTPOSDEF);
+            }
+        } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+        if (xcopy) MORPHO_FREE(xcopy);
+        if (rcopy) MORPHO_FREE(rcopy);
+    } else morpho_runtimeerror(v, FACTORIZATION_UPDATEARGS);
+
+    return MORPHO_NIL;
+}
+
+/** Rank one update */
+value Factorization_update(vm *v, int nargs, value *args) {
+    return factorization_update(v, nargs, args, false);
+}
+
+/** Rank one downdate */
+value Factorization_downdate(vm *v, int nargs, value *args) {
+    return factorization_update(v, nargs, args, true);
+}
+
+/** Singular values, in descending order, as a column matrix */
+value Factorization_singularvalues(vm *v, int nargs, value *args) {
+    objectfactorization *f=MORPHO_GETFACTORIZATION(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+
+    if (f->type!=FACTORIZATION_SVD) {
+        morpho_runtimeerror(v, FACTORIZATION_NOTSUPPORTED);
+        return MORPHO_NIL;
+    }
+
+    int k=(f->nrows<f->ncols ? f->nrows : f->ncols);
+    objectmatrix *new=object_newmatrix(k, 1, false);
+    if (new) {
+        cblas_dcopy(k, f->values, 1, new->elements, 1);
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+    return out;
+}
+
+/** Dimensions of the factorized matrix */
+value Factorization_dimensions(vm *v, int nargs, value *args) {
+    objectfactorization *f=MORPHO_GETFACTORIZATION(MORPHO_SELF(args));
+    value dim[2] = { MORPHO_INTEGER(f->nrows), MORPHO_INTEGER(f->ncols) };
+    value out=MORPHO_NIL;
+
+    objectlist *new=object_newlist(2, dim);
+    if (new) {
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+    return out;
+}
+
+MORPHO_BEGINCLASS(Factorization)
+MORPHO_METHOD(FACTORIZATION_SOLVE_METHOD, Factorization_solve, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_INVERSE_METHOD, Factorization_inverse, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_DET_METHOD, Factorization_det, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FACTORIZATION_UPDATE_METHOD, Factorization_update, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FACTORIZATION_DOWNDATE_METHOD, Factorization_downdate, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FACTORIZATION_SINGULARVALUES_METHOD, Factorization_singularvalues, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_DIMENSIONS_METHOD, Factorization_dimensions, BUILTIN_FLAGSEMPTY)
+MORPHO_ENDCLASS
+
+/* **********************************************************************
+ * Initialization
+ * ********************************************************************* */
+
+void factorization_initialize(void) {
+    objectfactorizationtype=object_addtype(&objectfactorizationdefn);
+
+    objectstring objname = MORPHO_STATICSTRING(OBJECT_CLASSNAME);
+    value objclass = builtin_findclass(MORPHO_OBJECT(&objname));
+
+    value factorizationclass=builtin_addclass(FACTORIZATION_CLASSNAME, MORPHO_GETCLASSDEFINITION(Factorization), objclass);
+    object_setveneerclass(OBJECT_FACTORIZATION, factorizationclass);
+
+    morpho_defineerror(FACTORIZATION_SOLVEARGS, ERROR_HALT, FACTORIZATION_SOLVEARGS_MSG);
+    morpho_defineerror(FACTORIZATION_UPDATEARGS, ERROR_HALT, FACTORIZATION_UPDATEARGS_MSG);
+    morpho_defineerror(FACTORIZATION_NOTPOSDEF, ERROR_HALT, FACTORIZATION_NOTPOSDEF_MSG);
+    morpho_defineerror(FACTORIZATION_QRDIM, ERROR_HALT, FACTORIZATION_QRDIM_MSG);
+    morpho_defineerror(FACTORIZATION_NOTSUPPORTED, ERROR_HALT, FACTORIZATION_NOTSUPPORTED_MSG);
+}
@@ -0,0 +1,96 @@
+/** @file factorization.h
+ *  @author T J Atherton
+ *
+ *  @brief Reusable dense matrix factorizations (LU, Cholesky, QR and SVD)
+ */
+
+#ifndef factorization_h
+#define factorization_h
+
+#include "matrix.h"
+
+/* -------------------------------------------------------
+ * Factorization objects
+ * ------------------------------------------------------- */
+
+extern objecttype objectfactorizationtype;
+#define OBJECT_FACTORIZATION objectfactorizationtype
+
+/** Types of factorization */
+typedef enum {
+    FACTORIZATION_LU,       /** PA = LU, for square matrices */
+    FACTORIZATION_CHOLESKY, /** A = R^T R, for symmetric positive definite matrices */
+    FACTORIZATION_QR,       /** A = QR, for matrices with at least as many rows as columns */
+    FACTORIZATION_SVD       /** A = U S V^T */
+} factorizationtype;
+
+/** A factorization holds the result of factoring a matrix so that it can be reused, e.g. to solve
+    against many right hand sides. All arrays are stored in the column-major format used by LAPACK:
+    - LU:       factors holds L and U packed together and pivot holds the row interchanges.
+    - Cholesky: the upper triangle of factors holds R.
+    - QR:       factors holds R and the Householder reflectors; values holds their scalar factors.
+    - SVD:      factors holds U (nrows x k), values the k singular values and vt holds V^T (k x ncols),
+                where k = min(nrows, ncols). */
+typedef struct {
+    object obj;
+    factorizationtype type;
+    int nrows;
+    int ncols;
+    double *factors;
+    double *values;
+    double *vt;
+    int *pivot;
+    double data[];
+} objectfactorization;
+
+/** Tests whether an object is a factorization */
+#define MORPHO_ISFACTORIZATION(val) object_istype(val, OBJECT_FACTORIZATION)
+
+/** Gets the object as a factorization */
+#define MORPHO_GETFACTORIZATION(val)   ((objectfactorization *) MORPHO_GETOBJECT(val))
+
+/* -------------------------------------------------------
+ * Factorization veneer class
+ * ------------------------------------------------------- */
+
+#define FACTORIZATION_CLASSNAME "Factorization"
+
+#define FACTORIZATION_LU_METHOD "lu"
+#define FACTORIZATION_CHOLESKY_METHOD "cholesky"
+#define FACTORIZATION_QR_METHOD "qr"
+#define FACTORIZATION_SVD_METHOD "svd"
+
+#define FACTORIZATION_SOLVE_METHOD "solve"
+#define FACTORIZATION_UPDATE_METHOD "update"
+#define FACTORIZATION_DOWNDATE_METHOD "downdate"
+#define FACTORIZATION_SINGULARVALUES_METHOD "singularvalues"
+
+#define FACTORIZATION_SOLVEARGS           "FctrztnSlvArgs"
+#define FACTORIZATION_SOLVEARGS_MSG       "Method solve expects a matrix with the same number of rows as the factorized matrix."
+
+#define FACTORIZATION_UPDATEARGS          "FctrztnUpdtArgs"
+#define FACTORIZATION_UPDATEARGS_MSG      "Methods update and downdate expect a column matrix with the same number of rows as the factorized matrix."
+
+#define FACTORIZATION_NOTPOSDEF           "FctrztnNtPsDf"
+#define FACTORIZATION_NOTPOSDEF_MSG       "Matrix is not positive definite."
+
+#define FACTORIZATION_QRDIM               "FctrztnQRDim"
+#define FACTORIZATION_QRDIM_MSG           "QR factorization requires at least as many rows as columns."
+
+#define FACTORIZATION_NOTSUPPORTED        "FctrztnNtSprtd"
+#define FACTORIZATION_NOTSUPPORTED_MSG    "Operation is not supported by this type of factorization."
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+objectmatrixerror factorization_new(objectmatrix *a, factorizationtype type, objectfactorization **out);
+objectmatrixerror factorization_solve(objectfactorization *f, objectmatrix *b, objectmatrix *out);
+objectmatrixerror factorization_det(objectfactorization *f, double *out);
+objectmatrixerror factorization_rankoneupdate(objectfactorization *f, double *x, bool downdate);
+
+value factorization_factorize(vm *v, objectmatrix *a, factorizationtype type);
+
+void factorization_initialize(void);
+
+#endif /* factorization_h */
@@ -10,6 +10,10 @@
 
 #include "matrix.h"
 #include "sparse.h"
+#include "matrixio.h"
+#include "smallmatrix.h"
+#include "factorization.h"
+#include "densekernels.h"
 #include "format.h"
 
 /* **********************************************************************
@@ -20,6 +24,7 @@ objecttype objectmatrixtype;
 
 /** Function object definitions */
 size_t objectmatrix_sizefn(object *obj) {
+    if (MATRIX_ISVIEW((objectmatrix *) obj)) return sizeof(objectmatrix);
     return sizeof(objectmatrix)+sizeof(double) *
             ((objectmatrix *) obj)->ncols *
             ((objectmatrix *) obj)->nrows;
@@ -29,9 +34,15 @@ void objectmatrix_printfn(object *obj, void *v) {
     morpho_printf(v, "<Matrix>");
 }
 
+/** Views keep the matrix that owns their elements alive */
+void objectmatrix_markfn(object *obj, void *v) {
+    objectmatrix *m = (objectmatrix *) obj;
+    if (m->parent) morpho_markobject(v, m->parent);
+}
+
 objecttypedefn objectmatrixdefn = {
     .printfn=objectmatrix_printfn,
-    .markfn=NULL,
+    .markfn=objectmatrix_markfn,
     .freefn=NULL,
     .sizefn=objectmatrix_sizefn,
     .hashfn=NULL,
@@ -47,6 +58,7 @@ objectmatrix *object_newmatrix(unsigned int nrows, unsigned int ncols, bool zero
         new->ncols=ncols;
         new->nrows=nrows;
         new->elements=new->matrixdata;
+        new->parent=NULL;
         if (zero) {
             memset(new->elements, 0, sizeof(double)*nel);
         }
@@ -55,6 +67,37 @@ objectmatrix *object_newmatrix(unsigned int nrows, unsigned int ncols, bool zero
     return new;
 }
 
+/** Creates a view onto the block of m with nrows rows starting at row0 and ncols columns starting at col0.
+ *  The view shares the elements of m, so that writes to either are visible in both, and keeps m alive.
+ *  A view is only possible where the block is contiguous in memory, i.e. it contains complete columns or
+ *  lies within a single column (see MATRIX_ISCONTIGUOUSBLOCK). If m is unmanaged it can't be kept alive
+ *  by the view, so the block is copied into a new matrix instead.
+ * @returns the view, or NULL if the block lies outside m, isn't contiguous or allocation failed */
+objectmatrix *object_newmatrixview(objectmatrix *m, unsigned int row0, unsigned int nrows, unsigned int col0, unsigned int ncols) {
+    if (row0+nrows>m->nrows || col0+ncols>m->ncols ||
+        !MATRIX_ISCONTIGUOUSBLOCK(m, nrows, ncols)) return NULL;
+    
+    objectmatrix *owner = (m->parent ? (objectmatrix *) m->parent : m);
+    
+    if (owner->obj.status==OBJECT_ISUNMANAGED) {
+        objectmatrix *new = object_newmatrix(nrows, ncols, false);
+        if (new) for (unsigned int j=0; j<ncols; j++) {
+            memcpy(new->elements+j*nrows, m->elements+(col0+j)*m->nrows+row0, sizeof(double)*nrows);
+        }
+        return new;
+    }
+    
+    objectmatrix *new = (objectmatrix *) object_new(sizeof(objectmatrix), OBJECT_MATRIX);
+    if (new) {
+        new->nrows=nrows;
+        new->ncols=ncols;
+        new->elements=m->elements+col0*m->nrows+row0;
+        new->parent=(object *) owner;
+    }
+    
+    return new;
+}
+
 /* **********************************************************************
  * Other constructors
  * ********************************************************************** */
@@ -335,17 +378,21 @@ objectmatrixerror matrix_copyat(objectmatrix *a, objectmatrix *out, int row0, in
     return MATRIX_INCMPTBLDIM;
 }
 
-/** Performs a + b -> out. */
-objectmatrixerror matrix_add(objectmatrix *a, objectmatrix *b, objectmatrix *out) {
+/** Performs alpha*a + beta*b -> out in a single pass; out may be the same as a or b. */
+objectmatrixerror matrix_linearcombination(double alpha, objectmatrix *a, double beta, objectmatrix *b, objectmatrix *out) {
     if (a->ncols==b->ncols && a->ncols==out->ncols &&
         a->nrows==b->nrows && a->nrows==out->nrows) {
-        if (a!=out) cblas_dcopy(a->ncols * a->nrows, a->elements, 1, out->elements, 1);
-        cblas_daxpy(a->ncols * a->nrows, 1.0, b->elements, 1, out->elements, 1);
+        dense_axpby(a->ncols * a->nrows, alpha, a->elements, beta, b->elements, out->elements);
         return MATRIX_OK;
     }
     return MATRIX_INCMPTBLDIM;
 }
 
+/** Performs a + b -> out. */
+objectmatrixerror matrix_add(objectmatrix *a, objectmatrix *b, objectmatrix *out) {
+    return matrix_linearcombination(1.0, a, 1.0, b, out);
+}
+
 /** Performs lambda*a + beta -> out. */
 objectmatrixerror matrix_addscalar(objectmatrix *a, double lambda, double beta, objectmatrix *out) {
     if (a->ncols==out->ncols && a->nrows==out->nrows) {
@@ -361,7 +408,7 @@ objectmatrixerror matrix_addscalar(objectmatrix *a, double lambda, double beta,
 /** Performs a + lambda*b -> a. */
 objectmatrixerror matrix_accumulate(objectmatrix *a, double lambda, objectmatrix *b) {
     if (a->ncols==b->ncols && a->nrows==b->nrows ) {
-        cblas_daxpy(a->ncols * a->nrows, lambda, b->elements, 1, a->elements, 1);
+        dense_axpy(a->ncols * a->nrows, lambda, b->elements, a->elements);
         return MATRIX_OK;
     }
     return MATRIX_INCMPTBLDIM;
@@ -369,18 +416,22 @@ objectmatrixerror matrix_accumulate(objectmatrix *a, double lambda, objectmatrix
 
 /** Performs a - b -> out */
 objectmatrixerror matrix_sub(objectmatrix *a, objectmatrix *b, objectmatrix *out) {
-    if (a->ncols==b->ncols && a->ncols==out->ncols &&
-        a->nrows==b->nrows && a->nrows==out->nrows) {
-        if (a!=out) cblas_dcopy(a->ncols * a->nrows, a->elements, 1, out->elements, 1);
-        cblas_daxpy(a->ncols * a->nrows, -1.0, b->elements, 1, out->elements, 1);
-        return MATRIX_OK;
-    }
-    return MATRIX_INCMPTBLDIM;
+    return matrix_linearcombination(1.0, a, -1.0, b, out);
 }
 
 /** Performs a * b -> out */
 objectmatrixerror matrix_mul(objectmatrix *a, objectmatrix *b, objectmatrix *out) {
     if (a->ncols==b->nrows && a->nrows==out->nrows && b->ncols==out->ncols) {
+        if (SMALLMATRIX_ISSMALL(a->nrows) && SMALLMATRIX_ISSMALL(a->ncols) && SMALLMATRIX_ISSMALL(b->ncols) &&
+            out!=a && out!=b) {
+            smallmatrix_mul(a->nrows, a->ncols, b->ncols, a->elements, b->elements, out->elements);
+            return MATRIX_OK;
+        }
+#ifdef MORPHO_LINALG_USE_NATIVEGEMM
+        if (out!=a && out!=b) {
+            return (dense_gemm(a->nrows, b->ncols, a->ncols, a->elements, a->nrows, b->elements, b->nrows, out->elements, out->nrows) ? MATRIX_OK : MATRIX_ALLOC);
+        }
+#endif
         cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, a->nrows, b->ncols, a->ncols, 1.0, a->elements, a->nrows, b->elements, b->nrows, 0.0, out->elements, out->nrows);
         return MATRIX_OK;
     }
@@ -390,7 +441,7 @@ objectmatrixerror matrix_mul(objectmatrix *a, objectmatrix *b, objectmatrix *out
 /** Finds the Frobenius inner product of two matrices  */
 objectmatrixerror matrix_inner(objectmatrix *a, objectmatrix *b, double *out) {
     if (a->ncols==b->ncols && a->nrows==b->nrows) {
-        *out=cblas_ddot(a->ncols*a->nrows, a->elements, 1, b->elements, 1);
+        *out=dense_dot(a->ncols*a->nrows, a->elements, b->elements);
         return MATRIX_OK;
     }
     return MATRIX_INCMPTBLDIM;
@@ -417,6 +468,10 @@ objectmatrixerror matrix_outer(objectmatrix *a, objectmatrix *b, objectmatrix *o
 static objectmatrixerror matrix_div(objectmatrix *a, objectmatrix *b, objectmatrix *out, double *lu, int *pivot) {
     int n=a->nrows, nrhs = b->ncols, info;
     
+    if (SMALLMATRIX_ISSMALL(n) && a->ncols==n) {
+        return (smallmatrix_solve(n, nrhs, a->elements, b->elements, out->elements) ? MATRIX_OK : MATRIX_SING);
+    }
+    
     cblas_dcopy(a->ncols * a->nrows, a->elements, 1, lu, 1);
     if (b!=out) cblas_dcopy(b->ncols * b->nrows, b->elements, 1, out->elements, 1);
 #ifdef MORPHO_LINALG_USE_LAPACKE
@@ -465,6 +520,10 @@ objectmatrixerror matrix_inverse(objectmatrix *a, objectmatrix *out) {
     int nrows=a->nrows, ncols=a->ncols, info;
     if (!(a->ncols==out->nrows && a->ncols == out->nrows)) return MATRIX_INCMPTBLDIM;
     
+    if (SMALLMATRIX_ISSMALL(nrows) && nrows==ncols) {
+        return (smallmatrix_inverse(nrows, a->elements, out->elements) ? MATRIX_OK : MATRIX_SING);
+    }
+    
     int pivot[nrows];
     
     cblas_dcopy(a->ncols * a->nrows, a->elements, 1, out->elements, 1);
@@ -486,6 +545,80 @@ objectmatrixerror matrix_inverse(objectmatrix *a, objectmatrix *out) {
     return (info==0 ? MATRIX_OK : (info>0 ? MATRIX_SING : MATRIX_INVLD));
 }
 
+/** Computes the determinant of a square matrix
+ * @param[in] a - the matrix
+ * @param[out] out - the determinant
+ * @returns objectmatrixerror indicating the status; MATRIX_OK indicates success. */
+objectmatrixerror matrix_det(objectmatrix *a, double *out) {
+    int n=a->nrows, info;
+    if (a->nrows!=a->ncols) return MATRIX_NSQ;
+    
+    if (n==0) { *out=1.0; return MATRIX_OK; }
+    if (SMALLMATRIX_ISSMALL(n)) { *out=smallmatrix_det(n, a->elements); return MATRIX_OK; }
+    
+    /* Otherwise compute the LU decomposition and take the product of the diagonal elements */
+    double *lu=MORPHO_MALLOC(sizeof(double)*n*n);
+    int *pivot=MORPHO_MALLOC(sizeof(int)*n);
+    objectmatrixerror ret=MATRIX_ALLOC;
+    
+    if (lu && pivot) {
+        cblas_dcopy(n*n, a->elements, 1, lu, 1);
+#ifdef MORPHO_LINALG_USE_LAPACKE
+        info=LAPACKE_dgetrf(LAPACK_COL_MAJOR, n, n, lu, n, pivot);
+#else
+        dgetrf_(&n, &n, lu, &n, pivot, &info);
+#endif
+        if (info>=0) { // A singular matrix (info>0) simply has a zero determinant
+            double det=1.0;
+            for (int i=0; i<n; i++) {
+                det*=lu[i*(n+1)];
+                if (pivot[i]!=i+1) det=-det;
+            }
+            *out=det;
+            ret=MATRIX_OK;
+        } else ret=MATRIX_INVLD;
+    }
+    
+    if (lu) MORPHO_FREE(lu);
+    if (pivot) MORPHO_FREE(pivot);
+    
+    return ret;
+}
+
+/** Compute eigenvalues and eigenvectors of a symmetric matrix; eigenvalues are returned in ascending order.
+ * @param[in] a - an objectmatrix to diagonalize of size n
+ * @param[out] w - a buffer of size n will hold the eigenvalues on exit
+ * @param[out] vec - (optional) will be filled out with orthonormal eigenvectors as columns (should be of size n)
+ * @returns an error code or MATRIX_OK on success
+ * @warning Only the upper triangle of a is referenced for large matrices */
+objectmatrixerror matrix_symmetriceigensystem(objectmatrix *a, double *w, objectmatrix *vec) {
+    int info, n=a->nrows;
+    if (a->nrows!=a->ncols) return MATRIX_NSQ;
+    if (vec && ((a->nrows!=vec->nrows) || (a->nrows!=vec->ncols))) return MATRIX_INCMPTBLDIM;
+    
+    if (SMALLMATRIX_ISSMALL(n)) {
+        smallmatrix_symmetriceigensystem(n, a->elements, w, (vec ? vec->elements : NULL));
+        return MATRIX_OK;
+    }
+    
+    double *acopy=(vec ? vec->elements : MORPHO_MALLOC(sizeof(double)*n*n));
+    if (!acopy) return MATRIX_ALLOC;
+    cblas_dcopy(n*n, a->elements, 1, acopy, 1);
+    
+#ifdef MORPHO_LINALG_USE_LAPACKE
+    info=LAPACKE_dsyev(LAPACK_COL_MAJOR, (vec ? 'V' : 'N'), 'U', n, acopy, n, w);
+#else
+    int lwork=3*n; double work[3*n];
+    dsyev_((vec ? "V" : "N"), "U", &n, acopy, &n, w, work, &lwork, &info);
+#endif
+    
+    if (!vec) MORPHO_FREE(acopy);
+    
+    if (info!=0) return (info>0 ? MATRIX_FAILED : MATRIX_INVLD);
+    
+    return MATRIX_OK;
+}
+
 /** Compute eigenvalues and eigenvectors of a matrix
  * @param[in] a - an objectmatrix to diagonalize of size n
  * @param[out] wr - a buffer of size n will hold the real part of the eigenvalues on exit
@@ -520,24 +653,14 @@ objectmatrixerror matrix_eigensystem(objectmatrix *a, double *wr, double *wi, ob
 
 /** Sums all elements of a matrix using Kahan summation */
 double matrix_sum(objectmatrix *a) {
-    unsigned int nel=a->ncols*a->nrows;
-    double sum=0.0, c=0.0, y,t;
-    
-    for (unsigned int i=0; i<nel; i++) {
-        y=a->elements[i]-c;
-        t=sum+y;
-        c=(t-sum)-y;
-        sum=t;
-    }
-    return sum;
+    return dense_sum(a->ncols*a->nrows, a->elements);
 }
 
 /** Norms */
 
 /** Computes the Frobenius norm of a matrix */
 double matrix_norm(objectmatrix *a) {
-    double nrm2=cblas_dnrm2(a->ncols*a->nrows, a->elements, 1);
-    return nrm2;
+    return dense_nrm2(a->ncols*a->nrows, a->elements);
 }
 
 /** Computes the L1 norm of a matrix */
@@ -746,6 +869,9 @@ value matrix_constructor(vm *v, int nargs, value *args) {
                MORPHO_ISSPARSE(MORPHO_GETARG(args, 0))) {
         objectsparseerror err=sparse_tomatrix(MORPHO_GETSPARSE(MORPHO_GETARG(args, 0)), &new);
         if (err!=SPARSE_OK) morpho_runtimeerror(v, MATRIX_INVLDARRAYINIT);
+    } else if (nargs==1 &&
+               MORPHO_ISSTRING(MORPHO_GETARG(args, 0))) {
+        new=matrix_loadfile(v, MORPHO_GETCSTRING(MORPHO_GETARG(args, 0)));
     } else morpho_runtimeerror(v, MATRIX_CONSTRUCTOR);
     
     if (new) {
@@ -819,11 +945,11 @@ void matrix_rollflat(objectmatrix *a, objectmatrix *b, int nplaces) {
     unsigned int Np = N - n; // Number of elements to roll
     
     if (nplaces<0) {
-        memcpy(b->matrixdata, a->matrixdata+n, sizeof(double)*Np);
-        memcpy(b->matrixdata+Np, a->matrixdata, sizeof(double)*n);
+        memcpy(b->elements, a->elements+n, sizeof(double)*Np);
+        memcpy(b->elements+Np, a->elements, sizeof(double)*n);
     } else {
-        memcpy(b->matrixdata+n, a->matrixdata, sizeof(double)*Np);
-        if (n>0) memcpy(b->matrixdata, a->matrixdata+Np, sizeof(double)*n);
+        memcpy(b->elements+n, a->elements, sizeof(double)*Np);
+        if (n>0) memcpy(b->elements, a->elements+Np, sizeof(double)*n);
     }
 }
 
@@ -942,6 +1068,53 @@ value Matrix_getcolumn(vm *v, int nargs, value *args) {
     return out;
 }
 
+/** Converts an integer or unit step range into a block of indices */
+static bool matrix_viewindices(value in, unsigned int *start, unsigned int *count) {
+    int i0, i1;
+    if (MORPHO_ISINTEGER(in)) {
+        i0 = MORPHO_GETINTEGERVALUE(in);
+        *count = 1;
+    } else if (MORPHO_ISRANGE(in)) {
+        objectrange *r = MORPHO_GETRANGE(in);
+        int n = range_count(r);
+        if (n<1 || !morpho_valuetoint(range_iterate(r, 0), &i0)) return false;
+        if (n>1 && !(morpho_valuetoint(range_iterate(r, 1), &i1) && i1==i0+1)) return false;
+        *count = (unsigned int) n;
+    } else return false;
+    
+    if (i0<0) return false;
+    *start = (unsigned int) i0;
+    return true;
+}
+
+/** Returns a view onto a block of a matrix that shares its elements */
+value Matrix_view(vm *v, int nargs, value *args) {
+    objectmatrix *m=MORPHO_GETMATRIX(MORPHO_SELF(args));
+    unsigned int row0=0, nrows=m->nrows, col0=0, ncols=0;
+    value out=MORPHO_NIL;
+    
+    if ((nargs==1 &&
+         matrix_viewindices(MORPHO_GETARG(args, 0), &col0, &ncols)) ||
+        (nargs==2 &&
+         matrix_viewindices(MORPHO_GETARG(args, 0), &row0, &nrows) &&
+         matrix_viewindices(MORPHO_GETARG(args, 1), &col0, &ncols))) {
+        
+        if (!(row0+nrows<=m->nrows && col0+ncols<=m->ncols)) {
+            morpho_runtimeerror(v, MATRIX_INDICESOUTSIDEBOUNDS);
+        } else if (!MATRIX_ISCONTIGUOUSBLOCK(m, nrows, ncols)) {
+            morpho_runtimeerror(v, MATRIX_VIEWNONCONTIG);
+        } else {
+            objectmatrix *new=object_newmatrixview(m, row0, nrows, col0, ncols);
+            if (new) {
+                out=MORPHO_OBJECT(new);
+                morpho_bindobjects(v, 1, &out);
+            } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        }
+    } else morpho_runtimeerror(v, MATRIX_VIEWARGS);
+    
+    return out;
+}
+
 /** Prints a matrix */
 value Matrix_print(vm *v, int nargs, value *args) {
     value self = MORPHO_SELF(args);
@@ -1136,10 +1309,10 @@ value Matrix_mul(vm *v, int nargs, value *args) {
     } else if (nargs==1 && MORPHO_ISNUMBER(MORPHO_GETARG(args, 0))) {
         double scale=1.0;
         if (morpho_valuetofloat(MORPHO_GETARG(args, 0), &scale)) {
-            objectmatrix *new = object_clonematrix(a);
+            objectmatrix *new = object_newmatrix(a->nrows, a->ncols, false);
             if (new) {
                 out=MORPHO_OBJECT(new);
-                matrix_scale(new, scale);
+                matrix_addscalar(a, scale, 0.0, new);
                 morpho_bindobjects(v, 1, &out);
             }
         }
@@ -1158,10 +1331,10 @@ value Matrix_mulr(vm *v, int nargs, value *args) {
     if (nargs==1 && MORPHO_ISNUMBER(MORPHO_GETARG(args, 0))) {
         double scale=1.0;
         if (morpho_valuetofloat(MORPHO_GETARG(args, 0), &scale)) {
-            objectmatrix *new = object_clonematrix(a);
+            objectmatrix *new = object_newmatrix(a->nrows, a->ncols, false);
             if (new) {
                 out=MORPHO_OBJECT(new);
-                matrix_scale(new, scale);
+                matrix_addscalar(a, scale, 0.0, new);
                 morpho_bindobjects(v, 1, &out);
             }
         }
@@ -1238,6 +1411,59 @@ value Matrix_acc(vm *v, int nargs, value *args) {
     return MORPHO_NIL;
 }
 
+/** Overwrites a matrix with a linear combination alpha*a + beta*b without creating temporaries */
+value Matrix_linearcombination(vm *v, int nargs, value *args) {
+    objectmatrix *m=MORPHO_GETMATRIX(MORPHO_SELF(args));
+    double alpha, beta;
+    
+    if (nargs==4 &&
+        morpho_valuetofloat(MORPHO_GETARG(args, 0), &alpha) &&
+        MORPHO_ISMATRIX(MORPHO_GETARG(args, 1)) &&
+        morpho_valuetofloat(MORPHO_GETARG(args, 2), &beta) &&
+        MORPHO_ISMATRIX(MORPHO_GETARG(args, 3))) {
+        objectmatrix *a=MORPHO_GETMATRIX(MORPHO_GETARG(args, 1));
+        objectmatrix *b=MORPHO_GETMATRIX(MORPHO_GETARG(args, 3));
+        
+        if (matrix_linearcombination(alpha, a, beta, b, m)!=MATRIX_OK) morpho_runtimeerror(v, MATRIX_INCOMPATIBLEMATRICES);
+    } else morpho_runtimeerror(v, MATRIX_LINCOMBARGS);
+    
+    return MORPHO_NIL;
+}
+
+/** Determinant */
+value Matrix_det(vm *v, int nargs, value *args) {
+    objectmatrix *a=MORPHO_GETMATRIX(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+    double det;
+    
+    objectmatrixerror err=matrix_det(a, &det);
+    if (err==MATRIX_OK) {
+        out=MORPHO_FLOAT(det);
+    } else matrix_raiseerror(v, err);
+    
+    return out;
+}
+
+/** LU factorization */
+value Matrix_lu(vm *v, int nargs, value *args) {
+    return factorization_factorize(v, MORPHO_GETMATRIX(MORPHO_SELF(args)), FACTORIZATION_LU);
+}
+
+/** Cholesky factorization */
+value Matrix_cholesky(vm *v, int nargs, value *args) {
+    return factorization_factorize(v, MORPHO_GETMATRIX(MORPHO_SELF(args)), FACTORIZATION_CHOLESKY);
+}
+
+/** QR factorization */
+value Matrix_qr(vm *v, int nargs, value *args) {
+    return factorization_factorize(v, MORPHO_GETMATRIX(MORPHO_SELF(args)), FACTORIZATION_QR);
+}
+
+/** Singular value decomposition */
+value Matrix_svd(vm *v, int nargs, value *args) {
+    return factorization_factorize(v, MORPHO_GETMATRIX(MORPHO_SELF(args)), FACTORIZATION_SVD);
+}
+
 /** Frobenius inner product */
 value Matrix_inner(vm *v, int nargs, value *args) {
     objectmatrix *a=MORPHO_GETMATRIX(MORPHO_SELF(args));
@@ -1499,11 +1725,23 @@ value Matrix_clone(vm *v, int nargs, value *args) {
     return out;
 }
 
+/** Saves a matrix to a file */
+value Matrix_save(vm *v, int nargs, value *args) {
+    objectmatrix *m=MORPHO_GETMATRIX(MORPHO_SELF(args));
+
+    if ((nargs==1 || nargs==2) && MORPHO_ISSTRING(MORPHO_GETARG(args, 0))) {
+        matrix_save(v, m, MORPHO_GETCSTRING(MORPHO_GETARG(args, 0)), (nargs==2 ? MORPHO_GETARG(args, 1) : MORPHO_NIL));
+    } else morpho_runtimeerror(v, MATRIXIO_SAVEARGS);
+
+    return MORPHO_NIL;
+}
+
 MORPHO_BEGINCLASS(Matrix)
 MORPHO_METHOD(MORPHO_GETINDEX_METHOD, Matrix_getindex, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_SETINDEX_METHOD, Matrix_setindex, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_GETCOLUMN_METHOD, Matrix_getcolumn, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_SETCOLUMN_METHOD, Matrix_setcolumn, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_VIEW_METHOD, Matrix_view, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_PRINT_METHOD, Matrix_print, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_FORMAT_METHOD, Matrix_format, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_ASSIGN_METHOD, Matrix_assign, BUILTIN_FLAGSEMPTY),
@@ -1515,11 +1753,17 @@ MORPHO_METHOD(MORPHO_MUL_METHOD, Matrix_mul, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_MULR_METHOD, Matrix_mulr, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_DIV_METHOD, Matrix_div, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_ACC_METHOD, Matrix_acc, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_LINEARCOMBINATION_METHOD, Matrix_linearcombination, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_INNER_METHOD, Matrix_inner, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_OUTER_METHOD, Matrix_outer, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_SUM_METHOD, Matrix_sum, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_NORM_METHOD, Matrix_norm, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_INVERSE_METHOD, Matrix_inverse, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_DET_METHOD, Matrix_det, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FACTORIZATION_LU_METHOD, Matrix_lu, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FACTORIZATION_CHOLESKY_METHOD, Matrix_cholesky, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FACTORIZATION_QR_METHOD, Matrix_qr, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(FACTORIZATION_SVD_METHOD, Matrix_svd, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_TRANSPOSE_METHOD, Matrix_transpose, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_RESHAPE_METHOD, Matrix_reshape, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_EIGENVALUES_METHOD, Matrix_eigenvalues, BUILTIN_FLAGSEMPTY),
@@ -1529,7 +1773,8 @@ MORPHO_METHOD(MORPHO_ENUMERATE_METHOD, Matrix_enumerate, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_COUNT_METHOD, Matrix_count, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_DIMENSIONS_METHOD, Matrix_dimensions, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_ROLL_METHOD, Matrix_roll, BUILTIN_FLAGSEMPTY),
-MORPHO_METHOD(MORPHO_CLONE_METHOD, Matrix_clone, BUILTIN_FLAGSEMPTY)
+MORPHO_METHOD(MORPHO_CLONE_METHOD, Matrix_clone, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MORPHO_SAVE_METHOD, Matrix_save, BUILTIN_FLAGSEMPTY)
 MORPHO_ENDCLASS
 
 /* **********************************************************************
@@ -1537,6 +1782,8 @@ MORPHO_ENDCLASS
  * ********************************************************************* */
 
 void matrix_initialize(void) {
+    dense_initialize();
+    
     objectmatrixtype=object_addtype(&objectmatrixdefn);
     
     builtin_addfunction(MATRIX_CLASSNAME, matrix_constructor, BUILTIN_FLAGSEMPTY);
@@ -1554,6 +1801,9 @@ void matrix_initialize(void) {
     morpho_defineerror(MATRIX_CONSTRUCTOR, ERROR_HALT, MATRIX_CONSTRUCTOR_MSG);
     morpho_defineerror(MATRIX_INVLDARRAYINIT, ERROR_HALT, MATRIX_INVLDARRAYINIT_MSG);
     morpho_defineerror(MATRIX_ARITHARGS, ERROR_HALT, MATRIX_ARITHARGS_MSG);
+    morpho_defineerror(MATRIX_LINCOMBARGS, ERROR_HALT, MATRIX_LINCOMBARGS_MSG);
+    morpho_defineerror(MATRIX_VIEWARGS, ERROR_HALT, MATRIX_VIEWARGS_MSG);
+    morpho_defineerror(MATRIX_VIEWNONCONTIG, ERROR_HALT, MATRIX_VIEWNONCONTIG_MSG);
     morpho_defineerror(MATRIX_RESHAPEARGS, ERROR_HALT, MATRIX_RESHAPEARGS_MSG);
     morpho_defineerror(MATRIX_INCOMPATIBLEMATRICES, ERROR_HALT, MATRIX_INCOMPATIBLEMATRICES_MSG);
     morpho_defineerror(MATRIX_SINGULAR, ERROR_HALT, MATRIX_SINGULAR_MSG);
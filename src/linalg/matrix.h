@@ -47,6 +47,7 @@ typedef struct {
     unsigned int nrows;
     unsigned int ncols;
     double *elements;
+    object *parent; /** For a view, the matrix that owns the elements; otherwise NULL */
     double matrixdata[];
 } objectmatrix;
 
@@ -59,6 +60,15 @@ typedef struct {
 /** Creates a matrix object */
 objectmatrix *object_newmatrix(unsigned int nrows, unsigned int ncols, bool zero);
 
+/** Tests whether a matrix is a view onto another matrix's elements */
+#define MATRIX_ISVIEW(m) ((m)->parent!=NULL)
+
+/** Tests whether a block of nrows x ncols taken from m is contiguous in memory, and hence can be viewed */
+#define MATRIX_ISCONTIGUOUSBLOCK(m, nrows, ncols) ((nrows)==(m)->nrows || (ncols)<=1)
+
+/** Creates a view onto a contiguous block of a matrix */
+objectmatrix *object_newmatrixview(objectmatrix *m, unsigned int row0, unsigned int nrows, unsigned int col0, unsigned int ncols);
+
 /** Creates a new matrix from an array */
 objectmatrix *object_matrixfromarray(objectarray *array);
 
@@ -92,6 +102,8 @@ objectmatrix *object_clonematrix(objectmatrix *array);
 #define MATRIX_GETCOLUMN_METHOD "column"
 #define MATRIX_SETCOLUMN_METHOD "setcolumn"
 #define MATRIX_RESHAPE_METHOD "reshape"
+#define MATRIX_VIEW_METHOD "view"
+#define MATRIX_LINEARCOMBINATION_METHOD "linearcombination"
 #define MATRIX_EIGENVALUES_METHOD "eigenvalues"
 #define MATRIX_EIGENSYSTEM_METHOD "eigensystem"
 
@@ -122,6 +134,9 @@ objectmatrix *object_clonematrix(objectmatrix *array);
 #define MATRIX_ARITHARGS                  "MtrxInvldArg"
 #define MATRIX_ARITHARGS_MSG              "Matrix arithmetic methods expect a matrix or number as their argument."
 
+#define MATRIX_LINCOMBARGS                "MtrxLnCmbArg"
+#define MATRIX_LINCOMBARGS_MSG            "Method 'linearcombination' expects arguments (number, matrix, number, matrix)."
+
 #define MATRIX_RESHAPEARGS                "MtrxRShpArg"
 #define MATRIX_RESHAPEARGS_MSG            "Reshape requires two integer arguments."
 
@@ -137,6 +152,12 @@ objectmatrix *object_clonematrix(objectmatrix *array);
 #define MATRIX_OPFAILED                   "MtrxOpFld"
 #define MATRIX_OPFAILED_MSG               "Matrix operation failed."
 
+#define MATRIX_VIEWARGS                   "MtrxVwArgs"
+#define MATRIX_VIEWARGS_MSG               "Method view expects a column index or range, optionally preceded by a row index or range; ranges must have unit step."
+
+#define MATRIX_VIEWNONCONTIG              "MtrxVwNCntg"
+#define MATRIX_VIEWNONCONTIG_MSG          "Method view can only select complete columns or part of a single column, since other blocks are not contiguous in memory; use getindex to copy them instead."
+
 #define MATRIX_SETCOLARGS                 "MtrxStClArgs"
 #define MATRIX_SETCOLARGS_MSG             "Method setcolumn expects an integer column index and a column matrix as arguments."
 
@@ -149,6 +170,8 @@ objectmatrix *object_clonematrix(objectmatrix *array);
 
 typedef enum { MATRIX_OK, MATRIX_INCMPTBLDIM, MATRIX_SING, MATRIX_INVLD, MATRIX_BNDS, MATRIX_NSQ, MATRIX_FAILED, MATRIX_ALLOC } objectmatrixerror;
 
+void matrix_raiseerror(vm *v, objectmatrixerror err);
+
 /* -------------------------------------------------------
  * Matrix interface
  * ------------------------------------------------------- */
@@ -170,6 +193,7 @@ unsigned int matrix_countdof(objectmatrix *a);
 
 objectmatrixerror matrix_copy(objectmatrix *a, objectmatrix *out);
 objectmatrixerror matrix_copyat(objectmatrix *a, objectmatrix *out, int row0, int col0);
+objectmatrixerror matrix_linearcombination(double alpha, objectmatrix *a, double beta, objectmatrix *b, objectmatrix *out);
 objectmatrixerror matrix_add(objectmatrix *a, objectmatrix *b, objectmatrix *out);
 objectmatrixerror matrix_accumulate(objectmatrix *a, double lambda, objectmatrix *b);
 objectmatrixerror matrix_sub(objectmatrix *a, objectmatrix *b, objectmatrix *out);
@@ -178,6 +202,8 @@ objectmatrixerror matrix_inner(objectmatrix *a, objectmatrix *b, double *out);
 objectmatrixerror matrix_outer(objectmatrix *a, objectmatrix *b, objectmatrix *out);
 objectmatrixerror matrix_divs(objectmatrix *a, objectmatrix *b, objectmatrix *out);
 objectmatrixerror matrix_divl(objectmatrix *a, objectmatrix *b, objectmatrix *out);
+objectmatrixerror matrix_det(objectmatrix *a, double *out);
+objectmatrixerror matrix_symmetriceigensystem(objectmatrix *a, double *w, objectmatrix *vec);
 objectmatrixerror matrix_inverse(objectmatrix *a, objectmatrix *out);
 objectmatrixerror matrix_transpose(objectmatrix *a, objectmatrix *out);
 objectmatrixerror matrix_trace(objectmatrix *a, double *out);
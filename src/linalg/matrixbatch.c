@@ -0,0 +1,445 @@
+/** @file matrixbatch.c
+ *  @author T J Atherton
+ *
+ *  @brief Veneer class over the objectmatrixbatch type, a stack of small matrices of identical shape
+ */
+
+#include <string.h>
+#include "morpho.h"
+#include "classes.h"
+
+#include "matrix.h"
+#include "matrixbatch.h"
+#include "smallmatrix.h"
+
+/* **********************************************************************
+ * MatrixBatch objects
+ * ********************************************************************** */
+
+objecttype objectmatrixbatchtype;
+
+/** Function object definitions */
+size_t objectmatrixbatch_sizefn(object *obj) {
+    objectmatrixbatch *b = (objectmatrixbatch *) obj;
+    return sizeof(objectmatrixbatch)+sizeof(double)*b->nmatrices*b->nrows*b->ncols;
+}
+
+void objectmatrixbatch_printfn(object *obj, void *v) {
+    morpho_printf(v, "<MatrixBatch>");
+}
+
+objecttypedefn objectmatrixbatchdefn = {
+    .printfn=objectmatrixbatch_printfn,
+    .markfn=NULL,
+    .freefn=NULL,
+    .sizefn=objectmatrixbatch_sizefn,
+    .hashfn=NULL,
+    .cmpfn=NULL
+};
+
+/** Creates a matrix batch object */
+objectmatrixbatch *object_newmatrixbatch(unsigned int nmatrices, unsigned int nrows, unsigned int ncols, bool zero) {
+    size_t nel = ((size_t) nmatrices)*nrows*ncols;
+    objectmatrixbatch *new = (objectmatrixbatch *) object_new(sizeof(objectmatrixbatch)+nel*sizeof(double), OBJECT_MATRIXBATCH);
+
+    if (new) {
+        new->nmatrices=nmatrices;
+        new->nrows=nrows;
+        new->ncols=ncols;
+        new->elements=new->batchdata;
+        if (zero) memset(new->elements, 0, sizeof(double)*nel);
+    }
+
+    return new;
+}
+
+/* **********************************************************************
+ * Batch operations
+ * ********************************************************************** */
+
+/** Batched product kernel; astride or bstride may be zero to broadcast a single matrix.
+    When called with constant dimensions the inner loops are fully unrolled. */
+static inline void matrixbatch_mulkernel(const int m, const int k, const int n, unsigned int nmatrices, double *a, size_t astride, double *b, size_t bstride, double *out) {
+    for (unsigned int p=0; p<nmatrices; p++) {
+        double *ap=a+p*astride, *bp=b+p*bstride, *op=out+p*m*n;
+        for (int j=0; j<n; j++) {
+            for (int i=0; i<m; i++) {
+                double sum=0.0;
+                for (int l=0; l<k; l++) sum+=ap[i+l*m]*bp[l+j*k];
+                op[i+j*m]=sum;
+            }
+        }
+    }
+}
+
+/** Multiplies a stack of m x k matrices by a stack of k x n matrices */
+static objectmatrixerror matrixbatch_mulstack(unsigned int nmatrices, int m, int k, int n, double *a, size_t astride, double *b, size_t bstride, double *out) {
+    if (SMALLMATRIX_ISSMALL(m) && SMALLMATRIX_ISSMALL(k) && SMALLMATRIX_ISSMALL(n)) {
+        if (m==k && k==n) {
+            switch (n) {
+                case 2: matrixbatch_mulkernel(2, 2, 2, nmatrices, a, astride, b, bstride, out); return MATRIX_OK;
+                case 3: matrixbatch_mulkernel(3, 3, 3, nmatrices, a, astride, b, bstride, out); return MATRIX_OK;
+                case 4: matrixbatch_mulkernel(4, 4, 4, nmatrices, a, astride, b, bstride, out); return MATRIX_OK;
+            }
+        }
+        matrixbatch_mulkernel(m, k, n, nmatrices, a, astride, b, bstride, out);
+        return MATRIX_OK;
+    }
+
+    for (unsigned int p=0; p<nmatrices; p++) {
+        objectmatrix ma = MORPHO_STATICMATRIX(a+p*astride, m, k);
+        objectmatrix mb = MORPHO_STATICMATRIX(b+p*bstride, k, n);
+        objectmatrix mo = MORPHO_STATICMATRIX(out+((size_t) p)*m*n, m, n);
+        objectmatrixerror err=matrix_mul(&ma, &mb, &mo);
+        if (err!=MATRIX_OK) return err;
+    }
+    return MATRIX_OK;
+}
+
+/** Multiplies each matrix in a by the corresponding matrix in b; if b contains a single matrix it is applied to every matrix in a
+ * @warning out must not be the same as a or b */
+objectmatrixerror matrixbatch_mul(objectmatrixbatch *a, objectmatrixbatch *b, objectmatrixbatch *out) {
+    if (a->ncols!=b->nrows || out->nrows!=a->nrows || out->ncols!=b->ncols ||
+        out->nmatrices!=a->nmatrices || !(b->nmatrices==a->nmatrices || b->nmatrices==1)) return MATRIX_INCMPTBLDIM;
+
+    return matrixbatch_mulstack(a->nmatrices, a->nrows, a->ncols, b->ncols,
+                                a->elements, a->nrows*a->ncols,
+                                b->elements, (b->nmatrices==1 ? 0 : b->nrows*b->ncols),
+                                out->elements);
+}
+
+/** Multiplies every matrix in a by a single matrix b
+ * @warning out must not be the same as a */
+objectmatrixerror matrixbatch_mulmatrix(objectmatrixbatch *a, objectmatrix *b, objectmatrixbatch *out) {
+    if (a->ncols!=b->nrows || out->nrows!=a->nrows || out->ncols!=b->ncols ||
+        out->nmatrices!=a->nmatrices) return MATRIX_INCMPTBLDIM;
+
+    return matrixbatch_mulstack(a->nmatrices, a->nrows, a->ncols, b->ncols,
+                                a->elements, a->nrows*a->ncols, b->elements, 0, out->elements);
+}
+
+/** Inverts every matrix in a batch; out may be the same as a */
+objectmatrixerror matrixbatch_inverse(objectmatrixbatch *a, objectmatrixbatch *out) {
+    int n=a->nrows;
+    if (a->nrows!=a->ncols) return MATRIX_NSQ;
+    if (out->nrows!=a->nrows || out->ncols!=a->ncols || out->nmatrices!=a->nmatrices) return MATRIX_INCMPTBLDIM;
+
+    for (unsigned int p=0; p<a->nmatrices; p++) {
+        double *ap=MATRIXBATCH_GETELEMENTS(a, p), *op=MATRIXBATCH_GETELEMENTS(out, p);
+
+        if (SMALLMATRIX_ISSMALL(n)) {
+            if (!smallmatrix_inverse(n, ap, op)) return MATRIX_SING;
+        } else {
+            objectmatrix ma = MORPHO_STATICMATRIX(ap, n, n);
+            objectmatrix mo = MORPHO_STATICMATRIX(op, n, n);
+            objectmatrixerror err=matrix_inverse(&ma, &mo);
+            if (err!=MATRIX_OK) return err;
+        }
+    }
+    return MATRIX_OK;
+}
+
+/** Computes the determinant of every matrix in a batch
+ * @param[in] a - the batch
+ * @param[out] out - array of size a->nmatrices to hold the determinants */
+objectmatrixerror matrixbatch_det(objectmatrixbatch *a, double *out) {
+    int n=a->nrows;
+    if (a->nrows!=a->ncols) return MATRIX_NSQ;
+
+    if (SMALLMATRIX_ISSMALL(n)) {
+        for (unsigned int p=0; p<a->nmatrices; p++) out[p]=smallmatrix_det(n, MATRIXBATCH_GETELEMENTS(a, p));
+        return MATRIX_OK;
+    }
+
+    for (unsigned int p=0; p<a->nmatrices; p++) {
+        objectmatrix ma = MORPHO_STATICMATRIX(MATRIXBATCH_GETELEMENTS(a, p), n, n);
+        objectmatrixerror err=matrix_det(&ma, out+p);
+        if (err!=MATRIX_OK) return err;
+    }
+    return MATRIX_OK;
+}
+
+/** Computes the eigenvalues of every matrix in a batch of symmetric matrices
+ * @param[in] a - the batch
+ * @param[out] out - array of size a->nmatrices*a->nrows; eigenvalues of matrix i are stored in ascending order from out+i*nrows */
+objectmatrixerror matrixbatch_symmetriceigenvalues(objectmatrixbatch *a, double *out) {
+    int n=a->nrows;
+    if (a->nrows!=a->ncols) return MATRIX_NSQ;
+
+    for (unsigned int p=0; p<a->nmatrices; p++) {
+        if (SMALLMATRIX_ISSMALL(n)) {
+            smallmatrix_symmetriceigensystem(n, MATRIXBATCH_GETELEMENTS(a, p), out+p*n, NULL);
+        } else {
+            objectmatrix ma = MORPHO_STATICMATRIX(MATRIXBATCH_GETELEMENTS(a, p), n, n);
+            objectmatrixerror err=matrix_symmetriceigensystem(&ma, out+p*n, NULL);
+            if (err!=MATRIX_OK) return err;
+        }
+    }
+    return MATRIX_OK;
+}
+
+/* **********************************************************************
+ * MatrixBatch veneer class
+ * ********************************************************************* */
+
+/** Creates a batch from a list of matrices */
+static objectmatrixbatch *matrixbatch_fromlist(objectlist *list) {
+    unsigned int n=list_length(list);
+    if (n==0 || !MORPHO_ISMATRIX(list->val.data[0])) return NULL;
+
+    objectmatrix *m0=MORPHO_GETMATRIX(list->val.data[0]);
+    for (unsigned int i=1; i<n; i++) {
+        value el=list->val.data[i];
+        if (!MORPHO_ISMATRIX(el) ||
+            MORPHO_GETMATRIX(el)->nrows!=m0->nrows ||
+            MORPHO_GETMATRIX(el)->ncols!=m0->ncols) return NULL;
+    }
+
+    objectmatrixbatch *new=object_newmatrixbatch(n, m0->nrows, m0->ncols, false);
+    if (new) for (unsigned int i=0; i<n; i++) {
+        memcpy(MATRIXBATCH_GETELEMENTS(new, i), MORPHO_GETMATRIX(list->val.data[i])->elements, sizeof(double)*m0->nrows*m0->ncols);
+    }
+    return new;
+}
+
+/** Constructs a MatrixBatch object */
+value matrixbatch_constructor(vm *v, int nargs, value *args) {
+    objectmatrixbatch *new=NULL;
+    value out=MORPHO_NIL;
+
+    if (nargs==3 &&
+        MORPHO_ISINTEGER(MORPHO_GETARG(args, 0)) &&
+        MORPHO_ISINTEGER(MORPHO_GETARG(args, 1)) &&
+        MORPHO_ISINTEGER(MORPHO_GETARG(args, 2))) {
+        int n = MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 0)),
+            nrows = MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 1)),
+            ncols = MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 2));
+        if (n>=0 && nrows>0 && ncols>0) {
+            new=object_newmatrixbatch(n, nrows, ncols, true);
+            if (!new) morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        } else morpho_runtimeerror(v, MATRIXBATCH_CONSTRUCTOR);
+    } else if (nargs==1 &&
+               MORPHO_ISLIST(MORPHO_GETARG(args, 0))) {
+        new=matrixbatch_fromlist(MORPHO_GETLIST(MORPHO_GETARG(args, 0)));
+        if (!new) morpho_runtimeerror(v, MATRIXBATCH_CONSTRUCTOR);
+    } else morpho_runtimeerror(v, MATRIXBATCH_CONSTRUCTOR);
+
+    if (new) {
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    }
+
+    return out;
+}
+
+/** Gets a matrix from the batch, or an element of one of the matrices */
+value MatrixBatch_getindex(vm *v, int nargs, value *args) {
+    objectmatrixbatch *b=MORPHO_GETMATRIXBATCH(MORPHO_SELF(args));
+    unsigned int indx[3]={0,0,0};
+    value out=MORPHO_NIL;
+
+    if ((nargs==1 || nargs==3) && array_valuelisttoindices(nargs, args+1, indx)) {
+        if (indx[0]>=b->nmatrices || indx[1]>=b->nrows || indx[2]>=b->ncols) {
+            morpho_runtimeerror(v, MATRIX_INDICESOUTSIDEBOUNDS);
+        } else if (nargs==1) {
+            objectmatrix *new=object_newmatrix(b->nrows, b->ncols, false);
+            if (new) {
+                memcpy(new->elements, MATRIXBATCH_GETELEMENTS(b, indx[0]), sizeof(double)*b->nrows*b->ncols);
+                out=MORPHO_OBJECT(new);
+                morpho_bindobjects(v, 1, &out);
+            } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        } else {
+            out=MORPHO_FLOAT(MATRIXBATCH_GETELEMENTS(b, indx[0])[indx[1]+indx[2]*b->nrows]);
+        }
+    } else morpho_runtimeerror(v, MATRIXBATCH_INDEX);
+
+    return out;
+}
+
+/** Sets a matrix in the batch, or an element of one of the matrices */
+value MatrixBatch_setindex(vm *v, int nargs, value *args) {
+    objectmatrixbatch *b=MORPHO_GETMATRIXBATCH(MORPHO_SELF(args));
+    unsigned int indx[3]={0,0,0};
+    value val=MORPHO_GETARG(args, nargs-1);
+
+    if ((nargs==2 || nargs==4) && array_valuelisttoindices(nargs-1, args+1, indx)) {
+        if (indx[0]>=b->nmatrices || indx[1]>=b->nrows || indx[2]>=b->ncols) {
+            morpho_runtimeerror(v, MATRIX_INDICESOUTSIDEBOUNDS);
+        } else if (nargs==2) {
+            if (MORPHO_ISMATRIX(val) &&
+                MORPHO_GETMATRIX(val)->nrows==b->nrows &&
+                MORPHO_GETMATRIX(val)->ncols==b->ncols) {
+                memcpy(MATRIXBATCH_GETELEMENTS(b, indx[0]), MORPHO_GETMATRIX(val)->elements, sizeof(double)*b->nrows*b->ncols);
+            } else morpho_runtimeerror(v, MATRIXBATCH_SETINDEX);
+        } else {
+            double x;
+            if (morpho_valuetofloat(val, &x)) {
+                MATRIXBATCH_GETELEMENTS(b, indx[0])[indx[1]+indx[2]*b->nrows]=x;
+            } else morpho_runtimeerror(v, MATRIXBATCH_SETINDEX);
+        }
+    } else morpho_runtimeerror(v, MATRIXBATCH_INDEX);
+
+    return MORPHO_NIL;
+}
+
+/** Batched multiplication */
+value MatrixBatch_mul(vm *v, int nargs, value *args) {
+    objectmatrixbatch *a=MORPHO_GETMATRIXBATCH(MORPHO_SELF(args));
+    objectmatrixbatch *new=NULL;
+    objectmatrixerror err=MATRIX_INCMPTBLDIM;
+    value out=MORPHO_NIL;
+
+    if (nargs==1 && MORPHO_ISMATRIXBATCH(MORPHO_GETARG(args, 0))) {
+        objectmatrixbatch *b=MORPHO_GETMATRIXBATCH(MORPHO_GETARG(args, 0));
+        new=object_newmatrixbatch(a->nmatrices, a->nrows, b->ncols, false);
+        if (new) err=matrixbatch_mul(a, b, new);
+    } else if (nargs==1 && MORPHO_ISMATRIX(MORPHO_GETARG(args, 0))) {
+        objectmatrix *b=MORPHO_GETMATRIX(MORPHO_GETARG(args, 0));
+        new=object_newmatrixbatch(a->nmatrices, a->nrows, b->ncols, false);
+        if (new) err=matrixbatch_mulmatrix(a, b, new);
+    } else {
+        morpho_runtimeerror(v, MATRIX_ARITHARGS);
+        return MORPHO_NIL;
+    }
+
+    if (!new) {
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    } else if (err==MATRIX_OK) {
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    } else {
+        object_free((object *) new);
+        matrix_raiseerror(v, err);
+    }
+
+    return out;
+}
+
+/** Batched inverse */
+value MatrixBatch_inverse(vm *v, int nargs, value *args) {
+    objectmatrixbatch *a=MORPHO_GETMATRIXBATCH(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+
+    objectmatrixbatch *new=object_newmatrixbatch(a->nmatrices, a->nrows, a->ncols, false);
+    if (new) {
+        objectmatrixerror err=matrixbatch_inverse(a, new);
+        if (err==MATRIX_OK) {
+            out=MORPHO_OBJECT(new);
+            morpho_bindobjects(v, 1, &out);
+        } else {
+            object_free((object *) new);
+            matrix_raiseerror(v, err);
+        }
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+    return out;
+}
+
+/** Batched determinant; returns a column vector */
+value MatrixBatch_det(vm *v, int nargs, value *args) {
+    objectmatrixbatch *a=MORPHO_GETMATRIXBATCH(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+
+    objectmatrix *new=object_newmatrix(a->nmatrices, 1, false);
+    if (new) {
+        objectmatrixerror err=matrixbatch_det(a, new->elements);
+        if (err==MATRIX_OK) {
+            out=MORPHO_OBJECT(new);
+            morpho_bindobjects(v, 1, &out);
+        } else {
+            object_free((object *) new);
+            matrix_raiseerror(v, err);
+        }
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+    return out;
+}
+
+/** Batched eigenvalues of symmetric matrices; returns a matrix whose columns contain the eigenvalues of each matrix */
+value MatrixBatch_eigenvalues(vm *v, int nargs, value *args) {
+    objectmatrixbatch *a=MORPHO_GETMATRIXBATCH(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+
+    objectmatrix *new=object_newmatrix(a->nrows, a->nmatrices, false);
+    if (new) {
+        objectmatrixerror err=matrixbatch_symmetriceigenvalues(a, new->elements);
+        if (err==MATRIX_OK) {
+            out=MORPHO_OBJECT(new);
+            morpho_bindobjects(v, 1, &out);
+        } else {
+            object_free((object *) new);
+            matrix_raiseerror(v, err);
+        }
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+    return out;
+}
+
+/** Number of matrices in the batch */
+value MatrixBatch_count(vm *v, int nargs, value *args) {
+    objectmatrixbatch *a=MORPHO_GETMATRIXBATCH(MORPHO_SELF(args));
+
+    return MORPHO_INTEGER(a->nmatrices);
+}
+
+/** Batch dimensions */
+value MatrixBatch_dimensions(vm *v, int nargs, value *args) {
+    objectmatrixbatch *a=MORPHO_GETMATRIXBATCH(MORPHO_SELF(args));
+    value dim[3] = { MORPHO_INTEGER(a->nmatrices), MORPHO_INTEGER(a->nrows), MORPHO_INTEGER(a->ncols) };
+    value out=MORPHO_NIL;
+
+    objectlist *new=object_newlist(3, dim);
+    if (new) {
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+    return out;
+}
+
+/** Clones a batch */
+value MatrixBatch_clone(vm *v, int nargs, value *args) {
+    objectmatrixbatch *a=MORPHO_GETMATRIXBATCH(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+
+    objectmatrixbatch *new=object_newmatrixbatch(a->nmatrices, a->nrows, a->ncols, false);
+    if (new) {
+        memcpy(new->elements, a->elements, sizeof(double)*a->nmatrices*a->nrows*a->ncols);
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+
+    return out;
+}
+
+MORPHO_BEGINCLASS(MatrixBatch)
+MORPHO_METHOD(MORPHO_GETINDEX_METHOD, MatrixBatch_getindex, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MORPHO_SETINDEX_METHOD, MatrixBatch_setindex, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MORPHO_MUL_METHOD, MatrixBatch_mul, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_INVERSE_METHOD, MatrixBatch_inverse, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_DET_METHOD, MatrixBatch_det, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_EIGENVALUES_METHOD, MatrixBatch_eigenvalues, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MORPHO_COUNT_METHOD, MatrixBatch_count, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_DIMENSIONS_METHOD, MatrixBatch_dimensions, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MORPHO_CLONE_METHOD, MatrixBatch_clone, BUILTIN_FLAGSEMPTY)
+MORPHO_ENDCLASS
+
+/* **********************************************************************
+ * Initialization
+ * ********************************************************************* */
+
+void matrixbatch_initialize(void) {
+    objectmatrixbatchtype=object_addtype(&objectmatrixbatchdefn);
+
+    builtin_addfunction(MATRIXBATCH_CLASSNAME, matrixbatch_constructor, BUILTIN_FLAGSEMPTY);
+
+    objectstring objname = MORPHO_STATICSTRING(OBJECT_CLASSNAME);
+    value objclass = builtin_findclass(MORPHO_OBJECT(&objname));
+
+    value batchclass=builtin_addclass(MATRIXBATCH_CLASSNAME, MORPHO_GETCLASSDEFINITION(MatrixBatch), objclass);
+    object_setveneerclass(OBJECT_MATRIXBATCH, batchclass);
+
+    morpho_defineerror(MATRIXBATCH_CONSTRUCTOR, ERROR_HALT, MATRIXBATCH_CONSTRUCTOR_MSG);
+    morpho_defineerror(MATRIXBATCH_INDEX, ERROR_HALT, MATRIXBATCH_INDEX_MSG);
+    morpho_defineerror(MATRIXBATCH_SETINDEX, ERROR_HALT, MATRIXBATCH_SETINDEX_MSG);
+}
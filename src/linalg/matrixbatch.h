@@ -0,0 +1,72 @@
+/** @file matrixbatch.h
+ *  @author T J Atherton
+ *
+ *  @brief Veneer class over the objectmatrixbatch type, a stack of small matrices of identical shape
+ */
+
+#ifndef matrixbatch_h
+#define matrixbatch_h
+
+#include "matrix.h"
+
+/* -------------------------------------------------------
+ * MatrixBatch objects
+ * ------------------------------------------------------- */
+
+extern objecttype objectmatrixbatchtype;
+#define OBJECT_MATRIXBATCH objectmatrixbatchtype
+
+/** A MatrixBatch holds nmatrices matrices of size nrows x ncols stored contiguously.
+    Each matrix is stored in column-major format, one after the other, so that matrix i begins at
+    elements + i*nrows*ncols. Operations on batches loop over the whole stack in a single call, which
+    is the natural layout for per-element calculations. */
+
+typedef struct {
+    object obj;
+    unsigned int nmatrices;
+    unsigned int nrows;
+    unsigned int ncols;
+    double *elements;
+    double batchdata[];
+} objectmatrixbatch;
+
+/** Tests whether an object is a matrix batch */
+#define MORPHO_ISMATRIXBATCH(val) object_istype(val, OBJECT_MATRIXBATCH)
+
+/** Gets the object as a matrix batch */
+#define MORPHO_GETMATRIXBATCH(val)   ((objectmatrixbatch *) MORPHO_GETOBJECT(val))
+
+/** Gets a pointer to the elements of matrix i in a batch */
+#define MATRIXBATCH_GETELEMENTS(b, i) ((b)->elements + ((size_t) (i))*(b)->nrows*(b)->ncols)
+
+/** Creates a matrix batch object */
+objectmatrixbatch *object_newmatrixbatch(unsigned int nmatrices, unsigned int nrows, unsigned int ncols, bool zero);
+
+/* -------------------------------------------------------
+ * MatrixBatch veneer class
+ * ------------------------------------------------------- */
+
+#define MATRIXBATCH_CLASSNAME "MatrixBatch"
+
+#define MATRIXBATCH_CONSTRUCTOR           "MtrxBtchCns"
+#define MATRIXBATCH_CONSTRUCTOR_MSG       "MatrixBatch() should be called either with dimensions (count, rows, columns) or a list of matrices of the same shape."
+
+#define MATRIXBATCH_INDEX                 "MtrxBtchIndx"
+#define MATRIXBATCH_INDEX_MSG             "MatrixBatch index should be an integer, optionally followed by a row and column."
+
+#define MATRIXBATCH_SETINDEX              "MtrxBtchStIndx"
+#define MATRIXBATCH_SETINDEX_MSG          "MatrixBatch entries should be set with a matrix of the same shape."
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+objectmatrixerror matrixbatch_mul(objectmatrixbatch *a, objectmatrixbatch *b, objectmatrixbatch *out);
+objectmatrixerror matrixbatch_mulmatrix(objectmatrixbatch *a, objectmatrix *b, objectmatrixbatch *out);
+objectmatrixerror matrixbatch_inverse(objectmatrixbatch *a, objectmatrixbatch *out);
+objectmatrixerror matrixbatch_det(objectmatrixbatch *a, double *out);
+objectmatrixerror matrixbatch_symmetriceigenvalues(objectmatrixbatch *a, double *out);
+
+void matrixbatch_initialize(void);
+
+#endif /* matrixbatch_h */
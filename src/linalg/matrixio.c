@@ -0,0 +1,745 @@
+/** @file matrixio.c
+ *  @author T J Atherton
+ *
+ *  @brief Reading and writing of dense and sparse matrices in Matrix Market and binary formats
+ */
+
+#include <limits.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "morpho.h"
+#include "classes.h"
+#include "file.h"
+
+#include "matrix.h"
+#include "sparse.h"
+#include "matrixio.h"
+
+/* **********************************************************************
+ * Matrix Market reader
+ * ********************************************************************** */
+
+typedef enum { MM_REAL, MM_INTEGER, MM_PATTERN } mmfield;
+typedef enum { MM_GENERAL, MM_SYMMETRIC, MM_SKEWSYMMETRIC } mmsymmetry;
+
+/** State of a streaming Matrix Market reader; entries are read one line at a time
+    so that arbitrarily large files can be processed with constant overhead. */
+typedef struct {
+    FILE *f;
+    varray_char buffer; // Line buffer
+    int line; // Current line number
+
+    bool coordinate; // Coordinate (sparse) or array (dense) layout
+    mmfield field;
+    mmsymmetry symmetry;
+
+    int nrows, ncols, nentries;
+
+    int count; // Number of entries read so far
+    int arow, acol; // Next position for array format
+} mmreader;
+
+/** Reads the next line into the reader's buffer. Returns false at the end of the file */
+static bool mmreader_readline(mmreader *r) {
+    r->buffer.count=0;
+    int ic=file_readlineintovarray(r->f, &r->buffer);
+    if (ic==EOF && r->buffer.count==0) return false;
+    if (r->buffer.count==0) varray_charwrite(&r->buffer, '\0');
+    r->line++;
+    return true;
+}
+
+/** Reads lines until a line that is neither blank nor a comment is found */
+static bool mmreader_readdataline(mmreader *r) {
+    while (mmreader_readline(r)) {
+        char *c=r->buffer.data;
+        while (*c==' ' || *c=='\t' || *c=='\r') c++;
+        if (*c!='\0' && *c!='%') return true;
+    }
+    return false;
+}
+
+/** Parses the banner and size line of a Matrix Market file */
+static matrixioerror mmreader_init(mmreader *r, FILE *f) {
+    char tok[5][64];
+    r->f=f;
+    r->line=0;
+    r->count=0;
+    r->arow=0; r->acol=0;
+    varray_charinit(&r->buffer);
+
+    if (!mmreader_readline(r)) return MATRIXIO_PARSE;
+    if (sscanf(r->buffer.data, "%63s %63s %63s %63s %63s", tok[0], tok[1], tok[2], tok[3], tok[4])!=5 ||
+        strcmp(tok[0], MATRIXIO_MMBANNER)!=0 ||
+        strcasecmp(tok[1], "matrix")!=0) return MATRIXIO_PARSE;
+
+    if (strcasecmp(tok[2], "coordinate")==0) r->coordinate=true;
+    else if (strcasecmp(tok[2], "array")==0) r->coordinate=false;
+    else return MATRIXIO_UNSPRTD;
+
+    if (strcasecmp(tok[3], "real")==0 || strcasecmp(tok[3], "double")==0) r->field=MM_REAL;
+    else if (strcasecmp(tok[3], "integer")==0) r->field=MM_INTEGER;
+    else if (strcasecmp(tok[3], "pattern")==0 && r->coordinate) r->field=MM_PATTERN;
+    else return MATRIXIO_UNSPRTD; // Complex matrices aren't supported
+
+    if (strcasecmp(tok[4], "general")==0) r->symmetry=MM_GENERAL;
+    else if (strcasecmp(tok[4], "symmetric")==0) r->symmetry=MM_SYMMETRIC;
+    else if (strcasecmp(tok[4], "skew-symmetric")==0) r->symmetry=MM_SKEWSYMMETRIC;
+    else return MATRIXIO_UNSPRTD;
+
+    /* Size line */
+    if (!mmreader_readdataline(r)) return MATRIXIO_PARSE;
+    if (r->coordinate) {
+        if (sscanf(r->buffer.data, "%d %d %d", &r->nrows, &r->ncols, &r->nentries)!=3) return MATRIXIO_PARSE;
+    } else {
+        if (sscanf(r->buffer.data, "%d %d", &r->nrows, &r->ncols)!=2) return MATRIXIO_PARSE;
+        if (r->nrows<0 || r->ncols<0) return MATRIXIO_PARSE;
+
+        size_t nentries, nrows=(size_t) r->nrows;
+        if (r->symmetry==MM_GENERAL) nentries=nrows*(size_t) r->ncols;
+        else if (r->symmetry==MM_SYMMETRIC) nentries=nrows*(nrows+1)/2;
+        else nentries=(nrows>0 ? nrows*(nrows-1)/2 : 0);
+        if (nentries>INT_MAX) return MATRIXIO_UNSPRTD; // Too large to index
+        r->nentries=(int) nentries;
+    }
+
+    if (r->nrows<0 || r->ncols<0 || r->nentries<0) return MATRIXIO_PARSE;
+    if (r->symmetry!=MM_GENERAL && r->nrows!=r->ncols) return MATRIXIO_PARSE;
+
+    /* Skew symmetric matrices in array format omit the diagonal */
+    if (!r->coordinate && r->symmetry==MM_SKEWSYMMETRIC) r->arow=1;
+
+    return MATRIXIO_OK;
+}
+
+/** Releases data held by the reader */
+static void mmreader_clear(mmreader *r) {
+    varray_charclear(&r->buffer);
+}
+
+/** Reads the next entry
+ * @param[in] r - the reader
+ * @param[out] i - row index (0-indexed)
+ * @param[out] j - column index (0-indexed)
+ * @param[out] val - the value
+ * @returns MATRIXIO_OK on success */
+static matrixioerror mmreader_next(mmreader *r, int *i, int *j, double *val) {
+    if (!mmreader_readdataline(r)) return MATRIXIO_PARSE;
+    char *c=r->buffer.data, *end;
+
+    if (r->coordinate) {
+        long row=strtol(c, &end, 10);
+        if (end==c) return MATRIXIO_PARSE;
+        c=end;
+        long col=strtol(c, &end, 10);
+        if (end==c) return MATRIXIO_PARSE;
+        c=end;
+        if (row<1 || row>r->nrows || col<1 || col>r->ncols) return MATRIXIO_PARSE;
+        *i=(int) row-1; *j=(int) col-1;
+    } else {
+        *i=r->arow; *j=r->acol;
+        r->arow++;
+        if (r->arow>=r->nrows) { // Advance to the next column
+            r->acol++;
+            r->arow=0;
+            if (r->symmetry==MM_SYMMETRIC) r->arow=r->acol;
+            else if (r->symmetry==MM_SKEWSYMMETRIC) r->arow=r->acol+1;
+        }
+    }
+
+    if (r->field==MM_PATTERN) {
+        *val=1.0;
+    } else {
+        *val=strtod(c, &end);
+        if (end==c) return MATRIXIO_PARSE;
+    }
+
+    r->count++;
+    return MATRIXIO_OK;
+}
+
+/** Number of entries that will be produced once symmetries are expanded */
+static size_t mmreader_maxentries(mmreader *r) {
+    return (r->symmetry==MM_GENERAL ? 1 : 2)*(size_t) r->nentries;
+}
+
+/** Value of the entry mirrored by a symmetry */
+static double mmreader_mirror(mmreader *r, double val) {
+    return (r->symmetry==MM_SKEWSYMMETRIC ? -val : val);
+}
+
+/* **********************************************************************
+ * Triplet to CCS conversion
+ * ********************************************************************** */
+
+/** Builds a CCS matrix directly from lists of (row, col, value) triplets.
+ *  Row indices are sorted within each column by a two pass counting sort and duplicate entries are summed.
+ * @param[in] nrows - number of rows
+ * @param[in] ncols - number of columns
+ * @param[in] n - number of triplets
+ * @param[in] ti - row indices
+ * @param[in] tj - column indices
+ * @param[in] tv - values (may be NULL for a pattern matrix)
+ * @param[out] out - initialized CCS structure to fill out
+ * @returns true on success */
+static bool matrixio_triplettoccs(int nrows, int ncols, int n, int *ti, int *tj, double *tv, sparseccs *out) {
+    int *rcount=MORPHO_MALLOC(sizeof(int)*(nrows+1));
+    int *perm=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    int *cptr=MORPHO_MALLOC(sizeof(int)*(ncols+1));
+    int *rix=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    double *values=(tv ? MORPHO_MALLOC(sizeof(double)*(n>0 ? n : 1)) : NULL);
+    bool success=false;
+
+    if (!(rcount && perm && cptr && rix && (!tv || values))) goto matrixio_triplettoccs_cleanup;
+
+    /* Sort triplets by row */
+    memset(rcount, 0, sizeof(int)*(nrows+1));
+    for (int k=0; k<n; k++) rcount[ti[k]+1]++;
+    for (int i=0; i<nrows; i++) rcount[i+1]+=rcount[i];
+    for (int k=0; k<n; k++) perm[rcount[ti[k]]++]=k;
+
+    /* Then distribute into columns, which leaves rows sorted within each column */
+    memset(cptr, 0, sizeof(int)*(ncols+1));
+    for (int k=0; k<n; k++) cptr[tj[k]+1]++;
+    for (int j=0; j<ncols; j++) cptr[j+1]+=cptr[j];
+
+    int *next=rcount; // Reuse as a column insertion pointer
+    if (ncols+1>nrows+1) {
+        next=MORPHO_REALLOC(rcount, sizeof(int)*(ncols+1));
+        if (!next) goto matrixio_triplettoccs_cleanup;
+        rcount=next;
+    }
+    memcpy(next, cptr, sizeof(int)*(ncols+1));
+
+    for (int p=0; p<n; p++) {
+        int k=perm[p], q=next[tj[k]]++;
+        rix[q]=ti[k];
+        if (values) values[q]=tv[k];
+    }
+
+    /* Sum duplicates, compacting the arrays in place */
+    int nnz=0;
+    for (int j=0; j<ncols; j++) {
+        int start=cptr[j], end=cptr[j+1];
+        cptr[j]=nnz;
+        for (int p=start; p<end; p++) {
+            if (nnz>cptr[j] && rix[nnz-1]==rix[p]) {
+                if (values) values[nnz-1]+=values[p];
+                continue;
+            }
+            rix[nnz]=rix[p];
+            if (values) values[nnz]=values[p];
+            nnz++;
+        }
+    }
+    cptr[ncols]=nnz;
+
+    out->nrows=nrows;
+    out->ncols=ncols;
+    out->nentries=nnz;
+    out->cptr=cptr;
+    out->rix=rix;
+    out->values=values;
+    success=true;
+
+matrixio_triplettoccs_cleanup:
+    if (rcount) MORPHO_FREE(rcount);
+    if (perm) MORPHO_FREE(perm);
+    if (!success) {
+        if (cptr) MORPHO_FREE(cptr);
+        if (rix) MORPHO_FREE(rix);
+        if (values) MORPHO_FREE(values);
+    }
+    return success;
+}
+
+/* **********************************************************************
+ * Loading from Matrix Market files
+ * ********************************************************************** */
+
+/** Loads a dense matrix from a Matrix Market file */
+static matrixioerror matrix_loadmarket(FILE *f, objectmatrix **out, int *line) {
+    mmreader r;
+    matrixioerror err=mmreader_init(&r, f);
+    objectmatrix *new=NULL;
+
+    if (err==MATRIXIO_OK && (size_t) r.nrows*(size_t) r.ncols>INT_MAX) err=MATRIXIO_UNSPRTD; // Too large to index
+
+    if (err==MATRIXIO_OK) {
+        new=object_newmatrix(r.nrows, r.ncols, true);
+        if (!new) err=MATRIXIO_ALLOC;
+    }
+
+    for (int k=0; err==MATRIXIO_OK && k<r.nentries; k++) {
+        int i, j;
+        double val;
+        err=mmreader_next(&r, &i, &j, &val);
+        if (err!=MATRIXIO_OK) break;
+
+        new->elements[j*r.nrows+i]+=val;
+        if (r.symmetry!=MM_GENERAL && i!=j) new->elements[i*r.nrows+j]+=mmreader_mirror(&r, val);
+    }
+
+    if (line) *line=r.line;
+    mmreader_clear(&r);
+
+    if (err==MATRIXIO_OK) *out=new;
+    else if (new) object_free((object *) new);
+
+    return err;
+}
+
+/** Loads a sparse matrix from a Matrix Market file, building the CCS arrays directly */
+static matrixioerror sparse_loadmarket(FILE *f, objectsparse **out, int *line) {
+    mmreader r;
+    matrixioerror err=mmreader_init(&r, f);
+    int *ti=NULL, *tj=NULL, n=0;
+    double *tv=NULL;
+    objectsparse *new=NULL;
+
+    size_t max=(err==MATRIXIO_OK ? mmreader_maxentries(&r) : 0);
+    if (max>INT_MAX) err=MATRIXIO_UNSPRTD; // Too many entries to index
+
+    if (err==MATRIXIO_OK) {
+        ti=MORPHO_MALLOC(sizeof(int)*(max>0 ? max : 1));
+        tj=MORPHO_MALLOC(sizeof(int)*(max>0 ? max : 1));
+        tv=MORPHO_MALLOC(sizeof(double)*(max>0 ? max : 1));
+        new=object_newsparse(NULL, NULL);
+        if (!(ti && tj && tv && new)) err=MATRIXIO_ALLOC;
+    }
+
+    for (int k=0; err==MATRIXIO_OK && k<r.nentries; k++) {
+        int i, j;
+        double val;
+        err=mmreader_next(&r, &i, &j, &val);
+        if (err!=MATRIXIO_OK) break;
+        if (!r.coordinate && val==0.0) continue; // Don't store explicit zeros from dense files
+
+        ti[n]=i; tj[n]=j; tv[n]=val; n++;
+        if (r.symmetry!=MM_GENERAL && i!=j) {
+            ti[n]=j; tj[n]=i; tv[n]=mmreader_mirror(&r, val); n++;
+        }
+    }
+
+    if (err==MATRIXIO_OK &&
+        !matrixio_triplettoccs(r.nrows, r.ncols, n, ti, tj, (r.field==MM_PATTERN ? NULL : tv), &new->ccs)) err=MATRIXIO_ALLOC;
+
+    if (line) *line=r.line;
+    mmreader_clear(&r);
+    if (ti) MORPHO_FREE(ti);
+    if (tj) MORPHO_FREE(tj);
+    if (tv) MORPHO_FREE(tv);
+
+    if (err==MATRIXIO_OK) *out=new;
+    else if (new) object_free((object *) new);
+
+    return err;
+}
+
+/* **********************************************************************
+ * Loading from binary files
+ * ********************************************************************** */
+
+/** Checks whether a file is in the binary format; the file position is restored */
+bool matrixio_isbinary(FILE *f) {
+    char magic[sizeof(MATRIXIO_BINARYMAGIC)-1];
+    long posn=ftell(f);
+    size_t n=fread(magic, 1, sizeof(magic), f);
+    fseek(f, posn, SEEK_SET);
+
+    return (n==sizeof(magic) && memcmp(magic, MATRIXIO_BINARYMAGIC, sizeof(magic))==0);
+}
+
+/** Validates a binary header found at the start of a mapped region */
+static matrixioerror matrixio_checkheader(char *base, size_t size, matrixioheader *hdr) {
+    if (size<sizeof(matrixioheader)) return MATRIXIO_PARSE;
+    memcpy(hdr, base, sizeof(matrixioheader));
+    if (memcmp(hdr->magic, MATRIXIO_BINARYMAGIC, sizeof(hdr->magic))!=0) return MATRIXIO_PARSE;
+    if (hdr->version!=MATRIXIO_BINARYVERSION) return MATRIXIO_UNSPRTD;
+    if (hdr->kind!=MATRIXIO_DENSE && hdr->kind!=MATRIXIO_SPARSE && hdr->kind!=MATRIXIO_PATTERN) return MATRIXIO_UNSPRTD;
+    if (hdr->nrows<0 || hdr->ncols<0 || hdr->nentries<0 || hdr->nentries>INT_MAX) return MATRIXIO_PARSE;
+    return MATRIXIO_OK;
+}
+
+/** Reads CCS arrays stored in binary format from a region of memory
+ * @param[in] base - start of the region
+ * @param[in] size - size of the region
+ * @param[in|out] offset - offset of the arrays; updated to point past them on exit
+ * @param[in] nrows - number of rows
+ * @param[in] ncols - number of columns
+ * @param[in] nentries - number of entries
+ * @param[in] values - whether the values array is present
+ * @param[out] out - CCS structure to fill out
+ * @returns MATRIXIO_OK on success */
+matrixioerror matrixio_readccs(char *base, size_t size, size_t *offset, int nrows, int ncols, int nentries, bool values, sparseccs *out) {
+    size_t cptrsize=sizeof(int32_t)*((size_t) ncols+1),
+           rixsize=sizeof(int32_t)*(size_t) nentries,
+           valsize=(values ? sizeof(double)*(size_t) nentries : 0);
+    size_t start=*offset, rixstart=start+MATRIXIO_ALIGN(cptrsize), valstart=rixstart+MATRIXIO_ALIGN(rixsize);
+
+    if (valstart+valsize>size) return MATRIXIO_PARSE;
+
+    sparseccs_init(out);
+    out->cptr=MORPHO_MALLOC(cptrsize);
+    out->rix=MORPHO_MALLOC(rixsize>0 ? rixsize : sizeof(int));
+    if (values) out->values=MORPHO_MALLOC(valsize>0 ? valsize : sizeof(double));
+    if (!(out->cptr && out->rix && (!values || out->values))) {
+        sparseccs_clear(out);
+        return MATRIXIO_ALLOC;
+    }
+
+    memcpy(out->cptr, base+start, cptrsize);
+    memcpy(out->rix, base+rixstart, rixsize);
+    if (values) memcpy(out->values, base+valstart, valsize);
+    out->nrows=nrows;
+    out->ncols=ncols;
+    out->nentries=nentries;
+
+    /* Check the structure is consistent */
+    bool valid=(out->cptr[0]==0 && out->cptr[ncols]==nentries);
+    for (int j=0; valid && j<ncols; j++) if (out->cptr[j+1]<out->cptr[j]) valid=false;
+    for (int k=0; valid && k<nentries; k++) if (out->rix[k]<0 || out->rix[k]>=nrows) valid=false;
+    if (!valid) {
+        sparseccs_clear(out);
+        return MATRIXIO_PARSE;
+    }
+
+    *offset=valstart+MATRIXIO_ALIGN(valsize);
+    return MATRIXIO_OK;
+}
+
+/** Maps a file into memory for reading; release the region with munmap */
+bool matrixio_map(FILE *f, char **base, size_t *size) {
+    struct stat st;
+    if (fstat(fileno(f), &st)!=0 || st.st_size<=0) return false;
+
+    void *map=mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    if (map==MAP_FAILED) return false;
+
+    *base=map;
+    *size=(size_t) st.st_size;
+    return true;
+}
+
+/** Loads a dense matrix from a binary file */
+static matrixioerror matrix_loadbinary(FILE *f, objectmatrix **out) {
+    char *base; size_t size;
+    matrixioheader hdr;
+    if (!matrixio_map(f, &base, &size)) return MATRIXIO_PARSE;
+
+    matrixioerror err=matrixio_checkheader(base, size, &hdr);
+    objectmatrix *new=NULL;
+
+    if (err==MATRIXIO_OK && hdr.kind==MATRIXIO_DENSE) {
+        size_t nel=(size_t) hdr.nrows*(size_t) hdr.ncols;
+        if (sizeof(matrixioheader)+nel*sizeof(double)>size) err=MATRIXIO_PARSE;
+        else if (nel>INT_MAX) err=MATRIXIO_UNSPRTD;
+        else if (!(new=object_newmatrix(hdr.nrows, hdr.ncols, false))) err=MATRIXIO_ALLOC;
+        else memcpy(new->elements, base+sizeof(matrixioheader), nel*sizeof(double));
+    } else if (err==MATRIXIO_OK) { // Convert a stored sparse matrix to dense
+        sparseccs ccs;
+        size_t offset=sizeof(matrixioheader);
+        if ((size_t) hdr.nrows*(size_t) hdr.ncols>INT_MAX) err=MATRIXIO_UNSPRTD;
+        else err=matrixio_readccs(base, size, &offset, hdr.nrows, hdr.ncols, (int) hdr.nentries, hdr.kind==MATRIXIO_SPARSE, &ccs);
+        if (err==MATRIXIO_OK) {
+            new=object_newmatrix(hdr.nrows, hdr.ncols, true);
+            if (!new) err=MATRIXIO_ALLOC;
+            else for (int j=0; j<ccs.ncols; j++) {
+                for (int k=ccs.cptr[j]; k<ccs.cptr[j+1]; k++) {
+                    new->elements[j*ccs.nrows+ccs.rix[k]]=(ccs.values ? ccs.values[k] : 1.0);
+                }
+            }
+            sparseccs_clear(&ccs);
+        }
+    }
+
+    munmap(base, size);
+    if (err==MATRIXIO_OK) *out=new;
+    return err;
+}
+
+/** Loads a sparse matrix from a binary file */
+static matrixioerror sparse_loadbinary(FILE *f, objectsparse **out) {
+    char *base; size_t size;
+    matrixioheader hdr;
+    if (!matrixio_map(f, &base, &size)) return MATRIXIO_PARSE;
+
+    matrixioerror err=matrixio_checkheader(base, size, &hdr);
+    objectsparse *new=NULL;
+
+    if (err==MATRIXIO_OK && hdr.kind==MATRIXIO_DENSE) { // Convert a stored dense matrix to sparse
+        size_t nel=(size_t) hdr.nrows*(size_t) hdr.ncols;
+        objectmatrix m = MORPHO_STATICMATRIX((double *) (base+sizeof(matrixioheader)), hdr.nrows, hdr.ncols);
+        int n=0, *ti=NULL, *tj=NULL;
+        double *tv=NULL;
+
+        if (sizeof(matrixioheader)+nel*sizeof(double)>size || nel>INT_MAX) err=MATRIXIO_PARSE;
+        else {
+            ti=MORPHO_MALLOC(sizeof(int)*(nel>0 ? nel : 1));
+            tj=MORPHO_MALLOC(sizeof(int)*(nel>0 ? nel : 1));
+            tv=MORPHO_MALLOC(sizeof(double)*(nel>0 ? nel : 1));
+            new=object_newsparse(NULL, NULL);
+            if (!(ti && tj && tv && new)) err=MATRIXIO_ALLOC;
+        }
+
+        for (int j=0; err==MATRIXIO_OK && j<m.ncols; j++) {
+            for (int i=0; i<m.nrows; i++) {
+                double val=m.elements[j*m.nrows+i];
+                if (val!=0.0) { ti[n]=i; tj[n]=j; tv[n]=val; n++; }
+            }
+        }
+
+        if (err==MATRIXIO_OK && !matrixio_triplettoccs(m.nrows, m.ncols, n, ti, tj, tv, &new->ccs)) err=MATRIXIO_ALLOC;
+
+        if (ti) MORPHO_FREE(ti);
+        if (tj) MORPHO_FREE(tj);
+        if (tv) MORPHO_FREE(tv);
+    } else if (err==MATRIXIO_OK) {
+        size_t offset=sizeof(matrixioheader);
+        new=object_newsparse(NULL, NULL);
+        if (!new) err=MATRIXIO_ALLOC;
+        else err=matrixio_readccs(base, size, &offset, hdr.nrows, hdr.ncols, (int) hdr.nentries, hdr.kind==MATRIXIO_SPARSE, &new->ccs);
+    }
+
+    munmap(base, size);
+    if (err==MATRIXIO_OK) *out=new;
+    else if (new) object_free((object *) new);
+    return err;
+}
+
+/* **********************************************************************
+ * Loaders
+ * ********************************************************************** */
+
+/** Loads a dense matrix from a file, detecting the format automatically
+ * @param[in] file - file name
+ * @param[out] out - the new matrix
+ * @param[out] line - line number for parse errors
+ * @returns MATRIXIO_OK on success */
+matrixioerror matrix_load(char *file, objectmatrix **out, int *line) {
+    FILE *f = file_openrelative(file, "rb");
+    if (!f) return MATRIXIO_NOTFOUND;
+
+    matrixioerror err;
+    if (matrixio_isbinary(f)) err=matrix_loadbinary(f, out);
+    else err=matrix_loadmarket(f, out, line);
+
+    fclose(f);
+    return err;
+}
+
+/** Loads a sparse matrix from a file, detecting the format automatically */
+matrixioerror sparse_load(char *file, objectsparse **out, int *line) {
+    FILE *f = file_openrelative(file, "rb");
+    if (!f) return MATRIXIO_NOTFOUND;
+
+    matrixioerror err;
+    if (matrixio_isbinary(f)) err=sparse_loadbinary(f, out);
+    else err=sparse_loadmarket(f, out, line);
+
+    fclose(f);
+    return err;
+}
+
+/* **********************************************************************
+ * Writers
+ * ********************************************************************** */
+
+/** Writes a dense matrix in Matrix Market array format */
+matrixioerror matrix_savemarket(objectmatrix *m, FILE *f) {
+    fprintf(f, "%s matrix array real general\n", MATRIXIO_MMBANNER);
+    fprintf(f, "%u %u\n", m->nrows, m->ncols);
+
+    unsigned int nel=m->nrows*m->ncols;
+    for (unsigned int i=0; i<nel; i++) {
+        if (fprintf(f, "%.17g\n", m->elements[i])<0) return MATRIXIO_WRITE;
+    }
+
+    return MATRIXIO_OK;
+}
+
+/** Writes a sparse matrix in Matrix Market coordinate format
+ * @warning the matrix must be available in CCS format */
+matrixioerror sparse_savemarket(objectsparse *s, FILE *f) {
+    sparseccs *ccs=&s->ccs;
+
+    fprintf(f, "%s matrix coordinate %s general\n", MATRIXIO_MMBANNER, (ccs->values ? "real" : "pattern"));
+    fprintf(f, "%i %i %i\n", ccs->nrows, ccs->ncols, ccs->nentries);
+
+    for (int j=0; j<ccs->ncols; j++) {
+        for (int k=ccs->cptr[j]; k<ccs->cptr[j+1]; k++) {
+            int err;
+            if (ccs->values) err=fprintf(f, "%i %i %.17g\n", ccs->rix[k]+1, j+1, ccs->values[k]);
+            else err=fprintf(f, "%i %i\n", ccs->rix[k]+1, j+1);
+            if (err<0) return MATRIXIO_WRITE;
+        }
+    }
+
+    return MATRIXIO_OK;
+}
+
+/** Writes zero bytes to pad an array to the alignment boundary */
+static bool matrixio_pad(FILE *f, size_t n) {
+    char zero[8] = { 0 };
+    size_t npad=MATRIXIO_ALIGN(n)-n;
+    return (npad==0 || fwrite(zero, 1, npad, f)==npad);
+}
+
+/** Writes a header for the binary format */
+static bool matrixio_writeheader(FILE *f, matrixiokind kind, int nrows, int ncols, int64_t nentries) {
+    matrixioheader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, MATRIXIO_BINARYMAGIC, sizeof(hdr.magic));
+    hdr.version=MATRIXIO_BINARYVERSION;
+    hdr.kind=kind;
+    hdr.nrows=nrows;
+    hdr.ncols=ncols;
+    hdr.nentries=nentries;
+    return fwrite(&hdr, sizeof(hdr), 1, f)==1;
+}
+
+/** Writes the arrays of a CCS matrix in binary format */
+bool matrixio_writeccs(FILE *f, sparseccs *ccs) {
+    size_t cptrsize=sizeof(int32_t)*((size_t) ccs->ncols+1),
+           rixsize=sizeof(int32_t)*(size_t) ccs->nentries;
+
+    if (ccs->cptr) {
+        if (fwrite(ccs->cptr, 1, cptrsize, f)!=cptrsize) return false;
+    } else { // An empty matrix may lack a column pointer array
+        int32_t zero=0;
+        for (int j=0; j<=ccs->ncols; j++) if (fwrite(&zero, sizeof(zero), 1, f)!=1) return false;
+    }
+    if (!matrixio_pad(f, cptrsize)) return false;
+
+    if (rixsize>0 && fwrite(ccs->rix, 1, rixsize, f)!=rixsize) return false;
+    if (!matrixio_pad(f, rixsize)) return false;
+
+    if (ccs->values && ccs->nentries>0) {
+        if (fwrite(ccs->values, sizeof(double), ccs->nentries, f)!=ccs->nentries) return false;
+    }
+
+    return true;
+}
+
+/** Writes a dense matrix in binary format */
+matrixioerror matrix_savebinary(objectmatrix *m, FILE *f) {
+    size_t nel=(size_t) m->nrows*(size_t) m->ncols;
+    if (!matrixio_writeheader(f, MATRIXIO_DENSE, m->nrows, m->ncols, nel)) return MATRIXIO_WRITE;
+    if (nel>0 && fwrite(m->elements, sizeof(double), nel, f)!=nel) return MATRIXIO_WRITE;
+    return MATRIXIO_OK;
+}
+
+/** Writes a sparse matrix in binary format
+ * @warning the matrix must be available in CCS format */
+matrixioerror sparse_savebinary(objectsparse *s, FILE *f) {
+    sparseccs *ccs=&s->ccs;
+    if (!matrixio_writeheader(f, (ccs->values ? MATRIXIO_SPARSE : MATRIXIO_PATTERN), ccs->nrows, ccs->ncols, ccs->nentries)) return MATRIXIO_WRITE;
+    if (!matrixio_writeccs(f, ccs)) return MATRIXIO_WRITE;
+    return MATRIXIO_OK;
+}
+
+/* **********************************************************************
+ * Interface for veneer classes
+ * ********************************************************************** */
+
+/** Decides whether to use the Matrix Market format, from an explicit format label or, if none is given, the file extension
+ * @param[in] fname - file name
+ * @param[in] format - nil or a string
+ * @param[out] market - true if Matrix Market should be used
+ * @returns false if the format label isn't recognized */
+bool matrixio_usemarket(char *fname, value format, bool *market) {
+    if (MORPHO_ISSTRING(format)) {
+        char *label=MORPHO_GETCSTRING(format);
+        if (strcasecmp(label, MATRIXIO_MATRIXMARKETFORMAT)==0 ||
+            strcasecmp(label, MATRIXIO_MMEXTENSION)==0) *market=true;
+        else if (strcasecmp(label, MATRIXIO_BINARYFORMAT)==0) *market=false;
+        else return false;
+    } else if (MORPHO_ISNIL(format)) {
+        char *ext=strrchr(fname, '.');
+        *market=(ext && strcasecmp(ext+1, MATRIXIO_MMEXTENSION)==0);
+    } else return false;
+
+    return true;
+}
+
+/** Raises an error corresponding to a matrixioerror */
+static void matrixio_raiseerror(vm *v, matrixioerror err, char *file, int line) {
+    switch (err) {
+        case MATRIXIO_OK: break;
+        case MATRIXIO_NOTFOUND: morpho_runtimeerror(v, MATRIXIO_FILENOTFOUND, file); break;
+        case MATRIXIO_PARSE: morpho_runtimeerror(v, MATRIXIO_PARSEERR, line); break;
+        case MATRIXIO_UNSPRTD: morpho_runtimeerror(v, MATRIXIO_UNSUPPORTED); break;
+        case MATRIXIO_ALLOC: morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED); break;
+        case MATRIXIO_WRITE: morpho_runtimeerror(v, MATRIXIO_WRITEFAILED, file); break;
+    }
+}
+
+/** Saves a matrix, raising an error on failure */
+bool matrix_save(vm *v, objectmatrix *m, char *file, value format) {
+    bool market;
+    if (!matrixio_usemarket(file, format, &market)) {
+        morpho_runtimeerror(v, MATRIXIO_SAVEARGS);
+        return false;
+    }
+
+    FILE *f = file_openrelative(file, "wb");
+    if (!f) { matrixio_raiseerror(v, MATRIXIO_WRITE, file, 0); return false; }
+
+    matrixioerror err=(market ? matrix_savemarket(m, f) : matrix_savebinary(m, f));
+    if (fclose(f)!=0 && err==MATRIXIO_OK) err=MATRIXIO_WRITE;
+
+    matrixio_raiseerror(v, err, file, 0);
+    return (err==MATRIXIO_OK);
+}
+
+/** Saves a sparse matrix, raising an error on failure
+ * @warning the matrix must be available in CCS format */
+bool sparse_save(vm *v, objectsparse *s, char *file, value format) {
+    bool market;
+    if (!matrixio_usemarket(file, format, &market)) {
+        morpho_runtimeerror(v, MATRIXIO_SAVEARGS);
+        return false;
+    }
+
+    FILE *f = file_openrelative(file, "wb");
+    if (!f) { matrixio_raiseerror(v, MATRIXIO_WRITE, file, 0); return false; }
+
+    matrixioerror err=(market ? sparse_savemarket(s, f) : sparse_savebinary(s, f));
+    if (fclose(f)!=0 && err==MATRIXIO_OK) err=MATRIXIO_WRITE;
+
+    matrixio_raiseerror(v, err, file, 0);
+    return (err==MATRIXIO_OK);
+}
+
+/** Loads a matrix, raising an error on failure */
+objectmatrix *matrix_loadfile(vm *v, char *file) {
+    objectmatrix *new=NULL;
+    int line=0;
+    matrixioerror err=matrix_load(file, &new, &line);
+    matrixio_raiseerror(v, err, file, line);
+    return (err==MATRIXIO_OK ? new : NULL);
+}
+
+/** Loads a sparse matrix, raising an error on failure */
+objectsparse *sparse_loadfile(vm *v, char *file) {
+    objectsparse *new=NULL;
+    int line=0;
+    matrixioerror err=sparse_load(file, &new, &line);
+    matrixio_raiseerror(v, err, file, line);
+    return (err==MATRIXIO_OK ? new : NULL);
+}
+
+/* **********************************************************************
+ * Initialization
+ * ********************************************************************** */
+
+void matrixio_initialize(void) {
+    morpho_defineerror(MATRIXIO_FILENOTFOUND, ERROR_HALT, MATRIXIO_FILENOTFOUND_MSG);
+    morpho_defineerror(MATRIXIO_PARSEERR, ERROR_HALT, MATRIXIO_PARSEERR_MSG);
+    morpho_defineerror(MATRIXIO_UNSUPPORTED, ERROR_HALT, MATRIXIO_UNSUPPORTED_MSG);
+    morpho_defineerror(MATRIXIO_WRITEFAILED, ERROR_HALT, MATRIXIO_WRITEFAILED_MSG);
+    morpho_defineerror(MATRIXIO_SAVEARGS, ERROR_HALT, MATRIXIO_SAVEARGS_MSG);
+}
@@ -0,0 +1,98 @@
+/** @file matrixio.h
+ *  @author T J Atherton
+ *
+ *  @brief Reading and writing of dense and sparse matrices in Matrix Market and binary formats
+ */
+
+#ifndef matrixio_h
+#define matrixio_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include "matrix.h"
+#include "sparse.h"
+
+/* -------------------------------------------------------
+ * File formats
+ * ------------------------------------------------------- */
+
+/** Matrix Market files are identified by this banner on the first line */
+#define MATRIXIO_MMBANNER                 "%%MatrixMarket"
+
+/** File extension that selects the Matrix Market format on save */
+#define MATRIXIO_MMEXTENSION              "mtx"
+
+/** Format labels accepted by the save methods */
+#define MATRIXIO_MATRIXMARKETFORMAT       "matrixmarket"
+#define MATRIXIO_BINARYFORMAT             "binary"
+
+/** The binary format consists of a fixed size header followed by the data arrays.
+    Each array begins on an 8 byte boundary so that a file can be mapped into memory and used in place.
+    Dense matrices:   double elements[nrows*ncols] (column major)
+    Sparse matrices:  int32 cptr[ncols+1], int32 rix[nentries], double values[nentries] (values omitted for pattern matrices) */
+#define MATRIXIO_BINARYMAGIC              "MORPHOLA"
+#define MATRIXIO_BINARYVERSION            1
+
+typedef enum { MATRIXIO_DENSE=1, MATRIXIO_SPARSE=2, MATRIXIO_PATTERN=3 } matrixiokind;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;
+    int32_t nrows;
+    int32_t ncols;
+    int64_t nentries;
+} matrixioheader;
+
+/** Rounds a byte count up to the alignment used for arrays in the binary format */
+#define MATRIXIO_ALIGN(n) (((n)+7) & ~((size_t) 7))
+
+/* -------------------------------------------------------
+ * Errors
+ * ------------------------------------------------------- */
+
+#define MATRIXIO_FILENOTFOUND             "MtrxFlNtFnd"
+#define MATRIXIO_FILENOTFOUND_MSG         "Matrix file '%s' not found."
+
+#define MATRIXIO_PARSEERR                 "MtrxFlPrsErr"
+#define MATRIXIO_PARSEERR_MSG             "Parse error in matrix file at line %i."
+
+#define MATRIXIO_UNSUPPORTED              "MtrxFlUnsprtd"
+#define MATRIXIO_UNSUPPORTED_MSG          "Unsupported matrix file format."
+
+#define MATRIXIO_WRITEFAILED              "MtrxFlWrtFld"
+#define MATRIXIO_WRITEFAILED_MSG          "Couldn't write matrix file '%s'."
+
+#define MATRIXIO_SAVEARGS                 "MtrxSvArgs"
+#define MATRIXIO_SAVEARGS_MSG             "Method 'save' expects a file name and, optionally, a format."
+
+typedef enum { MATRIXIO_OK, MATRIXIO_NOTFOUND, MATRIXIO_PARSE, MATRIXIO_UNSPRTD, MATRIXIO_ALLOC, MATRIXIO_WRITE } matrixioerror;
+
+/* -------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------- */
+
+bool matrixio_isbinary(FILE *f);
+bool matrixio_map(FILE *f, char **base, size_t *size);
+bool matrixio_usemarket(char *fname, value format, bool *market);
+
+bool matrixio_writeccs(FILE *f, sparseccs *ccs);
+matrixioerror matrixio_readccs(char *base, size_t size, size_t *offset, int nrows, int ncols, int nentries, bool values, sparseccs *out);
+
+matrixioerror matrix_savemarket(objectmatrix *m, FILE *f);
+matrixioerror matrix_savebinary(objectmatrix *m, FILE *f);
+matrixioerror sparse_savemarket(objectsparse *s, FILE *f);
+matrixioerror sparse_savebinary(objectsparse *s, FILE *f);
+
+matrixioerror matrix_load(char *file, objectmatrix **out, int *line);
+matrixioerror sparse_load(char *file, objectsparse **out, int *line);
+
+bool matrix_save(vm *v, objectmatrix *m, char *file, value format);
+bool sparse_save(vm *v, objectsparse *s, char *file, value format);
+
+objectmatrix *matrix_loadfile(vm *v, char *file);
+objectsparse *sparse_loadfile(vm *v, char *file);
+
+void matrixio_initialize(void);
+
+#endif /* matrixio_h */
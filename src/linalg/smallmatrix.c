@@ -0,0 +1,364 @@
+/** @file smallmatrix.c
+ *  @author T J Atherton
+ *
+ *  @brief Closed form kernels for matrices of size up to 4x4
+ */
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include "smallmatrix.h"
+
+/* **********************************************************************
+ * Determinants
+ * ********************************************************************** */
+
+/* All arrays are column-major, so that element (i,j) of an n x n matrix is a[i+j*n] */
+
+static inline double smallmatrix_det2(double *a) {
+    return a[0]*a[3] - a[2]*a[1];
+}
+
+static inline double smallmatrix_det3(double *a) {
+    return a[0]*(a[4]*a[8] - a[7]*a[5])
+         - a[3]*(a[1]*a[8] - a[7]*a[2])
+         + a[6]*(a[1]*a[5] - a[4]*a[2]);
+}
+
+/** The 4x4 determinant and inverse are computed from the 2x2 minors of the first two and last two columns */
+#define S4(i,j) (a[i+4*j])
+
+typedef struct {
+    double s[6], c[6];
+} smallmatrix_minors4;
+
+static inline void smallmatrix_minors(double *a, smallmatrix_minors4 *m) {
+    m->s[0] = S4(0,0)*S4(1,1) - S4(0,1)*S4(1,0);
+    m->s[1] = S4(0,0)*S4(2,1) - S4(0,1)*S4(2,0);
+    m->s[2] = S4(0,0)*S4(3,1) - S4(0,1)*S4(3,0);
+    m->s[3] = S4(1,0)*S4(2,1) - S4(1,1)*S4(2,0);
+    m->s[4] = S4(1,0)*S4(3,1) - S4(1,1)*S4(3,0);
+    m->s[5] = S4(2,0)*S4(3,1) - S4(2,1)*S4(3,0);
+
+    m->c[5] = S4(2,2)*S4(3,3) - S4(2,3)*S4(3,2);
+    m->c[4] = S4(1,2)*S4(3,3) - S4(1,3)*S4(3,2);
+    m->c[3] = S4(1,2)*S4(2,3) - S4(1,3)*S4(2,2);
+    m->c[2] = S4(0,2)*S4(3,3) - S4(0,3)*S4(3,2);
+    m->c[1] = S4(0,2)*S4(2,3) - S4(0,3)*S4(2,2);
+    m->c[0] = S4(0,2)*S4(1,3) - S4(0,3)*S4(1,2);
+}
+
+static inline double smallmatrix_det4minors(smallmatrix_minors4 *m) {
+    return m->s[0]*m->c[5] - m->s[1]*m->c[4] + m->s[2]*m->c[3]
+         + m->s[3]*m->c[2] - m->s[4]*m->c[1] + m->s[5]*m->c[0];
+}
+
+/** Computes the determinant of an n x n matrix with n<=SMALLMATRIX_MAXSIZE */
+double smallmatrix_det(int n, double *a) {
+    switch (n) {
+        case 1: return a[0];
+        case 2: return smallmatrix_det2(a);
+        case 3: return smallmatrix_det3(a);
+        case 4: {
+            smallmatrix_minors4 m;
+            smallmatrix_minors(a, &m);
+            return smallmatrix_det4minors(&m);
+        }
+    }
+    return 0.0;
+}
+
+/* **********************************************************************
+ * Inverses
+ * ********************************************************************** */
+
+/** Tests whether a matrix with determinant det is singular to working precision. By Hadamard's inequality
+ *  |det| is at most the product of the norms of the columns, and their ratio measures how close the columns
+ *  are to being linearly dependent. */
+static inline bool smallmatrix_issingular(const int n, double *a, double det) {
+    double bound=1.0;
+    for (int j=0; j<n; j++) {
+        double norm=0.0;
+        for (int i=0; i<n; i++) norm+=a[i+j*n]*a[i+j*n];
+        bound*=sqrt(norm);
+    }
+    return !(fabs(det)>n*DBL_EPSILON*bound);
+}
+
+static inline bool smallmatrix_inverse2(double *a, double *out) {
+    double det=smallmatrix_det2(a);
+    if (smallmatrix_issingular(2, a, det)) return false;
+    double r=1.0/det, a0=a[0];
+
+    out[1]=-a[1]*r;
+    out[2]=-a[2]*r;
+    out[0]=a[3]*r;
+    out[3]=a0*r;
+    return true;
+}
+
+static inline bool smallmatrix_inverse3(double *a, double *out) {
+    double det=smallmatrix_det3(a);
+    if (smallmatrix_issingular(3, a, det)) return false;
+    double r=1.0/det, b[9];
+
+    b[0] = (a[4]*a[8] - a[7]*a[5])*r;
+    b[3] = (a[6]*a[5] - a[3]*a[8])*r;
+    b[6] = (a[3]*a[7] - a[6]*a[4])*r;
+    b[1] = (a[7]*a[2] - a[1]*a[8])*r;
+    b[4] = (a[0]*a[8] - a[6]*a[2])*r;
+    b[7] = (a[6]*a[1] - a[0]*a[7])*r;
+    b[2] = (a[1]*a[5] - a[4]*a[2])*r;
+    b[5] = (a[3]*a[2] - a[0]*a[5])*r;
+    b[8] = (a[0]*a[4] - a[3]*a[1])*r;
+
+    memcpy(out, b, sizeof(b));
+    return true;
+}
+
+static inline bool smallmatrix_inverse4(double *a, double *out) {
+    smallmatrix_minors4 m;
+    smallmatrix_minors(a, &m);
+    double det=smallmatrix_det4minors(&m);
+    if (smallmatrix_issingular(4, a, det)) return false;
+    double r=1.0/det, b[16];
+    double *s=m.s, *c=m.c;
+
+    b[0]  = ( S4(1,1)*c[5] - S4(2,1)*c[4] + S4(3,1)*c[3])*r;
+    b[1]  = (-S4(1,0)*c[5] + S4(2,0)*c[4] - S4(3,0)*c[3])*r;
+    b[2]  = ( S4(1,3)*s[5] - S4(2,3)*s[4] + S4(3,3)*s[3])*r;
+    b[3]  = (-S4(1,2)*s[5] + S4(2,2)*s[4] - S4(3,2)*s[3])*r;
+
+    b[4]  = (-S4(0,1)*c[5] + S4(2,1)*c[2] - S4(3,1)*c[1])*r;
+    b[5]  = ( S4(0,0)*c[5] - S4(2,0)*c[2] + S4(3,0)*c[1])*r;
+    b[6]  = (-S4(0,3)*s[5] + S4(2,3)*s[2] - S4(3,3)*s[1])*r;
+    b[7]  = ( S4(0,2)*s[5] - S4(2,2)*s[2] + S4(3,2)*s[1])*r;
+
+    b[8]  = ( S4(0,1)*c[4] - S4(1,1)*c[2] + S4(3,1)*c[0])*r;
+    b[9]  = (-S4(0,0)*c[4] + S4(1,0)*c[2] - S4(3,0)*c[0])*r;
+    b[10] = ( S4(0,3)*s[4] - S4(1,3)*s[2] + S4(3,3)*s[0])*r;
+    b[11] = (-S4(0,2)*s[4] + S4(1,2)*s[2] - S4(3,2)*s[0])*r;
+
+    b[12] = (-S4(0,1)*c[3] + S4(1,1)*c[1] - S4(2,1)*c[0])*r;
+    b[13] = ( S4(0,0)*c[3] - S4(1,0)*c[1] + S4(2,0)*c[0])*r;
+    b[14] = (-S4(0,3)*s[3] + S4(1,3)*s[1] - S4(2,3)*s[0])*r;
+    b[15] = ( S4(0,2)*s[3] - S4(1,2)*s[1] + S4(2,2)*s[0])*r;
+
+    memcpy(out, b, sizeof(b));
+    return true;
+}
+
+#undef S4
+
+/** Inverts an n x n matrix with n<=SMALLMATRIX_MAXSIZE
+ * @param[in] n - size of the matrix
+ * @param[in] a - the matrix
+ * @param[out] out - the inverse; may be the same as a
+ * @returns false if the matrix is singular to working precision */
+bool smallmatrix_inverse(int n, double *a, double *out) {
+    if (n==1) {
+        if (a[0]==0.0) return false;
+        out[0]=1.0/a[0];
+        return true;
+    }
+    if (n<1 || n>SMALLMATRIX_MAXSIZE) return false;
+
+    /* The determinant of a matrix with very small or large elements under- or overflows, so each column is
+       first scaled exactly by a power of two to bring its largest element into [0.5, 1). If a = s d with d
+       diagonal, the inverse is d^-1 s^-1, i.e. row j of the inverse of s is scaled by the same power. */
+    double s[SMALLMATRIX_MAXSIZE*SMALLMATRIX_MAXSIZE];
+    int e[SMALLMATRIX_MAXSIZE];
+    for (int j=0; j<n; j++) {
+        double max=0.0;
+        for (int i=0; i<n; i++) if (fabs(a[i+j*n])>max) max=fabs(a[i+j*n]);
+        if (max==0.0 || !isfinite(max)) return false;
+        frexp(max, &e[j]);
+        for (int i=0; i<n; i++) s[i+j*n]=ldexp(a[i+j*n], -e[j]);
+    }
+
+    bool success=false;
+    switch (n) {
+        case 2: success=smallmatrix_inverse2(s, out); break;
+        case 3: success=smallmatrix_inverse3(s, out); break;
+        case 4: success=smallmatrix_inverse4(s, out); break;
+    }
+
+    if (success) for (int j=0; j<n; j++) for (int i=0; i<n; i++) out[j+i*n]=ldexp(out[j+i*n], -e[j]);
+    return success;
+}
+
+/* **********************************************************************
+ * Products
+ * ********************************************************************** */
+
+/** Product kernel; when called with constant dimensions the loops are fully unrolled */
+static inline void smallmatrix_mulkernel(const int m, const int k, const int n, double *a, double *b, double *out) {
+    for (int j=0; j<n; j++) {
+        for (int i=0; i<m; i++) {
+            double sum=0.0;
+            for (int l=0; l<k; l++) sum+=a[i+l*m]*b[l+j*k];
+            out[i+j*m]=sum;
+        }
+    }
+}
+
+/** Computes the product a*b of an m x k matrix a and a k x n matrix b
+ * @warning out must not be the same as a or b */
+void smallmatrix_mul(int m, int k, int n, double *a, double *b, double *out) {
+    if (m==k && k==n) {
+        switch (n) {
+            case 2: smallmatrix_mulkernel(2, 2, 2, a, b, out); return;
+            case 3: smallmatrix_mulkernel(3, 3, 3, a, b, out); return;
+            case 4: smallmatrix_mulkernel(4, 4, 4, a, b, out); return;
+        }
+    } else if (m==k && n==1) { // Matrix-vector products
+        switch (m) {
+            case 2: smallmatrix_mulkernel(2, 2, 1, a, b, out); return;
+            case 3: smallmatrix_mulkernel(3, 3, 1, a, b, out); return;
+            case 4: smallmatrix_mulkernel(4, 4, 1, a, b, out); return;
+        }
+    }
+    smallmatrix_mulkernel(m, k, n, a, b, out);
+}
+
+/* **********************************************************************
+ * Linear systems
+ * ********************************************************************** */
+
+/** LU factorization with partial pivoting followed by forward and back substitution; when called with
+ *  constant n the loops are fully unrolled. A pivot that is negligible relative to the largest element of
+ *  the same column of a is treated as zero, so that matrices that are singular to working precision are
+ *  reported whatever the scale of their columns. */
+static inline bool smallmatrix_solvekernel(const int n, int nrhs, double *a, double *b, double *out) {
+    double lu[SMALLMATRIX_MAXSIZE*SMALLMATRIX_MAXSIZE], tol[SMALLMATRIX_MAXSIZE];
+    int perm[SMALLMATRIX_MAXSIZE];
+
+    for (int j=0; j<n; j++) {
+        tol[j]=0.0;
+        for (int i=0; i<n; i++) {
+            lu[i+j*n]=a[i+j*n];
+            if (fabs(a[i+j*n])>tol[j]) tol[j]=fabs(a[i+j*n]);
+        }
+        tol[j]*=n*DBL_EPSILON;
+    }
+
+    for (int k=0; k<n; k++) {
+        int p=k; // Find the pivot
+        for (int i=k+1; i<n; i++) if (fabs(lu[i+k*n])>fabs(lu[p+k*n])) p=i;
+        perm[k]=p;
+        if (!(fabs(lu[p+k*n])>tol[k])) return false;
+
+        if (p!=k) for (int j=0; j<n; j++) {
+            double tmp=lu[k+j*n]; lu[k+j*n]=lu[p+j*n]; lu[p+j*n]=tmp;
+        }
+
+        for (int i=k+1; i<n; i++) {
+            double l=(lu[i+k*n]/=lu[k+k*n]);
+            for (int j=k+1; j<n; j++) lu[i+j*n]-=l*lu[k+j*n];
+        }
+    }
+
+    for (int c=0; c<nrhs; c++) {
+        double x[SMALLMATRIX_MAXSIZE];
+        for (int i=0; i<n; i++) x[i]=b[i+c*n];
+        for (int k=0; k<n; k++) if (perm[k]!=k) {
+            double tmp=x[k]; x[k]=x[perm[k]]; x[perm[k]]=tmp;
+        }
+
+        for (int i=1; i<n; i++) for (int j=0; j<i; j++) x[i]-=lu[i+j*n]*x[j];
+        for (int i=n-1; i>=0; i--) {
+            for (int j=i+1; j<n; j++) x[i]-=lu[i+j*n]*x[j];
+            x[i]/=lu[i+i*n];
+        }
+
+        memcpy(out+c*n, x, sizeof(double)*n);
+    }
+    return true;
+}
+
+/** Solves a.x = b for an n x n matrix a with n<=SMALLMATRIX_MAXSIZE and nrhs right hand sides
+ * @param[in] n - size of a
+ * @param[in] nrhs - number of columns of b
+ * @param[in] a - the matrix
+ * @param[in] b - right hand side
+ * @param[out] out - the solution; may be the same as b
+ * @returns false if a is singular to working precision */
+bool smallmatrix_solve(int n, int nrhs, double *a, double *b, double *out) {
+    switch (n) {
+        case 1: return smallmatrix_solvekernel(1, nrhs, a, b, out);
+        case 2: return smallmatrix_solvekernel(2, nrhs, a, b, out);
+        case 3: return smallmatrix_solvekernel(3, nrhs, a, b, out);
+        case 4: return smallmatrix_solvekernel(4, nrhs, a, b, out);
+    }
+    return false;
+}
+
+/* **********************************************************************
+ * Symmetric eigenproblem
+ * ********************************************************************** */
+
+#define SMALLMATRIX_JACOBIMAXSWEEPS 50
+
+/** Computes the eigenvalues and eigenvectors of a symmetric n x n matrix using cyclic Jacobi rotations.
+ * @param[in] n - size of a
+ * @param[in] a - the matrix, which is not modified
+ * @param[out] w - eigenvalues in ascending order
+ * @param[out] vec - (optional) corresponding orthonormal eigenvectors stored as columns */
+void smallmatrix_symmetriceigensystem(int n, double *a, double *w, double *vec) {
+    double s[SMALLMATRIX_MAXSIZE*SMALLMATRIX_MAXSIZE], v[SMALLMATRIX_MAXSIZE*SMALLMATRIX_MAXSIZE];
+    memcpy(s, a, sizeof(double)*n*n);
+    for (int i=0; i<n*n; i++) v[i]=0.0;
+    for (int i=0; i<n; i++) v[i+i*n]=1.0;
+
+    for (int sweep=0; sweep<SMALLMATRIX_JACOBIMAXSWEEPS; sweep++) {
+        double off=0.0, diag=0.0;
+        for (int q=0; q<n; q++) {
+            diag+=s[q+q*n]*s[q+q*n];
+            for (int p=0; p<q; p++) off+=s[p+q*n]*s[p+q*n];
+        }
+        if (off==0.0 || off<=1e-32*diag) break;
+
+        for (int p=0; p<n-1; p++) {
+            for (int q=p+1; q<n; q++) {
+                double apq=s[p+q*n];
+                if (apq==0.0) continue;
+
+                /* Rotation angle that annihilates element (p,q) */
+                double theta=(s[q+q*n]-s[p+p*n])/(2.0*apq);
+                double t=(theta>=0 ? 1.0 : -1.0)/(fabs(theta)+sqrt(theta*theta+1.0));
+                double c=1.0/sqrt(t*t+1.0), sn=t*c;
+
+                for (int k=0; k<n; k++) { // Columns p and q
+                    double skp=s[k+p*n], skq=s[k+q*n];
+                    s[k+p*n]=c*skp-sn*skq;
+                    s[k+q*n]=sn*skp+c*skq;
+                }
+                for (int k=0; k<n; k++) { // Rows p and q
+                    double spk=s[p+k*n], sqk=s[q+k*n];
+                    s[p+k*n]=c*spk-sn*sqk;
+                    s[q+k*n]=sn*spk+c*sqk;
+                }
+                for (int k=0; k<n; k++) { // Accumulate eigenvectors
+                    double vkp=v[k+p*n], vkq=v[k+q*n];
+                    v[k+p*n]=c*vkp-sn*vkq;
+                    v[k+q*n]=sn*vkp+c*vkq;
+                }
+            }
+        }
+    }
+
+    /* Sort eigenvalues in ascending order, carrying the eigenvectors along */
+    int order[SMALLMATRIX_MAXSIZE];
+    for (int i=0; i<n; i++) order[i]=i;
+    for (int i=1; i<n; i++) {
+        for (int j=i; j>0 && s[order[j]*(n+1)]<s[order[j-1]*(n+1)]; j--) {
+            int tmp=order[j]; order[j]=order[j-1]; order[j-1]=tmp;
+        }
+    }
+
+    for (int i=0; i<n; i++) {
+        w[i]=s[order[i]*(n+1)];
+        if (vec) memcpy(vec+i*n, v+order[i]*n, sizeof(double)*n);
+    }
+}
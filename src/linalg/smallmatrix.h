@@ -0,0 +1,30 @@
+/** @file smallmatrix.h
+ *  @author T J Atherton
+ *
+ *  @brief Closed form kernels for matrices of size up to 4x4
+ */
+
+#ifndef smallmatrix_h
+#define smallmatrix_h
+
+#include <stdbool.h>
+
+/* -------------------------------------------------------
+ * Small matrix kernels
+ * ------------------------------------------------------- */
+
+/** For small matrices, the overhead of calling BLAS or LAPACK dominates the cost of the calculation.
+    These kernels operate directly on column-major arrays of doubles and are used by the matrix class
+    whenever all dimensions are at most SMALLMATRIX_MAXSIZE. */
+#define SMALLMATRIX_MAXSIZE 4
+
+/** Tests whether a dimension can be handled by the small matrix kernels */
+#define SMALLMATRIX_ISSMALL(n) ((n)>0 && (n)<=SMALLMATRIX_MAXSIZE)
+
+double smallmatrix_det(int n, double *a);
+bool smallmatrix_inverse(int n, double *a, double *out);
+void smallmatrix_mul(int m, int k, int n, double *a, double *b, double *out);
+bool smallmatrix_solve(int n, int nrhs, double *a, double *b, double *out);
+void smallmatrix_symmetriceigensystem(int n, double *a, double *w, double *vec);
+
+#endif /* smallmatrix_h */
@@ -12,6 +12,7 @@
 
 #include "sparse.h"
 #include "matrix.h"
+#include "matrixio.h"
 
 /* ***************************************
  * Compatibility with Sparse libraries
@@ -1201,6 +1202,9 @@ value sparse_constructor(vm *v, int nargs, value *args) {
         objectsparseerror err = object_sparsefromlist(MORPHO_GETLIST(MORPHO_GETARG(args, 0)), &new);
 
         if (!new) sparse_raiseerror(v, err);
+    } else if (nargs==1 &&
+               MORPHO_ISSTRING(MORPHO_GETARG(args, 0))) {
+        new=sparse_loadfile(v, MORPHO_GETCSTRING(MORPHO_GETARG(args, 0)));
     } else if (nargs==0) {
         new = object_newsparse(NULL, NULL);
     } else {
@@ -1487,6 +1491,21 @@ value Sparse_clone(vm *v, int nargs, value *args) {
     return out;
 }
 
+/** Saves a sparse matrix to a file */
+value Sparse_save(vm *v, int nargs, value *args) {
+    objectsparse *s=MORPHO_GETSPARSE(MORPHO_SELF(args));
+
+    if ((nargs==1 || nargs==2) && MORPHO_ISSTRING(MORPHO_GETARG(args, 0))) {
+        size_t oldsize=sparse_size(s);
+        if (sparse_checkformat(s, SPARSE_CCS, true, true)) {
+            morpho_resizeobject(v, (object *) s, oldsize, sparse_size(s));
+            sparse_save(v, s, MORPHO_GETCSTRING(MORPHO_GETARG(args, 0)), (nargs==2 ? MORPHO_GETARG(args, 1) : MORPHO_NIL));
+        } else morpho_runtimeerror(v, SPARSE_CONVFAILEDERR);
+    } else morpho_runtimeerror(v, MATRIXIO_SAVEARGS);
+
+    return MORPHO_NIL;
+}
+
 /** Count number of elements */
 value Sparse_count(vm *v, int nargs, value *args) {
     objectsparse *s=MORPHO_GETSPARSE(MORPHO_SELF(args));
@@ -1658,6 +1677,7 @@ MORPHO_METHOD(SPARSE_ROWINDICES_METHOD, Sparse_rowindices, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(SPARSE_SETROWINDICES_METHOD, Sparse_setrowindices, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(SPARSE_COLINDICES_METHOD, Sparse_colindices, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_CLONE_METHOD, Sparse_clone, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MORPHO_SAVE_METHOD, Sparse_save, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(SPARSE_INDICES_METHOD, Sparse_indices, BUILTIN_FLAGSEMPTY)
 MORPHO_ENDCLASS
 
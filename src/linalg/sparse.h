@@ -161,6 +161,7 @@ typedef enum { SPARSE_OK, SPARSE_INCMPTBLDIM, SPARSE_INVLDINIT, SPARSE_CONVFAILE
 void sparse_raiseerror(vm *v, objectsparseerror err);
 
 bool sparse_checkformat(objectsparse *sparse, objectsparseformat format, bool force, bool copyvals);
+void sparse_removeformat(objectsparse *s, objectsparseformat format);
 
 objectsparseerror sparse_tomatrix(objectsparse *in, objectmatrix **out);
 objectsparse *sparse_clone(objectsparse *s);
@@ -6,6 +6,7 @@
 
 #include <ctype.h>
 #include "build.h"
+#include "morpho.h"
 #include "threadpool.h"
 
 /* **********************************************************************
@@ -26,10 +27,14 @@ int morpho_threadnumber(void) {
 
 DEFINE_VARRAY(task, task);
 
+/** Set in each worker thread, so that work submitted from within a task can be detected */
+static __thread bool threadpool_inworker = false;
+
 /* Worker thread */
 void *threadpool_worker(void *ref) {
     threadpool *pool = (threadpool *) ref;
     task t = { .func = NULL, .arg = NULL };
+    threadpool_inworker = true;
 
     while (true) {
         /* Await a task */
@@ -127,6 +132,35 @@ void threadpool_fence(threadpool *pool) {
     pthread_mutex_unlock(&pool->lock_mutex);
 }
 
+/* **********************************************************************
+* Shared thread pool
+* ********************************************************************** */
+
+static threadpool threadpool_sharedpool;
+static bool threadpool_sharedinitialized = false;
+static pthread_once_t threadpool_sharedonce = PTHREAD_ONCE_INIT;
+
+static void threadpool_sharedfinalize(void) {
+    if (threadpool_sharedinitialized) threadpool_clear(&threadpool_sharedpool);
+    threadpool_sharedinitialized = false;
+}
+
+static void threadpool_sharedinitialize(void) {
+    threadpool_sharedinitialized = threadpool_init(&threadpool_sharedpool, morpho_threadnumber());
+    if (threadpool_sharedinitialized) morpho_addfinalizefn(threadpool_sharedfinalize);
+}
+
+/** Returns the process-wide thread pool, creating it with morpho_threadnumber() workers on first use.
+ *  All parallel work in morpho should go through this pool rather than creating its own threads.
+ * @returns the pool, or NULL if it could not be created or if called from within a task running on a
+ *          worker thread; since a fence would then wait on the calling task itself, callers should
+ *          instead perform the work serially. */
+threadpool *threadpool_shared(void) {
+    if (threadpool_inworker) return NULL;
+    pthread_once(&threadpool_sharedonce, threadpool_sharedinitialize);
+    return (threadpool_sharedinitialized ? &threadpool_sharedpool : NULL);
+}
+
 /*
 bool worker(void *arg) {
     int *val = arg;
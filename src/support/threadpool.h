@@ -49,4 +49,6 @@ bool threadpool_add_task(threadpool *pool, workfn func, void *arg);
 void threadpool_fence(threadpool *pool);
 void threadpool_wait(threadpool *pool);
 
+threadpool *threadpool_shared(void);
+
 #endif /* threadpool_h */